@@ -0,0 +1,130 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NEO4J_BENCH_H
+#define NEO4J_BENCH_H
+
+#include "../src/lib/neo4j-client.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Benchmark results are written to stdout, one JSON object per line, so
+ * that runs can be collected and compared across versions.
+ */
+
+#define BENCH_RESULT_PREFIX \
+    "{\"version\":\"%s\",\"benchmark\":\"%s\",\"case\":\"%s\","
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+
+static inline unsigned int bench_iterations(int argc, char *argv[],
+        unsigned int dflt)
+{
+    if (argc < 2)
+    {
+        return dflt;
+    }
+    unsigned long n = strtoul(argv[1], NULL, 10);
+    return (n > 0 && n < UINT32_MAX)? (unsigned int)n : dflt;
+}
+
+
+static inline int bench_compare_ns(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * Report the distribution of a set of latency samples.
+ *
+ * The samples are sorted in place.
+ */
+static inline void bench_report_latency(const char *benchmark,
+        const char *name, uint64_t *samples, unsigned int n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+    qsort(samples, n, sizeof(uint64_t), bench_compare_ns);
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        total += samples[i];
+    }
+    printf(BENCH_RESULT_PREFIX "\"iterations\":%u,"
+            "\"mean_ns\":%" PRIu64 ",\"p50_ns\":%" PRIu64
+            ",\"p99_ns\":%" PRIu64 ",\"max_ns\":%" PRIu64 "}\n",
+            libneo4j_client_version(), benchmark, name, n, total / n,
+            samples[n / 2], samples[((uint64_t)n * 99) / 100],
+            samples[n - 1]);
+    fflush(stdout);
+}
+
+
+/**
+ * Report the rate of an operation that transfers a fixed number of bytes.
+ */
+static inline void bench_report_throughput(const char *benchmark,
+        const char *name, uint64_t iterations, uint64_t elapsed_ns,
+        size_t bytes_per_op)
+{
+    if (iterations == 0 || elapsed_ns == 0)
+    {
+        return;
+    }
+    double seconds = (double)elapsed_ns / 1e9;
+    printf(BENCH_RESULT_PREFIX "\"iterations\":%" PRIu64
+            ",\"ns_per_op\":%.1f,\"mb_per_s\":%.1f}\n",
+            libneo4j_client_version(), benchmark, name, iterations,
+            (double)elapsed_ns / iterations,
+            ((double)iterations * bytes_per_op) / (1024 * 1024) / seconds);
+    fflush(stdout);
+}
+
+
+/**
+ * Report the rate of an operation of no fixed size.
+ */
+static inline void bench_report_rate(const char *benchmark,
+        const char *name, uint64_t iterations, uint64_t elapsed_ns)
+{
+    if (iterations == 0 || elapsed_ns == 0)
+    {
+        return;
+    }
+    printf(BENCH_RESULT_PREFIX "\"iterations\":%" PRIu64
+            ",\"ns_per_op\":%.1f,\"ops_per_s\":%.0f}\n",
+            libneo4j_client_version(), benchmark, name, iterations,
+            (double)elapsed_ns / iterations,
+            (double)iterations * 1e9 / elapsed_ns);
+    fflush(stdout);
+}
+
+#endif/*NEO4J_BENCH_H*/
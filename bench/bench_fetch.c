@@ -0,0 +1,148 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures the rate at which rows are fetched through the whole client
+ * stack, from the socket to neo4j_fetch_next, against the Bolt stand-in
+ * server streaming synthetic results.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "../tests/bolt_server.h"
+#include "../src/lib/neo4j-client.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define DEFAULT_ROWS 1000000
+
+
+static const struct bolt_server_result results[] =
+    { { .statement = "ints", .columns = "n:int", .nrows = 0 },
+      { .statement = "mixed",
+        .columns = "id:int,name:string,score:float,flag:bool,tags:list",
+        .nrows = 0 },
+      { .statement = "nodes", .columns = "n:node,props:map", .nrows = 0 } };
+#define NRESULTS (sizeof(results) / sizeof(results[0]))
+
+
+static int bench_fetch(neo4j_session_t *session, const char *statement,
+        unsigned long long nrows)
+{
+    uint64_t start = bench_now_ns();
+    neo4j_result_stream_t *stream = neo4j_run(session, statement, neo4j_null);
+    if (stream == NULL)
+    {
+        neo4j_perror(stderr, errno, "neo4j_run");
+        return -1;
+    }
+    unsigned long long n = 0;
+    while (neo4j_fetch_next(stream) != NULL)
+    {
+        ++n;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    int err = neo4j_check_failure(stream);
+    if (neo4j_close_results(stream) || err)
+    {
+        neo4j_perror(stderr, err? err : errno, statement);
+        return -1;
+    }
+    if (n != nrows)
+    {
+        fprintf(stderr, "%s: expected %llu rows, got %llu\n",
+                statement, nrows, n);
+        return -1;
+    }
+    bench_report_rate("fetch_rows", statement, n, elapsed);
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int nrows = bench_iterations(argc, argv, DEFAULT_ROWS);
+
+    neo4j_client_init();
+
+    neo4j_config_t *config = neo4j_new_config();
+    if (config == NULL || neo4j_config_set_username(config, "bench") ||
+            neo4j_config_set_password(config, "bench"))
+    {
+        neo4j_perror(stderr, errno, "neo4j_new_config");
+        return EXIT_FAILURE;
+    }
+
+    struct bolt_server_result scripted[NRESULTS];
+    memcpy(scripted, results, sizeof(results));
+    for (unsigned int i = 0; i < NRESULTS; ++i)
+    {
+        scripted[i].nrows = nrows;
+    }
+    struct bolt_server_script script =
+        { .results = scripted, .nresults = NRESULTS };
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/neo4j-bench.%d.sock", (int)getpid());
+    struct bolt_server server;
+    if (bolt_server_start_unix(&server, path, &script))
+    {
+        neo4j_perror(stderr, errno, "bolt_server_start_unix");
+        return EXIT_FAILURE;
+    }
+
+    char uri[96];
+    snprintf(uri, sizeof(uri), "bolt+unix://%s", path);
+
+    int result = EXIT_FAILURE;
+    neo4j_session_t *session = NULL;
+    neo4j_connection_t *connection =
+        neo4j_connect(uri, config, NEO4J_INSECURE);
+    if (connection == NULL)
+    {
+        neo4j_perror(stderr, errno, uri);
+        goto cleanup;
+    }
+    session = neo4j_new_session(connection);
+    if (session == NULL)
+    {
+        neo4j_perror(stderr, errno, "neo4j_new_session");
+        goto cleanup;
+    }
+
+    for (unsigned int i = 0; i < NRESULTS; ++i)
+    {
+        if (bench_fetch(session, results[i].statement, nrows))
+        {
+            goto cleanup;
+        }
+    }
+    result = EXIT_SUCCESS;
+
+cleanup:
+    if (session != NULL)
+    {
+        neo4j_end_session(session);
+    }
+    if (connection != NULL)
+    {
+        neo4j_close(connection);
+    }
+    bolt_server_stop(&server);
+    neo4j_config_free(config);
+    neo4j_client_cleanup();
+    return result;
+}
@@ -0,0 +1,283 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures the chunking and buffering iostreams, and the ring buffer
+ * beneath them, using in-memory streams.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "../tests/memiostream.h"
+#include "../src/lib/buffering_iostream.h"
+#include "../src/lib/chunking_iostream.h"
+#include <errno.h>
+#include <string.h>
+
+#define DEFAULT_ITERATIONS 20000
+#define MESSAGE_SIZE 65536
+#define BUFFER_SIZE (4 * MESSAGE_SIZE)
+#define SMALL_IO_SIZE 16
+#define SND_MIN_CHUNK 1024
+#define PIECE_SIZE 4096
+
+
+static uint8_t message[MESSAGE_SIZE];
+static uint8_t scratch[MESSAGE_SIZE];
+
+
+static int write_message(neo4j_iostream_t *ios)
+{
+    // written in pieces, as values are by the serializer
+    for (size_t off = 0; off < MESSAGE_SIZE; off += PIECE_SIZE)
+    {
+        if (neo4j_ios_write_all(ios, message + off, PIECE_SIZE, NULL))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+static int bench_chunking(uint16_t chunk_size, unsigned int iterations,
+        ring_buffer_t *rb, neo4j_iostream_t *ios)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "chunk_%u", chunk_size);
+    // buffer small writes as the connection does, never beyond one chunk
+    uint8_t buffer[SND_MIN_CHUNK];
+    uint16_t bsize = (chunk_size < SND_MIN_CHUNK)? chunk_size : SND_MIN_CHUNK;
+
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        struct neo4j_chunking_iostream chunking_ios;
+        neo4j_iostream_t *cios = neo4j_chunking_iostream_init(&chunking_ios,
+                ios, buffer, bsize, chunk_size);
+        if (write_message(cios) ||
+                neo4j_ios_close(cios))
+        {
+            return -1;
+        }
+        rb_clear(rb);
+    }
+    bench_report_throughput("chunking_write", name, iterations,
+            bench_now_ns() - start, MESSAGE_SIZE);
+
+    // keep one chunked message, to be read repeatedly
+    struct neo4j_chunking_iostream chunking_ios;
+    neo4j_iostream_t *cios = neo4j_chunking_iostream_init(&chunking_ios,
+            ios, buffer, bsize, chunk_size);
+    if (write_message(cios) ||
+            neo4j_ios_close(cios))
+    {
+        return -1;
+    }
+    static uint8_t encoded[BUFFER_SIZE];
+    size_t nbytes = rb_extract(rb, encoded, sizeof(encoded));
+
+    start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        rb_append(rb, encoded, nbytes);
+        cios = neo4j_chunking_iostream_init(&chunking_ios,
+                ios, NULL, 0, UINT16_MAX);
+        if (neo4j_ios_read_all(cios, scratch, MESSAGE_SIZE, NULL) ||
+                neo4j_ios_close(cios))
+        {
+            return -1;
+        }
+        rb_clear(rb);
+    }
+    bench_report_throughput("chunking_read", name, iterations,
+            bench_now_ns() - start, MESSAGE_SIZE);
+    return 0;
+}
+
+
+static int bench_buffering(size_t buffer_size, unsigned int iterations,
+        ring_buffer_t *rb)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "buffer_%zu", buffer_size);
+    neo4j_iostream_t *ios = neo4j_loopback_iostream(rb);
+    if (ios == NULL)
+    {
+        return -1;
+    }
+    neo4j_iostream_t *bios = neo4j_buffering_iostream(ios, true,
+            buffer_size, buffer_size);
+    if (bios == NULL)
+    {
+        int errsv = errno;
+        neo4j_ios_close(ios);
+        errno = errsv;
+        return -1;
+    }
+
+    // many small writes, as made when serializing values
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        for (size_t off = 0; off < MESSAGE_SIZE; off += SMALL_IO_SIZE)
+        {
+            if (neo4j_ios_write_all(bios, message + off, SMALL_IO_SIZE, NULL))
+            {
+                goto failure;
+            }
+        }
+        if (neo4j_ios_flush(bios))
+        {
+            goto failure;
+        }
+        rb_clear(rb);
+    }
+    bench_report_throughput("buffering_write", name, iterations,
+            bench_now_ns() - start, MESSAGE_SIZE);
+
+    // and many small reads, as made when deserializing
+    start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        rb_append(rb, message, MESSAGE_SIZE);
+        for (size_t off = 0; off < MESSAGE_SIZE; off += SMALL_IO_SIZE)
+        {
+            if (neo4j_ios_read_all(bios, scratch + off, SMALL_IO_SIZE, NULL))
+            {
+                goto failure;
+            }
+        }
+    }
+    bench_report_throughput("buffering_read", name, iterations,
+            bench_now_ns() - start, MESSAGE_SIZE);
+
+    return neo4j_ios_close(bios);
+
+    int errsv;
+failure:
+    errsv = errno;
+    neo4j_ios_close(bios);
+    errno = errsv;
+    return -1;
+}
+
+
+static int bench_ring_buffer(size_t io_size, unsigned int iterations,
+        ring_buffer_t *rb)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "io_%zu", io_size);
+
+    // starting part way in, so that transfers wrap around the buffer end
+    rb_clear(rb);
+    rb_append(rb, message, io_size / 2 + 1);
+    rb_discard(rb, io_size / 2 + 1);
+
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        for (size_t off = 0; off < MESSAGE_SIZE; off += io_size)
+        {
+            rb_append(rb, message + off, io_size);
+            rb_extract(rb, scratch + off, io_size);
+        }
+    }
+    bench_report_throughput("ring_buffer", name, iterations,
+            bench_now_ns() - start, MESSAGE_SIZE);
+
+    struct iovec iov[4];
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        iov[i].iov_len = io_size / 4;
+    }
+    start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        for (size_t off = 0; off < MESSAGE_SIZE; off += io_size)
+        {
+            for (unsigned int j = 0; j < 4; ++j)
+            {
+                iov[j].iov_base = message + off + j * (io_size / 4);
+            }
+            rb_appendv(rb, iov, 4);
+            for (unsigned int j = 0; j < 4; ++j)
+            {
+                iov[j].iov_base = scratch + off + j * (io_size / 4);
+            }
+            rb_extractv(rb, iov, 4);
+        }
+    }
+    bench_report_throughput("ring_buffer_vectored", name, iterations,
+            bench_now_ns() - start, MESSAGE_SIZE);
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = bench_iterations(argc, argv, DEFAULT_ITERATIONS);
+
+    for (size_t i = 0; i < MESSAGE_SIZE; ++i)
+    {
+        message[i] = (uint8_t)i;
+    }
+
+    ring_buffer_t *rb = rb_alloc(BUFFER_SIZE);
+    neo4j_iostream_t *ios = (rb != NULL)? neo4j_loopback_iostream(rb) : NULL;
+    if (ios == NULL)
+    {
+        neo4j_perror(stderr, errno, "neo4j_loopback_iostream");
+        return EXIT_FAILURE;
+    }
+
+    static const uint16_t chunk_sizes[] = { 64, 1024, 8192, 65535 };
+    static const size_t buffer_sizes[] = { 1024, 4096, 16384 };
+    static const size_t io_sizes[] = { 16, 256, 4096 };
+
+    int result = EXIT_FAILURE;
+    for (unsigned int i = 0; i < sizeof(chunk_sizes) / sizeof(uint16_t); ++i)
+    {
+        if (bench_chunking(chunk_sizes[i], iterations, rb, ios))
+        {
+            neo4j_perror(stderr, errno, "chunking");
+            goto cleanup;
+        }
+    }
+    // small operations are many times slower, so fewer are made
+    unsigned int small_iterations = (iterations + 9) / 10;
+    for (unsigned int i = 0; i < sizeof(buffer_sizes) / sizeof(size_t); ++i)
+    {
+        if (bench_buffering(buffer_sizes[i], small_iterations, rb))
+        {
+            neo4j_perror(stderr, errno, "buffering");
+            goto cleanup;
+        }
+    }
+    for (unsigned int i = 0; i < sizeof(io_sizes) / sizeof(size_t); ++i)
+    {
+        if (bench_ring_buffer(io_sizes[i], small_iterations, rb))
+        {
+            neo4j_perror(stderr, errno, "ring_buffer");
+            goto cleanup;
+        }
+    }
+    result = EXIT_SUCCESS;
+
+cleanup:
+    neo4j_ios_close(ios);
+    rb_free(rb);
+    return result;
+}
@@ -0,0 +1,150 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures memory pool allocation and draining, in the patterns used by
+ * the client: many allocations released together, and allocations per
+ * record released back to a mark.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "../src/lib/memory.h"
+#include <errno.h>
+
+#define DEFAULT_ITERATIONS 2000
+#define ALLOCATIONS 1024
+#define RECORD_ALLOCATIONS 8
+#define ALLOCATION_SIZE 48
+
+
+static int bench_flat(unsigned int block_size, unsigned int iterations)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "flat_block_%u", block_size);
+    neo4j_mpool_t mpool = neo4j_mpool(&neo4j_std_memory_allocator,
+            block_size);
+
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        for (unsigned int j = 0; j < ALLOCATIONS; ++j)
+        {
+            if (neo4j_mpool_alloc(&mpool, ALLOCATION_SIZE) == NULL)
+            {
+                neo4j_mpool_drain(&mpool);
+                return -1;
+            }
+        }
+        neo4j_mpool_drain(&mpool);
+    }
+    bench_report_rate("mpool_alloc", name,
+            (uint64_t)iterations * ALLOCATIONS, bench_now_ns() - start);
+    return 0;
+}
+
+
+static int bench_nested(unsigned int block_size, unsigned int iterations)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "per_record_block_%u", block_size);
+    neo4j_mpool_t mpool = neo4j_mpool(&neo4j_std_memory_allocator,
+            block_size);
+
+    // a few long lived allocations beneath those released per record
+    for (unsigned int j = 0; j < RECORD_ALLOCATIONS; ++j)
+    {
+        if (neo4j_mpool_alloc(&mpool, ALLOCATION_SIZE) == NULL)
+        {
+            neo4j_mpool_drain(&mpool);
+            return -1;
+        }
+    }
+
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        for (unsigned int r = 0; r < ALLOCATIONS / RECORD_ALLOCATIONS; ++r)
+        {
+            size_t depth = neo4j_mpool_depth(mpool);
+            for (unsigned int j = 0; j < RECORD_ALLOCATIONS; ++j)
+            {
+                if (neo4j_mpool_alloc(&mpool, ALLOCATION_SIZE) == NULL)
+                {
+                    neo4j_mpool_drain(&mpool);
+                    return -1;
+                }
+            }
+            neo4j_mpool_drainto(&mpool, depth);
+        }
+    }
+    bench_report_rate("mpool_alloc", name,
+            (uint64_t)iterations * ALLOCATIONS, bench_now_ns() - start);
+    neo4j_mpool_drain(&mpool);
+    return 0;
+}
+
+
+static int bench_merge(unsigned int iterations)
+{
+    neo4j_mpool_t mpool = neo4j_mpool(&neo4j_std_memory_allocator, 128);
+
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        neo4j_mpool_t record_pool =
+            neo4j_mpool(&neo4j_std_memory_allocator, 128);
+        for (unsigned int j = 0; j < ALLOCATIONS; ++j)
+        {
+            if (neo4j_mpool_alloc(&record_pool, ALLOCATION_SIZE) == NULL ||
+                    (j % RECORD_ALLOCATIONS == RECORD_ALLOCATIONS - 1 &&
+                     neo4j_mpool_merge(&mpool, &record_pool) < 0))
+            {
+                neo4j_mpool_drain(&record_pool);
+                neo4j_mpool_drain(&mpool);
+                return -1;
+            }
+        }
+        neo4j_mpool_drain(&record_pool);
+        neo4j_mpool_drain(&mpool);
+    }
+    bench_report_rate("mpool_alloc", "merged_records",
+            (uint64_t)iterations * ALLOCATIONS, bench_now_ns() - start);
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = bench_iterations(argc, argv, DEFAULT_ITERATIONS);
+
+    static const unsigned int block_sizes[] = { 16, 128, 1024 };
+    for (unsigned int i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]);
+            ++i)
+    {
+        if (bench_flat(block_sizes[i], iterations) ||
+                bench_nested(block_sizes[i], iterations))
+        {
+            neo4j_perror(stderr, errno, "neo4j_mpool_alloc");
+            return EXIT_FAILURE;
+        }
+    }
+    if (bench_merge(iterations))
+    {
+        neo4j_perror(stderr, errno, "neo4j_mpool_merge");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures rendering results as a table and as CSV.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "../tests/canned_result_stream.h"
+#include <errno.h>
+
+#define DEFAULT_ITERATIONS 200
+#define NROWS 1000
+#define NFIELDS 4
+
+
+typedef int (*render_fn)(FILE *stream, neo4j_result_stream_t *results,
+        uint_fast32_t flags);
+
+
+static int render_table(FILE *stream, neo4j_result_stream_t *results,
+        uint_fast32_t flags)
+{
+    return neo4j_render_table(stream, results, 120, flags);
+}
+
+
+static int bench_render(const char *name, render_fn render,
+        uint_fast32_t flags, FILE *out, const neo4j_value_t *records,
+        unsigned int iterations)
+{
+    static const char * const fieldnames[NFIELDS] =
+        { "id", "name", "score", "tags" };
+
+    uint64_t elapsed = 0;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        neo4j_result_stream_t *results = neo4j_canned_result_stream(
+                fieldnames, NFIELDS, records, NROWS);
+        if (results == NULL)
+        {
+            return -1;
+        }
+        uint64_t start = bench_now_ns();
+        int err = render(out, results, flags);
+        elapsed += bench_now_ns() - start;
+        neo4j_close_results(results);
+        if (err)
+        {
+            return -1;
+        }
+    }
+    bench_report_rate("render", name, (uint64_t)iterations * NROWS, elapsed);
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = bench_iterations(argc, argv, DEFAULT_ITERATIONS);
+
+    static char names[NROWS][16];
+    static neo4j_value_t tags[3];
+    static neo4j_value_t fields[NROWS][NFIELDS];
+    static neo4j_value_t records[NROWS];
+    tags[0] = neo4j_string("red");
+    tags[1] = neo4j_string("green");
+    tags[2] = neo4j_string("blue");
+    for (unsigned int i = 0; i < NROWS; ++i)
+    {
+        snprintf(names[i], sizeof(names[i]), "name-%u", i);
+        fields[i][0] = neo4j_int(i);
+        fields[i][1] = neo4j_string(names[i]);
+        fields[i][2] = neo4j_float(i / 3.0);
+        fields[i][3] = neo4j_list(tags, 3);
+        records[i] = neo4j_list(fields[i], NFIELDS);
+    }
+
+    FILE *out = fopen("/dev/null", "w");
+    if (out == NULL)
+    {
+        neo4j_perror(stderr, errno, "/dev/null");
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    if (bench_render("table", render_table, NEO4J_RENDER_DEFAULT, out,
+                records, iterations) ||
+        bench_render("table_quoted", render_table, NEO4J_RENDER_QUOTE_STRINGS,
+                out, records, iterations) ||
+        bench_render("csv", neo4j_render_csv, NEO4J_RENDER_DEFAULT, out,
+                records, iterations))
+    {
+        neo4j_perror(stderr, errno, "render");
+        result = EXIT_FAILURE;
+    }
+    fclose(out);
+    return result;
+}
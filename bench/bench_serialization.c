@@ -0,0 +1,173 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures neo4j_serialize and neo4j_deserialize for each value type and
+ * for a few nesting shapes, using an in-memory stream.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "../tests/memiostream.h"
+#include "../src/lib/deserialization.h"
+#include "../src/lib/memory.h"
+#include "../src/lib/serialization.h"
+#include "../src/lib/values.h"
+#include <errno.h>
+#include <string.h>
+
+#define DEFAULT_ITERATIONS 200000
+#define BUFFER_SIZE 65536
+
+
+struct value_case
+{
+    const char *name;
+    neo4j_value_t value;
+};
+
+
+static int bench_serialize(const struct value_case *c,
+        unsigned int iterations, ring_buffer_t *rb, neo4j_iostream_t *ios)
+{
+    rb_clear(rb);
+    if (neo4j_serialize(c->value, ios))
+    {
+        return -1;
+    }
+    size_t nbytes = rb_used(rb);
+    rb_clear(rb);
+
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        if (neo4j_serialize(c->value, ios))
+        {
+            return -1;
+        }
+        rb_clear(rb);
+    }
+    bench_report_throughput("serialize", c->name, iterations,
+            bench_now_ns() - start, nbytes);
+    return 0;
+}
+
+
+static int bench_deserialize(const struct value_case *c,
+        unsigned int iterations, ring_buffer_t *rb, neo4j_iostream_t *ios)
+{
+    static uint8_t encoded[BUFFER_SIZE];
+    rb_clear(rb);
+    if (neo4j_serialize(c->value, ios))
+    {
+        return -1;
+    }
+    size_t nbytes = rb_extract(rb, encoded, sizeof(encoded));
+
+    neo4j_mpool_t mpool = neo4j_mpool(&neo4j_std_memory_allocator, 128);
+    // the cost of refilling the stream is included, but is small next to
+    // decoding and the same for every case of a given size
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        rb_append(rb, encoded, nbytes);
+        neo4j_value_t value;
+        if (neo4j_deserialize(ios, &mpool, &value))
+        {
+            return -1;
+        }
+        neo4j_mpool_drain(&mpool);
+    }
+    bench_report_throughput("deserialize", c->name, iterations,
+            bench_now_ns() - start, nbytes);
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = bench_iterations(argc, argv, DEFAULT_ITERATIONS);
+
+    static char long_string[1024];
+    memset(long_string, 'x', sizeof(long_string));
+
+    neo4j_value_t ints[16];
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        ints[i] = neo4j_int(i * 1000);
+    }
+
+    static const char *keys[8] =
+        { "id", "name", "age", "email", "city", "score", "active", "tag" };
+    neo4j_map_entry_t entries[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        entries[i] = neo4j_map_entry(keys[i], neo4j_int(i));
+    }
+
+    // a list of maps, each holding a list
+    neo4j_map_entry_t row_entries[8][2];
+    neo4j_value_t rows[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        row_entries[i][0] = neo4j_map_entry("id", neo4j_int(i));
+        row_entries[i][1] = neo4j_map_entry("values", neo4j_list(ints, 4));
+        rows[i] = neo4j_map(row_entries[i], 2);
+    }
+
+    neo4j_value_t label = neo4j_string("Person");
+    neo4j_map_entry_t props[2] =
+        { neo4j_map_entry("name", neo4j_string("Alice")),
+          neo4j_map_entry("age", neo4j_int(42)) };
+    neo4j_value_t node_fields[3] =
+        { neo4j_int(1234), neo4j_list(&label, 1), neo4j_map(props, 2) };
+
+    const struct value_case cases[] =
+        { { "null", neo4j_null },
+          { "bool", neo4j_bool(true) },
+          { "int_tiny", neo4j_int(7) },
+          { "int_64", neo4j_int(1LL << 40) },
+          { "float", neo4j_float(3.14159) },
+          { "string_short", neo4j_string("hello world") },
+          { "string_1k", neo4j_ustring(long_string, sizeof(long_string)) },
+          { "list_16_ints", neo4j_list(ints, 16) },
+          { "map_8_entries", neo4j_map(entries, 8) },
+          { "list_of_maps", neo4j_list(rows, 8) },
+          { "node", neo4j_struct(NEO4J_NODE_SIGNATURE, node_fields, 3) } };
+
+    ring_buffer_t *rb = rb_alloc(BUFFER_SIZE);
+    neo4j_iostream_t *ios = (rb != NULL)? neo4j_loopback_iostream(rb) : NULL;
+    if (ios == NULL)
+    {
+        neo4j_perror(stderr, errno, "neo4j_loopback_iostream");
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    for (unsigned int i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        if (bench_serialize(&(cases[i]), iterations, rb, ios) ||
+                bench_deserialize(&(cases[i]), iterations, rb, ios))
+        {
+            neo4j_perror(stderr, errno, cases[i].name);
+            result = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    neo4j_ios_close(ios);
+    rb_free(rb);
+    return result;
+}
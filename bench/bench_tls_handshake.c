@@ -0,0 +1,125 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures the latency of establishing a TLS connection through
+ * neo4j_openssl_iostream, against a local stand-in server that either
+ * permits or refuses session resumption.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "tls_server.h"
+#include <errno.h>
+
+#define DEFAULT_ITERATIONS 200
+
+
+static int run(const char *name, const struct tls_server *server,
+        const neo4j_config_t *config, unsigned int iterations)
+{
+    uint64_t *samples = calloc(iterations, sizeof(uint64_t));
+    if (samples == NULL)
+    {
+        return -1;
+    }
+
+    // the first connection primes the client session cache
+    int result = -1;
+    neo4j_iostream_t *ios = tls_server_connect(server, config);
+    if (ios == NULL || neo4j_ios_close(ios))
+    {
+        goto cleanup;
+    }
+
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        uint64_t start = bench_now_ns();
+        ios = tls_server_connect(server, config);
+        if (ios == NULL)
+        {
+            goto cleanup;
+        }
+        samples[i] = bench_now_ns() - start;
+        if (neo4j_ios_close(ios))
+        {
+            goto cleanup;
+        }
+    }
+
+    bench_report_latency("tls_handshake", name, samples, iterations);
+    result = 0;
+
+cleanup:
+    free(samples);
+    return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = bench_iterations(argc, argv, DEFAULT_ITERATIONS);
+
+    neo4j_client_init();
+
+    struct tls_credentials creds;
+    if (tls_credentials_init(&creds))
+    {
+        neo4j_perror(stderr, errno, "tls_credentials_init");
+        return 1;
+    }
+
+    int result = 1;
+    neo4j_config_t *config = neo4j_new_config();
+    if (config == NULL ||
+            neo4j_config_set_TLS_ca_file(config, creds.ca_file))
+    {
+        neo4j_perror(stderr, errno, "neo4j_new_config");
+        goto cleanup;
+    }
+
+    struct tls_server full;
+    struct tls_server resumed;
+    if (tls_server_start(&full, &creds, false, tls_drain_handler))
+    {
+        neo4j_perror(stderr, errno, "tls_server_start");
+        goto cleanup;
+    }
+    if (tls_server_start(&resumed, &creds, true, tls_drain_handler))
+    {
+        neo4j_perror(stderr, errno, "tls_server_start");
+        tls_server_stop(&full);
+        goto cleanup;
+    }
+
+    if (run("full", &full, config, iterations) ||
+            run("resumed", &resumed, config, iterations))
+    {
+        neo4j_perror(stderr, errno, "tls_server_connect");
+    }
+    else
+    {
+        result = 0;
+    }
+
+    tls_server_stop(&resumed);
+    tls_server_stop(&full);
+
+cleanup:
+    neo4j_config_free(config);
+    tls_credentials_cleanup(&creds);
+    neo4j_client_cleanup();
+    return result;
+}
@@ -0,0 +1,249 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Measures the throughput of openssl_writev and openssl_read for large
+ * payloads, against a local stand-in server that sinks or sources data.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "tls_server.h"
+#include <errno.h>
+#include <string.h>
+
+#define DEFAULT_MEGABYTES 64
+#define HEADER_SIZE 9
+#define SERVER_WRITE_SIZE 65536
+
+static const size_t payload_sizes[] = { 16384, 65536, 1048576 };
+
+
+static int ssl_read_all(SSL *ssl, void *buf, size_t nbyte)
+{
+    for (size_t n = 0; n < nbyte; )
+    {
+        int result = SSL_read(ssl, (uint8_t *)buf + n, nbyte - n);
+        if (result <= 0)
+        {
+            return -1;
+        }
+        n += result;
+    }
+    return 0;
+}
+
+
+/*
+ * Each request is a direction ('w' for the client writing, 'r' for the
+ * client reading) followed by a 64-bit big-endian byte count. Written data
+ * is acknowledged with a single byte, once it has all been received.
+ */
+static void transfer_handler(SSL *ssl)
+{
+    static uint8_t buf[SERVER_WRITE_SIZE];
+    uint8_t header[HEADER_SIZE];
+    while (ssl_read_all(ssl, header, sizeof(header)) == 0)
+    {
+        uint64_t total = 0;
+        for (unsigned int i = 1; i < HEADER_SIZE; ++i)
+        {
+            total = (total << 8) | header[i];
+        }
+
+        if (header[0] == 'w')
+        {
+            for (uint64_t n = 0; n < total; )
+            {
+                size_t len = (total - n < sizeof(buf))?
+                        (size_t)(total - n) : sizeof(buf);
+                int result = SSL_read(ssl, buf, len);
+                if (result <= 0)
+                {
+                    return;
+                }
+                n += result;
+            }
+            if (SSL_write(ssl, "k", 1) != 1)
+            {
+                return;
+            }
+        }
+        else
+        {
+            for (uint64_t n = 0; n < total; )
+            {
+                size_t len = (total - n < sizeof(buf))?
+                        (size_t)(total - n) : sizeof(buf);
+                int result = SSL_write(ssl, buf, len);
+                if (result <= 0)
+                {
+                    return;
+                }
+                n += result;
+            }
+        }
+    }
+}
+
+
+static int send_header(neo4j_iostream_t *ios, char direction, uint64_t total)
+{
+    uint8_t header[HEADER_SIZE];
+    header[0] = direction;
+    for (unsigned int i = HEADER_SIZE - 1; i > 0; --i)
+    {
+        header[i] = total & 0xFF;
+        total >>= 8;
+    }
+    if (neo4j_ios_write_all(ios, header, sizeof(header), NULL))
+    {
+        return -1;
+    }
+    return neo4j_ios_flush(ios);
+}
+
+
+static int bench_writev(neo4j_iostream_t *ios, uint8_t *buf, size_t size,
+        uint64_t total)
+{
+    uint64_t nops = total / size;
+    if (send_header(ios, 'w', nops * size))
+    {
+        return -1;
+    }
+
+    // shaped like the output of the chunking iostream: a small header
+    // followed by the chunk body
+    struct iovec iov[2];
+    iov[0].iov_base = buf;
+    iov[0].iov_len = 2;
+    iov[1].iov_base = buf + 2;
+    iov[1].iov_len = size - 2;
+
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < nops; ++i)
+    {
+        if (neo4j_ios_writev_all(ios, iov, 2, NULL))
+        {
+            return -1;
+        }
+    }
+    uint8_t ack;
+    if (neo4j_ios_flush(ios) || neo4j_ios_read_all(ios, &ack, 1, NULL))
+    {
+        return -1;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char name[32];
+    snprintf(name, sizeof(name), "writev_%zu", size);
+    bench_report_throughput("tls_throughput", name, nops, elapsed, size);
+    return 0;
+}
+
+
+static int bench_read(neo4j_iostream_t *ios, uint8_t *buf, size_t size,
+        uint64_t total)
+{
+    uint64_t nops = total / size;
+    if (send_header(ios, 'r', nops * size))
+    {
+        return -1;
+    }
+
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < nops; ++i)
+    {
+        if (neo4j_ios_read_all(ios, buf, size, NULL))
+        {
+            return -1;
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char name[32];
+    snprintf(name, sizeof(name), "read_%zu", size);
+    bench_report_throughput("tls_throughput", name, nops, elapsed, size);
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint64_t total = (uint64_t)bench_iterations(argc, argv,
+            DEFAULT_MEGABYTES) * 1024 * 1024;
+
+    neo4j_client_init();
+
+    struct tls_credentials creds;
+    if (tls_credentials_init(&creds))
+    {
+        neo4j_perror(stderr, errno, "tls_credentials_init");
+        return 1;
+    }
+
+    int result = 1;
+    neo4j_iostream_t *ios = NULL;
+    size_t max_size = payload_sizes[
+            sizeof(payload_sizes) / sizeof(payload_sizes[0]) - 1];
+    uint8_t *buf = calloc(max_size, 1);
+    neo4j_config_t *config = neo4j_new_config();
+    if (buf == NULL || config == NULL ||
+            neo4j_config_set_TLS_ca_file(config, creds.ca_file))
+    {
+        neo4j_perror(stderr, errno, "neo4j_new_config");
+        goto cleanup;
+    }
+
+    struct tls_server server;
+    if (tls_server_start(&server, &creds, false, transfer_handler))
+    {
+        neo4j_perror(stderr, errno, "tls_server_start");
+        goto cleanup;
+    }
+
+    ios = tls_server_connect(&server, config);
+    if (ios == NULL)
+    {
+        neo4j_perror(stderr, errno, "tls_server_connect");
+        goto stop;
+    }
+
+    for (unsigned int i = 0;
+            i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); ++i)
+    {
+        if (bench_writev(ios, buf, payload_sizes[i], total) ||
+                bench_read(ios, buf, payload_sizes[i], total))
+        {
+            neo4j_perror(stderr, errno, "transfer");
+            goto stop;
+        }
+    }
+    result = 0;
+
+stop:
+    if (ios != NULL)
+    {
+        neo4j_ios_close(ios);
+    }
+    tls_server_stop(&server);
+cleanup:
+    free(buf);
+    neo4j_config_free(config);
+    tls_credentials_cleanup(&creds);
+    neo4j_client_cleanup();
+    return result;
+}
@@ -0,0 +1,181 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Compares connecting to, and running statements against, a local Bolt
+ * stand-in server over a unix domain socket and over TCP loopback.
+ */
+#include "../config.h"
+#include "bench.h"
+#include "../tests/bolt_server.h"
+#include "../src/lib/neo4j-client.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define DEFAULT_ITERATIONS 2000
+
+
+static int bench_connect(const char *name, const char *uri,
+        neo4j_config_t *config, unsigned int iterations)
+{
+    uint64_t *samples = calloc(iterations, sizeof(uint64_t));
+    if (samples == NULL)
+    {
+        return -1;
+    }
+
+    int result = -1;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        uint64_t start = bench_now_ns();
+        neo4j_connection_t *connection =
+            neo4j_connect(uri, config, NEO4J_INSECURE);
+        if (connection == NULL)
+        {
+            neo4j_perror(stderr, errno, uri);
+            goto cleanup;
+        }
+        samples[i] = bench_now_ns() - start;
+        neo4j_close(connection);
+    }
+
+    bench_report_latency("unix_socket_connect", name, samples, iterations);
+    result = 0;
+
+cleanup:
+    free(samples);
+    return result;
+}
+
+
+static int bench_statement(const char *name, const char *uri,
+        neo4j_config_t *config, unsigned int iterations)
+{
+    uint64_t *samples = calloc(iterations, sizeof(uint64_t));
+    if (samples == NULL)
+    {
+        return -1;
+    }
+
+    int result = -1;
+    neo4j_session_t *session = NULL;
+    neo4j_connection_t *connection =
+        neo4j_connect(uri, config, NEO4J_INSECURE);
+    if (connection == NULL)
+    {
+        neo4j_perror(stderr, errno, uri);
+        goto cleanup;
+    }
+    session = neo4j_new_session(connection);
+    if (session == NULL)
+    {
+        neo4j_perror(stderr, errno, "neo4j_new_session");
+        goto cleanup;
+    }
+
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        uint64_t start = bench_now_ns();
+        neo4j_result_stream_t *results =
+            neo4j_run(session, "RETURN 1 AS n", neo4j_null);
+        if (results == NULL)
+        {
+            neo4j_perror(stderr, errno, "neo4j_run");
+            goto cleanup;
+        }
+        while (neo4j_fetch_next(results) != NULL)
+            ;
+        int err = neo4j_check_failure(results);
+        if (neo4j_close_results(results) || err)
+        {
+            neo4j_perror(stderr, err? err : errno, "neo4j_run");
+            goto cleanup;
+        }
+        samples[i] = bench_now_ns() - start;
+    }
+
+    bench_report_latency("unix_socket_statement", name, samples, iterations);
+    result = 0;
+
+cleanup:
+    if (session != NULL)
+    {
+        neo4j_end_session(session);
+    }
+    if (connection != NULL)
+    {
+        neo4j_close(connection);
+    }
+    free(samples);
+    return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = bench_iterations(argc, argv, DEFAULT_ITERATIONS);
+
+    neo4j_client_init();
+
+    neo4j_config_t *config = neo4j_new_config();
+    if (config == NULL || neo4j_config_set_username(config, "bench") ||
+            neo4j_config_set_password(config, "bench"))
+    {
+        neo4j_perror(stderr, errno, "neo4j_new_config");
+        return EXIT_FAILURE;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/neo4j-bench.%d.sock", (int)getpid());
+
+    struct bolt_server tcp_server;
+    struct bolt_server unix_server;
+    if (bolt_server_start_tcp(&tcp_server, 0, NULL))
+    {
+        neo4j_perror(stderr, errno, "bolt_server_start_tcp");
+        return EXIT_FAILURE;
+    }
+    if (bolt_server_start_unix(&unix_server, path, NULL))
+    {
+        neo4j_perror(stderr, errno, "bolt_server_start_unix");
+        bolt_server_stop(&tcp_server);
+        return EXIT_FAILURE;
+    }
+
+    char tcp_uri[64];
+    snprintf(tcp_uri, sizeof(tcp_uri), "bolt://127.0.0.1:%d", tcp_server.port);
+    char unix_uri[96];
+    snprintf(unix_uri, sizeof(unix_uri), "bolt+unix://%s", path);
+
+    // connecting is much slower than running a statement
+    unsigned int connections = (iterations + 9) / 10;
+    int result = EXIT_FAILURE;
+    if (bench_connect("tcp_loopback", tcp_uri, config, connections) ||
+        bench_connect("unix", unix_uri, config, connections) ||
+        bench_statement("tcp_loopback", tcp_uri, config, iterations) ||
+        bench_statement("unix", unix_uri, config, iterations))
+    {
+        goto cleanup;
+    }
+    result = EXIT_SUCCESS;
+
+cleanup:
+    bolt_server_stop(&unix_server);
+    bolt_server_stop(&tcp_server);
+    neo4j_config_free(config);
+    neo4j_client_cleanup();
+    return result;
+}
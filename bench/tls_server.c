@@ -0,0 +1,300 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "tls_server.h"
+#include "../src/lib/openssl_iostream.h"
+#include "../src/lib/posix_iostream.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+static EVP_PKEY *generate_key(void);
+static X509 *self_signed_cert(EVP_PKEY *pkey);
+static SSL_CTX *server_ctx(const struct tls_credentials *creds,
+        bool resumable);
+static void *serve(void *data);
+
+
+int tls_credentials_init(struct tls_credentials *creds)
+{
+    memset(creds, 0, sizeof(struct tls_credentials));
+    strcpy(creds->ca_file, "/tmp/neo4j-bench-ca.XXXXXX");
+    int fd = mkstemp(creds->ca_file);
+    if (fd < 0)
+    {
+        creds->ca_file[0] = '\0';
+        return -1;
+    }
+    FILE *stream = fdopen(fd, "w");
+    if (stream == NULL)
+    {
+        close(fd);
+        goto failure;
+    }
+
+    creds->pkey = generate_key();
+    creds->cert = (creds->pkey != NULL)? self_signed_cert(creds->pkey) : NULL;
+    if (creds->cert == NULL || PEM_write_X509(stream, creds->cert) != 1)
+    {
+        ERR_print_errors_fp(stderr);
+        fclose(stream);
+        errno = EPROTO;
+        goto failure;
+    }
+    if (fclose(stream))
+    {
+        goto failure;
+    }
+    return 0;
+
+    int errsv;
+failure:
+    errsv = errno;
+    tls_credentials_cleanup(creds);
+    errno = errsv;
+    return -1;
+}
+
+
+void tls_credentials_cleanup(struct tls_credentials *creds)
+{
+    if (creds->ca_file[0] != '\0')
+    {
+        unlink(creds->ca_file);
+    }
+    X509_free(creds->cert);
+    EVP_PKEY_free(creds->pkey);
+    memset(creds, 0, sizeof(struct tls_credentials));
+}
+
+
+EVP_PKEY *generate_key(void)
+{
+    EVP_PKEY *pkey = EVP_PKEY_new();
+    RSA *rsa = RSA_new();
+    BIGNUM *e = BN_new();
+    if (pkey == NULL || rsa == NULL || e == NULL ||
+            BN_set_word(e, RSA_F4) != 1 ||
+            RSA_generate_key_ex(rsa, 2048, e, NULL) != 1 ||
+            EVP_PKEY_assign_RSA(pkey, rsa) != 1)
+    {
+        BN_free(e);
+        RSA_free(rsa);
+        EVP_PKEY_free(pkey);
+        return NULL;
+    }
+    BN_free(e);
+    return pkey;
+}
+
+
+X509 *self_signed_cert(EVP_PKEY *pkey)
+{
+    X509 *cert = X509_new();
+    if (cert == NULL)
+    {
+        return NULL;
+    }
+    X509_NAME *name = X509_get_subject_name(cert);
+    if (X509_set_version(cert, 2) != 1 ||
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1) != 1 ||
+            X509_gmtime_adj(X509_get_notBefore(cert), -60) == NULL ||
+            X509_gmtime_adj(X509_get_notAfter(cert), 3600) == NULL ||
+            X509_set_pubkey(cert, pkey) != 1 ||
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                (const unsigned char *)"localhost", -1, -1, 0) != 1 ||
+            X509_set_issuer_name(cert, name) != 1 ||
+            X509_sign(cert, pkey, EVP_sha256()) == 0)
+    {
+        X509_free(cert);
+        return NULL;
+    }
+    return cert;
+}
+
+
+int tls_server_start(struct tls_server *server,
+        const struct tls_credentials *creds, bool resumable,
+        tls_handler_t handler)
+{
+    server->ctx = server_ctx(creds, resumable);
+    if (server->ctx == NULL)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    server->handler = handler;
+
+    server->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->fd < 0)
+    {
+        goto failure;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrlen = sizeof(addr);
+    if (bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+            listen(server->fd, 128) ||
+            getsockname(server->fd, (struct sockaddr *)&addr, &addrlen))
+    {
+        goto failure;
+    }
+    server->port = ntohs(addr.sin_port);
+
+    int err = pthread_create(&(server->thread), NULL, serve, server);
+    if (err)
+    {
+        errno = err;
+        goto failure;
+    }
+    return 0;
+
+    int errsv;
+failure:
+    errsv = errno;
+    if (server->fd >= 0)
+    {
+        close(server->fd);
+    }
+    SSL_CTX_free(server->ctx);
+    errno = errsv;
+    return -1;
+}
+
+
+void tls_server_stop(struct tls_server *server)
+{
+    shutdown(server->fd, SHUT_RDWR);
+    close(server->fd);
+    pthread_join(server->thread, NULL);
+    SSL_CTX_free(server->ctx);
+}
+
+
+SSL_CTX *server_ctx(const struct tls_credentials *creds, bool resumable)
+{
+    SSL_CTX *ctx = SSL_CTX_new(SSLv23_server_method());
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+    if (SSL_CTX_use_certificate(ctx, creds->cert) != 1 ||
+            SSL_CTX_use_PrivateKey(ctx, creds->pkey) != 1)
+    {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    if (resumable)
+    {
+        static const unsigned char sid_ctx[] = "bench";
+        SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx) - 1);
+    }
+    else
+    {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+    return ctx;
+}
+
+
+void *serve(void *data)
+{
+    struct tls_server *server = (struct tls_server *)data;
+    for (;;)
+    {
+        int fd = accept(server->fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return NULL;
+        }
+        SSL *ssl = SSL_new(server->ctx);
+        if (ssl != NULL && SSL_set_fd(ssl, fd) == 1 && SSL_accept(ssl) == 1)
+        {
+            server->handler(ssl);
+            SSL_shutdown(ssl);
+        }
+        SSL_free(ssl);
+        close(fd);
+    }
+}
+
+
+void tls_drain_handler(SSL *ssl)
+{
+    char buf[4096];
+    while (SSL_read(ssl, buf, sizeof(buf)) > 0)
+        ;
+}
+
+
+neo4j_iostream_t *tls_server_connect(const struct tls_server *server,
+        const neo4j_config_t *config)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server->port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        int errsv = errno;
+        close(fd);
+        errno = errsv;
+        return NULL;
+    }
+
+    neo4j_iostream_t *ios = neo4j_posix_iostream(fd);
+    if (ios == NULL)
+    {
+        int errsv = errno;
+        close(fd);
+        errno = errsv;
+        return NULL;
+    }
+    neo4j_iostream_t *tls = neo4j_openssl_iostream(ios, "localhost",
+            server->port, config, 0);
+    if (tls == NULL)
+    {
+        int errsv = errno;
+        neo4j_ios_close(ios);
+        errno = errsv;
+        return NULL;
+    }
+    return tls;
+}
@@ -0,0 +1,81 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NEO4J_BENCH_TLS_SERVER_H
+#define NEO4J_BENCH_TLS_SERVER_H
+
+#include "../src/lib/neo4j-client.h"
+#include "../src/lib/iostream.h"
+#include <openssl/ssl.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+/*
+ * A local TLS stand-in server, accepting connections on a loopback port
+ * and passing each established TLS connection to a handler in turn.
+ */
+
+struct tls_credentials
+{
+    EVP_PKEY *pkey;
+    X509 *cert;
+    char ca_file[32];
+};
+
+typedef void (*tls_handler_t)(SSL *ssl);
+
+struct tls_server
+{
+    SSL_CTX *ctx;
+    tls_handler_t handler;
+    int fd;
+    int port;
+    pthread_t thread;
+};
+
+/**
+ * Generate a key and a self-signed certificate for "localhost".
+ *
+ * The certificate is also written to a temporary file, named in
+ * `ca_file`, for use as the client's trusted CA.
+ */
+int tls_credentials_init(struct tls_credentials *creds);
+
+void tls_credentials_cleanup(struct tls_credentials *creds);
+
+/**
+ * Start a server in a new thread.
+ *
+ * If `resumable` is false, the server refuses session resumption.
+ */
+int tls_server_start(struct tls_server *server,
+        const struct tls_credentials *creds, bool resumable,
+        tls_handler_t handler);
+
+void tls_server_stop(struct tls_server *server);
+
+/**
+ * Read from the connection until the client closes it.
+ */
+void tls_drain_handler(SSL *ssl);
+
+/**
+ * Connect to the server through neo4j_openssl_iostream.
+ */
+neo4j_iostream_t *tls_server_connect(const struct tls_server *server,
+        const neo4j_config_t *config);
+
+#endif/*NEO4J_BENCH_TLS_SERVER_H*/
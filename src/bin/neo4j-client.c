@@ -50,6 +50,7 @@ const char *shortopts = "hp:Pu:v";
 #define NOHIST_OPT 1007
 #define VERSION_OPT 1008
 #define PIPELINE_MAX_OPT 1009
+#define PIPELINE_ADAPTIVE_OPT 1010
 
 static struct option longopts[] =
     { { "help", no_argument, NULL, 'h' },
@@ -64,6 +65,7 @@ static struct option longopts[] =
       { "known-hosts", required_argument, NULL, KNOWN_HOSTS_OPT },
       { "no-known-hosts", no_argument, NULL, NO_KNOWN_HOSTS_OPT },
       { "pipeline-max", required_argument, NULL, PIPELINE_MAX_OPT },
+      { "pipeline-adaptive", no_argument, NULL, PIPELINE_ADAPTIVE_OPT },
       { "verbose", no_argument, NULL, 'v' },
       { "version", no_argument, NULL, VERSION_OPT },
       { NULL, 0, NULL, 0 } };
@@ -89,6 +91,8 @@ static void usage(FILE *s, const char *prog_name)
 " --known-hosts=file  Set the path to the known-hosts file.\n"
 " --no-known-hosts    Do not do host checking via known-hosts (use only TLS\n"
 "                     certificate verification).\n"
+" --pipeline-adaptive Adapt the number of statements sent before awaiting\n"
+"                     results to the link latency and result sizes.\n"
 " --verbose, -v       Increase logging verbosity.\n"
 " --version           Output the version of neo4j-client and dependencies.\n"
 "\n"
@@ -245,6 +249,9 @@ int main(int argc, char *argv[])
                 neo4j_config_set_max_pipelined_requests(config, arg * 2);
             }
             break;
+        case PIPELINE_ADAPTIVE_OPT:
+            neo4j_config_set_adaptive_pipelining(config, true);
+            break;
         case VERSION_OPT:
             fprintf(state.out, "neo4j-client: %s\n", PACKAGE_VERSION);
             fprintf(state.out, "libneo4j-client: %s\n",
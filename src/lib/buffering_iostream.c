@@ -24,7 +24,7 @@
 
 
 struct buffering_iostream {
-    neo4j_iostream_t _iostream;
+    struct neo4j_waitable_iostream _waitable;
 
     neo4j_iostream_t *delegate;
     bool close_delegate;
@@ -44,6 +44,7 @@ static ssize_t buffering_writev(neo4j_iostream_t *stream,
         const struct iovec *iov, unsigned int iovcnt);
 static int buffering_flush(neo4j_iostream_t *stream);
 static int buffering_close(neo4j_iostream_t *stream);
+static int buffering_wait(neo4j_iostream_t *stream, unsigned int timeout);
 
 
 neo4j_iostream_t *neo4j_buffering_iostream(neo4j_iostream_t *delegate,
@@ -79,13 +80,14 @@ neo4j_iostream_t *neo4j_buffering_iostream(neo4j_iostream_t *delegate,
         }
     }
 
-    neo4j_iostream_t *iostream = &(ios->_iostream);
+    neo4j_iostream_t *iostream = neo4j_waitable_ios_init(&(ios->_waitable),
+            buffering_close,
+            neo4j_ios_can_wait(delegate)? buffering_wait : NULL);
     iostream->read = buffering_read;
     iostream->readv = buffering_readv;
     iostream->write = buffering_write;
     iostream->writev = buffering_writev;
     iostream->flush = buffering_flush;
-    iostream->close = buffering_close;
     return iostream;
 
     int errsv;
@@ -108,7 +110,7 @@ failure:
 ssize_t buffering_read(neo4j_iostream_t *stream, void *buf, size_t nbyte)
 {
     struct buffering_iostream *ios = container_of(stream,
-            struct buffering_iostream, _iostream);
+            struct buffering_iostream, _waitable._iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -157,7 +159,7 @@ ssize_t buffering_readv(neo4j_iostream_t *stream,
         const struct iovec *iov, unsigned int iovcnt)
 {
     struct buffering_iostream *ios = container_of(stream,
-            struct buffering_iostream, _iostream);
+            struct buffering_iostream, _waitable._iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -219,7 +221,7 @@ cleanup:
 ssize_t buffering_write(neo4j_iostream_t *stream, const void *buf, size_t nbyte)
 {
     struct buffering_iostream *ios = container_of(stream,
-            struct buffering_iostream, _iostream);
+            struct buffering_iostream, _waitable._iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -286,7 +288,7 @@ ssize_t buffering_writev(neo4j_iostream_t *stream,
         const struct iovec *iov, unsigned int iovcnt)
 {
     struct buffering_iostream *ios = container_of(stream,
-            struct buffering_iostream, _iostream);
+            struct buffering_iostream, _waitable._iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -360,7 +362,7 @@ cleanup:
 int buffering_flush(neo4j_iostream_t *stream)
 {
     struct buffering_iostream *ios = container_of(stream,
-            struct buffering_iostream, _iostream);
+            struct buffering_iostream, _waitable._iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -386,7 +388,7 @@ int buffering_flush(neo4j_iostream_t *stream)
 int buffering_close(neo4j_iostream_t *stream)
 {
     struct buffering_iostream *ios = container_of(stream,
-            struct buffering_iostream, _iostream);
+            struct buffering_iostream, _waitable._iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -399,3 +401,20 @@ int buffering_close(neo4j_iostream_t *stream)
     free(ios);
     return neo4j_ios_close(delegate);
 }
+
+
+int buffering_wait(neo4j_iostream_t *stream, unsigned int timeout)
+{
+    struct buffering_iostream *ios = container_of(stream,
+            struct buffering_iostream, _waitable._iostream);
+    if (ios->delegate == NULL)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    if (ios->rcvbuf != NULL && !rb_is_empty(ios->rcvbuf))
+    {
+        return 0;
+    }
+    return neo4j_ios_wait(ios->delegate, timeout);
+}
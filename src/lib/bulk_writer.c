@@ -0,0 +1,394 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../config.h"
+#include "neo4j-client.h"
+#include "client_config.h"
+#include "logging.h"
+#include "serialization.h"
+#include "session.h"
+#include "util.h"
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+
+#define BULK_BATCH_PARAM "batch"
+#define BULK_BATCH_MIN_CAPACITY 1024
+
+
+struct bulk_batch
+{
+    struct neo4j_value_producer _producer;
+
+    unsigned long long seq;
+    uint8_t *buffer;
+    size_t length;
+    size_t capacity;
+    unsigned int nrows;
+    neo4j_map_entry_t param;
+    neo4j_result_stream_t *results;
+    struct bulk_batch *next;
+};
+
+
+struct neo4j_bulk_writer
+{
+    neo4j_session_t *session;
+    neo4j_logger_t *logger;
+    char *statement;
+    unsigned int max_rows;
+    size_t max_bytes;
+    unsigned int max_inflight;
+    neo4j_bulk_batch_callback_t callback;
+    void *userdata;
+
+    // a write-only stream appending to the current batch
+    neo4j_iostream_t _batch_ios;
+
+    struct bulk_batch *current;
+    struct bulk_batch *inflight;
+    struct bulk_batch *inflight_tail;
+    unsigned int ninflight;
+    unsigned long long nbatches;
+    int failure;
+};
+
+
+static struct bulk_batch *new_batch(neo4j_bulk_writer_t *writer);
+static void free_batch(struct bulk_batch *batch);
+static int produce_batch(struct neo4j_value_producer *self,
+        neo4j_value_writer_t *writer);
+static int submit_batch(neo4j_bulk_writer_t *writer);
+static int complete_batch(neo4j_bulk_writer_t *writer);
+static ssize_t batch_ios_read(neo4j_iostream_t *self,
+        void *buf, size_t nbyte);
+static ssize_t batch_ios_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+static ssize_t batch_ios_write(neo4j_iostream_t *self,
+        const void *buf, size_t nbyte);
+static ssize_t batch_ios_writev(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+static int batch_ios_flush(neo4j_iostream_t *self);
+static int batch_ios_close(neo4j_iostream_t *self);
+
+
+neo4j_bulk_writer_t *neo4j_open_bulk_writer(neo4j_session_t *session,
+        const char *statement, unsigned int max_rows, size_t max_bytes,
+        neo4j_bulk_batch_callback_t callback, void *userdata)
+{
+    REQUIRE(session != NULL, NULL);
+    REQUIRE(statement != NULL, NULL);
+    REQUIRE(max_rows > 0, NULL);
+
+    neo4j_bulk_writer_t *writer = calloc(1, sizeof(neo4j_bulk_writer_t));
+    if (writer == NULL)
+    {
+        return NULL;
+    }
+
+    writer->statement = strdup(statement);
+    if (writer->statement == NULL)
+    {
+        free(writer);
+        return NULL;
+    }
+
+    const neo4j_config_t *config = session->config;
+    writer->session = session;
+    writer->logger = neo4j_get_logger(config, "bulk");
+    writer->max_rows = max_rows;
+    writer->max_bytes = max_bytes;
+    // each batch is sent as a RUN and a DISCARD_ALL
+    writer->max_inflight = maxu(config->max_pipelined_requests / 2, 1);
+    writer->callback = callback;
+    writer->userdata = userdata;
+
+    neo4j_iostream_t *ios = &(writer->_batch_ios);
+    ios->read = batch_ios_read;
+    ios->readv = batch_ios_readv;
+    ios->write = batch_ios_write;
+    ios->writev = batch_ios_writev;
+    ios->flush = batch_ios_flush;
+    ios->close = batch_ios_close;
+
+    return writer;
+}
+
+
+int neo4j_bulk_write(neo4j_bulk_writer_t *writer, neo4j_value_t row)
+{
+    REQUIRE(writer != NULL, -1);
+
+    if (writer->current == NULL)
+    {
+        writer->current = new_batch(writer);
+        if (writer->current == NULL)
+        {
+            return -1;
+        }
+    }
+
+    struct bulk_batch *batch = writer->current;
+    size_t plength = batch->length;
+    if (neo4j_serialize(row, &(writer->_batch_ios)))
+    {
+        batch->length = plength;
+        return -1;
+    }
+    (batch->nrows)++;
+
+    if (batch->nrows >= writer->max_rows ||
+            (writer->max_bytes > 0 && batch->length >= writer->max_bytes))
+    {
+        return submit_batch(writer);
+    }
+    return 0;
+}
+
+
+int neo4j_bulk_flush(neo4j_bulk_writer_t *writer)
+{
+    REQUIRE(writer != NULL, -1);
+    return submit_batch(writer);
+}
+
+
+int neo4j_close_bulk_writer(neo4j_bulk_writer_t *writer)
+{
+    REQUIRE(writer != NULL, -1);
+
+    int err = submit_batch(writer);
+    int errsv = errno;
+    while (writer->inflight != NULL)
+    {
+        if (complete_batch(writer) && err == 0)
+        {
+            err = -1;
+            errsv = errno;
+        }
+    }
+
+    if (err == 0 && writer->failure != 0)
+    {
+        err = -1;
+        errsv = writer->failure;
+    }
+
+    free_batch(writer->current);
+    neo4j_logger_release(writer->logger);
+    free(writer->statement);
+    free(writer);
+    errno = errsv;
+    return err;
+}
+
+
+struct bulk_batch *new_batch(neo4j_bulk_writer_t *writer)
+{
+    struct bulk_batch *batch = calloc(1, sizeof(struct bulk_batch));
+    if (batch == NULL)
+    {
+        return NULL;
+    }
+    batch->_producer.produce = produce_batch;
+    batch->seq = (writer->nbatches)++;
+    return batch;
+}
+
+
+void free_batch(struct bulk_batch *batch)
+{
+    if (batch == NULL)
+    {
+        return;
+    }
+    free(batch->buffer);
+    free(batch);
+}
+
+
+int produce_batch(struct neo4j_value_producer *self,
+        neo4j_value_writer_t *writer)
+{
+    struct bulk_batch *batch = container_of(self, struct bulk_batch,
+            _producer);
+    if (neo4j_writer_begin_list(writer, batch->nrows) ||
+        neo4j_writer_encoded(writer, batch->buffer, batch->length,
+            batch->nrows))
+    {
+        return -1;
+    }
+    return neo4j_writer_end(writer);
+}
+
+
+int submit_batch(neo4j_bulk_writer_t *writer)
+{
+    struct bulk_batch *batch = writer->current;
+    if (batch == NULL || batch->nrows == 0)
+    {
+        return 0;
+    }
+
+    while (writer->ninflight >= writer->max_inflight)
+    {
+        if (complete_batch(writer))
+        {
+            return -1;
+        }
+    }
+
+    batch->param = neo4j_map_entry(BULK_BATCH_PARAM,
+            neo4j_streamed_list(&(batch->_producer)));
+    batch->results = neo4j_send(writer->session, writer->statement,
+            neo4j_map(&(batch->param), 1));
+    if (batch->results == NULL)
+    {
+        neo4j_log_debug_errno(writer->logger, "failed to send batch");
+        return -1;
+    }
+    writer->current = NULL;
+
+    if (writer->inflight_tail != NULL)
+    {
+        writer->inflight_tail->next = batch;
+    }
+    else
+    {
+        writer->inflight = batch;
+    }
+    writer->inflight_tail = batch;
+    (writer->ninflight)++;
+
+    neo4j_log_trace(writer->logger, "sending batch %llu (%u rows, %zu bytes)",
+            batch->seq, batch->nrows, batch->length);
+
+    return neo4j_session_flush(writer->session);
+}
+
+
+int complete_batch(neo4j_bulk_writer_t *writer)
+{
+    struct bulk_batch *batch = writer->inflight;
+    assert(batch != NULL);
+    writer->inflight = batch->next;
+    if (writer->inflight == NULL)
+    {
+        writer->inflight_tail = NULL;
+    }
+    assert(writer->ninflight > 0);
+    (writer->ninflight)--;
+
+    // await completion of the whole batch, then check the outcome
+    neo4j_update_counts(batch->results);
+    int failure = neo4j_check_failure(batch->results);
+    if (failure != 0)
+    {
+        char ebuf[256];
+        neo4j_log_debug(writer->logger, "batch %llu failed: %s",
+                batch->seq, neo4j_strerror(failure, ebuf, sizeof(ebuf)));
+        if (writer->failure == 0)
+        {
+            writer->failure = failure;
+        }
+    }
+
+    if (writer->callback != NULL)
+    {
+        writer->callback(writer->userdata, batch->seq, batch->nrows,
+                batch->results);
+    }
+
+    int err = neo4j_close_results(batch->results);
+    free_batch(batch);
+    return err;
+}
+
+
+ssize_t batch_ios_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+
+ssize_t batch_ios_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+
+ssize_t batch_ios_write(neo4j_iostream_t *self, const void *buf, size_t nbyte)
+{
+    struct iovec iov = { .iov_base = (void *)(uintptr_t)buf,
+        .iov_len = nbyte };
+    return batch_ios_writev(self, &iov, 1);
+}
+
+
+ssize_t batch_ios_writev(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    neo4j_bulk_writer_t *writer = container_of(self,
+            neo4j_bulk_writer_t, _batch_ios);
+    struct bulk_batch *batch = writer->current;
+    assert(batch != NULL);
+
+    size_t total = iovlen(iov, iovcnt);
+    if (total > SSIZE_MAX)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if ((batch->length + total) > batch->capacity)
+    {
+        size_t capacity = maxzu(batch->capacity * 2, BULK_BATCH_MIN_CAPACITY);
+        while (capacity < (batch->length + total))
+        {
+            capacity *= 2;
+        }
+        uint8_t *buffer = realloc(batch->buffer, capacity);
+        if (buffer == NULL)
+        {
+            return -1;
+        }
+        batch->buffer = buffer;
+        batch->capacity = capacity;
+    }
+
+    for (unsigned int i = 0; i < iovcnt; ++i)
+    {
+        memcpy(batch->buffer + batch->length, iov[i].iov_base, iov[i].iov_len);
+        batch->length += iov[i].iov_len;
+    }
+    return total;
+}
+
+
+int batch_ios_flush(neo4j_iostream_t *self)
+{
+    return 0;
+}
+
+
+int batch_ios_close(neo4j_iostream_t *self)
+{
+    return 0;
+}
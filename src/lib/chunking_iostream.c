@@ -24,6 +24,10 @@
 static ssize_t chunking_read(neo4j_iostream_t *self, void *buf, size_t nbyte);
 static ssize_t chunking_readv(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt);
+static ssize_t read_chunks(struct neo4j_chunking_iostream *ios,
+        void *buf, size_t nbyte);
+static ssize_t readv_chunks(struct neo4j_chunking_iostream *ios,
+        const struct iovec *iov, unsigned int iovcnt);
 static ssize_t chunking_write(neo4j_iostream_t *self,
         const void *buf, size_t nbyte);
 static ssize_t chunking_writev(neo4j_iostream_t *self,
@@ -100,12 +104,39 @@ ssize_t chunking_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
     REQUIRE(buf != NULL, -1);
     struct neo4j_chunking_iostream *ios = container_of(self,
             struct neo4j_chunking_iostream, _iostream);
+    ssize_t result = read_chunks(ios, buf, nbyte);
+    if (result > 0)
+    {
+        ios->rcv_total += result;
+    }
+    return result;
+}
+
+
+ssize_t chunking_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    REQUIRE(iov != NULL, -1);
+    struct neo4j_chunking_iostream *ios = container_of(self,
+            struct neo4j_chunking_iostream, _iostream);
+    ssize_t result = readv_chunks(ios, iov, iovcnt);
+    if (result > 0)
+    {
+        ios->rcv_total += result;
+    }
+    return result;
+}
+
+
+ssize_t read_chunks(struct neo4j_chunking_iostream *ios,
+        void *buf, size_t nbyte)
+{
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
         return -1;
     }
-    if (nbyte == 0)
+    if (nbyte == 0 || ios->rcv_chunk_remaining < 0)
     {
         errno = ios->rcv_errno;
         return (ios->rcv_errno != 0)? -1 : 0;
@@ -153,7 +184,7 @@ ssize_t chunking_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
             received += minzu(result, l);
             ios->rcv_errno = errno;
             ios->rcv_chunk_remaining = -1;
-            return received;
+            return (received > 0)? received : -1;
         }
 
         if (result <= (size_t)ios->rcv_chunk_remaining)
@@ -177,27 +208,26 @@ ssize_t chunking_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
         nbyte -= l;
         buf = ((uint8_t *)buf) + l;
         ios->rcv_chunk_remaining = ntohs(length);
+        (ios->rcv_chunks)++;
     } while (nbyte > 0);
 
     return received;
 }
 
 
-ssize_t chunking_readv(neo4j_iostream_t *self,
+ssize_t readv_chunks(struct neo4j_chunking_iostream *ios,
         const struct iovec *iov, unsigned int iovcnt)
 {
     if (iovcnt == 1)
     {
-        return chunking_read(self, iov[0].iov_base, iov[0].iov_len);
+        REQUIRE(iov[0].iov_base != NULL, -1);
+        return read_chunks(ios, iov[0].iov_base, iov[0].iov_len);
     }
     else if (iovcnt > IOV_MAX-1)
     {
         iovcnt = IOV_MAX-1;
     }
 
-    REQUIRE(iov != NULL, -1);
-    struct neo4j_chunking_iostream *ios = container_of(self,
-            struct neo4j_chunking_iostream, _iostream);
     if (ios->delegate == NULL)
     {
         errno = EPIPE;
@@ -207,7 +237,7 @@ ssize_t chunking_readv(neo4j_iostream_t *self,
     if (ios->rcv_chunk_remaining < 0 || iovcnt == 0)
     {
         errno = ios->rcv_errno;
-        return (ios->rcv_errno > 0)? -1 : 0;
+        return (ios->rcv_errno != 0)? -1 : 0;
     }
 
     // duplicate the iovector, as it will be modified
@@ -253,6 +283,10 @@ ssize_t chunking_readv(neo4j_iostream_t *self,
             received += minzu(result, total);
             ios->rcv_errno = errno;
             ios->rcv_chunk_remaining = -1;
+            if (received == 0)
+            {
+                received = -1;
+            }
             goto cleanup;
         }
 
@@ -276,6 +310,7 @@ ssize_t chunking_readv(neo4j_iostream_t *self,
         }
 
         ios->rcv_chunk_remaining = ntohs(length);
+        (ios->rcv_chunks)++;
     } while (iovcnt > 0);
 
     int errsv;
@@ -341,6 +376,7 @@ ssize_t chunking_writev(neo4j_iostream_t *self,
                 USHRT_MAX - ios->snd_buffer_used, iov, iovcnt);
         assert(result > 0);
         ios->snd_buffer_used += result;
+        ios->snd_total += result;
         return result;
     }
 
@@ -435,6 +471,8 @@ ssize_t chunking_writev(neo4j_iostream_t *self,
     }
     assert((size_t)written == nbytes);
     FREE_IOVEC(diov);
+    ios->snd_total += written;
+    ios->snd_chunks += chunks_written;
     return written;
 }
 
@@ -480,6 +518,7 @@ int chunking_close(neo4j_iostream_t *self)
         iov[1].iov_base = ios->snd_buffer;
         iov[1].iov_len = ios->snd_buffer_used;
         iovcnt = 2;
+        (ios->snd_chunks)++;
     }
 
     uint16_t end = 0;
@@ -48,6 +48,10 @@ struct neo4j_chunking_iostream
     bool data_sent;
     int rcv_chunk_remaining;
     int rcv_errno;
+    size_t rcv_total;
+    unsigned int rcv_chunks;
+    size_t snd_total;
+    unsigned int snd_chunks;
 };
 
 
@@ -49,15 +49,27 @@ neo4j_config_t *neo4j_new_config()
         return NULL;
     }
     config->connection_factory = &neo4j_std_connection_factory;
+    config->unix_connection_factory = &neo4j_std_unix_connection_factory;
     config->allocator = &neo4j_std_memory_allocator;
     config->mpool_block_size = 128;
     config->client_id = libneo4j_client_id();
     config->io_rcvbuf_size = 4096;
     config->io_sndbuf_size = 4096;
+    config->tcp_nodelay = true;
+    config->connect_attempt_delay = 250;
+    config->dns_cache_ttl = 60;
+    config->dns_negative_cache_ttl = 5;
     config->snd_min_chunk_size = 1024;
     config->snd_max_chunk_size = UINT16_MAX;
     config->session_request_queue_size = 256;
+    config->session_request_queue_max_size = 4096;
     config->max_pipelined_requests = NEO4J_DEFAULT_MAX_PIPELINED_REQUESTS;
+    config->max_adaptive_pipelined_requests =
+        NEO4J_DEFAULT_MAX_ADAPTIVE_PIPELINED_REQUESTS;
+    config->pipeline_response_budget = 256 * 1024;
+#ifdef HAVE_TLS
+    config->tls_min_version = NEO4J_TLS_V1_2;
+#endif
     config->trust_known = true;
     return config;
 }
@@ -98,6 +110,14 @@ neo4j_config_t *neo4j_config_dup(const neo4j_config_t *config)
     {
         goto failure;
     }
+    if (strdup_null(&(dup->tls_ciphers), config->tls_ciphers))
+    {
+        goto failure;
+    }
+    if (strdup_null(&(dup->tls_ciphersuites), config->tls_ciphersuites))
+    {
+        goto failure;
+    }
 #endif
     if (strdup_null(&(dup->known_hosts_file), config->known_hosts_file))
     {
@@ -127,6 +147,8 @@ void neo4j_config_free(neo4j_config_t *config)
     free(config->tls_private_key_file);
     free(config->tls_ca_file);
     free(config->tls_ca_dir);
+    free(config->tls_ciphers);
+    free(config->tls_ciphersuites);
 #endif
     free(config->known_hosts_file);
     free(config);
@@ -167,6 +189,12 @@ void neo4j_config_allow_empty_password(neo4j_config_t *config, bool allow)
 }
 
 
+void neo4j_config_set_pipelined_init(neo4j_config_t *config, bool enable)
+{
+    config->pipelined_init = enable;
+}
+
+
 int neo4j_config_set_authentication_reattempt_callback(neo4j_config_t *config,
         neo4j_authentication_reattempt_callback_t callback, void *userdata)
 {
@@ -237,6 +265,59 @@ int neo4j_config_set_TLS_ca_dir(neo4j_config_t *config, const char *path)
 }
 
 
+int neo4j_config_set_TLS_min_version(neo4j_config_t *config,
+        unsigned int version)
+{
+    REQUIRE(config != NULL, -1);
+    REQUIRE(version >= NEO4J_TLS_V1_0 && version <= NEO4J_TLS_V1_3, -1);
+#ifdef HAVE_TLS
+    config->tls_min_version = version;
+    return 0;
+#else
+    errno = NEO4J_TLS_NOT_SUPPORTED;
+    return -1;
+#endif
+}
+
+
+int neo4j_config_set_TLS_ciphers(neo4j_config_t *config, const char *ciphers)
+{
+    REQUIRE(config != NULL, -1);
+#ifdef HAVE_TLS
+    return replace_strptr_dup(&(config->tls_ciphers), ciphers);
+#else
+    errno = NEO4J_TLS_NOT_SUPPORTED;
+    return -1;
+#endif
+}
+
+
+int neo4j_config_set_TLS_ciphersuites(neo4j_config_t *config,
+        const char *ciphersuites)
+{
+    REQUIRE(config != NULL, -1);
+#ifdef HAVE_TLS
+    return replace_strptr_dup(&(config->tls_ciphersuites), ciphersuites);
+#else
+    errno = NEO4J_TLS_NOT_SUPPORTED;
+    return -1;
+#endif
+}
+
+
+int neo4j_config_set_TLS_kernel_offload(neo4j_config_t *config, bool enable)
+{
+    REQUIRE(config != NULL, -1);
+#ifdef HAVE_TLS
+    config->tls_kernel_offload = enable;
+    return 0;
+#else
+    errno = NEO4J_TLS_NOT_SUPPORTED;
+    return -1;
+#endif
+}
+
+
 int neo4j_config_set_trust_known_hosts(neo4j_config_t *config, bool enable)
 {
     REQUIRE(config != NULL, -1);
@@ -326,6 +407,119 @@ int neo4j_config_set_so_rcvbuf_size(neo4j_config_t *config, unsigned int size)
 }
 
 
+int neo4j_config_set_tcp_nodelay(neo4j_config_t *config, bool enable)
+{
+    REQUIRE(config != NULL, -1);
+    config->tcp_nodelay = enable;
+    return 0;
+}
+
+
+int neo4j_config_set_tcp_quickack(neo4j_config_t *config, bool enable)
+{
+    REQUIRE(config != NULL, -1);
+    config->tcp_quickack = enable;
+    return 0;
+}
+
+
+int neo4j_config_set_tcp_keepalive(neo4j_config_t *config, unsigned int idle,
+        unsigned int interval, unsigned int count)
+{
+    REQUIRE(config != NULL, -1);
+    if (idle > INT_MAX || interval > INT_MAX || count > INT_MAX)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+    config->tcp_keepalive_idle = idle;
+    config->tcp_keepalive_interval = interval;
+    config->tcp_keepalive_count = count;
+    return 0;
+}
+
+
+int neo4j_config_set_so_busy_poll(neo4j_config_t *config, unsigned int usecs)
+{
+    REQUIRE(config != NULL, -1);
+    if (usecs > INT_MAX)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+    config->so_busy_poll = usecs;
+    return 0;
+}
+
+
+int neo4j_config_set_io_read_spin(neo4j_config_t *config, unsigned int usecs)
+{
+    REQUIRE(config != NULL, -1);
+    config->io_read_spin = usecs;
+    return 0;
+}
+
+
+int neo4j_config_set_io_uring(neo4j_config_t *config, bool enable)
+{
+    REQUIRE(config != NULL, -1);
+    config->io_uring = enable;
+    return 0;
+}
+
+
+int neo4j_config_set_dns_cache_ttl(neo4j_config_t *config,
+        unsigned int ttl, unsigned int negative_ttl)
+{
+    REQUIRE(config != NULL, -1);
+    config->dns_cache_ttl = ttl;
+    config->dns_negative_cache_ttl = negative_ttl;
+    return 0;
+}
+
+
+int neo4j_config_set_connect_attempt_delay(neo4j_config_t *config,
+        unsigned int delay)
+{
+    REQUIRE(config != NULL, -1);
+    if (delay > INT_MAX)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+    config->connect_attempt_delay = delay;
+    return 0;
+}
+
+
+int neo4j_config_set_io_read_timeout(neo4j_config_t *config,
+        unsigned int timeout)
+{
+    REQUIRE(config != NULL, -1);
+    if (timeout > INT_MAX)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+    config->io_read_timeout = timeout;
+    return 0;
+}
+
+
+int neo4j_config_set_io_write_timeout(neo4j_config_t *config,
+        unsigned int timeout)
+{
+    REQUIRE(config != NULL, -1);
+    if (timeout > INT_MAX)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+    config->io_write_timeout = timeout;
+    return 0;
+}
+
+
 void neo4j_config_set_connection_factory(neo4j_config_t *config,
         struct neo4j_connection_factory *connection_factory)
 {
@@ -333,6 +527,13 @@ void neo4j_config_set_connection_factory(neo4j_config_t *config,
 }
 
 
+void neo4j_config_set_unix_connection_factory(neo4j_config_t *config,
+        struct neo4j_unix_connection_factory *factory)
+{
+    config->unix_connection_factory = factory;
+}
+
+
 void neo4j_config_set_memory_allocator(neo4j_config_t *config,
         struct neo4j_memory_allocator *allocator)
 {
@@ -345,3 +546,26 @@ void neo4j_config_set_max_pipelined_requests(neo4j_config_t *config,
 {
     config->max_pipelined_requests = n;
 }
+
+
+void neo4j_config_set_adaptive_pipelining(neo4j_config_t *config, bool enable)
+{
+    config->adaptive_pipelining = enable;
+}
+
+
+void neo4j_config_set_max_adaptive_pipelined_requests(neo4j_config_t *config,
+        unsigned int n)
+{
+    config->max_adaptive_pipelined_requests = n;
+}
+
+
+int neo4j_config_set_trace_callback(neo4j_config_t *config,
+        neo4j_trace_callback_t callback, void *userdata)
+{
+    REQUIRE(config != NULL, -1);
+    config->trace_callback = callback;
+    config->trace_callback_userdata = userdata;
+    return 0;
+}
@@ -25,12 +25,14 @@ struct neo4j_config
     struct neo4j_logger_provider *logger_provider;
 
     struct neo4j_connection_factory *connection_factory;
+    struct neo4j_unix_connection_factory *unix_connection_factory;
     struct neo4j_memory_allocator *allocator;
     unsigned int mpool_block_size;
 
     char *username;
     char *password;
     bool allow_empty_password;
+    bool pipelined_init;
     neo4j_authentication_reattempt_callback_t auth_reattempt_callback;
     void *auth_reattempt_callback_userdata;
 
@@ -38,7 +40,20 @@ struct neo4j_config
 
     unsigned int so_rcvbuf_size;
     unsigned int so_sndbuf_size;
+    bool tcp_nodelay;
+    bool tcp_quickack;
+    unsigned int tcp_keepalive_idle;
+    unsigned int tcp_keepalive_interval;
+    unsigned int tcp_keepalive_count;
+    unsigned int so_busy_poll;
+    unsigned int io_read_spin;
+    bool io_uring;
     time_t connect_timeout;
+    unsigned int connect_attempt_delay;
+    unsigned int dns_cache_ttl;
+    unsigned int dns_negative_cache_ttl;
+    unsigned int io_read_timeout;
+    unsigned int io_write_timeout;
 
     size_t io_rcvbuf_size;
     size_t io_sndbuf_size;
@@ -47,7 +62,11 @@ struct neo4j_config
     uint16_t snd_max_chunk_size;
 
     unsigned int session_request_queue_size;
+    unsigned int session_request_queue_max_size;
     unsigned int max_pipelined_requests;
+    bool adaptive_pipelining;
+    unsigned int max_adaptive_pipelined_requests;
+    size_t pipeline_response_budget;
 
 #ifdef HAVE_TLS
     char *tls_private_key_file;
@@ -55,6 +74,10 @@ struct neo4j_config
     void *tls_pem_pw_callback_userdata;
     char *tls_ca_file;
     char *tls_ca_dir;
+    unsigned int tls_min_version;
+    char *tls_ciphers;
+    char *tls_ciphersuites;
+    bool tls_kernel_offload;
 #endif
 
     bool trust_known;
@@ -62,6 +85,9 @@ struct neo4j_config
 
     neo4j_unverified_host_callback_t unverified_host_callback;
     void *unverified_host_callback_userdata;
+
+    neo4j_trace_callback_t trace_callback;
+    void *trace_callback_userdata;
 };
 
 
@@ -27,23 +27,44 @@
 #include "openssl_iostream.h"
 #endif
 #include "posix_iostream.h"
+#include "probes.h"
 #include "serialization.h"
+#include "uring_iostream.h"
 #include "util.h"
 #include <assert.h>
+#include <limits.h>
 #include <unistd.h>
 
 
 static int add_userinfo_to_config(const char *userinfo, neo4j_config_t *config);
 static neo4j_connection_t *establish_connection(const char *hostname,
-        unsigned int port, const char *connection_name, neo4j_config_t *config,
-        uint_fast32_t flags);
+        unsigned int port, bool local, const char *connection_name,
+        neo4j_config_t *config, uint_fast32_t flags);
 static neo4j_iostream_t *std_tcp_connect(
         struct neo4j_connection_factory *factory, const char *hostname,
         unsigned int port, neo4j_config_t *config, uint_fast32_t flags,
         struct neo4j_logger *logger);
+static neo4j_iostream_t *std_unix_connect(
+        struct neo4j_unix_connection_factory *factory, const char *path,
+        neo4j_config_t *config, uint_fast32_t flags,
+        struct neo4j_logger *logger);
+static neo4j_iostream_t *socket_iostream(int fd, bool tcp,
+        neo4j_config_t *config, struct neo4j_logger *logger);
 static int negotiate_protocol_version(neo4j_iostream_t *iostream,
         uint32_t *protocol_version);
 static int disconnect(neo4j_connection_t *connection);
+static void init_counting_iostream(neo4j_connection_t *connection,
+        neo4j_iostream_t *transport);
+static ssize_t counting_read(neo4j_iostream_t *self, void *buf, size_t nbyte);
+static ssize_t counting_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+static ssize_t counting_write(neo4j_iostream_t *self,
+        const void *buf, size_t nbyte);
+static ssize_t counting_writev(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+static int counting_flush(neo4j_iostream_t *self);
+static int counting_close(neo4j_iostream_t *self);
+static int counting_wait(neo4j_iostream_t *self, unsigned int timeout);
 
 
 struct neo4j_connection_factory neo4j_std_connection_factory =
@@ -52,6 +73,12 @@ struct neo4j_connection_factory neo4j_std_connection_factory =
 };
 
 
+struct neo4j_unix_connection_factory neo4j_std_unix_connection_factory =
+{
+    .unix_connect = &std_unix_connect
+};
+
+
 neo4j_connection_t *neo4j_connect(const char *uri_string,
         neo4j_config_t *config, uint_fast32_t flags)
 {
@@ -74,7 +101,20 @@ neo4j_connection_t *neo4j_connect(const char *uri_string,
         goto cleanup;
     }
 
-    if (uri->scheme == NULL ||
+    bool local = false;
+    if (uri->scheme != NULL &&
+            (strcmp(uri->scheme, "neo4j+unix") == 0 ||
+             strcmp(uri->scheme, "bolt+unix") == 0))
+    {
+        // the socket is named by the path, as in neo4j+unix:///path
+        if (uri->hostname != NULL || uri->port >= 0 || uri->path[0] != '/')
+        {
+            errno = NEO4J_INVALID_URI;
+            goto cleanup;
+        }
+        local = true;
+    }
+    else if (uri->scheme == NULL ||
             (strcmp(uri->scheme, "neo4j") != 0 &&
              strcmp(uri->scheme, "bolt") != 0))
     {
@@ -90,9 +130,17 @@ neo4j_connection_t *neo4j_connect(const char *uri_string,
         }
     }
 
-    unsigned int port = (uri->port > 0)? uri->port : NEO4J_DEFAULT_TCP_PORT;
-    connection = establish_connection(
-            uri->hostname, port, uri_string, config, flags);
+    if (local)
+    {
+        connection = establish_connection(
+                uri->path, 0, true, uri_string, config, flags);
+    }
+    else
+    {
+        unsigned int port = (uri->port > 0)? uri->port : NEO4J_DEFAULT_TCP_PORT;
+        connection = establish_connection(
+                uri->hostname, port, false, uri_string, config, flags);
+    }
 
     int errsv;
 cleanup:
@@ -159,13 +207,27 @@ neo4j_connection_t *neo4j_tcp_connect(const char *hostname, unsigned int port,
     {
         return NULL;
     }
-    return establish_connection(hostname, port, host, config, flags);
+    return establish_connection(hostname, port, false, host, config, flags);
+}
+
+
+neo4j_connection_t *neo4j_unix_connect(const char *path,
+        neo4j_config_t *config, uint_fast32_t flags)
+{
+    REQUIRE(path != NULL, NULL);
+
+    config = neo4j_config_dup(config);
+    if (config == NULL)
+    {
+        return NULL;
+    }
+    return establish_connection(path, 0, true, path, config, flags);
 }
 
 
 neo4j_connection_t *establish_connection(const char *hostname,
-        unsigned int port, const char *connection_name, neo4j_config_t *config,
-        uint_fast32_t flags)
+        unsigned int port, bool local, const char *connection_name,
+        neo4j_config_t *config, uint_fast32_t flags)
 {
     neo4j_logger_t *logger = neo4j_get_logger(config, "connection");
 
@@ -201,15 +263,32 @@ neo4j_connection_t *establish_connection(const char *hostname,
         goto failure;
     }
 
-    iostream = config->connection_factory->tcp_connect(
-            config->connection_factory, hostname, port, config, flags, logger);
+    if (!local)
+    {
+        struct neo4j_connection_factory *factory =
+            config->connection_factory;
+        iostream = factory->tcp_connect(factory, hostname, port, config,
+                flags, logger);
+    }
+    else if (config->unix_connection_factory != NULL)
+    {
+        struct neo4j_unix_connection_factory *factory =
+            config->unix_connection_factory;
+        iostream = factory->unix_connect(factory, hostname, config,
+                flags, logger);
+    }
+    else
+    {
+        errno = ENOTSUP;
+    }
     if (iostream == NULL)
     {
         goto failure;
     }
+    init_counting_iostream(connection, iostream);
 
     uint32_t protocol_version;
-    if (negotiate_protocol_version(iostream, &protocol_version))
+    if (negotiate_protocol_version(connection->iostream, &protocol_version))
     {
         char ebuf[256];
         neo4j_log_error(logger,
@@ -234,15 +313,16 @@ neo4j_connection_t *establish_connection(const char *hostname,
         goto failure;
     }
     connection->port = port;
-    connection->iostream = iostream;
     connection->version = protocol_version;
 #ifdef HAVE_TLS
-    connection->insecure = flags & NEO4J_INSECURE;
+    // unix domain sockets are protected by filesystem permissions instead
+    connection->insecure = local || (flags & NEO4J_INSECURE);
 #else
     connection->insecure = true;
 #endif
     connection->snd_buffer = snd_buffer;
     connection->request_queue = request_queue;
+    connection->request_queue_size = config->session_request_queue_size;
 
     neo4j_log_info(logger, "connected (%p) to '%s'%s", (void *)connection,
             connection_name, connection->insecure? " (insecure)" : "");
@@ -296,7 +376,7 @@ neo4j_iostream_t *std_tcp_connect(struct neo4j_connection_factory *factory,
     neo4j_log_trace(logger, "opened socket to %s [%d] (fd=%d)",
             hostname, port, fd);
 
-    neo4j_iostream_t *ios = neo4j_posix_iostream(fd);
+    neo4j_iostream_t *ios = socket_iostream(fd, true, config, logger);
     if (ios == NULL)
     {
         goto failure;
@@ -344,6 +424,85 @@ failure:
 }
 
 
+neo4j_iostream_t *std_unix_connect(
+        struct neo4j_unix_connection_factory *factory, const char *path,
+        neo4j_config_t *config, uint_fast32_t flags,
+        struct neo4j_logger *logger)
+{
+    REQUIRE(factory != NULL, NULL);
+    REQUIRE(config != NULL, NULL);
+    REQUIRE(path != NULL, NULL);
+
+    int fd = neo4j_connect_unix_socket(path, config, logger);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    neo4j_log_trace(logger, "opened socket to %s (fd=%d)", path, fd);
+
+    neo4j_iostream_t *ios = socket_iostream(fd, false, config, logger);
+    if (ios == NULL)
+    {
+        int errsv = errno;
+        close(fd);
+        errno = errsv;
+        return NULL;
+    }
+
+    if (config->io_sndbuf_size > 0 || config->io_rcvbuf_size > 0)
+    {
+        neo4j_iostream_t *buffering_ios = neo4j_buffering_iostream(ios, true,
+                config->io_sndbuf_size, config->io_rcvbuf_size);
+        if (buffering_ios == NULL)
+        {
+            int errsv = errno;
+            neo4j_ios_close(ios);
+            errno = errsv;
+            return NULL;
+        }
+        ios = buffering_ios;
+    }
+
+    return ios;
+}
+
+
+neo4j_iostream_t *socket_iostream(int fd, bool tcp, neo4j_config_t *config,
+        struct neo4j_logger *logger)
+{
+    // the shared ring has no support for timeouts, so they take precedence
+    if (config->io_uring && config->io_read_timeout == 0 &&
+            config->io_write_timeout == 0)
+    {
+        neo4j_iostream_t *ios = neo4j_uring_iostream(fd);
+        if (ios != NULL)
+        {
+            neo4j_log_trace(logger, "using io_uring (fd=%d)", fd);
+            return ios;
+        }
+        neo4j_log_debug_errno(logger, "io_uring unavailable");
+    }
+
+    neo4j_iostream_t *ios = neo4j_posix_iostream_with_timeouts(fd,
+            config->io_read_timeout, config->io_write_timeout);
+    if (ios == NULL)
+    {
+        return NULL;
+    }
+    if (config->io_read_spin > 0)
+    {
+        neo4j_posix_iostream_set_read_spin(ios, config->io_read_spin);
+    }
+    if (tcp && config->tcp_quickack)
+    {
+        // a no-op where TCP_QUICKACK is unavailable
+        neo4j_posix_iostream_set_quickack(ios, true);
+    }
+    return ios;
+}
+
+
 int neo4j_close(neo4j_connection_t *connection)
 {
     REQUIRE(connection != NULL, -1);
@@ -382,10 +541,99 @@ int disconnect(neo4j_connection_t *connection)
     }
     int result = neo4j_ios_close(connection->iostream);
     connection->iostream = NULL;
+    connection->transport = NULL;
     return result;
 }
 
 
+void init_counting_iostream(neo4j_connection_t *connection,
+        neo4j_iostream_t *transport)
+{
+    neo4j_iostream_t *ios = neo4j_waitable_ios_init(
+            &(connection->_counting_iostream), counting_close,
+            neo4j_ios_can_wait(transport)? counting_wait : NULL);
+    ios->read = counting_read;
+    ios->readv = counting_readv;
+    ios->write = counting_write;
+    ios->writev = counting_writev;
+    ios->flush = counting_flush;
+    connection->transport = transport;
+    connection->iostream = ios;
+}
+
+
+ssize_t counting_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    if (connection->rcv_deadline > 0 &&
+            neo4j_connection_wait(connection, connection->rcv_deadline))
+    {
+        return -1;
+    }
+    (connection->stats.reads)++;
+    return neo4j_ios_read(connection->transport, buf, nbyte);
+}
+
+
+ssize_t counting_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    if (connection->rcv_deadline > 0 &&
+            neo4j_connection_wait(connection, connection->rcv_deadline))
+    {
+        return -1;
+    }
+    (connection->stats.reads)++;
+    return neo4j_ios_readv(connection->transport, iov, iovcnt);
+}
+
+
+ssize_t counting_write(neo4j_iostream_t *self, const void *buf, size_t nbyte)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    (connection->stats.writes)++;
+    return neo4j_ios_write(connection->transport, buf, nbyte);
+}
+
+
+ssize_t counting_writev(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    (connection->stats.writes)++;
+    return neo4j_ios_writev(connection->transport, iov, iovcnt);
+}
+
+
+int counting_flush(neo4j_iostream_t *self)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    return neo4j_ios_flush(connection->transport);
+}
+
+
+int counting_close(neo4j_iostream_t *self)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    return neo4j_ios_close(connection->transport);
+}
+
+
+int counting_wait(neo4j_iostream_t *self, unsigned int timeout)
+{
+    neo4j_connection_t *connection = container_of(self,
+            neo4j_connection_t, _counting_iostream._iostream);
+    return neo4j_ios_wait(connection->transport, timeout);
+}
+
+
 int negotiate_protocol_version(neo4j_iostream_t *iostream,
         uint32_t *protocol_version)
 {
@@ -432,9 +680,22 @@ int neo4j_connection_send(neo4j_connection_t *connection,
     }
 
     const neo4j_config_t *config = connection->config;
-    int res = neo4j_message_send(connection->iostream, type, argv, argc,
+    struct neo4j_message_size size = { 0, 0 };
+    int res = neo4j_message_send_sized(connection->iostream, type, argv, argc,
             connection->snd_buffer, config->snd_min_chunk_size,
-            config->snd_max_chunk_size);
+            config->snd_max_chunk_size, &size);
+    if (res == 0)
+    {
+        // each chunk, and the end marker, carries a 2 byte header
+        connection->stats.bytes_sent += size.nbytes + 2 * (size.nchunks + 1);
+        connection->stats.chunks_sent += size.nchunks;
+        (connection->stats.messages_sent)++;
+        if (NEO4J_PROBE_ENABLED(message_send))
+        {
+            NEO4J_PROBE4(message_send, connection, type->name,
+                    size.nbytes + 2 * (size.nchunks + 1), size.nchunks);
+        }
+    }
     if (res && errno != NEO4J_CONNECTION_CLOSED)
     {
         char ebuf[256];
@@ -447,7 +708,8 @@ int neo4j_connection_send(neo4j_connection_t *connection,
 
 
 int neo4j_connection_recv(neo4j_connection_t *connection, neo4j_mpool_t *mpool,
-        neo4j_message_type_t *type, const neo4j_value_t **argv, uint16_t *argc)
+        uint64_t deadline, neo4j_message_type_t *type,
+        const neo4j_value_t **argv, uint16_t *argc)
 {
     REQUIRE(connection != NULL, -1);
     if (connection->iostream == NULL)
@@ -456,7 +718,23 @@ int neo4j_connection_recv(neo4j_connection_t *connection, neo4j_mpool_t *mpool,
         return -1;
     }
 
-    int res = neo4j_message_recv(connection->iostream, mpool, type, argv, argc);
+    struct neo4j_message_size size = { 0, 0 };
+    connection->rcv_deadline = deadline;
+    int res = neo4j_message_recv_sized(connection->iostream, mpool,
+            type, argv, argc, &size);
+    connection->rcv_deadline = 0;
+    if (res == 0)
+    {
+        connection->stats.bytes_received +=
+            size.nbytes + 2 * (size.nchunks + 1);
+        connection->stats.chunks_received += size.nchunks;
+        (connection->stats.messages_received)++;
+        if (NEO4J_PROBE_ENABLED(message_recv))
+        {
+            NEO4J_PROBE4(message_recv, connection, (*type)->name,
+                    size.nbytes + 2 * (size.nchunks + 1), size.nchunks);
+        }
+    }
     if (res && errno != NEO4J_CONNECTION_CLOSED)
     {
         char ebuf[256];
@@ -468,6 +746,40 @@ int neo4j_connection_recv(neo4j_connection_t *connection, neo4j_mpool_t *mpool,
 }
 
 
+int neo4j_connection_wait(neo4j_connection_t *connection, uint64_t deadline)
+{
+    REQUIRE(connection != NULL, -1);
+    if (connection->iostream == NULL)
+    {
+        errno = NEO4J_CONNECTION_CLOSED;
+        return -1;
+    }
+
+    uint64_t now = monotonic_ns();
+    uint64_t remaining = (deadline > now)? deadline - now : 0;
+    // round up, so the wait never returns before the deadline
+    uint64_t timeout = (remaining + 999999) / 1000000;
+    if (neo4j_ios_wait(connection->iostream,
+                (timeout < UINT_MAX)? timeout : UINT_MAX) == 0)
+    {
+        return 0;
+    }
+    if (errno != ENOTSUP)
+    {
+        return -1;
+    }
+
+    // without support for waiting, the deadline can only be checked
+    // before blocking to receive
+    if (remaining == 0)
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}
+
+
 int neo4j_attach_session(neo4j_connection_t *connection,
         neo4j_session_t *session)
 {
@@ -485,13 +797,22 @@ int neo4j_attach_session(neo4j_connection_t *connection,
         return -1;
     }
     session->request_queue = connection->request_queue;
-    session->request_queue_size =
-        connection->config->session_request_queue_size;
+    session->request_queue_size = connection->request_queue_size;
     connection->session = session;
     return 0;
 }
 
 
+int neo4j_connection_stats(neo4j_connection_t *connection,
+        struct neo4j_connection_stats *stats)
+{
+    REQUIRE(connection != NULL, -1);
+    REQUIRE(stats != NULL, -1);
+    memcpy(stats, &(connection->stats), sizeof(struct neo4j_connection_stats));
+    return 0;
+}
+
+
 int neo4j_detach_session(neo4j_connection_t *connection,
         neo4j_session_t *session, bool reusable)
 {
@@ -33,11 +33,19 @@ struct neo4j_connection
     unsigned int port;
 
     neo4j_iostream_t *iostream;
+    neo4j_iostream_t *transport;
+    // counts operations on the transport (iostream is set to this)
+    struct neo4j_waitable_iostream _counting_iostream;
+    // while receiving, each read from the transport must complete by this
+    uint64_t rcv_deadline;
     uint32_t version;
     bool insecure;
 
     uint8_t *snd_buffer;
     struct neo4j_request *request_queue;
+    unsigned int request_queue_size;
+
+    struct neo4j_connection_stats stats;
 
     neo4j_session_t *session;
 };
@@ -63,22 +71,45 @@ int neo4j_connection_send(neo4j_connection_t *connection,
 /**
  * Receive a message on a connection.
  *
- * This call may block until data is available from the network.
+ * This call may block until data is available from the network. If a
+ * deadline is given, it bounds every read of the message, so that a message
+ * only partially received by the deadline also fails.
  *
  * @internal
  *
  * @param [connection] The connection to receive from.
  * @param [mpool] A memory pool to allocate values and buffer spaces in.
+ * @param [deadline] The time by which the message must be received, on the
+ *         monotonic clock (in nanoseconds), or 0 for no deadline.
  * @param [type] A pointer to a message type, which will be updated.
  * @param [argv] A pointer to an argument vector, which will be updated
  *         to point to the received message arguments.
  * @param [argc] A pointer to a `uin16_t`, which will be updated with the
  *         length of the received argument vector.
- * @return 0 on success, -1 on failure (errno will be set).
+ * @return 0 on success, -1 on failure (errno will be set to `ETIMEDOUT` if
+ *         the deadline expired).
  */
 __neo4j_must_check
 int neo4j_connection_recv(neo4j_connection_t *connection, neo4j_mpool_t *mpool,
-        neo4j_message_type_t *type, const neo4j_value_t **argv, uint16_t *argc);
+        uint64_t deadline, neo4j_message_type_t *type,
+        const neo4j_value_t **argv, uint16_t *argc);
+
+/**
+ * Wait for a message to be available on a connection.
+ *
+ * @internal
+ *
+ * If the connection does not support waiting, this call returns immediately
+ * unless the deadline has already expired.
+ *
+ * @param [connection] The connection to wait on.
+ * @param [deadline] The time to wait until, on the monotonic clock (in
+ *         nanoseconds).
+ * @return 0 on success, -1 on failure (errno will be set to `ETIMEDOUT` if
+ *         the deadline expired).
+ */
+__neo4j_must_check
+int neo4j_connection_wait(neo4j_connection_t *connection, uint64_t deadline);
 
 /**
  * Attach a session to a connection.
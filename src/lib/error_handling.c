@@ -92,6 +92,8 @@ const char *neo4j_strerror(int errnum, char *buf, size_t buflen)
         return "Too many authentication attempts - wait 5 seconds before trying again";
     case NEO4J_TLS_MALFORMED_CERTIFICATE:
         return "Server presented a malformed TLS certificate";
+    case NEO4J_STATEMENT_TIMEOUT:
+        return "Statement timed out and was cancelled";
     default:
 #ifdef STRERROR_R_CHAR_P
         return strerror_r(errnum, buf, buflen);
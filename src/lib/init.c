@@ -19,7 +19,9 @@
 #ifdef HAVE_OPENSSL
 #include "openssl.h"
 #endif
+#include "network.h"
 #include "thread.h"
+#include "uring.h"
 #include <errno.h>
 
 
@@ -59,6 +61,11 @@ int neo4j_client_cleanup(void)
 void do_init(void)
 {
     init_errno = 0;
+    if (neo4j_network_init())
+    {
+        init_errno = errno;
+        return;
+    }
 #ifdef HAVE_OPENSSL
     if (neo4j_openssl_init())
     {
@@ -77,6 +84,14 @@ void do_cleanup(void)
         cleanup_errno = errno;
     }
 #endif
+    if (neo4j_uring_cleanup() && cleanup_errno == 0)
+    {
+        cleanup_errno = errno;
+    }
+    if (neo4j_network_cleanup() && cleanup_errno == 0)
+    {
+        cleanup_errno = errno;
+    }
 }
 
 
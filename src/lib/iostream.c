@@ -22,6 +22,14 @@
 #include <unistd.h>
 
 
+int neo4j_waitable_ios_close(neo4j_iostream_t *stream)
+{
+    struct neo4j_waitable_iostream *ios = container_of(stream,
+            struct neo4j_waitable_iostream, _iostream);
+    return ios->close(stream);
+}
+
+
 int neo4j_ios_read_all(neo4j_iostream_t *stream,
         void *buf, size_t nbyte, size_t *received)
 {
@@ -18,10 +18,83 @@
 #define NEO4J_IOSTREAM_H
 
 #include "neo4j-client.h"
+#include <errno.h>
+#include <stddef.h>
 
 typedef struct neo4j_iostream neo4j_iostream_t;
 
 
+/**
+ * An iostream created by the library that also supports waiting for input.
+ *
+ * `struct neo4j_iostream` is part of the public ABI and cannot grow, so the
+ * library's own iostreams embed it here instead. The embedded iostream's
+ * close function is set to `neo4j_waitable_ios_close`, which identifies the
+ * extension and dispatches to `close`.
+ *
+ * @internal
+ */
+struct neo4j_waitable_iostream
+{
+    neo4j_iostream_t _iostream;
+    int (*close)(neo4j_iostream_t *self);
+    int (*wait)(neo4j_iostream_t *self, unsigned int timeout);
+};
+
+/**
+ * Close a waitable iostream, via its `close` function.
+ *
+ * @internal
+ *
+ * @param [ios] The embedded iostream of a `struct neo4j_waitable_iostream`.
+ * @return 0 on success, -1 on error (errno will be set).
+ */
+int neo4j_waitable_ios_close(neo4j_iostream_t *ios);
+
+/**
+ * Initialize the close and wait functions of a waitable iostream.
+ *
+ * The remaining functions of the embedded iostream must be set by the caller.
+ *
+ * @internal
+ *
+ * @param [ios] The waitable iostream.
+ * @param [close] The function closing the iostream.
+ * @param [wait] The function waiting for input, or `NULL` if unsupported.
+ * @return The embedded iostream.
+ */
+static inline neo4j_iostream_t *neo4j_waitable_ios_init(
+        struct neo4j_waitable_iostream *ios,
+        int (*close)(neo4j_iostream_t *self),
+        int (*wait)(neo4j_iostream_t *self, unsigned int timeout))
+{
+    ios->_iostream.close = neo4j_waitable_ios_close;
+    ios->close = close;
+    ios->wait = wait;
+    return &(ios->_iostream);
+}
+
+/**
+ * Get the waitable extension of an iostream.
+ *
+ * @internal
+ *
+ * @param [ios] The iostream.
+ * @return The waitable iostream, or `NULL` if the iostream was not created
+ *         by the library.
+ */
+static inline struct neo4j_waitable_iostream *neo4j_waitable_ios(
+        neo4j_iostream_t *ios)
+{
+    if (ios->close != neo4j_waitable_ios_close)
+    {
+        return NULL;
+    }
+    return (struct neo4j_waitable_iostream *)(void *)((char *)ios -
+            offsetof(struct neo4j_waitable_iostream, _iostream));
+}
+
+
 /**
  * Read from an iostream into a buffer.
  *
@@ -229,6 +302,42 @@ static inline int neo4j_ios_flush(neo4j_iostream_t *ios)
     return ios->flush(ios);
 }
 
+/**
+ * Wait until bytes are available to be read from an iostream.
+ *
+ * @internal
+ *
+ * @param [ios] The iostream to wait on.
+ * @param [timeout] The maximum time to wait, in milliseconds.
+ * @return 0 if bytes are available, or -1 on error (errno will be set to
+ *         `ETIMEDOUT` if the timeout expired, or `ENOTSUP` if the iostream
+ *         does not support waiting).
+ */
+static inline int neo4j_ios_wait(neo4j_iostream_t *ios, unsigned int timeout)
+{
+    struct neo4j_waitable_iostream *wios = neo4j_waitable_ios(ios);
+    if (wios == NULL || wios->wait == NULL)
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return wios->wait(ios, timeout);
+}
+
+/**
+ * Check if an iostream supports waiting for input.
+ *
+ * @internal
+ *
+ * @param [ios] The iostream.
+ * @return `true` if `neo4j_ios_wait` is supported by the iostream.
+ */
+static inline bool neo4j_ios_can_wait(neo4j_iostream_t *ios)
+{
+    struct neo4j_waitable_iostream *wios = neo4j_waitable_ios(ios);
+    return wios != NULL && wios->wait != NULL;
+}
+
 /**
  * Close the iostream.
  *
@@ -16,12 +16,19 @@
  */
 #include "../../config.h"
 #include "logging.h"
+#include "thread.h"
 #include "util.h"
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
+// how long the writer thread sleeps, when idle, before checking for entries
+// again (in case a wakeup is missed)
+#define ASYNC_LOGGER_IDLE_WAIT_NS 100000000
+
 
 void neo4j_log_errno(neo4j_logger_t *logger, uint_fast8_t level,
         const char *message)
@@ -32,6 +39,8 @@ void neo4j_log_errno(neo4j_logger_t *logger, uint_fast8_t level,
 }
 
 
+struct neo4j_async_logger_provider;
+
 static struct neo4j_logger *std_provider_get_logger(
         struct neo4j_logger_provider *self, const char *name);
 static struct neo4j_std_logger *find_std_logger(
@@ -49,6 +58,16 @@ static bool std_logger_is_enabled(struct neo4j_logger *self,
         uint_fast8_t level);
 static void std_logger_set_level(struct neo4j_logger *self,
         uint_fast8_t level);
+static struct neo4j_logger *async_provider_get_logger(
+        struct neo4j_logger_provider *self, const char *name);
+static void async_logger_log(struct neo4j_logger *self, uint_fast8_t level,
+        const char *format, va_list ap);
+static void *async_logger_writer(void *arg);
+static bool async_logger_write_next(
+        struct neo4j_async_logger_provider *provider);
+static void async_logger_report_dropped(
+        struct neo4j_async_logger_provider *provider);
+static void async_logger_idle(struct neo4j_async_logger_provider *provider);
 
 
 struct neo4j_std_logger
@@ -59,6 +78,7 @@ struct neo4j_std_logger
     volatile uint_fast8_t level;
     uint_fast32_t flags;
     char *name;
+    struct neo4j_async_logger_provider *async;
     struct neo4j_std_logger *prev;
     struct neo4j_std_logger *next;
 };
@@ -74,6 +94,39 @@ struct neo4j_std_logger_provider
 };
 
 
+struct async_log_entry
+{
+    // the position in the ring the entry is next available for: equal to
+    // the position when free, and one beyond once written
+    atomic_size_t seq;
+    size_t length;
+    char text[NEO4J_ASYNC_LOGGER_MAX_ENTRY];
+};
+
+
+struct neo4j_async_logger_provider
+{
+    struct neo4j_logger_provider _provider;
+    FILE *stream;
+    uint_fast8_t level;
+    uint_fast32_t flags;
+    struct neo4j_std_logger loggers;
+
+    struct async_log_entry *ring;
+    size_t mask;
+    atomic_size_t tail;
+    size_t head;
+    atomic_ullong dropped;
+    unsigned long long reported_dropped;
+
+    neo4j_thread_t writer;
+    neo4j_mutex_t mutex;
+    neo4j_cond_t cond;
+    atomic_bool sleeping;
+    atomic_bool stopping;
+};
+
+
 struct neo4j_logger_provider *neo4j_std_logger_provider(FILE *stream,
         uint_fast8_t level, uint_fast32_t flags)
 {
@@ -238,6 +291,12 @@ void std_logger_log(struct neo4j_logger *self, uint_fast8_t level,
         return;
     }
 
+    if (logger->async != NULL)
+    {
+        async_logger_log(self, level, format, ap);
+        return;
+    }
+
     const char *levelname = neo4j_log_level_str(level);
 
     flockfile(logger->stream);
@@ -270,6 +329,278 @@ void std_logger_set_level(struct neo4j_logger *self, uint_fast8_t level)
 }
 
 
+struct neo4j_logger_provider *neo4j_async_logger_provider(FILE *stream,
+        uint_fast8_t level, uint_fast32_t flags, unsigned int capacity)
+{
+    REQUIRE(stream != NULL, NULL);
+
+    size_t nentries = (capacity > 0)?
+        capacity : NEO4J_ASYNC_LOGGER_DEFAULT_CAPACITY;
+    size_t size = 1;
+    while (size < nentries)
+    {
+        size <<= 1;
+    }
+
+    struct neo4j_async_logger_provider *async_provider = calloc(1,
+            sizeof(struct neo4j_async_logger_provider));
+    if (async_provider == NULL)
+    {
+        return NULL;
+    }
+
+    async_provider->ring = calloc(size, sizeof(struct async_log_entry));
+    if (async_provider->ring == NULL)
+    {
+        goto failure;
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        atomic_init(&(async_provider->ring[i].seq), i);
+    }
+    async_provider->mask = size - 1;
+    atomic_init(&(async_provider->tail), 0);
+    atomic_init(&(async_provider->dropped), 0);
+    atomic_init(&(async_provider->sleeping), false);
+    atomic_init(&(async_provider->stopping), false);
+
+    async_provider->stream = stream;
+    async_provider->level = level;
+    async_provider->flags = flags;
+
+    if ((errno = neo4j_mutex_init(&(async_provider->mutex))) != 0)
+    {
+        goto failure;
+    }
+    if ((errno = neo4j_cond_init(&(async_provider->cond))) != 0)
+    {
+        neo4j_mutex_destroy(&(async_provider->mutex));
+        goto failure;
+    }
+    if ((errno = neo4j_thread_create(&(async_provider->writer),
+                    async_logger_writer, async_provider)) != 0)
+    {
+        neo4j_cond_destroy(&(async_provider->cond));
+        neo4j_mutex_destroy(&(async_provider->mutex));
+        goto failure;
+    }
+
+    struct neo4j_logger_provider *provider = &(async_provider->_provider);
+    provider->get_logger = async_provider_get_logger;
+    return provider;
+
+    int errsv;
+failure:
+    errsv = errno;
+    free(async_provider->ring);
+    free(async_provider);
+    errno = errsv;
+    return NULL;
+}
+
+
+void neo4j_async_logger_provider_free(struct neo4j_logger_provider *provider)
+{
+    struct neo4j_async_logger_provider *p = container_of(provider,
+        struct neo4j_async_logger_provider, _provider);
+
+    // remaining loggers write directly to the stream from now on
+    for (struct neo4j_std_logger *logger = p->loggers.next; logger != NULL;
+            logger = logger->next)
+    {
+        logger->async = NULL;
+    }
+    assert(p->loggers.prev == NULL);
+    if (p->loggers.next != NULL)
+    {
+        p->loggers.next->prev = NULL;
+    }
+
+    neo4j_mutex_lock(&(p->mutex));
+    atomic_store(&(p->stopping), true);
+    neo4j_cond_signal(&(p->cond));
+    neo4j_mutex_unlock(&(p->mutex));
+    neo4j_thread_join(p->writer);
+
+    neo4j_cond_destroy(&(p->cond));
+    neo4j_mutex_destroy(&(p->mutex));
+    free(p->ring);
+    p->stream = NULL;
+    free(p);
+}
+
+
+unsigned long long neo4j_async_logger_dropped(
+        struct neo4j_logger_provider *provider)
+{
+    REQUIRE(provider != NULL, 0);
+    struct neo4j_async_logger_provider *p = container_of(provider,
+        struct neo4j_async_logger_provider, _provider);
+    return atomic_load(&(p->dropped));
+}
+
+
+struct neo4j_logger *async_provider_get_logger(
+        struct neo4j_logger_provider *self, const char *name)
+{
+    struct neo4j_async_logger_provider *p = container_of(self,
+        struct neo4j_async_logger_provider, _provider);
+
+    struct neo4j_std_logger *stdlogger = find_std_logger(p->loggers.next, name);
+    if (stdlogger == NULL)
+    {
+        stdlogger = new_std_logger(p->stream, p->level, p->flags, name);
+        if (stdlogger == NULL)
+        {
+            return NULL;
+        }
+        stdlogger->async = p;
+        std_logger_list_add(&(p->loggers), stdlogger);
+    }
+
+    return &(stdlogger->_logger);
+}
+
+
+void async_logger_log(struct neo4j_logger *self, uint_fast8_t level,
+        const char *format, va_list ap)
+{
+    struct neo4j_std_logger *logger = container_of(self,
+            struct neo4j_std_logger, _logger);
+    struct neo4j_async_logger_provider *p = logger->async;
+
+    // claim the next free entry, as per a bounded MPMC queue
+    size_t pos = atomic_load_explicit(&(p->tail), memory_order_relaxed);
+    struct async_log_entry *entry;
+    for (;;)
+    {
+        entry = &(p->ring[pos & p->mask]);
+        size_t seq = atomic_load_explicit(&(entry->seq),
+                memory_order_acquire);
+        if (seq == pos)
+        {
+            if (atomic_compare_exchange_weak_explicit(&(p->tail), &pos,
+                        pos + 1, memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if ((ptrdiff_t)(seq - pos) < 0)
+        {
+            // full
+            atomic_fetch_add_explicit(&(p->dropped), 1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&(p->tail), memory_order_relaxed);
+        }
+    }
+
+    // the message must be formatted now, as the arguments may not outlive
+    // this call, but writing to the stream is deferred
+    size_t length = 0;
+    if ((logger->flags & NEO4J_STD_LOGGER_NO_PREFIX) == 0)
+    {
+        int n = snprintf(entry->text, sizeof(entry->text), "%-5s [%s]: ",
+                neo4j_log_level_str(level), logger->name);
+        length = (n < 0)? 0 : minzu(n, sizeof(entry->text) - 1);
+    }
+    int n = vsnprintf(entry->text + length, sizeof(entry->text) - length,
+            format, ap);
+    length = (n < 0)? length : minzu(length + n, sizeof(entry->text) - 2);
+    entry->text[length++] = '\n';
+    entry->length = length;
+
+    atomic_store(&(entry->seq), pos + 1);
+    if (atomic_load(&(p->sleeping)))
+    {
+        neo4j_mutex_lock(&(p->mutex));
+        neo4j_cond_signal(&(p->cond));
+        neo4j_mutex_unlock(&(p->mutex));
+    }
+}
+
+
+void *async_logger_writer(void *arg)
+{
+    struct neo4j_async_logger_provider *p = arg;
+    for (;;)
+    {
+        while (async_logger_write_next(p))
+            ;
+        async_logger_report_dropped(p);
+        fflush(p->stream);
+        // entries logged before stopping was set are written before exiting
+        if (atomic_load(&(p->stopping)) && !async_logger_write_next(p))
+        {
+            break;
+        }
+        async_logger_idle(p);
+    }
+    return NULL;
+}
+
+
+bool async_logger_write_next(struct neo4j_async_logger_provider *p)
+{
+    struct async_log_entry *entry = &(p->ring[p->head & p->mask]);
+    if (atomic_load(&(entry->seq)) != p->head + 1)
+    {
+        return false;
+    }
+    fwrite(entry->text, 1, entry->length, p->stream);
+    atomic_store_explicit(&(entry->seq), p->head + p->mask + 1,
+            memory_order_release);
+    (p->head)++;
+    return true;
+}
+
+
+void async_logger_report_dropped(struct neo4j_async_logger_provider *p)
+{
+    unsigned long long dropped = atomic_load_explicit(&(p->dropped),
+            memory_order_relaxed);
+    if (dropped == p->reported_dropped)
+    {
+        return;
+    }
+    if ((p->flags & NEO4J_STD_LOGGER_NO_PREFIX) == 0)
+    {
+        fprintf(p->stream, "%-5s [%s]: ", neo4j_log_level_str(NEO4J_LOG_WARN),
+                "logging");
+    }
+    fprintf(p->stream, "%llu log entries dropped\n",
+            dropped - p->reported_dropped);
+    p->reported_dropped = dropped;
+}
+
+
+void async_logger_idle(struct neo4j_async_logger_provider *p)
+{
+    neo4j_mutex_lock(&(p->mutex));
+    atomic_store(&(p->sleeping), true);
+    // check again after setting sleeping, so that an entry published
+    // concurrently is either seen here or signalled
+    struct async_log_entry *entry = &(p->ring[p->head & p->mask]);
+    if (atomic_load(&(entry->seq)) != p->head + 1 &&
+            !atomic_load(&(p->stopping)))
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += ASYNC_LOGGER_IDLE_WAIT_NS;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec += 1;
+            ts.tv_nsec -= 1000000000;
+        }
+        neo4j_cond_timedwait(&(p->cond), &(p->mutex), &ts);
+    }
+    atomic_store(&(p->sleeping), false);
+    neo4j_mutex_unlock(&(p->mutex));
+}
+
+
 const char *neo4j_log_level_str(uint_fast8_t level)
 {
     switch (level)
@@ -16,6 +16,7 @@
  */
 #include "../../config.h"
 #include "memory.h"
+#include "probes.h"
 #include "util.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -106,6 +107,7 @@ ssize_t neo4j_mpool_add(neo4j_mpool_t *pool, void *ptr)
         if (pool->debounce_offset < NEO4J_MPOOL_DEBOUNCE)
         {
             pool->debounce_ptrs[(pool->debounce_offset)++] = ptr;
+            NEO4J_PROBE2(mpool_add, pool, pool->depth + 1);
             return ++(pool->depth);
         }
 
@@ -116,6 +118,7 @@ ssize_t neo4j_mpool_add(neo4j_mpool_t *pool, void *ptr)
     }
 
     pool->ptrs[(pool->offset)++] = ptr;
+    NEO4J_PROBE2(mpool_add, pool, pool->depth + 1);
     return ++(pool->depth);
 }
 
@@ -145,6 +148,7 @@ void neo4j_mpool_drainto(neo4j_mpool_t *pool, size_t depth)
     {
         return;
     }
+    NEO4J_PROBE3(mpool_drainto, pool, pool->depth, depth);
 
     size_t todrain = pool->depth - depth;
 
@@ -208,7 +212,7 @@ ssize_t neo4j_mpool_merge(neo4j_mpool_t *pool1, neo4j_mpool_t *pool2)
         pool2 = &tpool;
     }
 
-    if (pool1->offset == pool1->block_size)
+    if (pool1->offset == pool1->block_size && pool2->ptrs != NULL)
     {
         // shortcut
         return concat_pools(pool1, pool2);
@@ -114,6 +114,7 @@ typedef struct neo4j_mpool
     void **ptrs;
     unsigned int offset;
     size_t depth;
+    size_t allocated; // total bytes allocated via the pool
 } neo4j_mpool_t;
 
 
@@ -209,6 +210,7 @@ static inline void *neo4j_mpool_alloc(neo4j_mpool_t *pool, size_t size)
         errno = errsv;
         return NULL;
     }
+    pool->allocated += size;
     return ptr;
 }
 
@@ -238,6 +240,7 @@ static inline void *neo4j_mpool_calloc(neo4j_mpool_t *pool,
         errno = errsv;
         return NULL;
     }
+    pool->allocated += count * size;
     return ptr;
 }
 
@@ -79,6 +79,15 @@ neo4j_message_type_t neo4j_message_type_for_signature(uint8_t signature)
 int neo4j_message_send(neo4j_iostream_t *ios, neo4j_message_type_t type,
         const neo4j_value_t *argv, uint16_t argc, uint8_t *buffer,
         uint16_t bsize, uint16_t max_chunk)
+{
+    return neo4j_message_send_sized(ios, type, argv, argc, buffer, bsize,
+            max_chunk, NULL);
+}
+
+
+int neo4j_message_send_sized(neo4j_iostream_t *ios, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc, uint8_t *buffer,
+        uint16_t bsize, uint16_t max_chunk, struct neo4j_message_size *size)
 {
     REQUIRE(ios != NULL, -1);
     REQUIRE(argc == 0 || argv != NULL, -1);
@@ -94,6 +103,11 @@ int neo4j_message_send(neo4j_iostream_t *ios, neo4j_message_type_t type,
     }
 
     neo4j_ios_close(cios);
+    if (size != NULL)
+    {
+        size->nbytes = chunking_ios.snd_total;
+        size->nchunks = chunking_ios.snd_chunks;
+    }
     return 0;
 }
 
@@ -101,6 +115,15 @@ int neo4j_message_send(neo4j_iostream_t *ios, neo4j_message_type_t type,
 int neo4j_message_recv(neo4j_iostream_t *ios,
         neo4j_mpool_t *mpool, neo4j_message_type_t *type,
         const neo4j_value_t **argv, uint16_t *argc)
+{
+    return neo4j_message_recv_sized(ios, mpool, type, argv, argc, NULL);
+}
+
+
+int neo4j_message_recv_sized(neo4j_iostream_t *ios,
+        neo4j_mpool_t *mpool, neo4j_message_type_t *type,
+        const neo4j_value_t **argv, uint16_t *argc,
+        struct neo4j_message_size *size)
 {
     REQUIRE(ios != NULL, -1);
     REQUIRE(mpool != NULL, -1);
@@ -140,6 +163,11 @@ int neo4j_message_recv(neo4j_iostream_t *ios,
     {
         *argc = neo4j_struct_size(message);
     }
+    if (size != NULL)
+    {
+        size->nbytes = chunking_ios.rcv_total;
+        size->nchunks = chunking_ios.rcv_chunks;
+    }
 
     neo4j_ios_close(cios);
     return 0;
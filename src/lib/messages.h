@@ -47,6 +47,12 @@ static inline const char *neo4j_message_type_str(neo4j_message_type_t type)
     return type->name;
 }
 
+struct neo4j_message_size
+{
+    size_t nbytes; // message bytes, excluding chunk headers
+    unsigned int nchunks; // chunks, excluding the end marker
+};
+
 
 /**
  * Send a message on an iostream.
@@ -70,6 +76,28 @@ int neo4j_message_send(neo4j_iostream_t *ios, neo4j_message_type_t type,
         const neo4j_value_t *argv, uint16_t argc, uint8_t *buffer,
         uint16_t bsize, uint16_t max_chunk);
 
+/**
+ * Send a message on an iostream, reporting its size.
+ *
+ * @internal
+ *
+ * @param [ios] The iostream to send over.
+ * @param [type] The message type.
+ * @param [argv] The vector of argument values to send with the message.
+ * @param [argc] The length of the argument vector.
+ * @param [buffer] A buffer to use for data held until a minimal chunk size is
+ *         reached.
+ * @param [bsize] The size of `buffer` (and the minimal chunk size).
+ * @param [max_chunk] The maximum chunk size.
+ * @param [size] A pointer to a `struct neo4j_message_size`, which will be
+ *         updated with the size of the message sent, or `NULL`.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_message_send_sized(neo4j_iostream_t *ios, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc, uint8_t *buffer,
+        uint16_t bsize, uint16_t max_chunk, struct neo4j_message_size *size);
+
 /**
  * Receive a message on a connection.
  *
@@ -91,4 +119,28 @@ int neo4j_message_recv(neo4j_iostream_t *ios,
         neo4j_mpool_t *mpool, neo4j_message_type_t *type,
         const neo4j_value_t **argv, uint16_t *argc);
 
+/**
+ * Receive a message on a connection, reporting its size.
+ *
+ * This call may block until data is available from the network.
+ *
+ * @internal
+ *
+ * @param [ios] The iostream to receive from.
+ * @param [mpool] A memory pool to allocate values and buffer spaces in.
+ * @param [type] A pointer to a message type, which will be updated.
+ * @param [argv] A pointer to an argument vector, which will be updated
+ *         to point to the received message arguments.
+ * @param [argc] A pointer to a `uin16_t`, which will be updated with the
+ *         length of the received argument vector.
+ * @param [size] A pointer to a `struct neo4j_message_size`, which will be
+ *         updated with the size of the message received, or `NULL`.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_message_recv_sized(neo4j_iostream_t *ios,
+        neo4j_mpool_t *mpool, neo4j_message_type_t *type,
+        const neo4j_value_t **argv, uint16_t *argc,
+        struct neo4j_message_size *size);
+
 #endif/*NEO4J_MESSAGES_H*/
@@ -263,12 +263,12 @@ struct ref_counted_statement_plan
 
 
 struct neo4j_statement_plan *neo4j_meta_plan(neo4j_value_t map,
-        const char *description, const neo4j_config_t *config,
-        neo4j_logger_t *logger)
+        const char *description, neo4j_memory_allocator_t *allocator,
+        unsigned int block_size, neo4j_logger_t *logger)
 {
     assert(neo4j_type(map) == NEO4J_MAP);
     assert(description != NULL);
-    assert(config != NULL);
+    assert(allocator != NULL);
 
     bool is_profile = true;
 
@@ -294,7 +294,7 @@ struct neo4j_statement_plan *neo4j_meta_plan(neo4j_value_t map,
     }
     const char *key_name = is_profile? "profile" : "plan";
 
-    neo4j_mpool_t mpool = neo4j_std_mpool(config);
+    neo4j_mpool_t mpool = neo4j_mpool(allocator, block_size);
 
     struct ref_counted_statement_plan *rc_plan = neo4j_mpool_calloc(&mpool, 1,
             sizeof(struct ref_counted_statement_plan));
@@ -161,14 +161,15 @@ int neo4j_meta_update_counts(struct neo4j_update_counts *counts,
  * @param [map] The metadata map.
  * @param [description] A description of the message from which the metadata
  *         came, for use when logging errors.
- * @param [config] The client configuration.
+ * @param [allocator] The allocator for memory used by the plan.
+ * @param [block_size] The block size for the memory pool used by the plan.
  * @param [logger] A logger to emit error messages to.
  * @return A pointer to the plan, or `NULL` if the plan is not available or
  *         if an error occurs (errno will be set).
  */
 struct neo4j_statement_plan *neo4j_meta_plan(neo4j_value_t map,
-        const char *description, const neo4j_config_t *config,
-        neo4j_logger_t *logger);
+        const char *description, neo4j_memory_allocator_t *allocator,
+        unsigned int block_size, neo4j_logger_t *logger);
 
 /**
  * Retain a statement plan.
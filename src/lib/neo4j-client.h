@@ -258,6 +258,57 @@ struct neo4j_logger_provider *neo4j_std_logger_provider(FILE *stream,
  */
 void neo4j_std_logger_provider_free(struct neo4j_logger_provider *provider);
 
+#define NEO4J_ASYNC_LOGGER_DEFAULT_CAPACITY 1024
+#define NEO4J_ASYNC_LOGGER_MAX_ENTRY 512
+
+/**
+ * Obtain an asynchronous logger provider.
+ *
+ * Log entries are formatted on the calling thread into a fixed size
+ * ring buffer, without taking any locks, and are written to the provided
+ * `FILE` by a background thread. Entries longer than
+ * `NEO4J_ASYNC_LOGGER_MAX_ENTRY` bytes are truncated. Should the ring
+ * buffer be full, entries are dropped rather than blocking the caller: the
+ * number of entries dropped can be obtained via
+ * neo4j_async_logger_dropped(), and is also reported to the stream.
+ *
+ * Output is otherwise the same as for neo4j_std_logger_provider(), and the
+ * same flags are supported.
+ *
+ * @param [stream] The stream to output to.
+ * @param [level] The default level to log at.
+ * @param [flags] A bitmask of flags for the standard logger output.
+ * @param [capacity] The number of entries the ring buffer can hold, which
+ *         will be rounded up to a power of 2, or 0 to use the default
+ *         (`NEO4J_ASYNC_LOGGER_DEFAULT_CAPACITY`).
+ * @return A `neo4j_logger_provider`, or `NULL` on error (errno will be set).
+ */
+__neo4j_must_check
+struct neo4j_logger_provider *neo4j_async_logger_provider(FILE *stream,
+        uint_fast8_t level, uint_fast32_t flags, unsigned int capacity);
+
+/**
+ * Free an asynchronous logger provider.
+ *
+ * Provider must have been obtained via neo4j_async_logger_provider(). All
+ * entries logged before this call are written to the stream before it
+ * returns. Any loggers obtained from the provider that have not been
+ * released will subsequently write directly to the stream.
+ *
+ * @param [provider] The provider to free.
+ */
+void neo4j_async_logger_provider_free(struct neo4j_logger_provider *provider);
+
+/**
+ * Get the number of log entries dropped by an asynchronous logger provider.
+ *
+ * @param [provider] The provider, which must have been obtained via
+ *         neo4j_async_logger_provider().
+ * @return The number of log entries dropped because the ring buffer was full.
+ */
+unsigned long long neo4j_async_logger_dropped(
+        struct neo4j_logger_provider *provider);
+
 /**
  * The name for the logging level.
  *
@@ -366,6 +417,28 @@ struct neo4j_connection_factory
             struct neo4j_logger *logger);
 };
 
+/**
+ * A factory for establishing connections to unix domain sockets.
+ */
+struct neo4j_unix_connection_factory
+{
+    /**
+     * Establish a connection to a unix domain socket.
+     *
+     * @param [self] This factory.
+     * @param [path] The filesystem path of the socket.
+     * @param [config] The client configuration.
+     * @param [flags] A bitmask of flags to control connections.
+     * @param [logger] A logger that may be used for status logging.
+     * @return A new neo4j_iostream, or `NULL` if an error occurs
+     *         (errno will be set).
+     */
+    struct neo4j_iostream *(*unix_connect)(
+            struct neo4j_unix_connection_factory *self, const char *path,
+            neo4j_config_t *config, uint_fast32_t flags,
+            struct neo4j_logger *logger);
+};
+
 
 /*
  * =====================================
@@ -401,6 +474,7 @@ struct neo4j_connection_factory
 #define NEO4J_NO_PLAN_AVAILABLE -35
 #define NEO4J_AUTH_RATE_LIMIT -36
 #define NEO4J_TLS_MALFORMED_CERTIFICATE -37
+#define NEO4J_STATEMENT_TIMEOUT -38
 
 /**
  * Print the error message corresponding to an error number.
@@ -798,6 +872,42 @@ unsigned int neo4j_list_length(neo4j_value_t value);
 __neo4j_pure
 neo4j_value_t neo4j_list_get(neo4j_value_t value, unsigned int index);
 
+/**
+ * Construct a neo4j value encoding a list of integers.
+ *
+ * The resulting value is of type NEO4J_LIST, and can be used anywhere
+ * a list can be used. However, as the integers are held in a native array,
+ * it avoids the construction of a `neo4j_value_t` for every element and
+ * is serialized in a single pass.
+ *
+ * @param [values] An array of integers. The pointer to the array must
+ *         remain valid, and the content unchanged, for the lifetime of the
+ *         neo4j value.
+ * @param [n] The length of the array. This must be less than
+ *         UINT32_MAX (or the list will be truncated).
+ * @return A neo4j value encoding the List.
+ */
+__neo4j_pure
+neo4j_value_t neo4j_int64_array(const int64_t *values, unsigned int n);
+
+/**
+ * Construct a neo4j value encoding a list of floats.
+ *
+ * The resulting value is of type NEO4J_LIST, and can be used anywhere
+ * a list can be used. However, as the floats are held in a native array,
+ * it avoids the construction of a `neo4j_value_t` for every element and
+ * is serialized in a single pass.
+ *
+ * @param [values] An array of doubles. The pointer to the array must
+ *         remain valid, and the content unchanged, for the lifetime of the
+ *         neo4j value.
+ * @param [n] The length of the array. This must be less than
+ *         UINT32_MAX (or the list will be truncated).
+ * @return A neo4j value encoding the List.
+ */
+__neo4j_pure
+neo4j_value_t neo4j_float64_array(const double *values, unsigned int n);
+
 
 /**
  * Construct a neo4j value encoding a map.
@@ -885,6 +995,192 @@ __neo4j_pure
 neo4j_map_entry_t neo4j_map_kentry(neo4j_value_t key, neo4j_value_t value);
 
 
+/**
+ * A writer for encoding a value directly to the wire.
+ */
+typedef struct neo4j_value_writer neo4j_value_writer_t;
+
+/**
+ * A producer of a streamed list or map value.
+ */
+struct neo4j_value_producer
+{
+    /**
+     * Write the value.
+     *
+     * This will be invoked when the value is serialized, which for statement
+     * parameters is when the request is sent to the server. It must write
+     * exactly one list (for a streamed list) or one map (for a streamed map)
+     * using the supplied writer.
+     *
+     * @param [self] This producer.
+     * @param [writer] The value writer.
+     * @return 0 on success, or -1 on failure (errno should be set).
+     */
+    int (*produce)(struct neo4j_value_producer *self,
+            neo4j_value_writer_t *writer);
+};
+
+/**
+ * Construct a neo4j value encoding a list that is produced when serialized.
+ *
+ * The list is written by the producer directly into the outgoing message
+ * buffer when the value is serialized, so that very large lists can be sent
+ * without constructing `neo4j_value_t` elements for their content.
+ *
+ * The resulting value is of type NEO4J_LIST. However, the content of the list
+ * is not available to the client: `neo4j_list_length(...)` will return 0.
+ *
+ * @attention If the producer fails, or writes an invalid value, then the
+ *         partially written message cannot be recovered and the connection
+ *         will be unusable.
+ *
+ * @param [producer] The producer for the list content. This pointer must
+ *         remain valid for the lifetime of the neo4j value.
+ * @return A neo4j value encoding the List.
+ */
+__neo4j_pure
+neo4j_value_t neo4j_streamed_list(struct neo4j_value_producer *producer);
+
+/**
+ * Construct a neo4j value encoding a map that is produced when serialized.
+ *
+ * The map is written by the producer directly into the outgoing message
+ * buffer when the value is serialized, so that very large maps can be sent
+ * without constructing `neo4j_value_t` entries for their content.
+ *
+ * The resulting value is of type NEO4J_MAP. However, the content of the map
+ * is not available to the client: `neo4j_map_get(...)` will always return
+ * `NULL`.
+ *
+ * @attention If the producer fails, or writes an invalid value, then the
+ *         partially written message cannot be recovered and the connection
+ *         will be unusable.
+ *
+ * @param [producer] The producer for the map content. This pointer must
+ *         remain valid for the lifetime of the neo4j value.
+ * @return A neo4j value encoding the Map.
+ */
+__neo4j_pure
+neo4j_value_t neo4j_streamed_map(struct neo4j_value_producer *producer);
+
+/**
+ * Begin writing a list.
+ *
+ * Exactly `n` values must be written before the list is ended with
+ * `neo4j_writer_end(...)`.
+ *
+ * @param [writer] The value writer.
+ * @param [n] The number of items that will be written into the list.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_begin_list(neo4j_value_writer_t *writer, unsigned int n);
+
+/**
+ * Begin writing a map.
+ *
+ * Exactly `n` entries, each being a key followed by a value, must be written
+ * before the map is ended with `neo4j_writer_end(...)`.
+ *
+ * @param [writer] The value writer.
+ * @param [n] The number of entries that will be written into the map.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_begin_map(neo4j_value_writer_t *writer, unsigned int n);
+
+/**
+ * End the list or map most recently begun.
+ *
+ * @param [writer] The value writer.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_end(neo4j_value_writer_t *writer);
+
+/**
+ * Write a key for the next map entry.
+ *
+ * @param [writer] The value writer.
+ * @param [key] The null terminated string key.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_key(neo4j_value_writer_t *writer, const char *key);
+
+/**
+ * Write a null.
+ *
+ * @param [writer] The value writer.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_null(neo4j_value_writer_t *writer);
+
+/**
+ * Write a boolean.
+ *
+ * @param [writer] The value writer.
+ * @param [value] The boolean value.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_bool(neo4j_value_writer_t *writer, bool value);
+
+/**
+ * Write an integer.
+ *
+ * @param [writer] The value writer.
+ * @param [value] The integer value.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_int(neo4j_value_writer_t *writer, long long value);
+
+/**
+ * Write a float.
+ *
+ * @param [writer] The value writer.
+ * @param [value] The float value.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_float(neo4j_value_writer_t *writer, double value);
+
+/**
+ * Write a null terminated string.
+ *
+ * @param [writer] The value writer.
+ * @param [s] The null terminated string.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_string(neo4j_value_writer_t *writer, const char *s);
+
+/**
+ * Write a UTF-8 string.
+ *
+ * @param [writer] The value writer.
+ * @param [u] A pointer to the UTF-8 string.
+ * @param [n] The length of the UTF-8 string.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_ustring(neo4j_value_writer_t *writer,
+        const char *u, unsigned int n);
+
+/**
+ * Write a neo4j value.
+ *
+ * @param [writer] The value writer.
+ * @param [value] The value to write.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_value(neo4j_value_writer_t *writer, neo4j_value_t value);
+
+
 /**
  * Return the label list of a neo4j node.
  *
@@ -1089,6 +1385,26 @@ int neo4j_config_set_password(neo4j_config_t *config, const char *password);
  */
 void neo4j_config_allow_empty_password(neo4j_config_t *config, bool allow);
 
+/**
+ * Enable or disable pipelined session initialization.
+ *
+ * By default, a new session authenticates with the server before
+ * neo4j_new_session() returns. When pipelined initialization is enabled,
+ * the authentication request is instead queued and sent along with the
+ * first statement, saving a round-trip. Any authentication failure is then
+ * reported through the result stream of the first statement (see
+ * neo4j_check_failure()), after which the session cannot be used.
+ *
+ * Pipelined initialization is not used when an authentication re-attempt
+ * callback has been set (see
+ * neo4j_config_set_authentication_reattempt_callback()).
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [enable] `true` to enable pipelined initialization, and `false`
+ *         to disable it.
+ */
+void neo4j_config_set_pipelined_init(neo4j_config_t *config, bool enable);
+
 #define NEO4J_AUTHENTICATION_REATTEMPT 0
 #define NEO4J_AUTHENTICATION_FAIL 1
 
@@ -1199,6 +1515,79 @@ int neo4j_config_set_TLS_ca_file(neo4j_config_t *config, const char *path);
 __neo4j_must_check
 int neo4j_config_set_TLS_ca_dir(neo4j_config_t *config, const char *path);
 
+#define NEO4J_TLS_V1_0 0x0301
+#define NEO4J_TLS_V1_1 0x0302
+#define NEO4J_TLS_V1_2 0x0303
+#define NEO4J_TLS_V1_3 0x0304
+
+/**
+ * Set the minimum TLS protocol version.
+ *
+ * Connections negotiate the highest version supported by both the client
+ * and the server, and fail if that is lower than the minimum. The default
+ * minimum is `NEO4J_TLS_V1_2`.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [version] The minimum version, which must be one of
+ *         `NEO4J_TLS_V1_0`, `NEO4J_TLS_V1_1`, `NEO4J_TLS_V1_2` or
+ *         `NEO4J_TLS_V1_3`.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_config_set_TLS_min_version(neo4j_config_t *config,
+        unsigned int version);
+
+/**
+ * Set the TLS cipher list, for protocol versions up to TLS 1.2.
+ *
+ * The list uses the OpenSSL cipher list format (see `ciphers(1)`). By
+ * default, ephemeral key exchange with AEAD ciphers is preferred, ordering
+ * AES-GCM ahead of ChaCha20-Poly1305 when the CPU has AES instructions
+ * and the reverse otherwise.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [ciphers] The cipher list, or `NULL` to restore the default.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_config_set_TLS_ciphers(neo4j_config_t *config, const char *ciphers);
+
+/**
+ * Set the TLS 1.3 cipher suites.
+ *
+ * The suites are a colon separated list in order of preference, e.g.
+ * `"TLS_AES_128_GCM_SHA256:TLS_CHACHA20_POLY1305_SHA256"`. By default, the
+ * order is chosen according to CPU capabilities, as for
+ * neo4j_config_set_TLS_ciphers(). Connections will fail if cipher suites
+ * are set and the TLS library does not support TLS 1.3.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [ciphersuites] The cipher suites, or `NULL` to restore the default.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_config_set_TLS_ciphersuites(neo4j_config_t *config,
+        const char *ciphersuites);
+
+/**
+ * Enable or disable kernel TLS offload.
+ *
+ * When enabled, and supported by both the platform (Linux with the `tls`
+ * module loaded) and the TLS library, encryption is handed to the kernel
+ * once the TLS handshake completes. Reads and writes then go directly to
+ * the socket, without copying through the TLS library. If offload is
+ * unavailable, or the negotiated cipher is not supported by the kernel,
+ * connections fall back to TLS in userspace. Offload is not attempted for
+ * connections with I/O timeouts. This is disabled by default.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [enable] `true` to enable kernel TLS offload, and `false` to
+ *         disable it.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_config_set_TLS_kernel_offload(neo4j_config_t *config, bool enable);
+
 /**
  * Enable or disable trusting of known hosts.
  *
@@ -1324,6 +1713,188 @@ int neo4j_config_set_so_sndbuf_size(neo4j_config_t *config, unsigned int size);
  */
 int neo4j_config_set_so_rcvbuf_size(neo4j_config_t *config, unsigned int size);
 
+/**
+ * Enable or disable TCP_NODELAY on connection sockets.
+ *
+ * With TCP_NODELAY, small writes (such as a request that follows another
+ * without waiting for its response) are sent immediately rather than held
+ * back by Nagle's algorithm until earlier data is acknowledged. This is
+ * enabled by default.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [enable] `true` to enable TCP_NODELAY, and `false` to disable it.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_tcp_nodelay(neo4j_config_t *config, bool enable);
+
+/**
+ * Enable or disable TCP quick acknowledgement.
+ *
+ * When enabled, received data is acknowledged immediately rather than after
+ * the delayed acknowledgement timeout. The option is re-armed after every
+ * read, as the kernel may clear it. This is only supported on Linux, and is
+ * ignored elsewhere. This is disabled by default.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [enable] `true` to enable quick acknowledgement, and `false` to
+ *         disable it.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_tcp_quickack(neo4j_config_t *config, bool enable);
+
+/**
+ * Set TCP keepalive parameters for connection sockets.
+ *
+ * Where the platform does not support setting the interval or count, the
+ * system defaults are used for these. Keepalive is disabled by default.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [idle] The time a connection must be idle before keepalive probes
+ *         are sent, in seconds, or 0 to disable keepalive.
+ * @param [interval] The time between keepalive probes, in seconds, or 0 to
+ *         use the system default.
+ * @param [count] The number of unanswered probes before the connection is
+ *         dropped, or 0 to use the system default.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_tcp_keepalive(neo4j_config_t *config, unsigned int idle,
+        unsigned int interval, unsigned int count);
+
+/**
+ * Set the busy poll time for connection sockets.
+ *
+ * When non-zero, a blocking read will poll the network device for up to
+ * the specified time before sleeping, which reduces latency at the cost of
+ * CPU time. This is only supported on Linux (`SO_BUSY_POLL`), and may
+ * require `CAP_NET_ADMIN`; if it cannot be set, a warning is logged and
+ * the connection proceeds without it.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [usecs] The busy poll time, in microseconds, or 0 to disable.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_so_busy_poll(neo4j_config_t *config, unsigned int usecs);
+
+/**
+ * Set the time to spin before blocking when reading from a connection.
+ *
+ * When non-zero, a read that finds no data available repeatedly checks the
+ * socket for up to the specified time, rather than immediately sleeping
+ * in the kernel. This avoids the wakeup latency of a blocking read for
+ * responses that arrive within microseconds, at the cost of CPU time.
+ * This is disabled by default.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [usecs] The time to spin, in microseconds, or 0 to disable.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_io_read_spin(neo4j_config_t *config, unsigned int usecs);
+
+/**
+ * Enable or disable the use of io_uring for connection I/O.
+ *
+ * When enabled, connections perform I/O through a single io_uring shared
+ * by the process, and writes queued by many connections are submitted to
+ * the kernel together. This reduces system call overhead for applications
+ * driving many concurrent connections. This is disabled by default.
+ *
+ * Connections fall back to ordinary reads and writes if io_uring is
+ * unavailable, or if I/O timeouts are set (see
+ * neo4j_config_set_io_read_timeout() and
+ * neo4j_config_set_io_write_timeout()). Spinning reads and TCP quick
+ * acknowledgement are not used for io_uring connections, and kernel TLS
+ * offload is not used for them.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [enable] `true` to use io_uring where available.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_io_uring(neo4j_config_t *config, bool enable);
+
+/**
+ * Set how long resolved server addresses are cached.
+ *
+ * The address(es) for a server name are shared by all connections in the
+ * process, and reused until the time expires or a connection to all of
+ * them fails. As the system resolver does not expose the TTL of DNS
+ * records, this should be no longer than the TTL of the records for the
+ * servers in use. By default, addresses are cached for 60 seconds, and
+ * names that do not exist for 5 seconds.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [ttl] The time to cache resolved addresses, in seconds, or 0 to
+ *         disable caching.
+ * @param [negative_ttl] The time to cache the absence of a name, in
+ *         seconds, or 0 to disable negative caching.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_dns_cache_ttl(neo4j_config_t *config,
+        unsigned int ttl, unsigned int negative_ttl);
+
+/**
+ * Set the delay between connection attempts to a server's addresses.
+ *
+ * When a server name resolves to multiple addresses, a connection is
+ * attempted to the next address if the previous attempt has not completed
+ * within this delay, without abandoning the earlier attempts. The first
+ * connection to succeed is used, so an unreachable address costs no more
+ * than this delay. The default is 250 milliseconds.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [delay] The delay, in milliseconds.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_connect_attempt_delay(neo4j_config_t *config,
+        unsigned int delay);
+
+/**
+ * Set the timeout for reading from a connection.
+ *
+ * Should a read from the connection not complete before the timeout expires,
+ * the request will fail with errno set to `ETIMEDOUT` and the session cannot
+ * be used further.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [timeout] The read timeout, in milliseconds, or 0 for no timeout.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_io_read_timeout(neo4j_config_t *config,
+        unsigned int timeout);
+
+/**
+ * Set the timeout for writing to a connection.
+ *
+ * Should a write to the connection not complete before the timeout expires,
+ * the request will fail with errno set to `ETIMEDOUT` and the session cannot
+ * be used further.
+ *
+ * This is only applicable to the standard connection factory.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [timeout] The write timeout, in milliseconds, or 0 for no timeout.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_io_write_timeout(neo4j_config_t *config,
+        unsigned int timeout);
+
 /**
  * Set a connection factory in the neo4j client configuration.
  *
@@ -1333,11 +1904,30 @@ int neo4j_config_set_so_rcvbuf_size(neo4j_config_t *config, unsigned int size);
 void neo4j_config_set_connection_factory(neo4j_config_t *config,
         struct neo4j_connection_factory *factory);
 
+/**
+ * Set a unix domain socket connection factory in the neo4j client
+ * configuration.
+ *
+ * If `NULL`, connections to unix domain sockets fail with errno set to
+ * `ENOTSUP`.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [factory] The unix domain socket connection factory.
+ */
+void neo4j_config_set_unix_connection_factory(neo4j_config_t *config,
+        struct neo4j_unix_connection_factory *factory);
+
 /**
  * The standard connection factory.
  */
 extern struct neo4j_connection_factory neo4j_std_connection_factory;
 
+/**
+ * The standard unix domain socket connection factory.
+ */
+extern struct neo4j_unix_connection_factory
+        neo4j_std_unix_connection_factory;
+
 /*
  * The standard memory allocator.
  *
@@ -1371,6 +1961,93 @@ void neo4j_config_set_memory_allocator(neo4j_config_t *config,
 void neo4j_config_set_max_pipelined_requests(neo4j_config_t *config,
         unsigned int n);
 
+/**
+ * Enable or disable adaptive pipelining.
+ *
+ * When enabled, each session measures the round-trip time and size of
+ * responses, and tunes the number of requests it keeps in flight. The
+ * window grows while responses arrive without queueing delay, such as over
+ * high-latency links, and shrinks when responses are large. The window
+ * starts at the maximum set by neo4j_config_set_max_pipelined_requests(),
+ * and is then bounded by neo4j_config_set_max_adaptive_pipelined_requests().
+ *
+ * The current window of a session can be obtained using
+ * neo4j_session_pipeline_window().
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [enable] `true` to enable adaptive pipelining, and `false` to
+ *         disable it.
+ */
+void neo4j_config_set_adaptive_pipelining(neo4j_config_t *config,
+        bool enable);
+
+#define NEO4J_DEFAULT_MAX_ADAPTIVE_PIPELINED_REQUESTS 100
+
+/**
+ * Set the maximum number of requests that can be pipelined to the
+ * server when adaptive pipelining is enabled.
+ *
+ * The window only grows this far while responses arrive without queueing
+ * delay, and the number of response bytes in flight is bounded regardless,
+ * so this may safely be higher than the fixed maximum.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [n] The new maximum.
+ */
+void neo4j_config_set_max_adaptive_pipelined_requests(neo4j_config_t *config,
+        unsigned int n);
+
+typedef enum
+{
+    /** A request has been queued in the session. */
+    NEO4J_TRACE_REQUEST_QUEUED,
+    /** A request has been serialized and sent to the server. */
+    NEO4J_TRACE_REQUEST_SENT,
+    /** The first response message for a request has been received. */
+    NEO4J_TRACE_RESPONSE_RECEIVED,
+    /** A record has been received in a result stream. */
+    NEO4J_TRACE_RECORD_RECEIVED,
+    /** The final response for a result stream has been received. */
+    NEO4J_TRACE_RESULTS_COMPLETED
+} neo4j_trace_point_t;
+
+/**
+ * Function type for callback when a request reaches a trace point.
+ *
+ * The callback is invoked synchronously, and should return promptly.
+ *
+ * @param [userdata] The user data for the callback.
+ * @param [point] The trace point reached.
+ * @param [timestamp] The time the trace point was reached, on the monotonic
+ *         clock (in nanoseconds).
+ * @param [session] The session the request was made in.
+ * @param [request_id] An identifier for the request, which is unique within
+ *         the session. All trace points for the same request are reported
+ *         with the same identifier.
+ * @param [request_type] The type of the request (e.g. "RUN" or "PULL_ALL").
+ */
+typedef void (*neo4j_trace_callback_t)(void *userdata,
+        neo4j_trace_point_t point, uint64_t timestamp,
+        neo4j_session_t *session, unsigned long long request_id,
+        const char *request_type);
+
+/**
+ * Set the request tracing callback.
+ *
+ * When set, the callback is invoked as each request is queued and sent,
+ * when the first response is received, and as records and the final
+ * response are received for a result stream. Tracing is disabled by
+ * default.
+ *
+ * @param [config] The neo4j client configuration to update.
+ * @param [callback] The callback to be invoked at each trace point, or
+ *         `NULL` to disable tracing.
+ * @param [userdata] User data that will be supplied to the callback.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_config_set_trace_callback(neo4j_config_t *config,
+        neo4j_trace_callback_t callback, void *userdata);
+
 /**
  * Return a path within the neo4j dot directory.
  *
@@ -1449,6 +2126,12 @@ int neo4j_mkdir_p(const char *path);
  *
  * If no flags are required, pass 0 or `NEO4J_CONNECT_DEFAULT`.
  *
+ * A URI with the scheme `neo4j` or `bolt` connects over TCP, e.g.
+ * `neo4j://localhost:7687`. A URI with the scheme `neo4j+unix` or
+ * `bolt+unix`, an empty host and an absolute path connects to a unix domain
+ * socket at that path, e.g. `bolt+unix:///var/run/neo4j/bolt.sock` (see
+ * neo4j_unix_connect()).
+ *
  * @param [uri] A URI describing the server to connect to, which may also
  *         include authentication data (which will override any provided
  *         in the config).
@@ -1480,6 +2163,25 @@ __neo4j_must_check
 neo4j_connection_t *neo4j_tcp_connect(const char *hostname, unsigned int port,
         neo4j_config_t *config, uint_fast32_t flags);
 
+/**
+ * Establish a connection to a neo4j server over a unix domain socket.
+ *
+ * This avoids the overhead of TCP for a server on the same host. Access to
+ * the server is controlled by the permissions of the socket, and TLS is not
+ * used, regardless of flags. The socket is connected using the unix
+ * connection factory of the configuration (see
+ * neo4j_config_set_unix_connection_factory()).
+ *
+ * @param [path] The filesystem path of the server's socket.
+ * @param [config] The neo4j client configuration to use for this connection.
+ * @param [flags] A bitmask of flags to control connections.
+ * @return A pointer to a `neo4j_connection_t` structure, or `NULL` on error
+ *         (errno will be set).
+ */
+__neo4j_must_check
+neo4j_connection_t *neo4j_unix_connect(const char *path,
+        neo4j_config_t *config, uint_fast32_t flags);
+
 /**
  * Close a connection to a neo4j server.
  *
@@ -1523,11 +2225,206 @@ int neo4j_end_session(neo4j_session_t *session);
  * cleared, including rolling back any open transactions, and causes any
  * existing result stream to be terminated.
  *
+ * The reset request is not awaited, but is sent to the server ahead of the
+ * next statement. Should the reset fail, that statement will fail and the
+ * session cannot be used further.
+ *
  * @param [session] The session to reset.
  * @return 0 on sucess, or -1 if an error occurs (errno will be set).
  */
 int neo4j_reset_session(neo4j_session_t *session);
 
+/**
+ * Get the pipelining window of a session.
+ *
+ * This is the maximum number of requests the session will currently keep in
+ * flight to the server, which varies over time when adaptive pipelining is
+ * enabled (see neo4j_config_set_adaptive_pipelining()).
+ *
+ * @param [session] The session.
+ * @return The current pipelining window.
+ */
+unsigned int neo4j_session_pipeline_window(neo4j_session_t *session);
+
+/**
+ * Set a timeout for statements evaluated in a session.
+ *
+ * The timeout applies to each statement subsequently evaluated in the
+ * session, and is measured from when neo4j_run() or neo4j_send() is invoked.
+ * Should the results not be received before it expires, the statement is
+ * cancelled by resetting the session, and the result stream fails with
+ * `NEO4J_STATEMENT_TIMEOUT`. The session remains usable for further
+ * statements, unless the timeout expires part way through receiving a
+ * message, in which case the session fails.
+ *
+ * @param [session] The session.
+ * @param [timeout] The timeout, in milliseconds, or 0 to wait indefinitely.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_session_set_statement_timeout(neo4j_session_t *session,
+        unsigned int timeout);
+
+
+/*
+ * =====================================
+ * statistics
+ * =====================================
+ */
+
+#define NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS 4
+#define NEO4J_LATENCY_HISTOGRAM_BUCKETS 128
+
+/**
+ * A histogram of latencies.
+ *
+ * Latencies are recorded in microseconds, in buckets of exponentially
+ * increasing size: latencies below 8us are recorded exactly, and each
+ * subsequent power of two is divided into 4 linear sub-buckets. The upper
+ * bound of each bucket can be obtained via neo4j_latency_bucket_bound().
+ */
+struct neo4j_latency_histogram
+{
+    /** The number of latencies recorded. */
+    unsigned long long count;
+    /** The sum of all latencies recorded, in microseconds. */
+    unsigned long long sum;
+    /** The largest latency recorded, in microseconds. */
+    unsigned long long max;
+    /** The number of latencies recorded in each bucket. */
+    unsigned long long buckets[NEO4J_LATENCY_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Statistics for a connection.
+ */
+struct neo4j_connection_stats
+{
+    /** The bytes sent, including chunk headers. */
+    unsigned long long bytes_sent;
+    /** The bytes received, including chunk headers. */
+    unsigned long long bytes_received;
+    /** The messages sent. */
+    unsigned long long messages_sent;
+    /** The messages received. */
+    unsigned long long messages_received;
+    /** The chunks sent. */
+    unsigned long long chunks_sent;
+    /** The chunks received. */
+    unsigned long long chunks_received;
+    /**
+     * The write operations on the connection iostream. When using the
+     * standard connection factory with send buffering disabled (see
+     * neo4j_config_set_sndbuf_size()), this is the number of system calls.
+     */
+    unsigned long long writes;
+    /**
+     * The read operations on the connection iostream. When using the
+     * standard connection factory with receive buffering disabled (see
+     * neo4j_config_set_rcvbuf_size()), this is the number of system calls.
+     */
+    unsigned long long reads;
+};
+
+/**
+ * Statistics for a session.
+ */
+struct neo4j_session_stats
+{
+    /** The requests completed. */
+    unsigned long long requests;
+    /** The requests that failed or were ignored by the server. */
+    unsigned long long failed_requests;
+    /** The memory pool allocations made for responses. */
+    unsigned long long mpool_allocations;
+    /** The memory pool bytes allocated for responses. */
+    unsigned long long mpool_bytes;
+    /** The current size of the request queue. */
+    unsigned int request_queue_size;
+    /** The current number of requests in the queue. */
+    unsigned int request_queue_depth;
+    /** The largest number of requests held in the queue. */
+    unsigned int max_request_queue_depth;
+    /** The current number of requests sent and awaiting responses. */
+    unsigned int inflight_requests;
+    /**
+     * The latency of each request, from being queued until the final
+     * response is received.
+     */
+    struct neo4j_latency_histogram request_latency;
+};
+
+/**
+ * Get the statistics for a connection.
+ *
+ * Statistics are maintained for the lifetime of the connection.
+ *
+ * @param [connection] The connection.
+ * @param [stats] A pointer to a structure, which will be populated.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_connection_stats(neo4j_connection_t *connection,
+        struct neo4j_connection_stats *stats);
+
+/**
+ * Get the statistics for a session.
+ *
+ * Statistics are maintained for the lifetime of the session.
+ *
+ * @param [session] The session.
+ * @param [stats] A pointer to a structure, which will be populated.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_session_stats(neo4j_session_t *session,
+        struct neo4j_session_stats *stats);
+
+/**
+ * Get the upper bound of a latency histogram bucket.
+ *
+ * @param [index] The index of the bucket.
+ * @return The (exclusive) upper bound of latencies recorded in the bucket,
+ *         in microseconds.
+ */
+__neo4j_pure
+unsigned long long neo4j_latency_bucket_bound(unsigned int index);
+
+/**
+ * Get a percentile of the latencies in a histogram.
+ *
+ * @param [histogram] The histogram.
+ * @param [percentile] The percentile, between 0 and 100.
+ * @return The upper bound of the bucket containing the percentile, in
+ *         microseconds, or 0 if no latencies have been recorded.
+ */
+__neo4j_pure
+unsigned long long neo4j_latency_percentile(
+        const struct neo4j_latency_histogram *histogram, double percentile);
+
+/**
+ * Write connection statistics to a stream, in a text exposition format.
+ *
+ * The statistics are written in the Prometheus text format, with each metric
+ * name prefixed by `neo4j_client_connection_`.
+ *
+ * @param [stream] The stream to write to.
+ * @param [stats] The connection statistics.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_fprint_connection_stats(FILE *stream,
+        const struct neo4j_connection_stats *stats);
+
+/**
+ * Write session statistics to a stream, in a text exposition format.
+ *
+ * The statistics are written in the Prometheus text format, with each metric
+ * name prefixed by `neo4j_client_session_`.
+ *
+ * @param [stream] The stream to write to.
+ * @param [stats] The session statistics.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_fprint_session_stats(FILE *stream,
+        const struct neo4j_session_stats *stats);
+
 
 /*
  * =====================================
@@ -1570,6 +2467,93 @@ __neo4j_must_check
 neo4j_result_stream_t *neo4j_send(neo4j_session_t *session,
         const char *statement, neo4j_value_t params);
 
+/**
+ * A writer for sending rows in batches.
+ */
+typedef struct neo4j_bulk_writer neo4j_bulk_writer_t;
+
+/**
+ * Callback invoked when a batch of rows has been evaluated.
+ *
+ * The result stream can be used to check for evaluation errors, using
+ * neo4j_check_failure(), and to obtain the update counts for the batch.
+ * It will be closed after the callback returns.
+ *
+ * @param [userdata] The user data for the callback.
+ * @param [batch] The sequence number of the batch, starting at 0.
+ * @param [nrows] The number of rows in the batch.
+ * @param [results] The result stream for the batch.
+ */
+typedef void (*neo4j_bulk_batch_callback_t)(void *userdata,
+        unsigned long long batch, unsigned int nrows,
+        neo4j_result_stream_t *results);
+
+/**
+ * Open a writer for sending rows in batches.
+ *
+ * Rows are collected into batches, and each batch is sent as a parameter
+ * named `batch` to the statement, which will typically be of the form
+ * `UNWIND $batch AS row ...`. A batch is sent when it reaches either
+ * `max_rows` rows or `max_bytes` serialized bytes. Up to half of the
+ * configured maximum pipelined requests (see
+ * neo4j_config_set_max_pipelined_requests()) batches are kept in flight
+ * at once, and only when that limit is reached will adding a row wait for
+ * the evaluation of the oldest batch to complete.
+ *
+ * @param [session] The session to evaluate the statement in. The session
+ *         should not be used for any other purpose until the bulk writer
+ *         is closed.
+ * @param [statement] The statement to be evaluated for each batch.
+ * @param [max_rows] The maximum number of rows in a batch.
+ * @param [max_bytes] The maximum serialized size, in bytes, of a batch. If 0,
+ *         then only `max_rows` is used.
+ * @param [callback] A callback to invoke as each batch completes, or `NULL`.
+ * @param [userdata] User data for the callback.
+ * @return A `neo4j_bulk_writer_t`, or `NULL` if an error occurs (errno
+ *         will be set).
+ */
+__neo4j_must_check
+neo4j_bulk_writer_t *neo4j_open_bulk_writer(neo4j_session_t *session,
+        const char *statement, unsigned int max_rows, size_t max_bytes,
+        neo4j_bulk_batch_callback_t callback, void *userdata);
+
+/**
+ * Add a row to a bulk writer.
+ *
+ * The row is serialized immediately, so the value need not remain valid
+ * after this function returns.
+ *
+ * @param [writer] The bulk writer.
+ * @param [row] The row to add.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_bulk_write(neo4j_bulk_writer_t *writer, neo4j_value_t row);
+
+/**
+ * Send any rows held by a bulk writer.
+ *
+ * The current batch is sent, even if it has not reached a threshold. This
+ * function does not wait for the batch to be evaluated.
+ *
+ * @param [writer] The bulk writer.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_bulk_flush(neo4j_bulk_writer_t *writer);
+
+/**
+ * Close a bulk writer.
+ *
+ * Any rows held by the writer are sent, and then all batches are awaited.
+ *
+ * @param [writer] The bulk writer. The pointer will be invalid after the
+ *         function returns.
+ * @return 0 if all batches were successfully evaluated, or -1 if an error
+ *         occurs or any batch failed (errno will be set).
+ */
+int neo4j_close_bulk_writer(neo4j_bulk_writer_t *writer);
+
 
 /*
  * =====================================
@@ -1638,6 +2622,29 @@ neo4j_result_t *neo4j_fetch_next(neo4j_result_stream_t *results);
  */
 int neo4j_close_results(neo4j_result_stream_t *results);
 
+/**
+ * Set a timeout for a result stream.
+ *
+ * The timeout replaces any timeout set for the session (see
+ * neo4j_session_set_statement_timeout()), and is measured from when this
+ * function is invoked. Should the results not be received before it expires,
+ * the statement is cancelled by resetting the session, and the stream fails
+ * with `NEO4J_STATEMENT_TIMEOUT`. The session remains usable for further
+ * statements, unless the timeout expires part way through receiving a
+ * message, in which case the session fails.
+ *
+ * Note that the timeout is only enforced while waiting for data on
+ * connections established by the library. For connections using an
+ * iostream from a custom `struct neo4j_connection_factory`, it is only
+ * checked between messages received from the server.
+ *
+ * @param [results] The result stream.
+ * @param [timeout] The timeout, in milliseconds, or 0 to wait indefinitely.
+ * @return 0 on success, or -1 if an error occurs (errno will be set).
+ */
+int neo4j_set_results_timeout(neo4j_result_stream_t *results,
+        unsigned int timeout);
+
 
 /*
  * =====================================
@@ -16,98 +16,481 @@
  */
 #include "../../config.h"
 #include "network.h"
+#include "client_config.h"
 #include "logging.h"
+#include "thread.h"
 #include "util.h"
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#define RESOLVER_CACHE_MAX_ENTRIES 64
+// interval between attempts to connect to a unix socket with a full backlog,
+// in milliseconds
+#define UNIX_CONNECT_RETRY_INTERVAL 10
+
+struct address
+{
+    int family;
+    int socktype;
+    int protocol;
+    socklen_t addrlen;
+    struct sockaddr_storage addr;
+};
+
+struct resolver_cache_entry
+{
+    struct resolver_cache_entry *next;
+    uint64_t expires;
+    // the errno for a failed resolution, or 0
+    int error;
+    struct address *addresses;
+    unsigned int naddresses;
+    const char *servname;
+    char hostname[];
+};
+
+static bool resolver_initialized;
+static neo4j_mutex_t resolver_cache_lock;
+static struct resolver_cache_entry *resolver_cache;
+
+static int resolve(const char *hostname, const char *servname,
+        const neo4j_config_t *config, neo4j_logger_t *logger,
+        struct address **addresses);
+static int lookup_addresses(const char *hostname, const char *servname,
+        struct address **addresses);
+static void cache_addresses(const char *hostname, const char *servname,
+        const struct address *addresses, int naddresses, int error,
+        unsigned int ttl);
+static void forget_addresses(const char *hostname, const char *servname);
+static struct resolver_cache_entry **find_cache_entry(const char *hostname,
+        const char *servname);
+static int getaddrinfo_addresses(const char *hostname, const char *servname,
+        struct address **addresses, int *gai_err);
 static void init_getaddrinfo_hints(struct addrinfo *hints);
 static int unsupported_sock_error(int err);
+static int connect_any(const struct address *addresses,
+        unsigned int naddresses, const neo4j_config_t *config,
+        neo4j_logger_t *logger);
+static int start_connect(const struct address *address,
+        const neo4j_config_t *config, neo4j_logger_t *logger,
+        bool *connected);
+static int connect_result(int fd);
+static int connect_unix(int fd, const struct sockaddr_un *addr,
+        uint64_t deadline);
+static int poll_timeout(uint64_t until, uint64_t now);
+static void log_connect_failure(const struct address *address, int err,
+        neo4j_logger_t *logger);
+static const char *describe_address(const struct address *address,
+        char *buf, size_t n);
 static void set_socket_options(int fd, const neo4j_config_t *config,
         neo4j_logger_t *logger);
-static int connect_with_timeout(int fd, const struct sockaddr *address,
-        socklen_t address_len, time_t timeout, neo4j_logger_t *logger);
+static void set_keepalive_options(int fd, const neo4j_config_t *config,
+        neo4j_logger_t *logger);
 static int update_socket_flags(int fd, int flags_to_set, int flags_to_clear,
         neo4j_logger_t *logger);
 
 
+int neo4j_network_init(void)
+{
+    int err = neo4j_mutex_init(&resolver_cache_lock);
+    if (err)
+    {
+        errno = err;
+        return -1;
+    }
+    resolver_initialized = true;
+    return 0;
+}
+
+
+int neo4j_network_cleanup(void)
+{
+    if (!resolver_initialized)
+    {
+        return 0;
+    }
+    while (resolver_cache != NULL)
+    {
+        struct resolver_cache_entry *entry = resolver_cache;
+        resolver_cache = entry->next;
+        free(entry->addresses);
+        free(entry);
+    }
+    resolver_initialized = false;
+    neo4j_mutex_destroy(&resolver_cache_lock);
+    return 0;
+}
+
+
 int neo4j_connect_tcp_socket(const char *hostname, const char *servname,
         const neo4j_config_t *config, neo4j_logger_t *logger)
 {
     REQUIRE(hostname != NULL, -1);
 
-    struct addrinfo hints;
-    struct addrinfo *candidate_addresses = NULL;
-    int err = 0;
+    struct address *addresses;
+    int naddresses = resolve(hostname, servname, config, logger, &addresses);
+    if (naddresses < 0)
+    {
+        return -1;
+    }
 
-    init_getaddrinfo_hints(&hints);
-    err = getaddrinfo(hostname, servname, &hints, &candidate_addresses);
-    if (err)
+    int fd = connect_any(addresses, naddresses, config, logger);
+    if (fd < 0)
     {
-        errno = NEO4J_UNKNOWN_HOST;
+        // the host may have moved, so resolve it again next time
+        int errsv = errno;
+        forget_addresses(hostname, servname);
+        errno = errsv;
+    }
+    free(addresses);
+    return fd;
+}
+
+
+int neo4j_connect_unix_socket(const char *path, const neo4j_config_t *config,
+        neo4j_logger_t *logger)
+{
+    REQUIRE(path != NULL, -1);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    size_t pathlen = strlen(path);
+    if (pathlen >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
         return -1;
     }
+    memcpy(addr.sun_path, path, pathlen + 1);
 
-    int fd = -1;
-    struct addrinfo *addr;
-    for (addr = candidate_addresses; addr != NULL; addr = addr->ai_next)
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
     {
-        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
-        if (fd < 0)
+        neo4j_log_error_errno(logger, "socket");
+        return -1;
+    }
+
+    if (update_socket_flags(fd, O_NONBLOCK, 0, logger))
+    {
+        goto failure;
+    }
+
+    neo4j_log_debug(logger, "attempting connection to %s", path);
+
+    uint64_t deadline = (config->connect_timeout > 0)?
+        monotonic_ns() + (uint64_t)config->connect_timeout * 1000000000 : 0;
+    if (connect_unix(fd, &addr, deadline))
+    {
+        char ebuf[256];
+        neo4j_log_info(logger, "connection to %s failed: %s",
+                path, neo4j_strerror(errno, ebuf, sizeof(ebuf)));
+        goto failure;
+    }
+
+    if (update_socket_flags(fd, 0, O_NONBLOCK, logger))
+    {
+        goto failure;
+    }
+    return fd;
+
+    int errsv;
+failure:
+    errsv = errno;
+    close(fd);
+    errno = errsv;
+    return -1;
+}
+
+
+int resolve(const char *hostname, const char *servname,
+        const neo4j_config_t *config, neo4j_logger_t *logger,
+        struct address **addresses)
+{
+    if (!resolver_initialized || config->dns_cache_ttl == 0)
+    {
+        return lookup_addresses(hostname, servname, addresses);
+    }
+
+    neo4j_mutex_lock(&resolver_cache_lock);
+    struct resolver_cache_entry **entryp =
+        find_cache_entry(hostname, servname);
+    if (entryp != NULL)
+    {
+        struct resolver_cache_entry *entry = *entryp;
+        // move to the front, so the least recently used entry is last
+        *entryp = entry->next;
+        entry->next = resolver_cache;
+        resolver_cache = entry;
+
+        int result = -1;
+        int errsv = entry->error;
+        if (errsv == 0)
         {
-            if (!unsupported_sock_error(errno))
-                continue;
-            neo4j_log_error_errno(logger, "socket");
-            freeaddrinfo(candidate_addresses);
-            return -1;
+            size_t size = entry->naddresses * sizeof(struct address);
+            *addresses = malloc(size);
+            if (*addresses != NULL)
+            {
+                memcpy(*addresses, entry->addresses, size);
+                result = entry->naddresses;
+            }
+            errsv = errno;
         }
+        neo4j_mutex_unlock(&resolver_cache_lock);
+        neo4j_log_trace(logger, "using cached resolution of %s [%s]",
+                hostname, (servname != NULL)? servname : "");
+        errno = errsv;
+        return result;
+    }
+    neo4j_mutex_unlock(&resolver_cache_lock);
+
+    // the cache is not locked during resolution, so a concurrent lookup of
+    // the same host may also resolve it, with the last to finish cached
+    int gai_err = 0;
+    int naddresses = getaddrinfo_addresses(hostname, servname, addresses,
+            &gai_err);
+    if (naddresses >= 0)
+    {
+        cache_addresses(hostname, servname, *addresses, naddresses, 0,
+                config->dns_cache_ttl);
+        return naddresses;
+    }
+
+    int errsv = errno;
+    // only cache answers that the name does not exist, rather than
+    // failures that may be transient
+    bool nonexistent = (gai_err == EAI_NONAME);
+#ifdef EAI_NODATA
+    nonexistent |= (gai_err == EAI_NODATA);
+#endif
+    if (nonexistent && config->dns_negative_cache_ttl > 0)
+    {
+        cache_addresses(hostname, servname, NULL, 0, errsv,
+                config->dns_negative_cache_ttl);
+    }
+    errno = errsv;
+    return -1;
+}
 
-        set_socket_options(fd, config, logger);
 
-        char hostnum[NI_MAXHOST];
-        char servnum[NI_MAXSERV];
-        err = getnameinfo(addr->ai_addr, addr->ai_addrlen,
-                hostnum, sizeof(hostnum), servnum, sizeof(servnum),
-                NI_NUMERICHOST | NI_NUMERICSERV);
-        if (err)
+int lookup_addresses(const char *hostname, const char *servname,
+        struct address **addresses)
+{
+    int gai_err;
+    return getaddrinfo_addresses(hostname, servname, addresses, &gai_err);
+}
+
+
+void cache_addresses(const char *hostname, const char *servname,
+        const struct address *addresses, int naddresses, int error,
+        unsigned int ttl)
+{
+    size_t hostname_len = strlen(hostname) + 1;
+    size_t servname_len = (servname != NULL)? strlen(servname) + 1 : 0;
+    struct resolver_cache_entry *entry = calloc(1,
+            sizeof(struct resolver_cache_entry) + hostname_len + servname_len);
+    if (entry == NULL)
+    {
+        return;
+    }
+    if (naddresses > 0)
+    {
+        size_t size = naddresses * sizeof(struct address);
+        entry->addresses = malloc(size);
+        if (entry->addresses == NULL)
         {
-            neo4j_log_error(logger, "getnameinfo: %s", gai_strerror(err));
-            freeaddrinfo(candidate_addresses);
-            errno = NEO4J_UNEXPECTED_ERROR;
-            return -1;
+            free(entry);
+            return;
         }
+        memcpy(entry->addresses, addresses, size);
+    }
+    entry->naddresses = naddresses;
+    entry->error = error;
+    entry->expires = monotonic_ns() + (uint64_t)ttl * 1000000000;
+    memcpy(entry->hostname, hostname, hostname_len);
+    if (servname != NULL)
+    {
+        char *s = entry->hostname + hostname_len;
+        memcpy(s, servname, servname_len);
+        entry->servname = s;
+    }
 
-        neo4j_log_debug(logger, "attempting connection to %s [%s]",
-                hostnum, servnum);
+    neo4j_mutex_lock(&resolver_cache_lock);
+    struct resolver_cache_entry **existing =
+        find_cache_entry(hostname, servname);
+    if (existing != NULL)
+    {
+        struct resolver_cache_entry *old = *existing;
+        *existing = old->next;
+        free(old->addresses);
+        free(old);
+    }
+    entry->next = resolver_cache;
+    resolver_cache = entry;
 
-        err = connect_with_timeout(fd, addr->ai_addr, addr->ai_addrlen,
-                    config->connect_timeout, logger);
-        if (err == 0)
+    unsigned int nentries = 1;
+    struct resolver_cache_entry **last = &(entry->next);
+    for (; *last != NULL; last = &((*last)->next), ++nentries)
+    {
+        if (nentries >= RESOLVER_CACHE_MAX_ENTRIES)
         {
             break;
         }
-        else if (err < 0)
+    }
+    while (*last != NULL)
+    {
+        struct resolver_cache_entry *evicted = *last;
+        *last = evicted->next;
+        free(evicted->addresses);
+        free(evicted);
+    }
+    neo4j_mutex_unlock(&resolver_cache_lock);
+}
+
+
+void forget_addresses(const char *hostname, const char *servname)
+{
+    if (!resolver_initialized)
+    {
+        return;
+    }
+    neo4j_mutex_lock(&resolver_cache_lock);
+    struct resolver_cache_entry **entryp =
+        find_cache_entry(hostname, servname);
+    if (entryp != NULL)
+    {
+        struct resolver_cache_entry *entry = *entryp;
+        *entryp = entry->next;
+        free(entry->addresses);
+        free(entry);
+    }
+    neo4j_mutex_unlock(&resolver_cache_lock);
+}
+
+
+/*
+ * Find an unexpired entry in the resolver cache, removing any expired
+ * entry for the same host. Must be called with the cache locked.
+ */
+struct resolver_cache_entry **find_cache_entry(const char *hostname,
+        const char *servname)
+{
+    for (struct resolver_cache_entry **entryp = &resolver_cache;
+            *entryp != NULL; entryp = &((*entryp)->next))
+    {
+        struct resolver_cache_entry *entry = *entryp;
+        if (strcmp(entry->hostname, hostname) != 0 ||
+                (entry->servname == NULL) != (servname == NULL) ||
+                (servname != NULL && strcmp(entry->servname, servname) != 0))
+        {
+            continue;
+        }
+        if (monotonic_ns() >= entry->expires)
         {
-            return -1;
+            *entryp = entry->next;
+            free(entry->addresses);
+            free(entry);
+            return NULL;
         }
+        return entryp;
+    }
+    return NULL;
+}
 
-        char ebuf[256];
-        neo4j_log_info(logger, "connection to %s [%s] failed: %s",
-                hostnum, servnum, neo4j_strerror(errno, ebuf, sizeof(ebuf)));
 
-        close(fd);
-        fd = -1;
+int getaddrinfo_addresses(const char *hostname, const char *servname,
+        struct address **addresses, int *gai_err)
+{
+    struct addrinfo hints;
+    struct addrinfo *candidate_addresses = NULL;
+
+    init_getaddrinfo_hints(&hints);
+    *gai_err = getaddrinfo(hostname, servname, &hints, &candidate_addresses);
+    if (*gai_err)
+    {
+        errno = NEO4J_UNKNOWN_HOST;
+        return -1;
+    }
+
+    unsigned int naddresses = 0;
+    for (struct addrinfo *addr = candidate_addresses; addr != NULL;
+            addr = addr->ai_next)
+    {
+        if (addr->ai_addrlen <= sizeof(struct sockaddr_storage))
+        {
+            ++naddresses;
+        }
+    }
+    if (naddresses == 0)
+    {
+        freeaddrinfo(candidate_addresses);
+        errno = NEO4J_UNKNOWN_HOST;
+        return -1;
+    }
+
+    *addresses = calloc(naddresses, sizeof(struct address));
+    if (*addresses == NULL)
+    {
+        freeaddrinfo(candidate_addresses);
+        return -1;
+    }
+
+    // getaddrinfo returns addresses in order of preference (RFC 6724), and
+    // these are interleaved by family so that a connection attempt to each
+    // family is made early (RFC 8305, section 4)
+    int first_family = candidate_addresses->ai_family;
+    struct addrinfo *next_preferred = candidate_addresses;
+    struct addrinfo *next_other = candidate_addresses;
+    bool take_preferred = true;
+    for (unsigned int i = 0; i < naddresses; ++i)
+    {
+        while (next_preferred != NULL &&
+                (next_preferred->ai_family != first_family ||
+                 next_preferred->ai_addrlen > sizeof(struct sockaddr_storage)))
+        {
+            next_preferred = next_preferred->ai_next;
+        }
+        while (next_other != NULL &&
+                (next_other->ai_family == first_family ||
+                 next_other->ai_addrlen > sizeof(struct sockaddr_storage)))
+        {
+            next_other = next_other->ai_next;
+        }
+
+        struct addrinfo *addr;
+        if (next_other == NULL ||
+                (take_preferred && next_preferred != NULL))
+        {
+            addr = next_preferred;
+            next_preferred = next_preferred->ai_next;
+        }
+        else
+        {
+            addr = next_other;
+            next_other = next_other->ai_next;
+        }
+        take_preferred = !take_preferred;
+
+        struct address *address = &((*addresses)[i]);
+        address->family = addr->ai_family;
+        address->socktype = addr->ai_socktype;
+        address->protocol = addr->ai_protocol;
+        address->addrlen = addr->ai_addrlen;
+        memcpy(&(address->addr), addr->ai_addr, addr->ai_addrlen);
     }
 
     freeaddrinfo(candidate_addresses);
-    return fd;
+    return naddresses;
 }
 
 
@@ -135,102 +518,444 @@ inline int unsupported_sock_error(int err)
 }
 
 
-void set_socket_options(int fd, const neo4j_config_t *config,
-        neo4j_logger_t *logger)
+/*
+ * Connect to the first of the addresses to accept a connection, starting
+ * a new attempt whenever the previous one has not completed within the
+ * connection attempt delay (RFC 8305, section 5).
+ */
+int connect_any(const struct address *addresses, unsigned int naddresses,
+        const neo4j_config_t *config, neo4j_logger_t *logger)
 {
-    int option;
+    struct pollfd *pfds = calloc(naddresses, sizeof(struct pollfd));
+    unsigned int *attempted = calloc(naddresses, sizeof(unsigned int));
+    if (pfds == NULL || attempted == NULL)
+    {
+        free(pfds);
+        free(attempted);
+        return -1;
+    }
 
-    if ((option = config->so_sndbuf_size) > 0)
+    uint64_t attempt_delay = (uint64_t)config->connect_attempt_delay * 1000000;
+    uint64_t deadline = (config->connect_timeout > 0)?
+        monotonic_ns() + (uint64_t)config->connect_timeout * 1000000000 : 0;
+    uint64_t next_attempt = 0;
+    unsigned int next = 0;
+    unsigned int ninflight = 0;
+    int fd = -1;
+    int err = ECONNREFUSED;
+
+    while (fd < 0)
     {
-        assert(option > 0);
-        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &option, sizeof(int)))
+        uint64_t now = monotonic_ns();
+        if (next < naddresses && (ninflight == 0 || now >= next_attempt))
         {
-            neo4j_log_warn_errno(logger, "setsockopt");
-            // continue
+            const struct address *address = &(addresses[next]);
+            bool connected = false;
+            int afd = start_connect(address, config, logger, &connected);
+            if (afd == -1)
+            {
+                if (!unsupported_sock_error(errno))
+                {
+                    err = errno;
+                    goto cleanup;
+                }
+                ++next;
+                continue;
+            }
+            if (afd < -1)
+            {
+                err = errno;
+                log_connect_failure(address, err, logger);
+                ++next;
+                continue;
+            }
+            if (connected)
+            {
+                fd = afd;
+                break;
+            }
+            pfds[ninflight].fd = afd;
+            pfds[ninflight].events = POLLOUT;
+            attempted[ninflight] = next;
+            ++ninflight;
+            ++next;
+            next_attempt = now + attempt_delay;
+            continue;
         }
-    }
 
-    if ((option = config->so_rcvbuf_size) > 0)
-    {
-        assert(option > 0);
-        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &option, sizeof(int)))
+        if (ninflight == 0)
         {
-            neo4j_log_warn_errno(logger, "setsockopt");
-            // continue
+            errno = err;
+            goto cleanup;
+        }
+
+        uint64_t until = (next < naddresses)? next_attempt : 0;
+        if (deadline > 0 && (until == 0 || deadline < until))
+        {
+            until = deadline;
+        }
+
+        int result = poll(pfds, ninflight, poll_timeout(until, now));
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            err = errno;
+            neo4j_log_error_errno(logger, "poll");
+            goto cleanup;
+        }
+        if (result == 0)
+        {
+            if (deadline > 0 && monotonic_ns() >= deadline)
+            {
+                err = ETIMEDOUT;
+                goto cleanup;
+            }
+            continue;
+        }
+
+        for (unsigned int i = 0; i < ninflight; )
+        {
+            if (pfds[i].revents == 0)
+            {
+                ++i;
+                continue;
+            }
+            if (connect_result(pfds[i].fd) == 0)
+            {
+                fd = pfds[i].fd;
+                pfds[i] = pfds[--ninflight];
+                break;
+            }
+            if (errno == EINPROGRESS)
+            {
+                ++i;
+                continue;
+            }
+            err = errno;
+            log_connect_failure(&(addresses[attempted[i]]), err, logger);
+            close(pfds[i].fd);
+            --ninflight;
+            pfds[i] = pfds[ninflight];
+            attempted[i] = attempted[ninflight];
+            // start the next attempt without waiting out the delay
+            next_attempt = 0;
         }
     }
+
+    if (update_socket_flags(fd, 0, O_NONBLOCK, logger))
+    {
+        err = errno;
+        close(fd);
+        fd = -1;
+    }
+
+cleanup:
+    for (unsigned int i = 0; i < ninflight; ++i)
+    {
+        close(pfds[i].fd);
+    }
+    free(pfds);
+    free(attempted);
+    if (fd < 0)
+    {
+        errno = err;
+    }
+    return fd;
 }
 
 
-int connect_with_timeout(int fd, const struct sockaddr *address,
-        socklen_t address_len, time_t timeout, neo4j_logger_t *logger)
+/*
+ * Start a non-blocking connection attempt, returning the socket, or -1 if
+ * a socket could not be created, or -2 if the connection attempt failed.
+ */
+int start_connect(const struct address *address,
+        const neo4j_config_t *config, neo4j_logger_t *logger,
+        bool *connected)
 {
-    struct timeval tv, *tvp = NULL;
-
-    if (timeout > 0)
+    int fd = socket(address->family, address->socktype, address->protocol);
+    if (fd < 0)
     {
-        tv.tv_sec = timeout;
-        tv.tv_usec = 0;
-        tvp = &tv;
+        if (!unsupported_sock_error(errno))
+        {
+            neo4j_log_error_errno(logger, "socket");
+        }
+        return -1;
     }
 
+    set_socket_options(fd, config, logger);
+
     if (update_socket_flags(fd, O_NONBLOCK, 0, logger))
     {
+        int errsv = errno;
+        close(fd);
+        errno = errsv;
         return -1;
     }
 
-    int err = connect(fd, address, address_len);
+    if (neo4j_log_is_enabled(logger, NEO4J_LOG_DEBUG))
+    {
+        char buf[NI_MAXHOST + NI_MAXSERV + 4];
+        neo4j_log_debug(logger, "attempting connection to %s",
+                describe_address(address, buf, sizeof(buf)));
+    }
 
-    if (err)
+    if (connect(fd, (const struct sockaddr *)&(address->addr),
+                address->addrlen) == 0)
     {
-        if (errno != EINPROGRESS)
+        *connected = true;
+    }
+    else if (errno != EINPROGRESS)
+    {
+        int errsv = errno;
+        close(fd);
+        errno = errsv;
+        return -2;
+    }
+    return fd;
+}
+
+
+/*
+ * Get the outcome of a connection attempt, returning 0 if connected, or -1
+ * if the attempt failed or is still in progress (errno will be set).
+ */
+int connect_result(int fd)
+{
+    int option_value;
+    socklen_t option_len = sizeof(option_value);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &option_value, &option_len))
+    {
+        return -1;
+    }
+    if (option_value != 0)
+    {
+        errno = option_value;
+        return -1;
+    }
+    // a socket with no error may still be connecting
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getpeername(fd, (struct sockaddr *)&peer, &peer_len))
+    {
+        errno = (errno == ENOTCONN)? EINPROGRESS : errno;
+        return -1;
+    }
+    errno = 0;
+    return 0;
+}
+
+
+/*
+ * Connect a non-blocking unix domain socket, waiting until the deadline (or
+ * indefinitely, if it is 0) for the connection to complete. Where the
+ * listener's backlog is full, Linux fails the attempt with EAGAIN rather
+ * than leaving it in progress, so it is retried until the deadline.
+ */
+int connect_unix(int fd, const struct sockaddr_un *addr, uint64_t deadline)
+{
+    int result = connect(fd, (const struct sockaddr *)addr, sizeof(*addr));
+    while (result)
+    {
+        if (errno != EINPROGRESS && errno != EAGAIN)
         {
-            return 1;
+            return -1;
+        }
+        uint64_t now = monotonic_ns();
+        if (deadline > 0 && now >= deadline)
+        {
+            errno = ETIMEDOUT;
+            return -1;
         }
 
-        fd_set fdset;
-        FD_ZERO(&fdset);
-        FD_SET(fd, &fdset);
-
-        do
+        if (errno == EAGAIN)
         {
-            err = select(fd + 1, NULL, &fdset, NULL, tvp);
-        } while (err < 0 && errno == EINTR);
+            uint64_t until = now + UNIX_CONNECT_RETRY_INTERVAL * 1000000;
+            if (deadline > 0 && deadline < until)
+            {
+                until = deadline;
+            }
+            if (poll(NULL, 0, poll_timeout(until, now)) >= 0 ||
+                    errno == EINTR)
+            {
+                result = connect(fd, (const struct sockaddr *)addr,
+                        sizeof(*addr));
+            }
+            continue;
+        }
 
-        if (err < 0)
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int n = poll(&pfd, 1, poll_timeout(deadline, now));
+        if (n < 0 && errno != EINTR)
         {
-            neo4j_log_error_errno(logger, "select");
             return -1;
         }
+        result = (n > 0)? connect_result(fd) : -1;
+        if (n <= 0)
+        {
+            errno = EINPROGRESS;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Get the timeout for poll(2), in milliseconds, to wait until the specified
+ * time (or indefinitely, if it is 0).
+ */
+int poll_timeout(uint64_t until, uint64_t now)
+{
+    if (until == 0)
+    {
+        return -1;
+    }
+    uint64_t remaining = (until > now)? until - now : 0;
+    // round up, so as not to spin for the last fraction
+    remaining = (remaining + 999999) / 1000000;
+    return (remaining > INT_MAX)? INT_MAX : (int)remaining;
+}
+
 
-        if (err == 0)
+void log_connect_failure(const struct address *address, int err,
+        neo4j_logger_t *logger)
+{
+    if (!neo4j_log_is_enabled(logger, NEO4J_LOG_INFO))
+    {
+        return;
+    }
+    char buf[NI_MAXHOST + NI_MAXSERV + 4];
+    char ebuf[256];
+    neo4j_log_info(logger, "connection to %s failed: %s",
+            describe_address(address, buf, sizeof(buf)),
+            neo4j_strerror(err, ebuf, sizeof(ebuf)));
+}
+
+
+const char *describe_address(const struct address *address,
+        char *buf, size_t n)
+{
+    char hostnum[NI_MAXHOST];
+    char servnum[NI_MAXSERV];
+    int err = getnameinfo((const struct sockaddr *)&(address->addr),
+            address->addrlen, hostnum, sizeof(hostnum),
+            servnum, sizeof(servnum), NI_NUMERICHOST | NI_NUMERICSERV);
+    if (err)
+    {
+        snprintf(buf, n, "<unknown>");
+        return buf;
+    }
+    snprintf(buf, n, "%s [%s]", hostnum, servnum);
+    return buf;
+}
+
+
+void set_socket_options(int fd, const neo4j_config_t *config,
+        neo4j_logger_t *logger)
+{
+    int option;
+
+    if ((option = config->so_sndbuf_size) > 0)
+    {
+        assert(option > 0);
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &option, sizeof(int)))
         {
-            errno = ETIMEDOUT;
-            return 1;
+            neo4j_log_warn_errno(logger, "setsockopt");
+            // continue
+        }
+    }
+
+    if ((option = config->so_rcvbuf_size) > 0)
+    {
+        assert(option > 0);
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &option, sizeof(int)))
+        {
+            neo4j_log_warn_errno(logger, "setsockopt");
+            // continue
         }
+    }
 
-        int option_value;
-        socklen_t option_len = sizeof(option_value);
-        err = getsockopt(fd, SOL_SOCKET, SO_ERROR, &option_value, &option_len);
-        if (err)
+    // avoid stalls on requests written separately, but sent together
+    option = config->tcp_nodelay? 1 : 0;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(int)))
+    {
+        neo4j_log_warn_errno(logger, "setsockopt(TCP_NODELAY)");
+        // continue
+    }
+
+#ifdef TCP_QUICKACK
+    if (config->tcp_quickack)
+    {
+        option = 1;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &option, sizeof(int)))
         {
-            neo4j_log_error_errno(logger, "getsockopt");
-            return -1;
+            neo4j_log_warn_errno(logger, "setsockopt(TCP_QUICKACK)");
+            // continue
         }
+    }
+#endif
+
+    if (config->tcp_keepalive_idle > 0)
+    {
+        set_keepalive_options(fd, config, logger);
+    }
 
-        if (option_value != 0)
+    if ((option = config->so_busy_poll) > 0)
+    {
+#ifdef SO_BUSY_POLL
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &option, sizeof(int)))
         {
-            errno = option_value;
-            return 1;
+            neo4j_log_warn_errno(logger, "setsockopt(SO_BUSY_POLL)");
+            // continue
         }
+#else
+        neo4j_log_warn(logger, "SO_BUSY_POLL is not supported on this system");
+#endif
     }
+}
 
-    if (update_socket_flags(fd, 0, O_NONBLOCK, logger))
+
+void set_keepalive_options(int fd, const neo4j_config_t *config,
+        neo4j_logger_t *logger)
+{
+    int option = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &option, sizeof(int)))
     {
-        return -1;
+        neo4j_log_warn_errno(logger, "setsockopt(SO_KEEPALIVE)");
+        return;
     }
 
-    return 0;
+    option = config->tcp_keepalive_idle;
+    assert(option > 0);
+#if defined TCP_KEEPIDLE
+    if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &option, sizeof(int)))
+    {
+        neo4j_log_warn_errno(logger, "setsockopt(TCP_KEEPIDLE)");
+    }
+#elif defined TCP_KEEPALIVE
+    if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPALIVE, &option, sizeof(int)))
+    {
+        neo4j_log_warn_errno(logger, "setsockopt(TCP_KEEPALIVE)");
+    }
+#endif
+
+#ifdef TCP_KEEPINTVL
+    if ((option = config->tcp_keepalive_interval) > 0 &&
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &option, sizeof(int)))
+    {
+        neo4j_log_warn_errno(logger, "setsockopt(TCP_KEEPINTVL)");
+    }
+#endif
+
+#ifdef TCP_KEEPCNT
+    if ((option = config->tcp_keepalive_count) > 0 &&
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &option, sizeof(int)))
+    {
+        neo4j_log_warn_errno(logger, "setsockopt(TCP_KEEPCNT)");
+    }
+#endif
 }
 
 
@@ -245,7 +970,7 @@ int update_socket_flags(int fd, int flags_to_set, int flags_to_clear,
     }
 
     arg |= flags_to_set;
-    arg &= flags_to_clear;
+    arg &= ~flags_to_clear;
 
     if (fcntl(fd, F_SETFL, arg) < 0)
     {
@@ -19,11 +19,41 @@
 
 #include "neo4j-client.h"
 
+/**
+ * Initialize the network layer.
+ *
+ * Must be called at initialization. Not thread safe.
+ *
+ * @internal
+ *
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_network_init(void);
+
+/**
+ * Cleanup anything allocated by the network layer.
+ *
+ * Should be called before termination. Not thread safe.
+ *
+ * @internal
+ *
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_network_cleanup(void);
+
 /**
  * Connect a TCP socket.
  *
  * @internal
  *
+ * Resolved addresses are cached for the time set in the configuration, and
+ * a name that does not exist is cached for the negative cache time. When a
+ * name resolves to multiple addresses, connections to each are attempted
+ * in parallel, staggered by the connection attempt delay, and interleaving
+ * address families (RFC 8305). The first connection to succeed is used.
+ *
  * @param [hostname] The hostname to connect to.
  * @param [servname] The name of the TCP service to connect to.
  * @param [config] The client configuration.
@@ -34,4 +64,21 @@ __neo4j_must_check
 int neo4j_connect_tcp_socket(const char *hostname, const char *servname,
         const neo4j_config_t *config, struct neo4j_logger *logger);
 
+/**
+ * Connect a unix domain socket.
+ *
+ * The connection is bounded by the configured connect timeout, which also
+ * applies while the listener's backlog is full.
+ *
+ * @internal
+ *
+ * @param [path] The path of the socket to connect to.
+ * @param [config] The client configuration.
+ * @param [logger] A logger to write diagnostics and errors to.
+ * @return The connected socket, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_connect_unix_socket(const char *path, const neo4j_config_t *config,
+        struct neo4j_logger *logger);
+
 #endif/*NEO4J_NETWORK_H*/
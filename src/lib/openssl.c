@@ -18,17 +18,127 @@
 #include "openssl.h"
 #include "errno.h"
 #include "logging.h"
+#include "probes.h"
 #include "thread.h"
 #include "tofu.h"
 #include "util.h"
 #include <assert.h>
 #include <openssl/x509v3.h>
 #include <openssl/err.h>
+#include <sys/stat.h>
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+#define TLS_CLIENT_METHOD TLS_client_method
+#else
+#define TLS_CLIENT_METHOD SSLv23_client_method
+#endif
+
+#if defined(TLS1_3_VERSION)
+#define TLS_MAX_VERSION_SUPPORTED NEO4J_TLS_V1_3
+#elif defined(TLS1_2_VERSION)
+#define TLS_MAX_VERSION_SUPPORTED NEO4J_TLS_V1_2
+#else
+#define TLS_MAX_VERSION_SUPPORTED NEO4J_TLS_V1_0
+#endif
+
+// Ephemeral key exchange and AEAD ciphers first, falling back to any strong
+// cipher. AES-GCM is only preferred if the CPU has AES instructions, as
+// ChaCha20-Poly1305 is faster (and constant time) in software.
+#define TLS_CIPHERS_AES_FIRST \
+    "ECDHE+AESGCM:ECDHE+CHACHA20:DHE+AESGCM:DHE+CHACHA20:" \
+    "HIGH:!EXPORT:!aNULL:!MD5:!RC4"
+#define TLS_CIPHERS_CHACHA_FIRST \
+    "ECDHE+CHACHA20:ECDHE+AESGCM:DHE+CHACHA20:DHE+AESGCM:" \
+    "HIGH:!EXPORT:!aNULL:!MD5:!RC4"
+#define TLS_CIPHERSUITES_AES_FIRST \
+    "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:" \
+    "TLS_CHACHA20_POLY1305_SHA256"
+#define TLS_CIPHERSUITES_CHACHA_FIRST \
+    "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256:" \
+    "TLS_AES_256_GCM_SHA384"
+
+#define CTX_CACHE_MAX_ENTRIES 8
+#define SESSION_CACHE_MAX_ENTRIES 64
+
+struct file_stamp
+{
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+};
+
+struct ctx_cache_entry
+{
+    char *tls_private_key_file;
+    char *tls_ca_file;
+    char *tls_ca_dir;
+    unsigned int tls_min_version;
+    char *tls_ciphers;
+    char *tls_ciphersuites;
+    neo4j_password_callback_t tls_pem_pw_callback;
+    void *tls_pem_pw_callback_userdata;
+    struct file_stamp private_key_stamp;
+    struct file_stamp ca_file_stamp;
+    struct file_stamp ca_dir_stamp;
+
+    SSL_CTX *ctx;
+    struct ctx_cache_entry *next;
+};
+
+struct session_key
+{
+    int port;
+    char hostname[];
+};
+
+struct session_cache_entry
+{
+    SSL_CTX *ctx;
+    SSL_SESSION *session;
+    struct session_cache_entry *next;
+    int port;
+    char hostname[];
+};
 
 static neo4j_mutex_t *thread_locks;
+static neo4j_mutex_t ctx_cache_lock;
+static struct ctx_cache_entry *ctx_cache;
+static neo4j_mutex_t session_cache_lock;
+static struct session_cache_entry *session_cache;
+static int session_key_index = -1;
 
 static void locking_callback(int mode, int type, const char *file, int line);
+static SSL_CTX *get_ctx(const neo4j_config_t *config, neo4j_logger_t *logger);
+static void stamp_file(struct file_stamp *stamp, const char *path);
+static bool ctx_cache_entry_matches(const struct ctx_cache_entry *entry,
+        const neo4j_config_t *config, const struct file_stamp stamps[3]);
+static struct ctx_cache_entry *new_ctx_cache_entry(
+        const neo4j_config_t *config, const struct file_stamp stamps[3],
+        SSL_CTX *ctx);
+static void free_ctx_cache_entry(struct ctx_cache_entry *entry);
+static void ctx_up_ref(SSL_CTX *ctx);
+static int set_session(SSL *ssl, const char *hostname, int port,
+        neo4j_logger_t *logger);
+static int new_session_callback(SSL *ssl, SSL_SESSION *session);
+static void remove_session(SSL *ssl);
+static struct session_cache_entry **find_session(SSL_CTX *ctx,
+        const struct session_key *key);
+static void free_session_cache_entry(struct session_cache_entry *entry);
+static void free_session_key(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+        int idx, long argl, void *argp);
 static SSL_CTX *new_ctx(const neo4j_config_t *config, neo4j_logger_t *logger);
+static int set_min_version(SSL_CTX *ctx, unsigned int version,
+        neo4j_logger_t *logger);
+static int set_ciphers(SSL_CTX *ctx, const neo4j_config_t *config,
+        neo4j_logger_t *logger);
+static bool has_aes_instructions(void);
 static int load_private_key(SSL_CTX *ctx, const neo4j_config_t *config,
         neo4j_logger_t *logger);
 static int pem_pw_callback(char *buf, int size, int rwflag, void *userdata);
@@ -86,7 +196,30 @@ int neo4j_openssl_init(void)
         CRYPTO_set_id_callback(neo4j_current_thread_id);
     }
 
-    SSL_CTX *ctx = SSL_CTX_new(TLSv1_method());
+    int err = neo4j_mutex_init(&ctx_cache_lock);
+    if (err)
+    {
+        errno = err;
+        return -1;
+    }
+
+    err = neo4j_mutex_init(&session_cache_lock);
+    if (err)
+    {
+        neo4j_mutex_destroy(&ctx_cache_lock);
+        errno = err;
+        return -1;
+    }
+
+    session_key_index = SSL_get_ex_new_index(0, NULL, NULL, NULL,
+            free_session_key);
+    if (session_key_index < 0)
+    {
+        errno = openssl_error(NULL, NEO4J_LOG_ERROR, __FILE__, __LINE__);
+        return -1;
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_CLIENT_METHOD());
     if (ctx == NULL)
     {
         errno = openssl_error(NULL, NEO4J_LOG_ERROR, __FILE__, __LINE__);
@@ -106,6 +239,22 @@ int neo4j_openssl_cleanup(void)
         CRYPTO_set_id_callback(NULL);
     }
 
+    while (session_cache != NULL)
+    {
+        struct session_cache_entry *entry = session_cache;
+        session_cache = entry->next;
+        free_session_cache_entry(entry);
+    }
+    neo4j_mutex_destroy(&session_cache_lock);
+
+    while (ctx_cache != NULL)
+    {
+        struct ctx_cache_entry *entry = ctx_cache;
+        ctx_cache = entry->next;
+        free_ctx_cache_entry(entry);
+    }
+    neo4j_mutex_destroy(&ctx_cache_lock);
+
     int num_locks = CRYPTO_num_locks();
     for (int i = 0; i < num_locks; i++)
     {
@@ -136,7 +285,7 @@ BIO *neo4j_openssl_new_bio(BIO *delegate, const char *hostname, int port,
 {
     neo4j_logger_t *logger = neo4j_get_logger(config, "tls");
 
-    SSL_CTX *ctx = new_ctx(config, logger);
+    SSL_CTX *ctx = get_ctx(config, logger);
     if (ctx == NULL)
     {
         neo4j_logger_release(logger);
@@ -151,8 +300,26 @@ BIO *neo4j_openssl_new_bio(BIO *delegate, const char *hostname, int port,
         goto failure;
     }
 
+    // release the reference returned by get_ctx, as the SSL holds its own
     SSL_CTX_free(ctx);
 
+    SSL *ssl = NULL;
+    BIO_get_ssl(ssl_bio, &ssl);
+    assert(ssl != NULL);
+    if (set_session(ssl, hostname, port, logger))
+    {
+        goto failure;
+    }
+
+#ifdef SSL_OP_ENABLE_KTLS
+    // the kernel can only take over when OpenSSL is writing to the socket
+    if (config->tls_kernel_offload &&
+            BIO_method_type(delegate) == BIO_TYPE_SOCKET)
+    {
+        SSL_set_options(ssl, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
     BIO_push(ssl_bio, delegate);
     if (BIO_set_close(ssl_bio, BIO_CLOSE) != 1)
     {
@@ -160,7 +327,9 @@ BIO *neo4j_openssl_new_bio(BIO *delegate, const char *hostname, int port,
         goto failure;
     }
 
+    NEO4J_PROBE3(tls_handshake_start, ssl_bio, hostname, port);
     int result = BIO_do_handshake(ssl_bio);
+    NEO4J_PROBE2(tls_handshake_done, ssl_bio, result);
     if (result != 1)
     {
         if (result == 0)
@@ -172,11 +341,17 @@ BIO *neo4j_openssl_new_bio(BIO *delegate, const char *hostname, int port,
         goto failure;
     }
 
-    SSL *ssl = NULL;
-    BIO_get_ssl(ssl_bio, &ssl);
-    assert(ssl != NULL);
+    if (SSL_session_reused(ssl))
+    {
+        neo4j_log_debug(logger, "resumed TLS session with %s:%d",
+                hostname, port);
+    }
+
+    // a resumed session carries the verification result from when it was
+    // established, so this still applies the current trust settings
     if (verify(ssl, hostname, port, config, flags, logger))
     {
+        remove_session(ssl);
         goto failure;
     }
 
@@ -193,26 +368,366 @@ failure:
 }
 
 
+SSL_CTX *get_ctx(const neo4j_config_t *config, neo4j_logger_t *logger)
+{
+    // contexts are shared between connections with the same TLS
+    // configuration, and replaced if any of the files they were loaded
+    // from have since changed
+    struct file_stamp stamps[3];
+    stamp_file(&(stamps[0]), config->tls_private_key_file);
+    stamp_file(&(stamps[1]), config->tls_ca_file);
+    stamp_file(&(stamps[2]), config->tls_ca_dir);
+
+    neo4j_mutex_lock(&ctx_cache_lock);
+
+    struct ctx_cache_entry **prev = &ctx_cache;
+    unsigned int nentries = 0;
+    for (struct ctx_cache_entry *entry = ctx_cache; entry != NULL;
+            prev = &(entry->next), entry = entry->next, ++nentries)
+    {
+        if (!ctx_cache_entry_matches(entry, config, stamps))
+        {
+            continue;
+        }
+        // move to the front, so the least recently used entry is last
+        *prev = entry->next;
+        entry->next = ctx_cache;
+        ctx_cache = entry;
+        ctx_up_ref(entry->ctx);
+        SSL_CTX *ctx = entry->ctx;
+        neo4j_mutex_unlock(&ctx_cache_lock);
+        neo4j_log_trace(logger, "reusing cached SSL_CTX %p", (void *)ctx);
+        return ctx;
+    }
+
+    SSL_CTX *ctx = new_ctx(config, logger);
+    if (ctx == NULL)
+    {
+        int errsv = errno;
+        neo4j_mutex_unlock(&ctx_cache_lock);
+        errno = errsv;
+        return NULL;
+    }
+
+    struct ctx_cache_entry *entry = new_ctx_cache_entry(config, stamps, ctx);
+    if (entry == NULL)
+    {
+        // the context is still usable, it just won't be shared
+        neo4j_mutex_unlock(&ctx_cache_lock);
+        return ctx;
+    }
+    ctx_up_ref(ctx);
+    entry->next = ctx_cache;
+    ctx_cache = entry;
+
+    if (nentries >= CTX_CACHE_MAX_ENTRIES)
+    {
+        struct ctx_cache_entry **last = &(entry->next);
+        while ((*last)->next != NULL)
+        {
+            last = &((*last)->next);
+        }
+        free_ctx_cache_entry(*last);
+        *last = NULL;
+    }
+
+    neo4j_mutex_unlock(&ctx_cache_lock);
+    return ctx;
+}
+
+
+void stamp_file(struct file_stamp *stamp, const char *path)
+{
+    memset(stamp, 0, sizeof(struct file_stamp));
+    struct stat sb;
+    if (path == NULL || stat(path, &sb))
+    {
+        return;
+    }
+    stamp->dev = sb.st_dev;
+    stamp->ino = sb.st_ino;
+    stamp->size = sb.st_size;
+    stamp->mtime = sb.st_mtime;
+}
+
+
+static bool str_equal(const char *s1, const char *s2)
+{
+    return (s1 == NULL || s2 == NULL)? s1 == s2 : strcmp(s1, s2) == 0;
+}
+
+
+bool ctx_cache_entry_matches(const struct ctx_cache_entry *entry,
+        const neo4j_config_t *config, const struct file_stamp stamps[3])
+{
+    return str_equal(entry->tls_private_key_file,
+                config->tls_private_key_file) &&
+        str_equal(entry->tls_ca_file, config->tls_ca_file) &&
+        str_equal(entry->tls_ca_dir, config->tls_ca_dir) &&
+        entry->tls_min_version == config->tls_min_version &&
+        str_equal(entry->tls_ciphers, config->tls_ciphers) &&
+        str_equal(entry->tls_ciphersuites, config->tls_ciphersuites) &&
+        entry->tls_pem_pw_callback == config->tls_pem_pw_callback &&
+        entry->tls_pem_pw_callback_userdata ==
+            config->tls_pem_pw_callback_userdata &&
+        memcmp(&(entry->private_key_stamp), &(stamps[0]),
+                sizeof(struct file_stamp)) == 0 &&
+        memcmp(&(entry->ca_file_stamp), &(stamps[1]),
+                sizeof(struct file_stamp)) == 0 &&
+        memcmp(&(entry->ca_dir_stamp), &(stamps[2]),
+                sizeof(struct file_stamp)) == 0;
+}
+
+
+struct ctx_cache_entry *new_ctx_cache_entry(const neo4j_config_t *config,
+        const struct file_stamp stamps[3], SSL_CTX *ctx)
+{
+    struct ctx_cache_entry *entry = calloc(1, sizeof(struct ctx_cache_entry));
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+    if (strdup_null(&(entry->tls_private_key_file),
+                config->tls_private_key_file) ||
+        strdup_null(&(entry->tls_ca_file), config->tls_ca_file) ||
+        strdup_null(&(entry->tls_ca_dir), config->tls_ca_dir) ||
+        strdup_null(&(entry->tls_ciphers), config->tls_ciphers) ||
+        strdup_null(&(entry->tls_ciphersuites), config->tls_ciphersuites))
+    {
+        free(entry->tls_private_key_file);
+        free(entry->tls_ca_file);
+        free(entry->tls_ca_dir);
+        free(entry->tls_ciphers);
+        free(entry);
+        return NULL;
+    }
+    entry->tls_min_version = config->tls_min_version;
+    entry->tls_pem_pw_callback = config->tls_pem_pw_callback;
+    entry->tls_pem_pw_callback_userdata = config->tls_pem_pw_callback_userdata;
+    memcpy(&(entry->private_key_stamp), &(stamps[0]),
+            sizeof(struct file_stamp));
+    memcpy(&(entry->ca_file_stamp), &(stamps[1]), sizeof(struct file_stamp));
+    memcpy(&(entry->ca_dir_stamp), &(stamps[2]), sizeof(struct file_stamp));
+    entry->ctx = ctx;
+    return entry;
+}
+
+
+void free_ctx_cache_entry(struct ctx_cache_entry *entry)
+{
+    SSL_CTX_free(entry->ctx);
+    free(entry->tls_private_key_file);
+    free(entry->tls_ca_file);
+    free(entry->tls_ca_dir);
+    free(entry->tls_ciphers);
+    free(entry->tls_ciphersuites);
+    free(entry);
+}
+
+
+void ctx_up_ref(SSL_CTX *ctx)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    CRYPTO_add(&(ctx->references), 1, CRYPTO_LOCK_SSL_CTX);
+#else
+    SSL_CTX_up_ref(ctx);
+#endif
+}
+
+
+int set_session(SSL *ssl, const char *hostname, int port,
+        neo4j_logger_t *logger)
+{
+    size_t hostlen = strlen(hostname) + 1;
+    struct session_key *key = malloc(sizeof(struct session_key) + hostlen);
+    if (key == NULL)
+    {
+        return -1;
+    }
+    key->port = port;
+    memcpy(key->hostname, hostname, hostlen);
+
+    if (SSL_set_ex_data(ssl, session_key_index, key) != 1)
+    {
+        free(key);
+        errno = openssl_error(logger, NEO4J_LOG_ERROR, __FILE__, __LINE__);
+        return -1;
+    }
+
+    neo4j_mutex_lock(&session_cache_lock);
+    struct session_cache_entry **entryp =
+        find_session(SSL_get_SSL_CTX(ssl), key);
+    if (entryp == NULL)
+    {
+        neo4j_mutex_unlock(&session_cache_lock);
+        return 0;
+    }
+
+    struct session_cache_entry *entry = *entryp;
+    SSL_SESSION *session = entry->session;
+    if ((long)time(NULL) >=
+            SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session))
+    {
+        *entryp = entry->next;
+        free_session_cache_entry(entry);
+        neo4j_mutex_unlock(&session_cache_lock);
+        return 0;
+    }
+
+    // move to the front, so the least recently used entry is last
+    *entryp = entry->next;
+    entry->next = session_cache;
+    session_cache = entry;
+
+    int result = SSL_set_session(ssl, session);
+    neo4j_mutex_unlock(&session_cache_lock);
+    if (result != 1)
+    {
+        // not fatal, as a full handshake will be done instead
+        openssl_error(logger, NEO4J_LOG_WARN, __FILE__, __LINE__);
+    }
+    return 0;
+}
+
+
+int new_session_callback(SSL *ssl, SSL_SESSION *session)
+{
+    const struct session_key *key = SSL_get_ex_data(ssl, session_key_index);
+    if (key == NULL)
+    {
+        return 0;
+    }
+    SSL_CTX *ctx = SSL_get_SSL_CTX(ssl);
+
+    neo4j_mutex_lock(&session_cache_lock);
+
+    struct session_cache_entry *entry;
+    struct session_cache_entry **entryp = find_session(ctx, key);
+    if (entryp != NULL)
+    {
+        entry = *entryp;
+        *entryp = entry->next;
+        SSL_SESSION_free(entry->session);
+    }
+    else
+    {
+        size_t hostlen = strlen(key->hostname) + 1;
+        entry = malloc(sizeof(struct session_cache_entry) + hostlen);
+        if (entry == NULL)
+        {
+            neo4j_mutex_unlock(&session_cache_lock);
+            return 0;
+        }
+        ctx_up_ref(ctx);
+        entry->ctx = ctx;
+        entry->port = key->port;
+        memcpy(entry->hostname, key->hostname, hostlen);
+    }
+
+    // the cache takes ownership of the reference to the session
+    entry->session = session;
+    entry->next = session_cache;
+    session_cache = entry;
+
+    unsigned int nentries = 0;
+    for (entryp = &session_cache; *entryp != NULL;
+            entryp = &((*entryp)->next))
+    {
+        if (++nentries > SESSION_CACHE_MAX_ENTRIES)
+        {
+            free_session_cache_entry(*entryp);
+            *entryp = NULL;
+            break;
+        }
+    }
+
+    neo4j_mutex_unlock(&session_cache_lock);
+    return 1;
+}
+
+
+void remove_session(SSL *ssl)
+{
+    const struct session_key *key = SSL_get_ex_data(ssl, session_key_index);
+    if (key == NULL)
+    {
+        return;
+    }
+
+    neo4j_mutex_lock(&session_cache_lock);
+    struct session_cache_entry **entryp =
+        find_session(SSL_get_SSL_CTX(ssl), key);
+    if (entryp != NULL)
+    {
+        struct session_cache_entry *entry = *entryp;
+        *entryp = entry->next;
+        free_session_cache_entry(entry);
+    }
+    neo4j_mutex_unlock(&session_cache_lock);
+}
+
+
+struct session_cache_entry **find_session(SSL_CTX *ctx,
+        const struct session_key *key)
+{
+    // sessions are only reused with the context they were established
+    // with, as the context determines which certificates were trusted
+    for (struct session_cache_entry **entryp = &session_cache;
+            *entryp != NULL; entryp = &((*entryp)->next))
+    {
+        struct session_cache_entry *entry = *entryp;
+        if (entry->ctx == ctx && entry->port == key->port &&
+                strcmp(entry->hostname, key->hostname) == 0)
+        {
+            return entryp;
+        }
+    }
+    return NULL;
+}
+
+
+void free_session_cache_entry(struct session_cache_entry *entry)
+{
+    SSL_SESSION_free(entry->session);
+    SSL_CTX_free(entry->ctx);
+    free(entry);
+}
+
+
+void free_session_key(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+        int idx, long argl, void *argp)
+{
+    free(ptr);
+}
+
+
 SSL_CTX *new_ctx(const neo4j_config_t *config, neo4j_logger_t *logger)
 {
-    SSL_CTX *ctx = SSL_CTX_new(TLSv1_method());
+    SSL_CTX *ctx = SSL_CTX_new(TLS_CLIENT_METHOD());
     if (ctx == NULL)
     {
         errno = openssl_error(logger, NEO4J_LOG_ERROR, __FILE__, __LINE__);
         return NULL;
     }
 
-    if (SSL_CTX_set_cipher_list(ctx, "HIGH:!EXPORT:!aNULL@STRENGTH") != 1)
+    if (set_min_version(ctx, config->tls_min_version, logger))
+    {
+        goto failure;
+    }
+
+    if (set_ciphers(ctx, config, logger))
     {
-        errno = openssl_error(logger, NEO4J_LOG_ERROR, __FILE__, __LINE__);
         goto failure;
     }
 
     // Necessary when using blocking sockets
     SSL_CTX_set_mode(ctx, SSL_MODE_AUTO_RETRY);
 
-    // Caching should be done at the protocol layer anyway
-    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    // Sessions are cached per server in new_session_callback, rather than
+    // in the internal store (which is for server-side lookup by id)
+    SSL_CTX_set_session_cache_mode(ctx,
+            SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, new_session_callback);
 
     if (load_private_key(ctx, config, logger))
     {
@@ -224,6 +739,10 @@ SSL_CTX *new_ctx(const neo4j_config_t *config, neo4j_logger_t *logger)
         goto failure;
     }
 
+    // the context may outlive the config, so must not keep a reference to it
+    SSL_CTX_set_default_passwd_cb(ctx, NULL);
+    SSL_CTX_set_default_passwd_cb_userdata(ctx, NULL);
+
     return ctx;
 
     int errsv;
@@ -235,6 +754,97 @@ failure:
 }
 
 
+int set_min_version(SSL_CTX *ctx, unsigned int version,
+        neo4j_logger_t *logger)
+{
+    if (version > TLS_MAX_VERSION_SUPPORTED)
+    {
+        neo4j_log_error(logger, "TLS version 0x%04x is not supported by %s",
+                version, SSLeay_version(SSLEAY_VERSION));
+        errno = ENOTSUP;
+        return -1;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    if (SSL_CTX_set_min_proto_version(ctx, version) != 1)
+    {
+        errno = openssl_error(logger, NEO4J_LOG_ERROR, __FILE__, __LINE__);
+        return -1;
+    }
+#else
+    long options = SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3;
+    if (version > NEO4J_TLS_V1_0)
+    {
+        options |= SSL_OP_NO_TLSv1;
+    }
+#ifdef SSL_OP_NO_TLSv1_1
+    if (version > NEO4J_TLS_V1_1)
+    {
+        options |= SSL_OP_NO_TLSv1_1;
+    }
+#endif
+    SSL_CTX_set_options(ctx, options);
+#endif
+    return 0;
+}
+
+
+int set_ciphers(SSL_CTX *ctx, const neo4j_config_t *config,
+        neo4j_logger_t *logger)
+{
+    bool aes_first = has_aes_instructions();
+
+    const char *ciphers = config->tls_ciphers;
+    if (ciphers == NULL)
+    {
+        ciphers = aes_first? TLS_CIPHERS_AES_FIRST : TLS_CIPHERS_CHACHA_FIRST;
+    }
+    if (SSL_CTX_set_cipher_list(ctx, ciphers) != 1)
+    {
+        errno = openssl_error(logger, NEO4J_LOG_ERROR, __FILE__, __LINE__);
+        return -1;
+    }
+
+#ifdef TLS1_3_VERSION
+    const char *ciphersuites = config->tls_ciphersuites;
+    if (ciphersuites == NULL)
+    {
+        ciphersuites = aes_first?
+            TLS_CIPHERSUITES_AES_FIRST : TLS_CIPHERSUITES_CHACHA_FIRST;
+    }
+    if (SSL_CTX_set_ciphersuites(ctx, ciphersuites) != 1)
+    {
+        errno = openssl_error(logger, NEO4J_LOG_ERROR, __FILE__, __LINE__);
+        return -1;
+    }
+#else
+    if (config->tls_ciphersuites != NULL)
+    {
+        neo4j_log_error(logger, "TLS 1.3 cipher suites are not supported by %s",
+                SSLeay_version(SSLEAY_VERSION));
+        errno = ENOTSUP;
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+
+bool has_aes_instructions(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes");
+#elif defined(__aarch64__) && defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#elif defined(__aarch64__) && defined(__APPLE__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
 int load_private_key(SSL_CTX *ctx, const neo4j_config_t *config,
         neo4j_logger_t *logger)
 {
@@ -47,6 +47,10 @@ int neo4j_openssl_cleanup(void);
 /**
  * Create a SSL BIO.
  *
+ * The SSL context is shared with other connections that use the same TLS
+ * configuration, and is reloaded if the key or certificate authority files
+ * change.
+ *
  * @internal
  *
  * @param [delegate] A BIO for the cleartext stream.
@@ -16,21 +16,40 @@
  */
 #include "../../config.h"
 #include "openssl_iostream.h"
+#include "client_config.h"
+#include "logging.h"
 #include "openssl.h"
+#include "posix_iostream.h"
 #include "util.h"
 #include <assert.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
 #include <stddef.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 
+// the maximum plaintext in a single TLS record
+#define TLS_RECORD_SIZE 16384
+// ciphertext is collected for up to a few records before being written
+#define CIPHERTEXT_BATCH_SIZE (4 * (TLS_RECORD_SIZE + 1024))
+
+
 struct openssl_iostream {
-    neo4j_iostream_t _iostream;
+    struct neo4j_waitable_iostream _waitable;
     BIO *bio;
     neo4j_iostream_t *delegate;
+    // plaintext collected until there is enough for a full record, or
+    // until the stream is flushed
+    uint8_t record[TLS_RECORD_SIZE];
+    size_t record_length;
+    // ciphertext from the iostream BIO, awaiting a write to the delegate
+    uint8_t *ciphertext;
+    size_t ciphertext_length;
 };
 
 
@@ -43,6 +62,22 @@ static ssize_t openssl_writev(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt);
 static int openssl_flush(neo4j_iostream_t *self);
 static int openssl_close(neo4j_iostream_t *self);
+static int openssl_wait(neo4j_iostream_t *self, unsigned int timeout);
+static struct openssl_iostream *new_openssl_iostream(
+        neo4j_iostream_t *delegate);
+static void free_openssl_iostream(struct openssl_iostream *ios);
+static int write_record(struct openssl_iostream *ios,
+        const void *buf, size_t nbyte);
+static int write_errno(struct openssl_iostream *ios, int result);
+static int flush_record(struct openssl_iostream *ios);
+static int flush_ciphertext(struct openssl_iostream *ios);
+#if defined(SSL_OP_ENABLE_KTLS) && defined(BIO_get_ktls_send) && \
+    defined(HAVE_LINUX_TLS_H)
+#define HAVE_KTLS 1
+static neo4j_iostream_t *ktls_iostream(neo4j_iostream_t *delegate,
+        const char *hostname, int port,
+        const neo4j_config_t *config, uint_fast32_t flags);
+#endif
 
 static int iostream_bio_write(BIO *bio, const char *buf, int nbyte);
 static int iostream_bio_read(BIO *bio, char *buf, int nbyte);
@@ -74,14 +109,35 @@ neo4j_iostream_t *neo4j_openssl_iostream(neo4j_iostream_t *delegate,
     REQUIRE(hostname != NULL, NULL);
     REQUIRE(config != NULL, NULL);
 
+    if (config->tls_kernel_offload)
+    {
+#ifdef HAVE_KTLS
+        neo4j_iostream_t *ios = ktls_iostream(delegate, hostname, port,
+                config, flags);
+        if (ios != NULL || errno != ENOTSUP)
+        {
+            return ios;
+        }
+#endif
+        neo4j_logger_t *logger = neo4j_get_logger(config, "tls");
+        neo4j_log_debug(logger, "kernel TLS offload unavailable for %s:%d",
+                hostname, port);
+        neo4j_logger_release(logger);
+    }
+
+    struct openssl_iostream *ios = new_openssl_iostream(delegate);
+    if (ios == NULL)
+    {
+        return NULL;
+    }
+
     BIO *iostream_bio = BIO_new(&iostream_bio_method);
     if (iostream_bio == NULL)
     {
+        free_openssl_iostream(ios);
         return NULL;
     }
-    iostream_bio->ptr = delegate;
-
-    struct openssl_iostream *ios = NULL;
+    iostream_bio->ptr = ios;
 
     BIO *ssl_bio = neo4j_openssl_new_bio(iostream_bio, hostname, port,
             config, flags);
@@ -90,45 +146,136 @@ neo4j_iostream_t *neo4j_openssl_iostream(neo4j_iostream_t *delegate,
         goto failure;
     }
 
-    ios = calloc(1, sizeof(struct openssl_iostream));
+    ios->bio = ssl_bio;
+    return &(ios->_waitable._iostream);
+
+    int errsv;
+failure:
+    errsv = errno;
+    BIO_free(iostream_bio);
+    free_openssl_iostream(ios);
+    errno = errsv;
+    return NULL;
+}
+
+
+struct openssl_iostream *new_openssl_iostream(neo4j_iostream_t *delegate)
+{
+    struct openssl_iostream *ios = calloc(1, sizeof(struct openssl_iostream));
     if (ios == NULL)
     {
-        goto failure;
+        return NULL;
     }
 
-    ios->bio = ssl_bio;
     ios->delegate = delegate;
-    neo4j_iostream_t *iostream = &(ios->_iostream);
+    neo4j_iostream_t *iostream = neo4j_waitable_ios_init(&(ios->_waitable),
+            openssl_close,
+            neo4j_ios_can_wait(delegate)? openssl_wait : NULL);
     iostream->read = openssl_read;
     iostream->readv = openssl_readv;
     iostream->write = openssl_write;
     iostream->writev = openssl_writev;
     iostream->flush = openssl_flush;
-    iostream->close = openssl_close;
-    return iostream;
+    return ios;
+}
 
-    int errsv;
-failure:
-    errsv = errno;
-    if (ssl_bio != NULL)
+
+void free_openssl_iostream(struct openssl_iostream *ios)
+{
+    free(ios->ciphertext);
+    free(ios);
+}
+
+
+#ifdef HAVE_KTLS
+/*
+ * Establish TLS with OpenSSL reading and writing the socket directly, so it
+ * can pass the keys to the kernel after the handshake. Fails with ENOTSUP,
+ * before any I/O, if the delegate is not a suitable socket.
+ */
+neo4j_iostream_t *ktls_iostream(neo4j_iostream_t *delegate,
+        const char *hostname, int port,
+        const neo4j_config_t *config, uint_fast32_t flags)
+{
+    int fd = neo4j_posix_iostream_fd(delegate);
+    int fdflags = (fd >= 0)? fcntl(fd, F_GETFL, 0) : -1;
+    if (fdflags == -1 || (fdflags & O_NONBLOCK))
+    {
+        // a socket BIO can't wait for a non-blocking descriptor
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    BIO *socket_bio = BIO_new_socket(fd, BIO_NOCLOSE);
+    if (socket_bio == NULL)
     {
-        BIO_free(ssl_bio);
+        errno = ENOMEM;
+        return NULL;
     }
-    BIO_free(iostream_bio);
-    errno = errsv;
-    return NULL;
+
+    BIO *ssl_bio = neo4j_openssl_new_bio(socket_bio, hostname, port,
+            config, flags);
+    if (ssl_bio == NULL)
+    {
+        int errsv = errno;
+        BIO_free(socket_bio);
+        errno = errsv;
+        return NULL;
+    }
+
+    SSL *ssl = NULL;
+    BIO_get_ssl(ssl_bio, &ssl);
+    assert(ssl != NULL);
+    bool ktls_send = BIO_get_ktls_send(SSL_get_wbio(ssl));
+    bool ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+
+    neo4j_logger_t *logger = neo4j_get_logger(config, "tls");
+    if (ktls_send && ktls_recv && SSL_pending(ssl) == 0 &&
+            neo4j_posix_iostream_enable_ktls(delegate) == 0)
+    {
+        neo4j_log_debug(logger, "kernel TLS offload enabled for %s:%d",
+                hostname, port);
+        neo4j_logger_release(logger);
+        // the kernel now holds all the state, so OpenSSL is discarded
+        // without it sending a close notify
+        SSL_set_quiet_shutdown(ssl, 1);
+        BIO_free_all(ssl_bio);
+        return delegate;
+    }
+
+    neo4j_log_debug(logger, "kernel TLS offload %s for %s:%d",
+            ktls_send? "enabled for sending only" : "unavailable",
+            hostname, port);
+    neo4j_logger_release(logger);
+
+    struct openssl_iostream *ios = new_openssl_iostream(delegate);
+    if (ios == NULL)
+    {
+        int errsv = errno;
+        BIO_free_all(ssl_bio);
+        errno = errsv;
+        return NULL;
+    }
+    ios->bio = ssl_bio;
+    return &(ios->_waitable._iostream);
 }
+#endif
 
 
 ssize_t openssl_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
 {
     struct openssl_iostream *ios = container_of(self,
-            struct openssl_iostream, _iostream);
+            struct openssl_iostream, _waitable._iostream);
     if (ios->bio == NULL)
     {
         errno = EPIPE;
         return -1;
     }
+    // a read is usually awaiting the response to what was written
+    if (flush_record(ios) || flush_ciphertext(ios))
+    {
+        return -1;
+    }
     // TODO: check if BIO_read sets errno on error
     int len = (nbyte < INT_MAX)? nbyte : INT_MAX;
     return BIO_read(ios->bio, buf, len);
@@ -139,110 +286,257 @@ ssize_t openssl_readv(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt)
 {
     REQUIRE(iovcnt > 0 && iov[0].iov_len > 0, -1);
-    struct openssl_iostream *ios = container_of(self,
-            struct openssl_iostream, _iostream);
-    if (ios->bio == NULL)
-    {
-        errno = EPIPE;
-        return -1;
-    }
-
-    // TODO: check if BIO_read sets errno on error
     // TODO: if iovcnt > 1, this will always be a short read, so instead
     // consider reading entire vector
-    int len = (iov[0].iov_len < INT_MAX)? iov[0].iov_len : INT_MAX;
-    return BIO_read(ios->bio, iov[0].iov_base, len);
+    return openssl_read(self, iov[0].iov_base, iov[0].iov_len);
 }
 
 
 ssize_t openssl_write(neo4j_iostream_t *self, const void *buf, size_t nbyte)
 {
-    struct openssl_iostream *ios = container_of(self,
-            struct openssl_iostream, _iostream);
-    if (ios->bio == NULL)
-    {
-        errno = EPIPE;
-        return -1;
-    }
-    // TODO: check if BIO_write sets errno on error
-    int len = (nbyte < INT_MAX)? nbyte : INT_MAX;
-    return BIO_write(ios->bio, buf, len);
+    struct iovec iov = { .iov_base = (void *)(uintptr_t)buf,
+        .iov_len = nbyte };
+    return openssl_writev(self, &iov, 1);
 }
 
 
 ssize_t openssl_writev(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt)
 {
-    REQUIRE(iovcnt > 0 && iov[0].iov_len > 0, -1);
     struct openssl_iostream *ios = container_of(self,
-            struct openssl_iostream, _iostream);
+            struct openssl_iostream, _waitable._iostream);
     if (ios->bio == NULL)
     {
         errno = EPIPE;
         return -1;
     }
-    // TODO: check if BIO_write sets errno on error
-    // TODO: if iovcnt > 1, this will always be a short write, so instead
-    // consider reading entire vector
-    int len = (iov[0].iov_len < INT_MAX)? iov[0].iov_len : INT_MAX;
-    return BIO_write(ios->bio, iov[0].iov_base, len);
+
+    size_t total = iovlen(iov, iovcnt);
+    if (total > SSIZE_MAX)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    // plaintext is only encrypted in full records, so that small writes
+    // (such as chunk headers) do not each become a record of their own
+    for (unsigned int i = 0; i < iovcnt; ++i)
+    {
+        const uint8_t *base = iov[i].iov_base;
+        size_t remaining = iov[i].iov_len;
+        while (remaining > 0)
+        {
+            if (ios->record_length == 0 && remaining >= TLS_RECORD_SIZE)
+            {
+                // encrypt directly from the callers buffer
+                if (write_record(ios, base, TLS_RECORD_SIZE))
+                {
+                    return -1;
+                }
+                base += TLS_RECORD_SIZE;
+                remaining -= TLS_RECORD_SIZE;
+                continue;
+            }
+
+            size_t n = minzu(TLS_RECORD_SIZE - ios->record_length, remaining);
+            memcpy(ios->record + ios->record_length, base, n);
+            ios->record_length += n;
+            base += n;
+            remaining -= n;
+            if (ios->record_length == TLS_RECORD_SIZE && flush_record(ios))
+            {
+                return -1;
+            }
+        }
+    }
+    return total;
 }
 
 
 int openssl_flush(neo4j_iostream_t *self)
 {
     struct openssl_iostream *ios = container_of(self,
-            struct openssl_iostream, _iostream);
+            struct openssl_iostream, _waitable._iostream);
     if (ios->bio == NULL)
     {
         errno = EPIPE;
         return -1;
     }
+    if (flush_record(ios))
+    {
+        return -1;
+    }
     // TODO: check if BIO_flush sets errno on error
     return (BIO_flush(ios->bio) == 1)? 0 : -1;
 }
 
+
 int openssl_close(neo4j_iostream_t *self)
 {
     struct openssl_iostream *ios = container_of(self,
-            struct openssl_iostream, _iostream);
+            struct openssl_iostream, _waitable._iostream);
     if (ios->bio == NULL)
     {
         errno = EPIPE;
         return -1;
     }
+    // any plaintext not yet flushed is discarded, as for other streams
     BIO_free_all(ios->bio);
     ios->bio = NULL;
     neo4j_ios_close(ios->delegate);
     ios->delegate = NULL;
-    free(ios);
+    free_openssl_iostream(ios);
     return 0;
 }
 
 
+int write_record(struct openssl_iostream *ios, const void *buf, size_t nbyte)
+{
+    assert(nbyte <= TLS_RECORD_SIZE);
+    // the SSL BIO is blocking, so it only returns once all is written
+    errno = 0;
+    int result = BIO_write(ios->bio, buf, (int)nbyte);
+    if (result > 0 && (size_t)result == nbyte)
+    {
+        return 0;
+    }
+    errno = write_errno(ios, result);
+    return -1;
+}
+
+
+int write_errno(struct openssl_iostream *ios, int result)
+{
+    int errsv = errno;
+    SSL *ssl = NULL;
+    BIO_get_ssl(ios->bio, &ssl);
+    int err = (ssl != NULL && result <= 0)?
+        SSL_get_error(ssl, result) : SSL_ERROR_NONE;
+    ERR_clear_error();
+    switch (err)
+    {
+    case SSL_ERROR_SYSCALL:
+        // the delegate iostream failed, and will have set errno
+        return (errsv != 0)? errsv : EPIPE;
+    case SSL_ERROR_ZERO_RETURN:
+        return EPIPE;
+    case SSL_ERROR_SSL:
+        return NEO4J_UNEXPECTED_ERROR;
+    default:
+        return EIO;
+    }
+}
+
+
+int flush_record(struct openssl_iostream *ios)
+{
+    if (ios->record_length == 0)
+    {
+        return 0;
+    }
+    if (write_record(ios, ios->record, ios->record_length))
+    {
+        return -1;
+    }
+    ios->record_length = 0;
+    return 0;
+}
+
+
+int flush_ciphertext(struct openssl_iostream *ios)
+{
+    if (ios->ciphertext_length == 0)
+    {
+        return 0;
+    }
+    assert(ios->delegate != NULL);
+    int result = neo4j_ios_write_all(ios->delegate, ios->ciphertext,
+            ios->ciphertext_length, NULL);
+    ios->ciphertext_length = 0;
+    if (result)
+    {
+        return -1;
+    }
+    return neo4j_ios_flush(ios->delegate);
+}
+
+
+int openssl_wait(neo4j_iostream_t *self, unsigned int timeout)
+{
+    struct openssl_iostream *ios = container_of(self,
+            struct openssl_iostream, _waitable._iostream);
+    if (ios->bio == NULL)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    // decrypted bytes may already be held by the SSL BIO
+    if (BIO_pending(ios->bio) > 0)
+    {
+        return 0;
+    }
+    return neo4j_ios_wait(ios->delegate, timeout);
+}
+
+
 int iostream_bio_write(BIO *bio, const char *buf, int nbyte)
 {
-    neo4j_iostream_t *ios = (neo4j_iostream_t *)bio->ptr;
-    if (ios == NULL)
+    struct openssl_iostream *ios = (struct openssl_iostream *)bio->ptr;
+    if (ios == NULL || ios->delegate == NULL)
     {
         errno = EPIPE;
         return -1;
     }
-    ssize_t result = neo4j_ios_write(ios, buf, nbyte);
-    assert(result < INT_MAX);
-    return result;
+    if (nbyte <= 0)
+    {
+        return 0;
+    }
+
+    // ciphertext is held until the SSL BIO is flushed, so that the records
+    // from a single flush reach the delegate in a single write
+    size_t n = nbyte;
+    if ((ios->ciphertext_length + n) > CIPHERTEXT_BATCH_SIZE &&
+            flush_ciphertext(ios))
+    {
+        return -1;
+    }
+    if (n > CIPHERTEXT_BATCH_SIZE)
+    {
+        if (neo4j_ios_write_all(ios->delegate, buf, n, NULL))
+        {
+            return -1;
+        }
+        return nbyte;
+    }
+
+    if (ios->ciphertext == NULL)
+    {
+        ios->ciphertext = malloc(CIPHERTEXT_BATCH_SIZE);
+        if (ios->ciphertext == NULL)
+        {
+            return -1;
+        }
+    }
+    memcpy(ios->ciphertext + ios->ciphertext_length, buf, n);
+    ios->ciphertext_length += n;
+    return nbyte;
 }
 
 
 int iostream_bio_read(BIO *bio, char *buf, int nbyte)
 {
-    neo4j_iostream_t *ios = (neo4j_iostream_t *)bio->ptr;
-    if (ios == NULL)
+    struct openssl_iostream *ios = (struct openssl_iostream *)bio->ptr;
+    if (ios == NULL || ios->delegate == NULL)
     {
         errno = EPIPE;
         return -1;
     }
-    ssize_t result = neo4j_ios_read(ios, buf, nbyte);
+    // the handshake writes and then reads, without flushing in between
+    if (flush_ciphertext(ios))
+    {
+        return -1;
+    }
+    ssize_t result = neo4j_ios_read(ios->delegate, buf, nbyte);
     assert(result < INT_MAX);
     return result;
 }
@@ -250,15 +544,13 @@ int iostream_bio_read(BIO *bio, char *buf, int nbyte)
 
 int iostream_bio_puts(BIO *bio, const char *s)
 {
-    neo4j_iostream_t *ios = (neo4j_iostream_t *)bio->ptr;
-    if (ios == NULL)
+    size_t n = strlen(s);
+    if (n > INT_MAX)
     {
-        errno = EPIPE;
+        errno = EMSGSIZE;
         return -1;
     }
-    ssize_t result = neo4j_ios_write(ios, s, strlen(s));
-    assert(result < INT_MAX);
-    return result;
+    return iostream_bio_write(bio, s, (int)n);
 }
 
 
@@ -274,7 +566,15 @@ long iostream_bio_ctrl(BIO *bio, int cmd, long num, void *ptr)
     switch (cmd)
     {
     case BIO_CTRL_FLUSH:
-        return 1;
+        {
+            struct openssl_iostream *ios =
+                (struct openssl_iostream *)bio->ptr;
+            if (ios == NULL || ios->delegate == NULL)
+            {
+                return 1;
+            }
+            return (flush_ciphertext(ios) == 0)? 1 : 0;
+        }
     default:
         return 0;
     }
@@ -293,12 +593,17 @@ int iostream_bio_create(BIO *bio)
 
 int iostream_bio_destroy(BIO *bio)
 {
-    neo4j_iostream_t *ios = (neo4j_iostream_t *)bio->ptr;
+    struct openssl_iostream *ios = (struct openssl_iostream *)bio->ptr;
     if (ios == NULL)
     {
         errno = EPIPE;
         return -1;
     }
+    // deliver anything written during SSL shutdown (e.g. close_notify)
+    if (ios->delegate != NULL)
+    {
+        flush_ciphertext(ios);
+    }
     bio->ptr = NULL;
     bio->init = 0;
     bio->flags = 0;
@@ -18,14 +18,42 @@
 #include "posix_iostream.h"
 #include "util.h"
 #include <assert.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <stddef.h>
+#include <sys/socket.h>
 #include <unistd.h>
+#ifdef HAVE_LINUX_TLS_H
+#include <linux/tls.h>
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
+#define TLS_RECORD_TYPE_ALERT 21
+#define TLS_RECORD_TYPE_HANDSHAKE 22
+#define TLS_RECORD_TYPE_APPLICATION_DATA 23
+#define TLS_ALERT_CLOSE_NOTIFY 0
+#define TLS_HANDSHAKE_KEY_UPDATE 24
 
 
 struct posix_iostream {
-    neo4j_iostream_t _iostream;
+    struct neo4j_waitable_iostream _waitable;
     int fd;
+    // timeouts for each read or write, in milliseconds, where a non-zero
+    // timeout requires the file descriptor be non-blocking
+    unsigned int rcv_timeout;
+    unsigned int snd_timeout;
+    // time to spin awaiting input before blocking, in nanoseconds
+    uint64_t read_spin;
+    // re-enable TCP quick acknowledgement after each read
+    bool quickack;
+    // state for parsing TLS control records, which may be received in
+    // parts when reading from a kernel TLS socket
+    struct neo4j_tls_control ctrl;
 };
 
 
@@ -38,11 +66,39 @@ static ssize_t posix_writev(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt);
 static int posix_flush(neo4j_iostream_t *self);
 static int posix_close(neo4j_iostream_t *self);
+static int posix_wait(neo4j_iostream_t *self, unsigned int timeout);
+static bool is_posix_iostream(neo4j_iostream_t *ios);
+#ifdef TLS_GET_RECORD_TYPE
+static ssize_t ktls_read(neo4j_iostream_t *self, void *buf, size_t nbyte);
+static ssize_t ktls_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+#endif
+static void spin_for_input(struct posix_iostream *ios);
+static void rearm_quickack(struct posix_iostream *ios);
+static int await_fd(struct posix_iostream *ios, short events, int timeout);
+static int io_timeout(unsigned int timeout);
 
 
 neo4j_iostream_t *neo4j_posix_iostream(int fd)
+{
+    return neo4j_posix_iostream_with_timeouts(fd, 0, 0);
+}
+
+
+neo4j_iostream_t *neo4j_posix_iostream_with_timeouts(int fd,
+        unsigned int rcv_timeout, unsigned int snd_timeout)
 {
     REQUIRE(fd >= 0, NULL);
+    REQUIRE(rcv_timeout <= INT_MAX && snd_timeout <= INT_MAX, NULL);
+
+    if (rcv_timeout > 0 || snd_timeout > 0)
+    {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        {
+            return NULL;
+        }
+    }
 
     struct posix_iostream *ios = calloc(1, sizeof(struct posix_iostream));
     if (ios == NULL)
@@ -51,28 +107,105 @@ neo4j_iostream_t *neo4j_posix_iostream(int fd)
     }
 
     ios->fd = fd;
+    ios->rcv_timeout = rcv_timeout;
+    ios->snd_timeout = snd_timeout;
 
-    neo4j_iostream_t *iostream = &(ios->_iostream);
+    neo4j_iostream_t *iostream = neo4j_waitable_ios_init(&(ios->_waitable),
+            posix_close, posix_wait);
     iostream->read = posix_read;
     iostream->readv = posix_readv;
     iostream->write = posix_write;
     iostream->writev = posix_writev;
     iostream->flush = posix_flush;
-    iostream->close = posix_close;
     return iostream;
 }
 
 
+bool is_posix_iostream(neo4j_iostream_t *ios)
+{
+    struct neo4j_waitable_iostream *wios = neo4j_waitable_ios(ios);
+    return wios != NULL && wios->close == posix_close;
+}
+
+
+int neo4j_posix_iostream_fd(neo4j_iostream_t *ios)
+{
+    REQUIRE(ios != NULL, -1);
+    if (!is_posix_iostream(ios))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    struct posix_iostream *pios = container_of(ios,
+            struct posix_iostream, _waitable._iostream);
+    return pios->fd;
+}
+
+
+int neo4j_posix_iostream_set_read_spin(neo4j_iostream_t *ios,
+        unsigned int usecs)
+{
+    REQUIRE(ios != NULL, -1);
+    REQUIRE(is_posix_iostream(ios), -1);
+    struct posix_iostream *pios = container_of(ios,
+            struct posix_iostream, _waitable._iostream);
+    pios->read_spin = (uint64_t)usecs * 1000;
+    return 0;
+}
+
+
+int neo4j_posix_iostream_set_quickack(neo4j_iostream_t *ios, bool enable)
+{
+    REQUIRE(ios != NULL, -1);
+    REQUIRE(is_posix_iostream(ios), -1);
+#ifdef TCP_QUICKACK
+    struct posix_iostream *pios = container_of(ios,
+            struct posix_iostream, _waitable._iostream);
+    pios->quickack = enable;
+    return 0;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+
+int neo4j_posix_iostream_enable_ktls(neo4j_iostream_t *ios)
+{
+    REQUIRE(ios != NULL, -1);
+    REQUIRE(is_posix_iostream(ios), -1);
+#ifdef TLS_GET_RECORD_TYPE
+    ios->read = ktls_read;
+    ios->readv = ktls_readv;
+    return 0;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+
 ssize_t posix_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
 {
     struct posix_iostream *ios = container_of(self,
-            struct posix_iostream, _iostream);
+            struct posix_iostream, _waitable._iostream);
     if (ios->fd < 0)
     {
         errno = EPIPE;
         return -1;
     }
-    return read(ios->fd, buf, nbyte);
+    spin_for_input(ios);
+    ssize_t result;
+    while ((result = read(ios->fd, buf, nbyte)) < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        if (await_fd(ios, POLLIN, io_timeout(ios->rcv_timeout)))
+        {
+            return -1;
+        }
+    }
+    rearm_quickack(ios);
+    return result;
 }
 
 
@@ -80,7 +213,7 @@ ssize_t posix_readv(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt)
 {
     struct posix_iostream *ios = container_of(self,
-            struct posix_iostream, _iostream);
+            struct posix_iostream, _waitable._iostream);
     if (ios->fd < 0)
     {
         errno = EPIPE;
@@ -90,20 +223,40 @@ ssize_t posix_readv(neo4j_iostream_t *self,
     {
         iovcnt = INT_MAX;
     }
-    return readv(ios->fd, iov, iovcnt);
+    spin_for_input(ios);
+    ssize_t result;
+    while ((result = readv(ios->fd, iov, iovcnt)) < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        if (await_fd(ios, POLLIN, io_timeout(ios->rcv_timeout)))
+        {
+            return -1;
+        }
+    }
+    rearm_quickack(ios);
+    return result;
 }
 
 
 ssize_t posix_write(neo4j_iostream_t *self, const void *buf, size_t nbyte)
 {
     struct posix_iostream *ios = container_of(self,
-            struct posix_iostream, _iostream);
+            struct posix_iostream, _waitable._iostream);
     if (ios->fd < 0)
     {
         errno = EPIPE;
         return -1;
     }
-    return write(ios->fd, buf, nbyte);
+    ssize_t result;
+    while ((result = write(ios->fd, buf, nbyte)) < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        if (await_fd(ios, POLLOUT, io_timeout(ios->snd_timeout)))
+        {
+            return -1;
+        }
+    }
+    return result;
 }
 
 
@@ -111,7 +264,42 @@ ssize_t posix_writev(neo4j_iostream_t *self,
         const struct iovec *iov, unsigned int iovcnt)
 {
     struct posix_iostream *ios = container_of(self,
-            struct posix_iostream, _iostream);
+            struct posix_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    if (iovcnt > INT_MAX)
+    {
+        iovcnt = INT_MAX;
+    }
+    ssize_t result;
+    while ((result = writev(ios->fd, iov, iovcnt)) < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        if (await_fd(ios, POLLOUT, io_timeout(ios->snd_timeout)))
+        {
+            return -1;
+        }
+    }
+    return result;
+}
+
+
+#ifdef TLS_GET_RECORD_TYPE
+ssize_t ktls_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
+{
+    struct iovec iov = { .iov_base = buf, .iov_len = nbyte };
+    return ktls_readv(self, &iov, 1);
+}
+
+
+ssize_t ktls_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    struct posix_iostream *ios = container_of(self,
+            struct posix_iostream, _waitable._iostream);
     if (ios->fd < 0)
     {
         errno = EPIPE;
@@ -121,7 +309,126 @@ ssize_t posix_writev(neo4j_iostream_t *self,
     {
         iovcnt = INT_MAX;
     }
-    return writev(ios->fd, iov, iovcnt);
+
+    for (;;)
+    {
+        spin_for_input(ios);
+        uint8_t cbuf[CMSG_SPACE(sizeof(uint8_t))];
+        struct msghdr msg = {
+            .msg_iov = (struct iovec *)(uintptr_t)iov,
+            .msg_iovlen = iovcnt,
+            .msg_control = cbuf,
+            .msg_controllen = sizeof(cbuf)
+        };
+
+        ssize_t result = recvmsg(ios->fd, &msg, 0);
+        if (result < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return -1;
+            }
+            if (await_fd(ios, POLLIN, io_timeout(ios->rcv_timeout)))
+            {
+                return -1;
+            }
+            continue;
+        }
+        rearm_quickack(ios);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (result == 0 || cmsg == NULL || cmsg->cmsg_level != SOL_TLS ||
+                cmsg->cmsg_type != TLS_GET_RECORD_TYPE)
+        {
+            return result;
+        }
+
+        uint8_t type = *CMSG_DATA(cmsg);
+        if (type == TLS_RECORD_TYPE_APPLICATION_DATA)
+        {
+            return result;
+        }
+        // the control record content has been read into the caller's
+        // buffers, and is consumed from there before reading again
+        int status = neo4j_tls_control_record(&(ios->ctrl), type,
+                iov, result);
+        if (status <= 0)
+        {
+            return status;
+        }
+    }
+}
+#endif
+
+
+int neo4j_tls_control_record(struct neo4j_tls_control *ctrl, uint8_t type,
+        const struct iovec *iov, size_t n)
+{
+    REQUIRE(ctrl != NULL, -1);
+    REQUIRE(n == 0 || iov != NULL, -1);
+
+    if (type != ctrl->type)
+    {
+        ctrl->type = type;
+        ctrl->header_length = 0;
+        ctrl->skip = 0;
+    }
+
+    for (; n > 0; ++iov)
+    {
+        const uint8_t *p = iov->iov_base;
+        size_t len = minzu(iov->iov_len, n);
+        n -= len;
+        while (len > 0)
+        {
+            if (ctrl->skip > 0)
+            {
+                size_t d = minzu(ctrl->skip, len);
+                ctrl->skip -= d;
+                p += d;
+                len -= d;
+                continue;
+            }
+            ctrl->header[(ctrl->header_length)++] = *(p++);
+            --len;
+
+            switch (type)
+            {
+            case TLS_RECORD_TYPE_ALERT:
+                if (ctrl->header_length < 2)
+                {
+                    break;
+                }
+                if (ctrl->header[1] == TLS_ALERT_CLOSE_NOTIFY)
+                {
+                    return 0;
+                }
+                errno = ECONNRESET;
+                return -1;
+            case TLS_RECORD_TYPE_HANDSHAKE:
+                if (ctrl->header_length < 4)
+                {
+                    break;
+                }
+                // new keys can't be handed to the kernel after the fact
+                if (ctrl->header[0] == TLS_HANDSHAKE_KEY_UPDATE)
+                {
+                    errno = EPROTO;
+                    return -1;
+                }
+                // session tickets are of no use once the TLS library is no
+                // longer involved, so the message body is skipped
+                ctrl->skip = ((size_t)ctrl->header[1] << 16) |
+                    ((size_t)ctrl->header[2] << 8) | ctrl->header[3];
+                ctrl->header_length = 0;
+                break;
+            default:
+                errno = EPROTO;
+                return -1;
+            }
+        }
+    }
+    return 1;
 }
 
 
@@ -134,7 +441,7 @@ int posix_flush(neo4j_iostream_t *self)
 int posix_close(neo4j_iostream_t *self)
 {
     struct posix_iostream *ios = container_of(self,
-            struct posix_iostream, _iostream);
+            struct posix_iostream, _waitable._iostream);
     if (ios->fd < 0)
     {
         errno = EPIPE;
@@ -145,3 +452,84 @@ int posix_close(neo4j_iostream_t *self)
     free(ios);
     return close(fd);
 }
+
+
+int posix_wait(neo4j_iostream_t *self, unsigned int timeout)
+{
+    struct posix_iostream *ios = container_of(self,
+            struct posix_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+
+    return await_fd(ios, POLLIN, (timeout > INT_MAX)? INT_MAX : (int)timeout);
+}
+
+
+int io_timeout(unsigned int timeout)
+{
+    // without a timeout, the descriptor is only non-blocking due to a timeout
+    // in the other direction, so the wait is unbounded
+    return (timeout > 0)? (int)timeout : -1;
+}
+
+
+void spin_for_input(struct posix_iostream *ios)
+{
+    if (ios->read_spin == 0)
+    {
+        return;
+    }
+    // poll without blocking until input arrives or the spin time is up,
+    // after which the read proceeds (and blocks) as usual
+    struct pollfd pfd = { .fd = ios->fd, .events = POLLIN };
+    uint64_t deadline = monotonic_ns() + ios->read_spin;
+    do
+    {
+        if (poll(&pfd, 1, 0) != 0)
+        {
+            return;
+        }
+    } while (monotonic_ns() < deadline);
+}
+
+
+void rearm_quickack(struct posix_iostream *ios)
+{
+#ifdef TCP_QUICKACK
+    if (!ios->quickack)
+    {
+        return;
+    }
+    // linux clears quick acknowledgement whenever it sees fit, so it is
+    // set again after each read (failure is of no consequence)
+    int option = 1;
+    int errsv = errno;
+    setsockopt(ios->fd, IPPROTO_TCP, TCP_QUICKACK, &option, sizeof(int));
+    errno = errsv;
+#endif
+}
+
+
+int await_fd(struct posix_iostream *ios, short events, int timeout)
+{
+    struct pollfd pfd = { .fd = ios->fd, .events = events };
+    int result;
+    do
+    {
+        result = poll(&pfd, 1, timeout);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0)
+    {
+        return -1;
+    }
+    if (result == 0)
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}
@@ -31,4 +31,113 @@
 __neo4j_must_check
 neo4j_iostream_t *neo4j_posix_iostream(int fd);
 
+/**
+ * Create an iostream for a POSIX file descriptor, with I/O timeouts.
+ *
+ * @internal
+ *
+ * If either timeout is non-zero, the file descriptor is made non-blocking
+ * and each read or write waits for the descriptor using `poll(2)`. Should
+ * a read or write not progress before the timeout expires, it will fail
+ * with errno set to `ETIMEDOUT`.
+ *
+ * @param [fd] The file descriptor to create an iostream for.
+ * @param [rcv_timeout] The timeout for each read, in milliseconds, or 0 for
+ *         no timeout.
+ * @param [snd_timeout] The timeout for each write, in milliseconds, or 0 for
+ *         no timeout.
+ * @return The newly created iostream.
+ */
+__neo4j_must_check
+neo4j_iostream_t *neo4j_posix_iostream_with_timeouts(int fd,
+        unsigned int rcv_timeout, unsigned int snd_timeout);
+
+/**
+ * Get the file descriptor of a POSIX iostream.
+ *
+ * @internal
+ *
+ * @param [ios] The iostream.
+ * @return The file descriptor, or -1 if the iostream is not a POSIX iostream
+ *         (errno will be set).
+ */
+int neo4j_posix_iostream_fd(neo4j_iostream_t *ios);
+
+/**
+ * Set the time a POSIX iostream spins awaiting input before blocking.
+ *
+ * @internal
+ *
+ * @param [ios] The POSIX iostream.
+ * @param [usecs] The time to spin, in microseconds, or 0 to disable.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+int neo4j_posix_iostream_set_read_spin(neo4j_iostream_t *ios,
+        unsigned int usecs);
+
+/**
+ * Enable or disable re-arming of TCP quick acknowledgement after each read.
+ *
+ * @internal
+ *
+ * @param [ios] The POSIX iostream, which should be for a TCP socket.
+ * @param [enable] `true` to enable quick acknowledgement.
+ * @return 0 on success, or -1 on failure (errno will be set, and is
+ *         `ENOTSUP` if the platform does not support quick acknowledgement).
+ */
+int neo4j_posix_iostream_set_quickack(neo4j_iostream_t *ios, bool enable);
+
+/**
+ * Switch a POSIX iostream to reading from a kernel TLS socket.
+ *
+ * @internal
+ *
+ * Once the kernel holds the TLS keys for a socket, reads must check the
+ * type of each record received, as the kernel does not process TLS alerts
+ * or handshake messages itself. A close notify alert is reported as
+ * end-of-stream, and other alerts as `ECONNRESET`. Session tickets are
+ * discarded. Writes are unaffected, as the kernel frames them as
+ * application data.
+ *
+ * @param [ios] The POSIX iostream.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_posix_iostream_enable_ktls(neo4j_iostream_t *ios);
+
+/**
+ * State for parsing the TLS control records read from a kernel TLS socket.
+ *
+ * @internal
+ *
+ * Should be zero initialized.
+ */
+struct neo4j_tls_control
+{
+    uint8_t type;
+    uint8_t header[4];
+    unsigned int header_length;
+    size_t skip;
+};
+
+/**
+ * Process (part of) a TLS control record.
+ *
+ * @internal
+ *
+ * Control records may be read in parts, over several reads, so the state of
+ * the record being parsed is held in `ctrl` between calls.
+ *
+ * @param [ctrl] The control record parsing state.
+ * @param [type] The TLS record type.
+ * @param [iov] The content of the record that has been read.
+ * @param [n] The number of bytes read into `iov`.
+ * @return 0 on close notify, 1 if reading should continue, or -1 on
+ *         failure (errno will be set, and is `ECONNRESET` for an alert or
+ *         `EPROTO` for a message that cannot be handled).
+ */
+__neo4j_must_check
+int neo4j_tls_control_record(struct neo4j_tls_control *ctrl, uint8_t type,
+        const struct iovec *iov, size_t n);
+
 #endif/*NEO4J_POSIX_IOSTREAM_H*/
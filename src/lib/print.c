@@ -356,6 +356,113 @@ ssize_t neo4j_list_fprint(const neo4j_value_t *value, FILE *stream)
 }
 
 
+size_t neo4j_array_str(const neo4j_value_t *value, char *buf, size_t n)
+{
+    REQUIRE(value != NULL, -1);
+    REQUIRE(n == 0 || buf != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST);
+    unsigned int length = neo4j_list_length(*value);
+
+    if (n > 0)
+    {
+        buf[0] = '[';
+    }
+    size_t l = 1;
+
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        l += neo4j_ntostring(neo4j_list_get(*value, i),
+                buf+l, (l < n)? n-l : 0);
+
+        if ((i+1) < length)
+        {
+            if ((l+1) < n)
+            {
+                buf[l] = ',';
+            }
+            l++;
+        }
+    }
+
+    if ((l+1) < n)
+    {
+        buf[l] = ']';
+    }
+    l++;
+    if (n > 0)
+    {
+        buf[minzu(n - 1, l)] = '\0';
+    }
+    return l;
+}
+
+
+ssize_t neo4j_array_fprint(const neo4j_value_t *value, FILE *stream)
+{
+    REQUIRE(value != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST);
+    unsigned int length = neo4j_list_length(*value);
+
+    if (fputc('[', stream) == EOF)
+    {
+        return -1;
+    }
+    size_t l = 1;
+
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        ssize_t ll = neo4j_fprint(neo4j_list_get(*value, i), stream);
+        if (ll < 0)
+        {
+            return -1;
+        }
+        l += (size_t)ll;
+
+        if ((i+1) < length)
+        {
+            if (fputc(',', stream) == EOF)
+            {
+                return -1;
+            }
+            l++;
+        }
+    }
+
+    if (fputc(']', stream) == EOF)
+    {
+        return -1;
+    }
+    return ++l;
+}
+
+
+size_t neo4j_streamed_str(const neo4j_value_t *value, char *buf, size_t n)
+{
+    REQUIRE(value != NULL, -1);
+    REQUIRE(n == 0 || buf != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST ||
+            neo4j_type(*value) == NEO4J_MAP);
+    const char *s = (neo4j_type(*value) == NEO4J_LIST)? "[...]" : "{...}";
+    if (n > 0)
+    {
+        size_t len = minzu(n - 1, 5);
+        memcpy(buf, s, len);
+        buf[len] = '\0';
+    }
+    return 5;
+}
+
+
+ssize_t neo4j_streamed_fprint(const neo4j_value_t *value, FILE *stream)
+{
+    REQUIRE(value != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST ||
+            neo4j_type(*value) == NEO4J_MAP);
+    const char *s = (neo4j_type(*value) == NEO4J_LIST)? "[...]" : "{...}";
+    return (fputs(s, stream) == EOF)? -1 : 5;
+}
+
+
 size_t list_str(char *buf, size_t n, const neo4j_value_t *values,
         unsigned int nvalues)
 {
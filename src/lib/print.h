@@ -37,6 +37,11 @@ ssize_t neo4j_string_fprint(const neo4j_value_t *value, FILE *stream);
 size_t neo4j_list_str(const neo4j_value_t *value, char *buf, size_t n);
 ssize_t neo4j_list_fprint(const neo4j_value_t *value, FILE *stream);
 
+size_t neo4j_array_str(const neo4j_value_t *value, char *buf, size_t n);
+ssize_t neo4j_array_fprint(const neo4j_value_t *value, FILE *stream);
+size_t neo4j_streamed_str(const neo4j_value_t *value, char *buf, size_t n);
+ssize_t neo4j_streamed_fprint(const neo4j_value_t *value, FILE *stream);
+
 size_t neo4j_map_str(const neo4j_value_t *value, char *buf, size_t n);
 ssize_t neo4j_map_fprint(const neo4j_value_t *value, FILE *stream);
 
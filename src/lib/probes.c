@@ -0,0 +1,36 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../config.h"
+#include "probes.h"
+
+/*
+ * Probe semaphores. A tracer increments a probe's semaphore while attached,
+ * so that NEO4J_PROBE_ENABLED() can skip computing arguments otherwise.
+ */
+#define NEO4J_PROBE_SEMAPHORE(name) \
+    volatile unsigned short neo4j_##name##_semaphore \
+        __attribute__((unused, section(".probes")))
+
+NEO4J_PROBE_SEMAPHORE(message_send);
+NEO4J_PROBE_SEMAPHORE(message_recv);
+NEO4J_PROBE_SEMAPHORE(append_result);
+NEO4J_PROBE_SEMAPHORE(session_sync_start);
+NEO4J_PROBE_SEMAPHORE(session_sync_done);
+NEO4J_PROBE_SEMAPHORE(mpool_add);
+NEO4J_PROBE_SEMAPHORE(mpool_drainto);
+NEO4J_PROBE_SEMAPHORE(tls_handshake_start);
+NEO4J_PROBE_SEMAPHORE(tls_handshake_done);
@@ -0,0 +1,82 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NEO4J_PROBES_H
+#define NEO4J_PROBES_H
+
+/*
+ * Static tracing probes, for use with dtrace, bpftrace, perf or systemtap.
+ * When sys/sdt.h is available, each probe compiles to a single nop, but its
+ * arguments are always evaluated (they must be in registers or memory for
+ * the tracer to read). Probes whose arguments need computing should be
+ * guarded with `NEO4J_PROBE_ENABLED(name)`, which tests the probe's
+ * semaphore and is only true while a tracer is attached. Without sys/sdt.h,
+ * probes compile to nothing and `NEO4J_PROBE_ENABLED` is always false.
+ *
+ * Probes are in the `neo4j` provider:
+ *
+ * message_send(connection, type, nbytes, nchunks)
+ * message_recv(connection, type, nbytes, nchunks)
+ *     A message has been sent or received on a connection. The type is a
+ *     string, and nbytes includes chunk headers.
+ * append_result(session, results, nfields)
+ *     A record has been received for a result stream.
+ * session_sync_start(session, depth, inflight)
+ * session_sync_done(session, result)
+ *     A session has started and finished synchronizing.
+ * mpool_add(pool, depth)
+ * mpool_drainto(pool, depth, target)
+ *     Memory has been added to, or is being drained from, a memory pool.
+ * tls_handshake_start(bio, hostname, port)
+ * tls_handshake_done(bio, result)
+ *     A TLS handshake has started and finished.
+ */
+
+/* semaphores are defined in probes.c */
+extern volatile unsigned short neo4j_message_send_semaphore;
+extern volatile unsigned short neo4j_message_recv_semaphore;
+extern volatile unsigned short neo4j_append_result_semaphore;
+extern volatile unsigned short neo4j_session_sync_start_semaphore;
+extern volatile unsigned short neo4j_session_sync_done_semaphore;
+extern volatile unsigned short neo4j_mpool_add_semaphore;
+extern volatile unsigned short neo4j_mpool_drainto_semaphore;
+extern volatile unsigned short neo4j_tls_handshake_start_semaphore;
+extern volatile unsigned short neo4j_tls_handshake_done_semaphore;
+
+#ifdef HAVE_SYS_SDT_H
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define NEO4J_PROBE_ENABLED(name) \
+    __builtin_expect(neo4j_##name##_semaphore != 0, 0)
+
+#define NEO4J_PROBE2(name, a1, a2) \
+    DTRACE_PROBE2(neo4j, name, a1, a2)
+#define NEO4J_PROBE3(name, a1, a2, a3) \
+    DTRACE_PROBE3(neo4j, name, a1, a2, a3)
+#define NEO4J_PROBE4(name, a1, a2, a3, a4) \
+    DTRACE_PROBE4(neo4j, name, a1, a2, a3, a4)
+
+#else
+
+#define NEO4J_PROBE_ENABLED(name) 0
+#define NEO4J_PROBE2(name, a1, a2) do {} while (0)
+#define NEO4J_PROBE3(name, a1, a2, a3) do {} while (0)
+#define NEO4J_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+
+#endif
+
+#endif/*NEO4J_PROBES_H*/
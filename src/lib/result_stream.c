@@ -19,6 +19,7 @@
 #include "client_config.h"
 #include "job.h"
 #include "metadata.h"
+#include "probes.h"
 #include "session.h"
 #include "util.h"
 #include <assert.h>
@@ -102,6 +103,19 @@ int neo4j_close_results(neo4j_result_stream_t *results)
 }
 
 
+int neo4j_set_results_timeout(neo4j_result_stream_t *results,
+        unsigned int timeout)
+{
+    REQUIRE(results != NULL, -1);
+    if (results->set_timeout == NULL)
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return results->set_timeout(results, timeout);
+}
+
+
 neo4j_value_t neo4j_result_field(const neo4j_result_t *result,
         unsigned int index)
 {
@@ -127,6 +141,11 @@ void neo4j_release(neo4j_result_t *result)
 
 typedef struct run_result_stream run_result_stream_t;
 
+// items of the statement metadata, which are parsed on demand
+#define METADATA_STATEMENT_TYPE 0x01
+#define METADATA_STATEMENT_PLAN 0x02
+#define METADATA_UPDATE_COUNTS 0x04
+
 typedef struct result_record result_record_t;
 struct result_record
 {
@@ -147,11 +166,16 @@ struct run_result_stream
     neo4j_job_t job;
     neo4j_logger_t *logger;
     neo4j_memory_allocator_t *allocator;
+    unsigned int mpool_block_size;
     neo4j_mpool_t mpool;
     neo4j_mpool_t record_mpool;
     unsigned int refcount;
     unsigned int starting;
     unsigned int streaming;
+    uint64_t deadline;
+    neo4j_value_t metadata;
+    const char *metadata_source;
+    uint8_t parsed_metadata;
     int statement_type;
     struct neo4j_statement_plan *statement_plan;
     struct neo4j_update_counts update_counts;
@@ -181,6 +205,8 @@ static struct neo4j_statement_plan *run_rs_statement_plan(
 static struct neo4j_update_counts run_rs_update_counts(
         neo4j_result_stream_t *self);
 static int run_rs_close(neo4j_result_stream_t *self);
+static int run_rs_set_timeout(neo4j_result_stream_t *self,
+        unsigned int timeout);
 
 static neo4j_value_t run_result_field(const neo4j_result_t *self,
         unsigned int index);
@@ -196,6 +222,7 @@ static int discard_all_callback(void *cdata, neo4j_message_type_t type,
         const neo4j_value_t *argv, uint16_t argc);
 static int stream_end(run_result_stream_t *results, neo4j_message_type_t type,
         const char *src_message_type, const neo4j_value_t *argv, uint16_t argc);
+static int parse_metadata(run_result_stream_t *results, uint8_t items);
 static int await(run_result_stream_t *results, const unsigned int *condition);
 static int append_result(run_result_stream_t *results,
         const neo4j_value_t *argv, uint16_t argc);
@@ -218,6 +245,15 @@ neo4j_result_stream_t *neo4j_run(neo4j_session_t *session,
         return NULL;
     }
 
+    // queue the RUN and the request that follows it together, so that
+    // neither is queued without the other
+    if (neo4j_session_reserve(session, 2, results->deadline))
+    {
+        neo4j_log_debug_errno(results->logger,
+                "neo4j_session_reserve failed");
+        goto failure;
+    }
+
     if (neo4j_session_run(session, &(results->mpool), statement, params,
             run_callback, results))
     {
@@ -260,6 +296,15 @@ neo4j_result_stream_t *neo4j_send(neo4j_session_t *session,
         return NULL;
     }
 
+    // queue the RUN and the request that follows it together, so that
+    // neither is queued without the other
+    if (neo4j_session_reserve(session, 2, results->deadline))
+    {
+        neo4j_log_debug_errno(results->logger,
+                "neo4j_session_reserve failed");
+        goto failure;
+    }
+
     if (neo4j_session_run(session, &(results->mpool), statement, params,
             run_callback, results))
     {
@@ -298,10 +343,17 @@ run_result_stream_t *run_rs_open(neo4j_session_t *session)
     results->session = session;
     results->logger = neo4j_get_logger(session->config, "results");
     results->allocator = session->config->allocator;
+    results->mpool_block_size = session->config->mpool_block_size;
     results->mpool = neo4j_std_mpool(session->config);
     results->record_mpool = neo4j_std_mpool(session->config);
+    results->metadata = neo4j_null;
     results->statement_type = -1;
     results->refcount = 1;
+    if (session->statement_timeout > 0)
+    {
+        run_rs_set_timeout(&(results->_result_stream),
+                session->statement_timeout);
+    }
 
     results->job.notify_session_ending = notify_session_ending;
     if (neo4j_attach_job(session, &(results->job)))
@@ -322,6 +374,7 @@ run_result_stream_t *run_rs_open(neo4j_session_t *session)
     result_stream->statement_plan = run_rs_statement_plan;
     result_stream->update_counts = run_rs_update_counts;
     result_stream->close = run_rs_close;
+    result_stream->set_timeout = run_rs_set_timeout;
     return results;
 
     int errsv;
@@ -458,7 +511,8 @@ int run_rs_statement_type(neo4j_result_stream_t *self)
     run_result_stream_t *results = container_of(self,
             run_result_stream_t, _result_stream);
     if (results == NULL || results->failure != 0 ||
-            await(results, &(results->streaming)))
+            await(results, &(results->streaming)) ||
+            parse_metadata(results, METADATA_STATEMENT_TYPE))
     {
         assert(results->failure != 0);
         errno = results->failure;
@@ -474,7 +528,8 @@ struct neo4j_statement_plan *run_rs_statement_plan(neo4j_result_stream_t *self)
     run_result_stream_t *results = container_of(self,
             run_result_stream_t, _result_stream);
     if (results == NULL || results->failure != 0 ||
-            await(results, &(results->streaming)))
+            await(results, &(results->streaming)) ||
+            parse_metadata(results, METADATA_STATEMENT_PLAN))
     {
         assert(results->failure != 0);
         errno = results->failure;
@@ -496,7 +551,8 @@ struct neo4j_update_counts run_rs_update_counts(neo4j_result_stream_t *self)
             run_result_stream_t, _result_stream);
 
     if (results == NULL || results->failure != 0 ||
-            await(results, &(results->streaming)))
+            await(results, &(results->streaming)) ||
+            parse_metadata(results, METADATA_UPDATE_COUNTS))
     {
         assert(results->failure != 0);
         errno = results->failure;
@@ -522,6 +578,14 @@ int run_rs_close(neo4j_result_stream_t *self)
     assert(results->refcount > 0);
     --(results->refcount);
     int err = await(results, &(results->refcount));
+    if (results->refcount > 0)
+    {
+        // the deadline expired and the statement was cancelled, so await
+        // the remaining responses from the server
+        assert(results->failure == NEO4J_STATEMENT_TIMEOUT);
+        results->deadline = 0;
+        await(results, &(results->refcount));
+    }
     // even if await fails, queued messages should still be drained
     assert(results->refcount == 0);
 
@@ -554,6 +618,17 @@ int run_rs_close(neo4j_result_stream_t *self)
 }
 
 
+int run_rs_set_timeout(neo4j_result_stream_t *self, unsigned int timeout)
+{
+    run_result_stream_t *results = container_of(self,
+            run_result_stream_t, _result_stream);
+    REQUIRE(results != NULL, -1);
+    results->deadline = (timeout > 0)?
+        monotonic_ns() + (uint64_t)timeout * 1000000 : 0;
+    return 0;
+}
+
+
 neo4j_value_t run_result_field(const neo4j_result_t *self,
         unsigned int index)
 {
@@ -720,6 +795,7 @@ int stream_end(run_result_stream_t *results, neo4j_message_type_t type,
     {
         return 0;
     }
+    neo4j_session_trace_response(session, NEO4J_TRACE_RESULTS_COMPLETED);
 
     if (type == NEO4J_IGNORED_MESSAGE)
     {
@@ -735,7 +811,11 @@ int stream_end(run_result_stream_t *results, neo4j_message_type_t type,
         return 0;
     }
 
-    assert(results->failure == 0);
+    if (results->failure != 0)
+    {
+        // the stream was cancelled, so any late response is discarded
+        return 0;
+    }
 
     if (type == NEO4J_FAILURE_MESSAGE)
     {
@@ -751,53 +831,96 @@ int stream_end(run_result_stream_t *results, neo4j_message_type_t type,
         return -1;
     }
 
-    char description[128];
-    snprintf(description, sizeof(description), "SUCCESS in %p (response to %s)",
-            (void *)session, src_message_type);
-
-    const neo4j_value_t *metadata = neo4j_validate_metadata(argv, argc,
-            description, logger);
-    if (metadata == NULL)
+    // the metadata is retained (in the result stream mpool) and only parsed
+    // on demand, so a description is only needed when logging
+    bool trace = neo4j_log_is_enabled(logger, NEO4J_LOG_TRACE);
+    if (trace || argc != 1 || neo4j_type(argv[0]) != NEO4J_MAP)
     {
-        set_failure(results, errno);
-        return -1;
+        char description[128];
+        snprintf(description, sizeof(description),
+                "SUCCESS in %p (response to %s)",
+                (void *)session, src_message_type);
+
+        const neo4j_value_t *metadata = neo4j_validate_metadata(argv, argc,
+                description, logger);
+        if (metadata == NULL)
+        {
+            set_failure(results, errno);
+            return -1;
+        }
+
+        if (trace)
+        {
+            neo4j_metadata_log(logger, NEO4J_LOG_TRACE, description,
+                    *metadata);
+        }
     }
 
-    if (neo4j_log_is_enabled(logger, NEO4J_LOG_TRACE))
+    results->metadata = argv[0];
+    results->metadata_source = src_message_type;
+    return 0;
+}
+
+
+int parse_metadata(run_result_stream_t *results, uint8_t items)
+{
+    items &= ~(results->parsed_metadata);
+    if (items == 0 || neo4j_is_null(results->metadata))
     {
-        neo4j_metadata_log(logger, NEO4J_LOG_TRACE, description, *metadata);
+        return 0;
     }
 
-    results->statement_type =
-        neo4j_meta_statement_type(*metadata, description, logger);
-    if (results->statement_type < 0)
+    // parsing doesn't depend on the session, which may since have ended
+    neo4j_logger_t *logger = results->logger;
+    char description[128];
+    snprintf(description, sizeof(description),
+            "SUCCESS for %p (response to %s)", (void *)results,
+            results->metadata_source);
+
+    if (items & METADATA_STATEMENT_TYPE)
     {
-        set_failure(results, errno);
-        return -1;
+        results->statement_type =
+            neo4j_meta_statement_type(results->metadata, description, logger);
+        if (results->statement_type < 0)
+        {
+            goto failure;
+        }
     }
 
-    results->statement_plan = neo4j_meta_plan(*metadata, description,
-            session->config, logger);
-    if (results->statement_plan == NULL && errno != NEO4J_NO_PLAN_AVAILABLE)
+    if (items & METADATA_STATEMENT_PLAN)
     {
-        set_failure(results, errno);
-        return -1;
+        results->statement_plan = neo4j_meta_plan(results->metadata,
+                description, results->allocator, results->mpool_block_size,
+                logger);
+        if (results->statement_plan == NULL &&
+                errno != NEO4J_NO_PLAN_AVAILABLE)
+        {
+            goto failure;
+        }
     }
 
-    if (neo4j_meta_update_counts(&(results->update_counts), *metadata,
-                description, logger))
+    if (items & METADATA_UPDATE_COUNTS)
     {
-        set_failure(results, errno);
-        return -1;
+        if (neo4j_meta_update_counts(&(results->update_counts),
+                    results->metadata, description, logger))
+        {
+            goto failure;
+        }
     }
 
+    results->parsed_metadata |= items;
     return 0;
+
+failure:
+    set_failure(results, errno);
+    return -1;
 }
 
 
 int await(run_result_stream_t *results, const unsigned int *condition)
 {
-    if (*condition > 0 && neo4j_session_sync(results->session, condition))
+    if (*condition > 0 && neo4j_session_sync_until(results->session,
+                condition, results->deadline))
     {
         neo4j_log_trace_errno(results->logger, "neo4j_session_sync failed");
         set_failure(results, errno);
@@ -835,6 +958,16 @@ int append_result(run_result_stream_t *results,
         return -1;
     }
 
+    if (NEO4J_PROBE_ENABLED(append_result))
+    {
+        NEO4J_PROBE3(append_result, session, results,
+                neo4j_list_length(argv[0]));
+    }
+    if (session != NULL)
+    {
+        neo4j_session_trace_response(session, NEO4J_TRACE_RECORD_RECEIVED);
+    }
+
     if (!results->streaming)
     {
         // discard memory for the record
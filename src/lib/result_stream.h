@@ -148,6 +148,16 @@ struct neo4j_result_stream
      * @return 0 on success, or -1 on failure (errno will be set).
      */
     int (*close)(neo4j_result_stream_t *self);
+
+    /**
+     * Set a timeout for the result stream.
+     *
+     * @param [self] This result stream.
+     * @param [timeout] The timeout, in milliseconds, or 0 to wait
+     *         indefinitely.
+     * @return 0 on success, or -1 on failure (errno will be set).
+     */
+    int (*set_timeout)(neo4j_result_stream_t *self, unsigned int timeout);
 };
 
 
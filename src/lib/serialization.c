@@ -50,13 +50,43 @@ struct length_header
     {
         int8_t l8;
         int16_t l16;
-        int16_t l32;
+        int32_t l32;
     } length;
 };
 
 
 static int build_header(struct iovec *iov, struct length_header *header,
         size_t length, struct markers *markers);
+static size_t pack_int(uint8_t *buf, int64_t value);
+static size_t pack_float(uint8_t *buf, double value);
+
+#define WRITER_MAX_DEPTH 32
+
+struct writer_frame
+{
+    uint32_t remaining;
+    bool map;
+    bool expect_key;
+};
+
+struct neo4j_value_writer
+{
+    neo4j_iostream_t *stream;
+    neo4j_type_t type;
+    bool failed;
+    bool done;
+    unsigned int depth;
+    struct writer_frame frames[WRITER_MAX_DEPTH];
+};
+
+static int writer_check_value(neo4j_value_writer_t *writer);
+static void writer_value_written(neo4j_value_writer_t *writer);
+static int writer_begin(neo4j_value_writer_t *writer, unsigned int n,
+        bool map);
+
+/* maximum encoded size of an int or float */
+#define PACKED_NUMBER_MAX 9
+#define ARRAY_SERIALIZE_BUFFER_SIZE 1024
 
 
 /* null */
@@ -95,53 +125,9 @@ int neo4j_int_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream)
             neo4j_type(*value) == NEO4J_IDENTITY);
     const struct neo4j_int *v = (const struct neo4j_int *)value;
 
-    uint8_t marker;
-    union
-    {
-        int8_t v8;
-        int16_t v16;
-        int32_t v32;
-        int64_t v64;
-    } data;
-    int datalen;
-
-    if (v->value >= -(1<<4) && v->value < (1<<7))
-    {
-        marker = v->value;
-        datalen = 0;
-    }
-    else if (v->value >= INT8_MIN && v->value <= INT8_MAX)
-    {
-        marker = int_markers.m8;
-        data.v8 = v->value;
-        datalen = 1;
-    }
-    else if (v->value >= INT16_MIN && v->value <= INT16_MAX)
-    {
-        marker = int_markers.m16;
-        data.v16 = htons(v->value);
-        datalen = 2;
-    }
-    else if (v->value >= INT32_MIN && v->value <= INT32_MAX)
-    {
-        marker = int_markers.m32;
-        data.v32 = htonl(v->value);
-        datalen = 4;
-    }
-    else
-    {
-        marker = int_markers.m64;
-        data.v64 = htobe64(v->value);
-        datalen = 8;
-    }
-
-    struct iovec iov[2];
-    iov[0].iov_base = &marker;
-    iov[0].iov_len = 1;
-    iov[1].iov_base = &data;
-    iov[1].iov_len = datalen;
-
-    return neo4j_ios_writev_all(stream, iov, 2, NULL);
+    uint8_t buf[PACKED_NUMBER_MAX];
+    size_t n = pack_int(buf, v->value);
+    return neo4j_ios_write_all(stream, buf, n, NULL);
 }
 
 
@@ -154,22 +140,9 @@ int neo4j_float_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream)
     assert(neo4j_type(*value) == NEO4J_FLOAT);
     const struct neo4j_float *v = (const struct neo4j_float *)value;
 
-    uint8_t marker = 0xC1;
-    struct iovec iov[2];
-    iov[0].iov_base = &marker;
-    iov[0].iov_len = 1;
-
-    union
-    {
-        uint64_t data;
-        double value;
-    } double_data;
-
-    double_data.value = v->value;
-    double_data.data = htobe64(double_data.data);
-    iov[1].iov_base = &(double_data.data);
-    iov[1].iov_len = 8;
-    return neo4j_ios_writev_all(stream, iov, 2, NULL);
+    uint8_t buf[PACKED_NUMBER_MAX];
+    size_t n = pack_float(buf, v->value);
+    return neo4j_ios_write_all(stream, buf, n, NULL);
 }
 
 
@@ -223,6 +196,80 @@ int neo4j_list_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream)
 }
 
 
+/* typed arrays */
+
+int neo4j_int_array_serialize(const neo4j_value_t *value,
+        neo4j_iostream_t *stream)
+{
+    REQUIRE(value != NULL, -1);
+    REQUIRE(stream != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST);
+    const struct neo4j_array *v = (const struct neo4j_array *)value;
+    REQUIRE(v->length == 0 || v->ints != NULL, -1);
+
+    struct iovec iov[2];
+    struct length_header header;
+    int iovcnt = build_header(iov, &header, v->length, &list_markers);
+
+    if (neo4j_ios_writev_all(stream, iov, iovcnt, NULL))
+    {
+        return -1;
+    }
+
+    uint8_t buf[ARRAY_SERIALIZE_BUFFER_SIZE];
+    size_t used = 0;
+    for (unsigned int i = 0; i < v->length; ++i)
+    {
+        if ((used + PACKED_NUMBER_MAX) > sizeof(buf))
+        {
+            if (neo4j_ios_write_all(stream, buf, used, NULL))
+            {
+                return -1;
+            }
+            used = 0;
+        }
+        used += pack_int(buf + used, v->ints[i]);
+    }
+    return (used > 0)? neo4j_ios_write_all(stream, buf, used, NULL) : 0;
+}
+
+
+int neo4j_float_array_serialize(const neo4j_value_t *value,
+        neo4j_iostream_t *stream)
+{
+    REQUIRE(value != NULL, -1);
+    REQUIRE(stream != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST);
+    const struct neo4j_array *v = (const struct neo4j_array *)value;
+    REQUIRE(v->length == 0 || v->floats != NULL, -1);
+
+    struct iovec iov[2];
+    struct length_header header;
+    int iovcnt = build_header(iov, &header, v->length, &list_markers);
+
+    if (neo4j_ios_writev_all(stream, iov, iovcnt, NULL))
+    {
+        return -1;
+    }
+
+    uint8_t buf[ARRAY_SERIALIZE_BUFFER_SIZE];
+    size_t used = 0;
+    for (unsigned int i = 0; i < v->length; ++i)
+    {
+        if ((used + PACKED_NUMBER_MAX) > sizeof(buf))
+        {
+            if (neo4j_ios_write_all(stream, buf, used, NULL))
+            {
+                return -1;
+            }
+            used = 0;
+        }
+        used += pack_float(buf + used, v->floats[i]);
+    }
+    return (used > 0)? neo4j_ios_write_all(stream, buf, used, NULL) : 0;
+}
+
+
 /* map */
 
 int neo4j_map_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream)
@@ -263,6 +310,303 @@ int neo4j_map_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream)
 }
 
 
+/* streamed values */
+
+int neo4j_streamed_serialize(const neo4j_value_t *value,
+        neo4j_iostream_t *stream)
+{
+    REQUIRE(value != NULL, -1);
+    REQUIRE(stream != NULL, -1);
+    assert(neo4j_type(*value) == NEO4J_LIST ||
+            neo4j_type(*value) == NEO4J_MAP);
+    const struct neo4j_streamed *v = (const struct neo4j_streamed *)value;
+    REQUIRE(v->producer != NULL && v->producer->produce != NULL, -1);
+
+    neo4j_value_writer_t writer =
+        { .stream = stream, .type = neo4j_type(*value),
+          .failed = false, .done = false, .depth = 0 };
+
+    if (v->producer->produce(v->producer, &writer))
+    {
+        return -1;
+    }
+    if (writer.failed || !writer.done)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+
+int neo4j_writer_begin_list(neo4j_value_writer_t *writer, unsigned int n)
+{
+    REQUIRE(writer != NULL, -1);
+    return writer_begin(writer, n, false);
+}
+
+
+int neo4j_writer_begin_map(neo4j_value_writer_t *writer, unsigned int n)
+{
+    REQUIRE(writer != NULL, -1);
+    return writer_begin(writer, n, true);
+}
+
+
+int writer_begin(neo4j_value_writer_t *writer, unsigned int n, bool map)
+{
+    if (writer->depth == 0 && writer->type != (map? NEO4J_MAP : NEO4J_LIST))
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+    if (writer_check_value(writer))
+    {
+        return -1;
+    }
+    if (writer->depth >= WRITER_MAX_DEPTH)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+#if UINT_MAX != UINT32_MAX
+    if (n > UINT32_MAX)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+#endif
+
+    struct iovec iov[2];
+    struct length_header header;
+    int iovcnt = build_header(iov, &header, n,
+            map? &map_markers : &list_markers);
+    if (neo4j_ios_writev_all(writer->stream, iov, iovcnt, NULL))
+    {
+        writer->failed = true;
+        return -1;
+    }
+
+    struct writer_frame *frame = &(writer->frames[writer->depth]);
+    frame->remaining = n;
+    frame->map = map;
+    frame->expect_key = map;
+    (writer->depth)++;
+    return 0;
+}
+
+
+int neo4j_writer_end(neo4j_value_writer_t *writer)
+{
+    REQUIRE(writer != NULL, -1);
+    if (writer->failed)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (writer->depth == 0 ||
+            writer->frames[writer->depth - 1].remaining > 0)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+    (writer->depth)--;
+    writer_value_written(writer);
+    return 0;
+}
+
+
+int neo4j_writer_key(neo4j_value_writer_t *writer, const char *key)
+{
+    REQUIRE(writer != NULL, -1);
+    REQUIRE(key != NULL, -1);
+    if (writer->failed)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    struct writer_frame *frame = (writer->depth > 0)?
+        &(writer->frames[writer->depth - 1]) : NULL;
+    if (frame == NULL || !frame->expect_key || frame->remaining == 0)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+
+    neo4j_value_t value = neo4j_string(key);
+    if (neo4j_string_serialize(&value, writer->stream))
+    {
+        writer->failed = true;
+        return -1;
+    }
+    frame->expect_key = false;
+    return 0;
+}
+
+
+int neo4j_writer_null(neo4j_value_writer_t *writer)
+{
+    return neo4j_writer_value(writer, neo4j_null);
+}
+
+
+int neo4j_writer_bool(neo4j_value_writer_t *writer, bool value)
+{
+    return neo4j_writer_value(writer, neo4j_bool(value));
+}
+
+
+int neo4j_writer_int(neo4j_value_writer_t *writer, long long value)
+{
+    REQUIRE(writer != NULL, -1);
+    if (writer_check_value(writer))
+    {
+        return -1;
+    }
+    uint8_t buf[PACKED_NUMBER_MAX];
+    size_t n = pack_int(buf, value);
+    if (neo4j_ios_write_all(writer->stream, buf, n, NULL))
+    {
+        writer->failed = true;
+        return -1;
+    }
+    writer_value_written(writer);
+    return 0;
+}
+
+
+int neo4j_writer_float(neo4j_value_writer_t *writer, double value)
+{
+    REQUIRE(writer != NULL, -1);
+    if (writer_check_value(writer))
+    {
+        return -1;
+    }
+    uint8_t buf[PACKED_NUMBER_MAX];
+    size_t n = pack_float(buf, value);
+    if (neo4j_ios_write_all(writer->stream, buf, n, NULL))
+    {
+        writer->failed = true;
+        return -1;
+    }
+    writer_value_written(writer);
+    return 0;
+}
+
+
+int neo4j_writer_string(neo4j_value_writer_t *writer, const char *s)
+{
+    REQUIRE(s != NULL, -1);
+    return neo4j_writer_value(writer, neo4j_string(s));
+}
+
+
+int neo4j_writer_ustring(neo4j_value_writer_t *writer,
+        const char *u, unsigned int n)
+{
+    REQUIRE(n == 0 || u != NULL, -1);
+    return neo4j_writer_value(writer, neo4j_ustring(u, n));
+}
+
+
+int neo4j_writer_value(neo4j_value_writer_t *writer, neo4j_value_t value)
+{
+    REQUIRE(writer != NULL, -1);
+    if (writer->depth == 0 && neo4j_type(value) != writer->type)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+    if (writer_check_value(writer))
+    {
+        return -1;
+    }
+    if (neo4j_serialize(value, writer->stream))
+    {
+        writer->failed = true;
+        return -1;
+    }
+    writer_value_written(writer);
+    return 0;
+}
+
+
+int neo4j_writer_encoded(neo4j_value_writer_t *writer, const void *buf,
+        size_t n, unsigned int nvalues)
+{
+    REQUIRE(writer != NULL, -1);
+    REQUIRE(n == 0 || buf != NULL, -1);
+    if (writer->failed)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    struct writer_frame *frame = (writer->depth > 0)?
+        &(writer->frames[writer->depth - 1]) : NULL;
+    if (frame == NULL || frame->map || frame->remaining < nvalues)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+    if (n > 0 && neo4j_ios_write_all(writer->stream, buf, n, NULL))
+    {
+        writer->failed = true;
+        return -1;
+    }
+    frame->remaining -= nvalues;
+    return 0;
+}
+
+
+int writer_check_value(neo4j_value_writer_t *writer)
+{
+    if (writer->failed)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (writer->depth == 0)
+    {
+        if (writer->done)
+        {
+            writer->failed = true;
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+    const struct writer_frame *frame = &(writer->frames[writer->depth - 1]);
+    if (frame->remaining == 0 || frame->expect_key)
+    {
+        writer->failed = true;
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+
+void writer_value_written(neo4j_value_writer_t *writer)
+{
+    if (writer->depth == 0)
+    {
+        writer->done = true;
+        return;
+    }
+    struct writer_frame *frame = &(writer->frames[writer->depth - 1]);
+    assert(frame->remaining > 0);
+    (frame->remaining)--;
+    frame->expect_key = frame->map;
+}
+
+
 /* structure */
 
 int neo4j_struct_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream)
@@ -337,3 +681,56 @@ int build_header(struct iovec *iov, struct length_header *header,
     }
     return iovcnt;
 }
+
+
+size_t pack_int(uint8_t *buf, int64_t value)
+{
+    if (value >= -(1<<4) && value < (1<<7))
+    {
+        buf[0] = (uint8_t)value;
+        return 1;
+    }
+    else if (value >= INT8_MIN && value <= INT8_MAX)
+    {
+        buf[0] = int_markers.m8;
+        buf[1] = (uint8_t)value;
+        return 2;
+    }
+    else if (value >= INT16_MIN && value <= INT16_MAX)
+    {
+        uint16_t v16 = htons((uint16_t)value);
+        buf[0] = int_markers.m16;
+        memcpy(buf + 1, &v16, 2);
+        return 3;
+    }
+    else if (value >= INT32_MIN && value <= INT32_MAX)
+    {
+        uint32_t v32 = htonl((uint32_t)value);
+        buf[0] = int_markers.m32;
+        memcpy(buf + 1, &v32, 4);
+        return 5;
+    }
+    else
+    {
+        uint64_t v64 = htobe64((uint64_t)value);
+        buf[0] = int_markers.m64;
+        memcpy(buf + 1, &v64, 8);
+        return 9;
+    }
+}
+
+
+size_t pack_float(uint8_t *buf, double value)
+{
+    union
+    {
+        uint64_t data;
+        double value;
+    } double_data;
+
+    double_data.value = value;
+    double_data.data = htobe64(double_data.data);
+    buf[0] = 0xC1;
+    memcpy(buf + 1, &(double_data.data), 8);
+    return 9;
+}
@@ -32,6 +32,21 @@
 __neo4j_must_check
 int neo4j_serialize(neo4j_value_t v, struct neo4j_iostream *stream);
 
+/**
+ * Write already serialized values into the current list of a value writer.
+ *
+ * @internal
+ *
+ * @param [writer] The value writer, which must be writing a list.
+ * @param [buf] A buffer containing the serialized values.
+ * @param [n] The length of the buffer.
+ * @param [nvalues] The number of values contained in the buffer.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_writer_encoded(neo4j_value_writer_t *writer, const void *buf,
+        size_t n, unsigned int nvalues);
+
 int neo4j_null_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream);
 int neo4j_bool_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream);
 int neo4j_int_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream);
@@ -39,7 +54,13 @@ int neo4j_float_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream);
 int neo4j_string_serialize(const neo4j_value_t *value,
         neo4j_iostream_t *stream);
 int neo4j_list_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream);
+int neo4j_int_array_serialize(const neo4j_value_t *value,
+        neo4j_iostream_t *stream);
+int neo4j_float_array_serialize(const neo4j_value_t *value,
+        neo4j_iostream_t *stream);
 int neo4j_map_serialize(const neo4j_value_t *value, neo4j_iostream_t *stream);
+int neo4j_streamed_serialize(const neo4j_value_t *value,
+        neo4j_iostream_t *stream);
 int neo4j_struct_serialize(const neo4j_value_t *value,
         neo4j_iostream_t *stream);
 
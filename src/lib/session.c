@@ -21,7 +21,9 @@
 #include "memory.h"
 #include "messages.h"
 #include "metadata.h"
+#include "probes.h"
 #include "serialization.h"
+#include "stats.h"
 #include "util.h"
 #include <assert.h>
 #include <unistd.h>
@@ -33,21 +35,52 @@ static_assert(NEO4J_REQUEST_ARGV_PREALLOC >= 2,
 #define NEO4J_MAXUSERNAMELEN 1024
 #define NEO4J_MAXPASSWORDLEN 1024
 
+// bounds on the estimated number of requests queued at the server, used
+// when adapting the pipeline window
+#define NEO4J_PIPELINE_QUEUED_MIN 1
+#define NEO4J_PIPELINE_QUEUED_MAX 3
+
 
 static int session_start(neo4j_session_t *session);
 static int session_clear(neo4j_session_t *session);
-static int send_requests(neo4j_session_t *session);
+static int sync_until(neo4j_session_t *session,
+        const unsigned int *condition, uint64_t deadline);
+static int send_requests(neo4j_session_t *session, unsigned int limit);
+static int send_control_requests(neo4j_session_t *session);
+static int send_request(neo4j_session_t *session,
+        struct neo4j_request *request);
+static int cancel_requests(neo4j_session_t *session);
+static unsigned int pipeline_window(const neo4j_session_t *session);
+static void measure_response(neo4j_session_t *session,
+        struct neo4j_request *request);
+static void adapt_pipeline_window(neo4j_session_t *session,
+        size_t rcvd_bytes);
 static int receive_responses(neo4j_session_t *session,
-        const unsigned int *condition);
+        const unsigned int *condition, uint64_t deadline);
 static int drain_queued_requests(neo4j_session_t *session);
-
-static struct neo4j_request *new_request(neo4j_session_t *session);
+static void record_completion(neo4j_session_t *session,
+        uint64_t queued_at, neo4j_message_type_t type);
+
+static struct neo4j_request *new_request(neo4j_session_t *session,
+        neo4j_message_type_t type);
+static void trace(neo4j_session_t *session,
+        const struct neo4j_request *request, neo4j_trace_point_t point,
+        uint64_t timestamp);
+static int grow_request_queue(neo4j_session_t *session);
+static int retire_request(neo4j_session_t *session, uint64_t deadline);
+static int retire_callback(void *cdata, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc);
 static void pop_request(neo4j_session_t* session);
 
 static int initialize(neo4j_session_t *session, unsigned int attempts,
         char *username, size_t usize, char *password, size_t psize);
 static int initialize_callback(void *cdata, neo4j_message_type_t type,
         const neo4j_value_t *argv, uint16_t argc);
+static int pipeline_init(neo4j_session_t *session);
+static int queue_pipelined_init(neo4j_session_t *session);
+static int pipelined_init_callback(void *cdata, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc);
+static void free_pending_init(neo4j_session_t *session);
 static int ack_failure(neo4j_session_t *session);
 static int ack_failure_callback(void *cdata, neo4j_message_type_t type,
        const neo4j_value_t *argv, uint16_t argc);
@@ -102,6 +135,19 @@ int session_start(neo4j_session_t *session)
 {
     const neo4j_config_t *config = session->config;
 
+    if ((config->username != NULL &&
+                strlen(config->username) >= NEO4J_MAXUSERNAMELEN) ||
+        (config->password != NULL &&
+                strlen(config->password) >= NEO4J_MAXPASSWORDLEN))
+    {
+        neo4j_log_error(session->logger,
+                "session (%p) cannot start: username or password is longer"
+                " than %d characters", (void *)session,
+                NEO4J_MAXUSERNAMELEN - 1);
+        errno = NEO4J_INVALID_CREDENTIALS;
+        return -1;
+    }
+
     if (neo4j_attach_session(session->connection, session))
     {
         char ebuf[256];
@@ -115,15 +161,31 @@ int session_start(neo4j_session_t *session)
     assert(session->request_queue_size > 0);
     assert(session->request_queue_depth == 0);
 
+    session->pipeline_window = maxu(minu(config->max_pipelined_requests,
+            config->max_adaptive_pipelined_requests), 1);
+    session->min_rtt = 0;
+    session->srtt = 0;
+    session->response_size = 0;
+
+    if (config->pipelined_init && config->auth_reattempt_callback == NULL)
+    {
+        if (pipeline_init(session))
+        {
+            goto failure;
+        }
+        return 0;
+    }
+
+    // the buffers are writable, as the reattempt callback may update them
     char username[NEO4J_MAXUSERNAMELEN] = "";
     if (config->username)
     {
-        strncpy(username, config->username, sizeof(username));
+        memcpy(username, config->username, strlen(config->username) + 1);
     }
     char password[NEO4J_MAXPASSWORDLEN] = "";
     if (config->password)
     {
-        strncpy(password, config->password, sizeof(password));
+        memcpy(password, config->password, strlen(config->password) + 1);
     }
     if (initialize(session, 0, username, sizeof(username),
             password, sizeof(password)))
@@ -164,7 +226,14 @@ static int session_clear(neo4j_session_t *session)
     }
     session->jobs = NULL;
 
-    if (!session->failed && receive_responses(session, NULL))
+    if (!session->failed && send_control_requests(session))
+    {
+        err = -1;
+        errsv = errno;
+        session->failed = true;
+    }
+
+    if (!session->failed && receive_responses(session, NULL, 0))
     {
         err = -1;
         errsv = errno;
@@ -197,6 +266,8 @@ int neo4j_end_session(neo4j_session_t *session)
         errsv = errno;
     }
 
+    free_pending_init(session);
+
     int result = neo4j_detach_session(session->connection, session,
             !session->failed);
     if (result && err == 0)
@@ -223,6 +294,11 @@ int neo4j_reset_session(neo4j_session_t *session)
     {
         return -1;
     }
+    // if initialization was queued but never sent, it must be sent again
+    if (session->pending_init != NULL && queue_pipelined_init(session))
+    {
+        return -1;
+    }
     if (reset(session))
     {
         return -1;
@@ -232,6 +308,35 @@ int neo4j_reset_session(neo4j_session_t *session)
 }
 
 
+unsigned int neo4j_session_pipeline_window(neo4j_session_t *session)
+{
+    REQUIRE(session != NULL, 0);
+    return pipeline_window(session);
+}
+
+
+int neo4j_session_set_statement_timeout(neo4j_session_t *session,
+        unsigned int timeout)
+{
+    REQUIRE(session != NULL, -1);
+    session->statement_timeout = timeout;
+    return 0;
+}
+
+
+int neo4j_session_stats(neo4j_session_t *session,
+        struct neo4j_session_stats *stats)
+{
+    REQUIRE(session != NULL, -1);
+    REQUIRE(stats != NULL, -1);
+    memcpy(stats, &(session->stats), sizeof(struct neo4j_session_stats));
+    stats->request_queue_size = session->request_queue_size;
+    stats->request_queue_depth = session->request_queue_depth;
+    stats->inflight_requests = session->inflight_requests;
+    return 0;
+}
+
+
 int neo4j_attach_job(neo4j_session_t *session, neo4j_job_t *job)
 {
     REQUIRE(session != NULL, -1);
@@ -276,8 +381,26 @@ int neo4j_detach_job(neo4j_session_t *session, neo4j_job_t *job)
 
 
 int neo4j_session_sync(neo4j_session_t *session, const unsigned int *condition)
+{
+    return neo4j_session_sync_until(session, condition, 0);
+}
+
+
+int neo4j_session_sync_until(neo4j_session_t *session,
+        const unsigned int *condition, uint64_t deadline)
 {
     REQUIRE(session != NULL, -1);
+    NEO4J_PROBE3(session_sync_start, session, session->request_queue_depth,
+            session->inflight_requests);
+    int result = sync_until(session, condition, deadline);
+    NEO4J_PROBE2(session_sync_done, session, result);
+    return result;
+}
+
+
+int sync_until(neo4j_session_t *session, const unsigned int *condition,
+        uint64_t deadline)
+{
     ENSURE_NOT_NULL(unsigned int, condition, 1);
 
     if (session->failed)
@@ -288,7 +411,14 @@ int neo4j_session_sync(neo4j_session_t *session, const unsigned int *condition)
 
     while (*condition > 0 && session->request_queue_depth > 0)
     {
-        int result = receive_responses(session, condition);
+        int result = receive_responses(session, condition, deadline);
+        // after a timeout part way through a message, the session has
+        // failed and the requests can no longer be cancelled
+        if (result < 0 && errno == NEO4J_STATEMENT_TIMEOUT &&
+                !session->failed)
+        {
+            return cancel_requests(session);
+        }
         if (result < 0)
         {
             goto error;
@@ -305,7 +435,7 @@ int neo4j_session_sync(neo4j_session_t *session, const unsigned int *condition)
             return ack_failure(session);
         }
 
-        if (send_requests(session))
+        if (send_requests(session, pipeline_window(session)))
         {
             goto error;
         }
@@ -323,37 +453,130 @@ error:
 }
 
 
-int send_requests(neo4j_session_t *session)
+int neo4j_session_flush(neo4j_session_t *session)
+{
+    REQUIRE(session != NULL, -1);
+
+    if (session->failed)
+    {
+        errno = NEO4J_SESSION_FAILED;
+        return -1;
+    }
+
+    if (send_requests(session, pipeline_window(session)))
+    {
+        int errsv = errno;
+        drain_queued_requests(session);
+        assert(session->request_queue_depth == 0);
+        errno = errsv;
+        return -1;
+    }
+    return 0;
+}
+
+
+int send_requests(neo4j_session_t *session, unsigned int limit)
 {
     assert(session != NULL);
-    neo4j_connection_t *connection = session->connection;
-    const neo4j_config_t *config = session->config;
 
     for (unsigned int i = session->inflight_requests;
-            i < session->request_queue_depth &&
-            i < config->max_pipelined_requests; ++i)
+            i < session->request_queue_depth && i < limit; ++i)
+    {
+        int offset =
+            (session->request_queue_head + i) % session->request_queue_size;
+        if (send_request(session, &(session->request_queue[offset])))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int send_control_requests(neo4j_session_t *session)
+{
+    assert(session != NULL);
+
+    // ACK_FAILURE and RESET are queued lazily, ahead of the next request,
+    // so ensure they are sent before any unsent requests are drained
+    for (unsigned int i = session->inflight_requests;
+            i < session->request_queue_depth; ++i)
     {
         int offset =
             (session->request_queue_head + i) % session->request_queue_size;
         struct neo4j_request *request = &(session->request_queue[offset]);
+        if (request->type != NEO4J_ACK_FAILURE_MESSAGE &&
+                request->type != NEO4J_RESET_MESSAGE)
+        {
+            break;
+        }
 
-        if (neo4j_connection_send(connection, request->type,
-                    request->argv, request->argc))
+        if (send_request(session, request))
         {
             return -1;
         }
+    }
 
-        (session->inflight_requests)++;
-        neo4j_log_debug(session->logger, "sent %s (%p) in %p",
-                neo4j_message_type_str(request->type),
-                (void *)request, (void *)session);
+    return 0;
+}
+
+
+int send_request(neo4j_session_t *session, struct neo4j_request *request)
+{
+    const neo4j_config_t *config = session->config;
+
+    if (neo4j_connection_send(session->connection, request->type,
+                request->argv, request->argc))
+    {
+        // a partially sent message cannot be recovered from
+        session->failed = true;
+        return -1;
     }
 
+    // the send time is needed to measure the round-trip for the pipeline
+    // window, as well as for tracing
+    if (config->adaptive_pipelining || config->trace_callback != NULL)
+    {
+        request->sent_at = monotonic_ns();
+        trace(session, request, NEO4J_TRACE_REQUEST_SENT, request->sent_at);
+    }
+    (session->inflight_requests)++;
+    neo4j_log_debug(session->logger, "sent %s (%p) in %p",
+            neo4j_message_type_str(request->type),
+            (void *)request, (void *)session);
     return 0;
 }
 
 
-int receive_responses(neo4j_session_t *session, const unsigned int *condition)
+int cancel_requests(neo4j_session_t *session)
+{
+    assert(session != NULL);
+
+    neo4j_log_debug(session->logger,
+            "deadline expired in %p, cancelling requests", (void *)session);
+
+    // the RESET interrupts the request being evaluated by the server, and
+    // must be sent immediately, so all requests queued ahead of it are sent
+    // regardless of the pipeline window
+    if (reset(session) ||
+            send_requests(session, session->request_queue_depth))
+    {
+        int errsv = errno;
+        session->failed = true;
+        drain_queued_requests(session);
+        assert(session->request_queue_depth == 0);
+        errno = errsv;
+        return -1;
+    }
+
+    errno = NEO4J_STATEMENT_TIMEOUT;
+    return -1;
+}
+
+
+int receive_responses(neo4j_session_t *session, const unsigned int *condition,
+        uint64_t deadline)
 {
     assert(session != NULL);
     ENSURE_NOT_NULL(unsigned int, condition, 1);
@@ -368,15 +591,54 @@ int receive_responses(neo4j_session_t *session, const unsigned int *condition)
 
         struct neo4j_request *request =
             &(session->request_queue[session->request_queue_head]);
-        if (neo4j_connection_recv(connection, request->mpool,
+        if (deadline > 0 && neo4j_connection_wait(connection, deadline))
+        {
+            if (errno == ETIMEDOUT)
+            {
+                errno = NEO4J_STATEMENT_TIMEOUT;
+            }
+            return -1;
+        }
+
+        unsigned long long rcvd_bytes = connection->stats.bytes_received;
+        size_t mpool_depth = neo4j_mpool_depth(*(request->mpool));
+        size_t mpool_allocated = request->mpool->allocated;
+        if (neo4j_connection_recv(connection, request->mpool, deadline,
                     &type, &argv, &argc))
         {
             neo4j_log_trace_errno(session->logger,
                     "neo4j_connection_recv failed");
+            // a partially received message cannot be recovered from
+            session->failed = true;
+            if (deadline > 0 && errno == ETIMEDOUT)
+            {
+                errno = NEO4J_STATEMENT_TIMEOUT;
+            }
             return -1;
         }
+        request->rcvd_bytes +=
+            connection->stats.bytes_received - rcvd_bytes;
+        session->stats.mpool_allocations +=
+            neo4j_mpool_depth(*(request->mpool)) - mpool_depth;
+        session->stats.mpool_bytes +=
+            request->mpool->allocated - mpool_allocated;
+        if (!request->responded && session->config->trace_callback != NULL)
+        {
+            trace(session, request, NEO4J_TRACE_RESPONSE_RECEIVED,
+                    monotonic_ns());
+        }
+        if (session->config->adaptive_pipelining)
+        {
+            measure_response(session, request);
+        }
+        request->responded = true;
 
-        if (failure && type != NEO4J_IGNORED_MESSAGE)
+        if (failure && request->type == NEO4J_RESET_MESSAGE)
+        {
+            // a RESET sent to cancel requests also clears the failure
+            failure = false;
+        }
+        else if (failure && type != NEO4J_IGNORED_MESSAGE)
         {
             neo4j_log_error(session->logger,
                     "unexpected %s message received in %p"
@@ -395,10 +657,18 @@ int receive_responses(neo4j_session_t *session, const unsigned int *condition)
                 neo4j_message_type_str(type),
                 neo4j_message_type_str(request->type), (void *)request);
 
+        // the callback may queue requests, which can reallocate the queue
+        size_t response_bytes = request->rcvd_bytes;
+        uint64_t queued_at = request->queued_at;
         int result = request->receive(request->cdata, type, argv, argc);
         int errsv = errno;
         if (result <= 0)
         {
+            if (session->config->adaptive_pipelining)
+            {
+                adapt_pipeline_window(session, response_bytes);
+            }
+            record_completion(session, queued_at, type);
             pop_request(session);
             (session->inflight_requests)--;
         }
@@ -414,6 +684,124 @@ int receive_responses(neo4j_session_t *session, const unsigned int *condition)
 }
 
 
+unsigned int pipeline_window(const neo4j_session_t *session)
+{
+    const neo4j_config_t *config = session->config;
+    if (!config->adaptive_pipelining)
+    {
+        return config->max_pipelined_requests;
+    }
+    return minu(session->pipeline_window,
+            config->max_adaptive_pipelined_requests);
+}
+
+
+void measure_response(neo4j_session_t *session, struct neo4j_request *request)
+{
+    if (request->responded)
+    {
+        return;
+    }
+
+    // the round-trip time is measured to the first response message, and
+    // a smoothed value is maintained along with the minimum observed
+    uint64_t rtt = monotonic_ns() - request->sent_at;
+    if (session->min_rtt == 0 || rtt < session->min_rtt)
+    {
+        session->min_rtt = rtt;
+    }
+    session->srtt = (session->srtt == 0)? rtt :
+        (session->srtt * 7 + rtt) / 8;
+}
+
+
+void adapt_pipeline_window(neo4j_session_t *session, size_t rcvd_bytes)
+{
+    const neo4j_config_t *config = session->config;
+    unsigned int window = session->pipeline_window;
+
+    // estimate how many requests are queued at the server, from the extra
+    // delay in the smoothed round-trip time relative to the minimum: grow
+    // the window while there is little or no queueing (e.g. over a
+    // high-latency link), and shrink it once requests are backing up
+    if (session->srtt > 0)
+    {
+        uint64_t delay = session->srtt - session->min_rtt;
+        uint64_t queued = (window * delay) / session->srtt;
+        if (queued < NEO4J_PIPELINE_QUEUED_MIN)
+        {
+            window++;
+        }
+        else if (queued > NEO4J_PIPELINE_QUEUED_MAX)
+        {
+            window--;
+        }
+    }
+
+    // limit the window so the responses in flight fit within the budget
+    session->response_size = (session->response_size == 0)? rcvd_bytes :
+        (session->response_size * 7 + rcvd_bytes) / 8;
+    if (session->response_size > 0)
+    {
+        size_t limit = config->pipeline_response_budget /
+            session->response_size;
+        window = minzu(window, limit);
+    }
+
+    window = maxu(minu(window, config->max_adaptive_pipelined_requests), 1);
+    if (window != session->pipeline_window)
+    {
+        neo4j_log_trace(session->logger,
+                "pipeline window in %p now %u (srtt=%lluus, min_rtt=%lluus,"
+                " response_size=%zu)", (void *)session, window,
+                (unsigned long long)(session->srtt / 1000),
+                (unsigned long long)(session->min_rtt / 1000),
+                session->response_size);
+        session->pipeline_window = window;
+    }
+}
+
+
+void neo4j_session_trace_response(neo4j_session_t *session,
+        neo4j_trace_point_t point)
+{
+    assert(session != NULL);
+    if (session->config->trace_callback == NULL)
+    {
+        return;
+    }
+    assert(session->request_queue_depth > 0);
+    trace(session, &(session->request_queue[session->request_queue_head]),
+            point, monotonic_ns());
+}
+
+
+void trace(neo4j_session_t *session, const struct neo4j_request *request,
+        neo4j_trace_point_t point, uint64_t timestamp)
+{
+    const neo4j_config_t *config = session->config;
+    if (config->trace_callback == NULL)
+    {
+        return;
+    }
+    config->trace_callback(config->trace_callback_userdata, point, timestamp,
+            session, request->id, neo4j_message_type_str(request->type));
+}
+
+
+void record_completion(neo4j_session_t *session, uint64_t queued_at,
+        neo4j_message_type_t type)
+{
+    (session->stats.requests)++;
+    if (type == NEO4J_FAILURE_MESSAGE || type == NEO4J_IGNORED_MESSAGE)
+    {
+        (session->stats.failed_requests)++;
+    }
+    neo4j_latency_record(&(session->stats.request_latency),
+            monotonic_ns() - queued_at);
+}
+
+
 int drain_queued_requests(neo4j_session_t *session)
 {
     assert(session != NULL);
@@ -445,21 +833,14 @@ int drain_queued_requests(neo4j_session_t *session)
 }
 
 
-struct neo4j_request *new_request(neo4j_session_t *session)
+struct neo4j_request *new_request(neo4j_session_t *session,
+        neo4j_message_type_t type)
 {
     assert(session != NULL);
     const neo4j_config_t *config = session->config;
 
-    if (session->failed)
-    {
-        errno = NEO4J_SESSION_FAILED;
-        return NULL;
-    }
-
-    if (session->request_queue_depth >= session->request_queue_size)
+    if (neo4j_session_reserve(session, 1, 0))
     {
-        assert(session->request_queue_depth == session->request_queue_size);
-        errno = ENOBUFS;
         return NULL;
     }
 
@@ -471,14 +852,50 @@ struct neo4j_request *new_request(neo4j_session_t *session)
         session->request_queue_head - request_queue_free;
 
     (session->request_queue_depth)++;
+    if (session->request_queue_depth > session->stats.max_request_queue_depth)
+    {
+        session->stats.max_request_queue_depth = session->request_queue_depth;
+    }
     struct neo4j_request *req =
         &(session->request_queue[request_queue_tail]);
+    req->type = type;
     req->_mpool = neo4j_mpool(config->allocator, config->mpool_block_size);
     req->mpool = &(req->_mpool);
+    req->id = (session->request_seq)++;
+    req->queued_at = monotonic_ns();
+    trace(session, req, NEO4J_TRACE_REQUEST_QUEUED, req->queued_at);
     return req;
 }
 
 
+int neo4j_session_reserve(neo4j_session_t *session, unsigned int n,
+        uint64_t deadline)
+{
+    REQUIRE(session != NULL, -1);
+
+    if (session->failed)
+    {
+        errno = NEO4J_SESSION_FAILED;
+        return -1;
+    }
+
+    while (session->request_queue_size - session->request_queue_depth < n)
+    {
+        // grow the queue if permitted, otherwise synchronize to make room
+        if (grow_request_queue(session) == 0)
+        {
+            continue;
+        }
+        if (session->request_queue_depth == 0 ||
+                retire_request(session, deadline))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
 void pop_request(neo4j_session_t* session)
 {
     assert(session != NULL);
@@ -499,6 +916,127 @@ void pop_request(neo4j_session_t* session)
 }
 
 
+int grow_request_queue(neo4j_session_t *session)
+{
+    assert(session != NULL);
+    neo4j_connection_t *connection = session->connection;
+    unsigned int max_size = session->config->session_request_queue_max_size;
+
+    if (session->request_queue_size >= max_size)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+    unsigned int size = (session->request_queue_size > max_size / 2)?
+        max_size : session->request_queue_size * 2;
+
+    struct neo4j_request *queue = calloc(size, sizeof(struct neo4j_request));
+    if (queue == NULL)
+    {
+        neo4j_log_debug_errno(session->logger,
+                "failed to grow request queue");
+        return -1;
+    }
+
+    // copy the ring into the new queue, starting at the head, and rebase
+    // any references to the preallocated fields of each request
+    for (unsigned int i = 0; i < session->request_queue_depth; ++i)
+    {
+        unsigned int offset =
+            (session->request_queue_head + i) % session->request_queue_size;
+        struct neo4j_request *from = &(session->request_queue[offset]);
+        struct neo4j_request *to = &(queue[i]);
+        memcpy(to, from, sizeof(struct neo4j_request));
+        if (from->argv == from->_argv)
+        {
+            to->argv = to->_argv;
+        }
+        if (from->mpool == &(from->_mpool))
+        {
+            to->mpool = &(to->_mpool);
+        }
+    }
+
+    neo4j_log_trace(session->logger, "grew request queue in %p to %u",
+            (void *)session, size);
+
+    assert(connection->request_queue == session->request_queue);
+    free(session->request_queue);
+    connection->request_queue = queue;
+    connection->request_queue_size = size;
+    session->request_queue = queue;
+    session->request_queue_size = size;
+    session->request_queue_head = 0;
+    return 0;
+}
+
+
+struct retire_cdata
+{
+    neo4j_response_recv_t receive;
+    void *cdata;
+    unsigned int awaiting;
+};
+
+
+int retire_request(neo4j_session_t *session, uint64_t deadline)
+{
+    assert(session != NULL);
+    assert(session->request_queue_depth > 0);
+
+    neo4j_log_trace(session->logger,
+            "request queue full in %p, synchronizing", (void *)session);
+
+    // intercept responses to the request at the head of the queue, and
+    // synchronize until it has been completed
+    struct neo4j_request *request =
+        &(session->request_queue[session->request_queue_head]);
+    struct retire_cdata cdata =
+        { .receive = request->receive, .cdata = request->cdata,
+          .awaiting = 1 };
+    unsigned long long id = request->id;
+    request->receive = retire_callback;
+    request->cdata = &cdata;
+
+    if (neo4j_session_sync_until(session, &(cdata.awaiting), deadline) == 0)
+    {
+        return 0;
+    }
+
+    // the request may still be queued (and may have moved if the queue
+    // grew), so restore its callback before the cdata goes out of scope
+    int errsv = errno;
+    for (unsigned int i = 0; cdata.awaiting &&
+            i < session->request_queue_depth; ++i)
+    {
+        unsigned int offset =
+            (session->request_queue_head + i) % session->request_queue_size;
+        request = &(session->request_queue[offset]);
+        if (request->id == id && request->cdata == &cdata)
+        {
+            request->receive = cdata.receive;
+            request->cdata = cdata.cdata;
+            break;
+        }
+    }
+    errno = errsv;
+    return -1;
+}
+
+
+int retire_callback(void *cdata, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc)
+{
+    struct retire_cdata *rcdata = (struct retire_cdata *)cdata;
+    int result = rcdata->receive(rcdata->cdata, type, argv, argc);
+    if (result <= 0)
+    {
+        rcdata->awaiting = 0;
+    }
+    return result;
+}
+
+
 struct init_cdata
 {
     neo4j_session_t *session;
@@ -518,12 +1056,11 @@ int initialize(neo4j_session_t *session, unsigned int attempts,
     if (attempts > 0 || config->auth_reattempt_callback == NULL ||
             password[0] != '\0' || config->allow_empty_password)
     {
-        struct neo4j_request *req = new_request(session);
+        struct neo4j_request *req = new_request(session, NEO4J_INIT_MESSAGE);
         if (req == NULL)
         {
             return -1;
         }
-        req->type = NEO4J_INIT_MESSAGE;
         req->_argv[0] = neo4j_string(client_id);
         neo4j_map_entry_t auth_token[3] =
             { neo4j_map_entry("scheme", neo4j_string("basic")),
@@ -684,24 +1221,128 @@ cleanup:
 }
 
 
+struct neo4j_pending_init
+{
+    // the credentials are referenced from the session's config
+    neo4j_map_entry_t auth_token[3];
+};
+
+
+int pipeline_init(neo4j_session_t *session)
+{
+    assert(session != NULL);
+    assert(session->pending_init == NULL);
+
+    struct neo4j_pending_init *init =
+        calloc(1, sizeof(struct neo4j_pending_init));
+    if (init == NULL)
+    {
+        neo4j_log_error_errno(session->logger,
+                "malloc of neo4j_pending_init failed");
+        return -1;
+    }
+    const neo4j_config_t *config = session->config;
+    const char *username = (config->username != NULL)? config->username : "";
+    const char *password = (config->password != NULL)? config->password : "";
+    init->auth_token[0] =
+        neo4j_map_entry("scheme", neo4j_string("basic"));
+    init->auth_token[1] =
+        neo4j_map_entry("principal", neo4j_string(username));
+    init->auth_token[2] =
+        neo4j_map_entry("credentials", neo4j_string(password));
+    session->pending_init = init;
+
+    if (queue_pipelined_init(session))
+    {
+        free_pending_init(session);
+        return -1;
+    }
+    return 0;
+}
+
+
+int queue_pipelined_init(neo4j_session_t *session)
+{
+    assert(session != NULL);
+    assert(session->pending_init != NULL);
+    const char *client_id = session->config->client_id;
+
+    struct neo4j_request *req = new_request(session, NEO4J_INIT_MESSAGE);
+    if (req == NULL)
+    {
+        return -1;
+    }
+    req->_argv[0] = neo4j_string(client_id);
+    req->_argv[1] = neo4j_map(session->pending_init->auth_token, 3);
+    req->argv = req->_argv;
+    req->argc = 2;
+    req->receive = pipelined_init_callback;
+    req->cdata = session;
+
+    neo4j_log_trace(session->logger, "enqu INIT{\"%s\"} (%p) in %p",
+            client_id, (void *)req, (void *)session);
+    return 0;
+}
+
+
+int pipelined_init_callback(void *cdata, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc)
+{
+    assert(cdata != NULL);
+    neo4j_session_t *session = (neo4j_session_t *)cdata;
+
+    if (type == NEO4J_IGNORED_MESSAGE)
+    {
+        // drained before being sent, so retain the credentials in case
+        // the session is reset
+        return 0;
+    }
+
+    struct init_cdata init_cdata = { .session = session, .error = 0 };
+    int result = initialize_callback(&init_cdata, type, argv, argc);
+    int errsv = errno;
+    if (result == 0 && init_cdata.error != 0)
+    {
+        neo4j_log_debug(session->logger,
+                "pipelined initialization failed in %p", (void *)session);
+        errsv = init_cdata.error;
+        result = -1;
+    }
+    free_pending_init(session);
+    errno = errsv;
+    return result;
+}
+
+
+void free_pending_init(neo4j_session_t *session)
+{
+    if (session->pending_init == NULL)
+    {
+        return;
+    }
+    memset(session->pending_init, 0, sizeof(struct neo4j_pending_init));
+    free(session->pending_init);
+    session->pending_init = NULL;
+}
+
+
 int ack_failure(neo4j_session_t *session)
 {
     assert(session != NULL);
 
-    struct neo4j_request *req = new_request(session);
+    struct neo4j_request *req =
+        new_request(session, NEO4J_ACK_FAILURE_MESSAGE);
     if (req == NULL)
     {
         return -1;
     }
-    req->type = NEO4J_ACK_FAILURE_MESSAGE;
     req->argc = 0;
     req->receive = ack_failure_callback;
     req->cdata = session;
 
     neo4j_log_trace(session->logger, "enqu ACK_FAILURE (%p) in %p",
             (void *)req, (void *)session);
-
-    return neo4j_session_sync(session, NULL);
+    return 0;
 }
 
 
@@ -736,20 +1377,18 @@ int reset(neo4j_session_t *session)
 {
     assert(session != NULL);
 
-    struct neo4j_request *req = new_request(session);
+    struct neo4j_request *req = new_request(session, NEO4J_RESET_MESSAGE);
     if (req == NULL)
     {
         return -1;
     }
-    req->type = NEO4J_RESET_MESSAGE;
     req->argc = 0;
     req->receive = reset_callback;
     req->cdata = session;
 
     neo4j_log_trace(session->logger, "enqu RESET (%p) in %p",
             (void *)req, (void *)session);
-
-    return neo4j_session_sync(session, NULL);
+    return 0;
 }
 
 
@@ -790,12 +1429,11 @@ int neo4j_session_run(neo4j_session_t *session, neo4j_mpool_t *mpool,
     REQUIRE(neo4j_type(params) == NEO4J_MAP || neo4j_is_null(params), -1);
     REQUIRE(callback != NULL, -1);
 
-    struct neo4j_request *req = new_request(session);
+    struct neo4j_request *req = new_request(session, NEO4J_RUN_MESSAGE);
     if (req == NULL)
     {
         return -1;
     }
-    req->type = NEO4J_RUN_MESSAGE;
     req->_argv[0] = neo4j_string(statement);
     req->_argv[1] = neo4j_is_null(params)? neo4j_map(NULL, 0) : params;
     req->argv = req->_argv;
@@ -818,13 +1456,12 @@ int neo4j_session_pull_all(neo4j_session_t *session, neo4j_mpool_t *mpool,
     REQUIRE(mpool != NULL, -1);
     REQUIRE(callback != NULL, -1);
 
-    struct neo4j_request *req = new_request(session);
+    struct neo4j_request *req =
+        new_request(session, NEO4J_PULL_ALL_MESSAGE);
     if (req == NULL)
     {
         return -1;
     }
-
-    req->type = NEO4J_PULL_ALL_MESSAGE;
     req->argv = NULL;
     req->argc = 0;
     req->mpool = mpool;
@@ -845,13 +1482,12 @@ int neo4j_session_discard_all(neo4j_session_t *session, neo4j_mpool_t *mpool,
     REQUIRE(mpool != NULL, -1);
     REQUIRE(callback != NULL, -1);
 
-    struct neo4j_request *req = new_request(session);
+    struct neo4j_request *req =
+        new_request(session, NEO4J_DISCARD_ALL_MESSAGE);
     if (req == NULL)
     {
         return -1;
     }
-
-    req->type = NEO4J_DISCARD_ALL_MESSAGE;
     req->argv = NULL;
     req->argc = 0;
     req->mpool = mpool;
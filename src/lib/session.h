@@ -41,6 +41,12 @@ struct neo4j_request
 
     neo4j_response_recv_t receive;
     void *cdata;
+
+    unsigned long long id;
+    uint64_t queued_at;
+    uint64_t sent_at;
+    bool responded;
+    size_t rcvd_bytes;
 };
 
 
@@ -59,6 +65,18 @@ struct neo4j_session
 
     unsigned int inflight_requests;
 
+    struct neo4j_pending_init *pending_init;
+
+    unsigned int pipeline_window;
+    uint64_t min_rtt;
+    uint64_t srtt;
+    size_t response_size;
+
+    unsigned int statement_timeout;
+
+    struct neo4j_session_stats stats;
+    unsigned long long request_seq;
+
     neo4j_job_t *jobs;
 };
 
@@ -86,6 +104,20 @@ int neo4j_attach_job(neo4j_session_t *session, neo4j_job_t *job);
  */
 int neo4j_detach_job(neo4j_session_t *session, neo4j_job_t *job);
 
+/**
+ * Report that the request being responded to has reached a trace point.
+ *
+ * @internal
+ *
+ * Must only be invoked from within a response callback, as the request is
+ * taken to be at the head of the queue.
+ *
+ * @param [session] The session.
+ * @param [point] The trace point reached.
+ */
+void neo4j_session_trace_response(neo4j_session_t *session,
+        neo4j_trace_point_t point);
+
 /**
  * Synchronize a session.
  *
@@ -102,6 +134,60 @@ int neo4j_detach_job(neo4j_session_t *session, neo4j_job_t *job);
 __neo4j_must_check
 int neo4j_session_sync(neo4j_session_t *session, const unsigned int *condition);
 
+/**
+ * Synchronize a session, subject to a deadline.
+ *
+ * @internal
+ *
+ * As for neo4j_session_sync(), except that should the deadline expire whilst
+ * awaiting responses, all queued requests are cancelled by sending a RESET
+ * and the call fails with `NEO4J_STATEMENT_TIMEOUT`. The responses to the
+ * cancelled requests are then received in subsequent synchronizations,
+ * leaving the session usable.
+ *
+ * @param [session] The session to synchronize.
+ * @param [condition] The condition to be met, which is indicated by the
+ *         value referenced by the pointer being zero.
+ * @param [deadline] The deadline, on the monotonic clock (in nanoseconds),
+ *         or 0 for no deadline.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_session_sync_until(neo4j_session_t *session,
+        const unsigned int *condition, uint64_t deadline);
+
+/**
+ * Send queued requests in a session, without awaiting any responses.
+ *
+ * @internal
+ *
+ * Requests are sent up to the pipelining limit of the session.
+ *
+ * @param [session] The session to flush.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_session_flush(neo4j_session_t *session);
+
+/**
+ * Ensure there is room in the request queue of a session.
+ *
+ * @internal
+ *
+ * Grows the request queue, up to its maximum size, or synchronizes the
+ * session until enough queued requests have completed, so that `n`
+ * requests can then be queued without further synchronization.
+ *
+ * @param [session] The session.
+ * @param [n] The number of requests to make room for.
+ * @param [deadline] The deadline for any synchronization, on the monotonic
+ *         clock (in nanoseconds), or 0 for no deadline.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_session_reserve(neo4j_session_t *session, unsigned int n,
+        uint64_t deadline);
+
 /**
  * Send a RUN message in a session.
  *
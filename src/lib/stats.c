@@ -0,0 +1,226 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../config.h"
+#include "stats.h"
+#include "util.h"
+#include <errno.h>
+#include <math.h>
+
+#define CONNECTION_PREFIX "neo4j_client_connection_"
+#define SESSION_PREFIX "neo4j_client_session_"
+
+
+static int fprint_counter(FILE *stream, const char *prefix, const char *name,
+        const char *help, unsigned long long value);
+static int fprint_gauge(FILE *stream, const char *prefix, const char *name,
+        const char *help, unsigned long long value);
+static int fprint_latency_histogram(FILE *stream, const char *prefix,
+        const char *name, const char *help,
+        const struct neo4j_latency_histogram *histogram);
+
+
+unsigned long long neo4j_latency_bucket_bound(unsigned int index)
+{
+    if (index < NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return index + 1;
+    }
+    if (index >= NEO4J_LATENCY_HISTOGRAM_BUCKETS)
+    {
+        index = NEO4J_LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+    // bucket 4n+s covers [(4+s) << (n-1), (5+s) << (n-1))
+    unsigned int sub = NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS +
+        (index % NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS);
+    unsigned int shift = (index / NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS) - 1;
+    return (unsigned long long)(sub + 1) << shift;
+}
+
+
+unsigned long long neo4j_latency_percentile(
+        const struct neo4j_latency_histogram *histogram, double percentile)
+{
+    REQUIRE(histogram != NULL, 0);
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+    percentile = (percentile < 0)? 0 : (percentile > 100)? 100 : percentile;
+
+    unsigned long long target =
+        (unsigned long long)ceil(histogram->count * (percentile / 100));
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < NEO4J_LATENCY_HISTOGRAM_BUCKETS - 1; ++i)
+    {
+        total += histogram->buckets[i];
+        if (total >= target)
+        {
+            unsigned long long bound = neo4j_latency_bucket_bound(i);
+            return (bound < histogram->max)? bound : histogram->max;
+        }
+    }
+    // the last bucket also holds all latencies beyond its bound
+    return histogram->max;
+}
+
+
+int neo4j_fprint_connection_stats(FILE *stream,
+        const struct neo4j_connection_stats *stats)
+{
+    REQUIRE(stream != NULL, -1);
+    REQUIRE(stats != NULL, -1);
+
+    if (fprint_counter(stream, CONNECTION_PREFIX, "sent_bytes",
+                "Bytes sent, including chunk headers.",
+                stats->bytes_sent) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "received_bytes",
+                "Bytes received, including chunk headers.",
+                stats->bytes_received) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "sent_messages",
+                "Messages sent.", stats->messages_sent) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "received_messages",
+                "Messages received.", stats->messages_received) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "sent_chunks",
+                "Chunks sent.", stats->chunks_sent) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "received_chunks",
+                "Chunks received.", stats->chunks_received) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "writes",
+                "Write operations on the connection iostream.",
+                stats->writes) ||
+        fprint_counter(stream, CONNECTION_PREFIX, "reads",
+                "Read operations on the connection iostream.",
+                stats->reads))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+int neo4j_fprint_session_stats(FILE *stream,
+        const struct neo4j_session_stats *stats)
+{
+    REQUIRE(stream != NULL, -1);
+    REQUIRE(stats != NULL, -1);
+
+    if (fprint_counter(stream, SESSION_PREFIX, "requests",
+                "Requests completed.", stats->requests) ||
+        fprint_counter(stream, SESSION_PREFIX, "failed_requests",
+                "Requests that failed or were ignored.",
+                stats->failed_requests) ||
+        fprint_counter(stream, SESSION_PREFIX, "mpool_allocations",
+                "Memory pool allocations made for responses.",
+                stats->mpool_allocations) ||
+        fprint_counter(stream, SESSION_PREFIX, "mpool_bytes",
+                "Memory pool bytes allocated for responses.",
+                stats->mpool_bytes) ||
+        fprint_gauge(stream, SESSION_PREFIX, "request_queue_size",
+                "Size of the request queue.",
+                stats->request_queue_size) ||
+        fprint_gauge(stream, SESSION_PREFIX, "request_queue_depth",
+                "Requests held in the request queue.",
+                stats->request_queue_depth) ||
+        fprint_gauge(stream, SESSION_PREFIX, "max_request_queue_depth",
+                "Largest number of requests held in the request queue.",
+                stats->max_request_queue_depth) ||
+        fprint_gauge(stream, SESSION_PREFIX, "inflight_requests",
+                "Requests sent and awaiting responses.",
+                stats->inflight_requests) ||
+        fprint_latency_histogram(stream, SESSION_PREFIX,
+                "request_latency_seconds",
+                "Latency from a request being queued until its final"
+                " response is received.", &(stats->request_latency)))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+int fprint_counter(FILE *stream, const char *prefix, const char *name,
+        const char *help, unsigned long long value)
+{
+    if (fprintf(stream, "# HELP %s%s_total %s\n"
+                "# TYPE %s%s_total counter\n"
+                "%s%s_total %llu\n",
+                prefix, name, help, prefix, name, prefix, name, value) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+int fprint_gauge(FILE *stream, const char *prefix, const char *name,
+        const char *help, unsigned long long value)
+{
+    if (fprintf(stream, "# HELP %s%s %s\n"
+                "# TYPE %s%s gauge\n"
+                "%s%s %llu\n",
+                prefix, name, help, prefix, name, prefix, name, value) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+int fprint_latency_histogram(FILE *stream, const char *prefix,
+        const char *name, const char *help,
+        const struct neo4j_latency_histogram *histogram)
+{
+    if (fprintf(stream, "# HELP %s%s %s\n"
+                "# TYPE %s%s histogram\n",
+                prefix, name, help, prefix, name) < 0)
+    {
+        return -1;
+    }
+
+    // only buckets bounded by a power of two are exposed, to keep the
+    // output compact
+    unsigned long long total = 0;
+    for (unsigned int i = 0; i < NEO4J_LATENCY_HISTOGRAM_BUCKETS - 1; ++i)
+    {
+        total += histogram->buckets[i];
+        unsigned long long bound = neo4j_latency_bucket_bound(i);
+        if ((bound & (bound - 1)) != 0)
+        {
+            continue;
+        }
+        if (fprintf(stream, "%s%s_bucket{le=\"%g\"} %llu\n",
+                    prefix, name, bound / 1e6, total) < 0)
+        {
+            return -1;
+        }
+    }
+
+    if (fprintf(stream, "%s%s_bucket{le=\"+Inf\"} %llu\n"
+                "%s%s_sum %g\n"
+                "%s%s_count %llu\n",
+                prefix, name, histogram->count,
+                prefix, name, histogram->sum / 1e6,
+                prefix, name, histogram->count) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
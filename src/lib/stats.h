@@ -0,0 +1,69 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NEO4J_STATS_H
+#define NEO4J_STATS_H
+
+#include "neo4j-client.h"
+#include <assert.h>
+#include <stdint.h>
+
+static_assert(NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS == 4,
+        "latency bucket indexing assumes 4 sub-buckets");
+
+/**
+ * Get the histogram bucket for a latency.
+ *
+ * @internal
+ *
+ * @param [us] The latency, in microseconds.
+ * @return The index of the bucket.
+ */
+static inline unsigned int neo4j_latency_bucket(uint64_t us)
+{
+    if (us < NEO4J_LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return us;
+    }
+    // the top 3 significant bits select the bucket within each power of 2
+    unsigned int msb = 63 - __builtin_clzll(us);
+    unsigned int index = 4 * (msb - 2) + (unsigned int)(us >> (msb - 2));
+    return (index < NEO4J_LATENCY_HISTOGRAM_BUCKETS)?
+        index : NEO4J_LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Record a latency in a histogram.
+ *
+ * @internal
+ *
+ * @param [histogram] The histogram to record in.
+ * @param [ns] The latency, in nanoseconds.
+ */
+static inline void neo4j_latency_record(
+        struct neo4j_latency_histogram *histogram, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    (histogram->buckets[neo4j_latency_bucket(us)])++;
+    (histogram->count)++;
+    histogram->sum += us;
+    if (us > histogram->max)
+    {
+        histogram->max = us;
+    }
+}
+
+#endif/*NEO4J_STATS_H*/
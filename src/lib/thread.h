@@ -26,6 +26,7 @@ unsigned long neo4j_current_thread_id(void);
 #include <pthread.h>
 
 #define neo4j_mutex_t pthread_mutex_t
+#define NEO4J_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
 #define neo4j_mutex_init(n) pthread_mutex_init((n),NULL)
 #define neo4j_mutex_lock pthread_mutex_lock
 #define neo4j_mutex_unlock pthread_mutex_unlock
@@ -35,6 +36,18 @@ unsigned long neo4j_current_thread_id(void);
 #define NEO4J_ONCE_INIT PTHREAD_ONCE_INIT
 #define neo4j_thread_once(c,r) pthread_once((c),(r))
 
+#define neo4j_cond_t pthread_cond_t
+#define neo4j_cond_init(n) pthread_cond_init((n),NULL)
+#define neo4j_cond_signal pthread_cond_signal
+#define neo4j_cond_broadcast pthread_cond_broadcast
+#define neo4j_cond_wait pthread_cond_wait
+#define neo4j_cond_timedwait pthread_cond_timedwait
+#define neo4j_cond_destroy pthread_cond_destroy
+
+#define neo4j_thread_t pthread_t
+#define neo4j_thread_create(t,f,a) pthread_create((t),NULL,(f),(a))
+#define neo4j_thread_join(t) pthread_join((t),NULL)
+
 #else
 #error "No threading support found"
 #endif
@@ -0,0 +1,637 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../config.h"
+#include "uring.h"
+#include "thread.h"
+#include "util.h"
+#include <assert.h>
+#include <errno.h>
+
+#ifdef HAVE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_ENTRIES 256
+#define URING_SLOTS 256
+
+
+struct neo4j_uring
+{
+    int fd;
+    neo4j_mutex_t lock;
+    neo4j_cond_t cond;
+    // set while a thread is blocked in the kernel awaiting completions
+    bool reaping;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    // the tail including queued entries, and the tail last submitted
+    unsigned int sq_queued_tail;
+    unsigned int sq_submitted_tail;
+
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    struct io_uring_cqe *cqes;
+    unsigned int cq_mask;
+
+    uint8_t *slots;
+    bool fixed_buffers;
+    uint8_t *free_slots[URING_SLOTS];
+    unsigned int nfree_slots;
+};
+
+
+// the shared ring is created on first use, and again after cleanup
+static neo4j_mutex_t shared_lock = NEO4J_MUTEX_INITIALIZER;
+static neo4j_uring_t *shared_ring;
+// the reason the ring could not be created, so setup is not retried
+static int shared_errno;
+
+static neo4j_uring_t *new_uring(void);
+static void free_uring(neo4j_uring_t *ring);
+static struct io_uring_sqe *queue_sqe(neo4j_uring_t *ring);
+static int submit(neo4j_uring_t *ring);
+static void reap(neo4j_uring_t *ring);
+
+
+static inline int io_uring_setup(unsigned int entries,
+        struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+
+static inline int io_uring_enter(int fd, unsigned int to_submit,
+        unsigned int min_complete, unsigned int flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+            flags, NULL, 0);
+}
+
+
+static inline int io_uring_register(int fd, unsigned int opcode,
+        const void *arg, unsigned int nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+int neo4j_uring_cleanup(void)
+{
+    neo4j_mutex_lock(&shared_lock);
+    if (shared_ring != NULL)
+    {
+        free_uring(shared_ring);
+        shared_ring = NULL;
+    }
+    shared_errno = 0;
+    neo4j_mutex_unlock(&shared_lock);
+    return 0;
+}
+
+
+neo4j_uring_t *neo4j_uring_shared(void)
+{
+    neo4j_mutex_lock(&shared_lock);
+    if (shared_ring == NULL && shared_errno == 0)
+    {
+        shared_ring = new_uring();
+        if (shared_ring == NULL)
+        {
+            shared_errno = errno;
+        }
+    }
+    neo4j_uring_t *ring = shared_ring;
+    int errsv = shared_errno;
+    neo4j_mutex_unlock(&shared_lock);
+
+    if (ring == NULL)
+    {
+        errno = errsv;
+    }
+    return ring;
+}
+
+
+neo4j_uring_t *new_uring(void)
+{
+    neo4j_uring_t *ring = calloc(1, sizeof(neo4j_uring_t));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+    ring->fd = -1;
+    ring->sq_ring = MAP_FAILED;
+    ring->cq_ring = MAP_FAILED;
+    ring->sqes = MAP_FAILED;
+    ring->slots = MAP_FAILED;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // kernels without io_uring (or where it is disabled) fail here
+    ring->fd = io_uring_setup(URING_ENTRIES, &params);
+    if (ring->fd < 0)
+    {
+        goto failure;
+    }
+
+    ring->sq_ring_size = params.sq_off.array +
+        params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+    {
+        ring->sq_ring_size = ring->cq_ring_size =
+            maxzu(ring->sq_ring_size, ring->cq_ring_size);
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        goto failure;
+    }
+    if (single_mmap)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            goto failure;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        goto failure;
+    }
+
+    uint8_t *sq = ring->sq_ring;
+    ring->sq_head = (unsigned int *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    ring->sq_array = (unsigned int *)(sq + params.sq_off.array);
+    ring->sq_mask = *(unsigned int *)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned int *)(sq + params.sq_off.ring_entries);
+    ring->sq_queued_tail = ring->sq_submitted_tail = *(ring->sq_tail);
+
+    uint8_t *cq = ring->cq_ring;
+    ring->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->cq_mask = *(unsigned int *)(cq + params.cq_off.ring_mask);
+
+    // each connection holds at most two slots, each with a single operation
+    // in flight, so the completion queue (which is at least as large as the
+    // submission queue) cannot overflow
+    static_assert(URING_SLOTS <= URING_ENTRIES,
+            "completion queue could overflow");
+
+    size_t slots_size = (size_t)URING_SLOTS * NEO4J_URING_SLOT_SIZE;
+    ring->slots = mmap(NULL, slots_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->slots == MAP_FAILED)
+    {
+        goto failure;
+    }
+    // registration pins the memory, and may exceed RLIMIT_MEMLOCK, in which
+    // case plain (unregistered) reads and writes are used
+    struct iovec region = { .iov_base = ring->slots, .iov_len = slots_size };
+    ring->fixed_buffers =
+        (io_uring_register(ring->fd, IORING_REGISTER_BUFFERS, &region, 1) == 0);
+    for (unsigned int i = 0; i < URING_SLOTS; ++i)
+    {
+        ring->free_slots[i] =
+            ring->slots + (size_t)(URING_SLOTS - 1 - i) * NEO4J_URING_SLOT_SIZE;
+    }
+    ring->nfree_slots = URING_SLOTS;
+
+    int err = neo4j_mutex_init(&(ring->lock));
+    if (err)
+    {
+        errno = err;
+        goto failure;
+    }
+    err = neo4j_cond_init(&(ring->cond));
+    if (err)
+    {
+        neo4j_mutex_destroy(&(ring->lock));
+        errno = err;
+        goto failure;
+    }
+    return ring;
+
+    int errsv;
+failure:
+    errsv = errno;
+    if (ring->slots != MAP_FAILED)
+    {
+        munmap(ring->slots, slots_size);
+    }
+    if (ring->sqes != MAP_FAILED)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != MAP_FAILED)
+    {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0)
+    {
+        close(ring->fd);
+    }
+    free(ring);
+    errno = errsv;
+    return NULL;
+}
+
+
+void free_uring(neo4j_uring_t *ring)
+{
+    neo4j_cond_destroy(&(ring->cond));
+    neo4j_mutex_destroy(&(ring->lock));
+    munmap(ring->slots, (size_t)URING_SLOTS * NEO4J_URING_SLOT_SIZE);
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    free(ring);
+}
+
+
+uint8_t *neo4j_uring_alloc_slot(neo4j_uring_t *ring)
+{
+    REQUIRE(ring != NULL, NULL);
+    neo4j_mutex_lock(&(ring->lock));
+    uint8_t *slot = NULL;
+    if (ring->nfree_slots > 0)
+    {
+        slot = ring->free_slots[--(ring->nfree_slots)];
+    }
+    neo4j_mutex_unlock(&(ring->lock));
+    if (slot == NULL)
+    {
+        errno = ENOBUFS;
+    }
+    return slot;
+}
+
+
+void neo4j_uring_free_slot(neo4j_uring_t *ring, uint8_t *slot)
+{
+    assert(slot >= ring->slots && slot <
+            ring->slots + (size_t)URING_SLOTS * NEO4J_URING_SLOT_SIZE);
+    neo4j_mutex_lock(&(ring->lock));
+    assert(ring->nfree_slots < URING_SLOTS);
+    ring->free_slots[(ring->nfree_slots)++] = slot;
+    neo4j_mutex_unlock(&(ring->lock));
+}
+
+
+int neo4j_uring_queue_read(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        int fd, uint8_t *buf, size_t n)
+{
+    REQUIRE(ring != NULL, -1);
+    REQUIRE(op != NULL, -1);
+    REQUIRE(n <= NEO4J_URING_SLOT_SIZE, -1);
+
+    neo4j_mutex_lock(&(ring->lock));
+    struct io_uring_sqe *sqe = queue_sqe(ring);
+    if (sqe == NULL)
+    {
+        int errsv = errno;
+        neo4j_mutex_unlock(&(ring->lock));
+        errno = errsv;
+        return -1;
+    }
+    op->done = false;
+    sqe->fd = fd;
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    if (ring->fixed_buffers)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)buf;
+        sqe->len = n;
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        op->iov.iov_base = buf;
+        op->iov.iov_len = n;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)&(op->iov);
+        sqe->len = 1;
+    }
+    neo4j_mutex_unlock(&(ring->lock));
+    return 0;
+}
+
+
+int neo4j_uring_queue_write(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        int fd, const uint8_t *buf, size_t n)
+{
+    REQUIRE(ring != NULL, -1);
+    REQUIRE(op != NULL, -1);
+    REQUIRE(n <= NEO4J_URING_SLOT_SIZE, -1);
+
+    neo4j_mutex_lock(&(ring->lock));
+    struct io_uring_sqe *sqe = queue_sqe(ring);
+    if (sqe == NULL)
+    {
+        int errsv = errno;
+        neo4j_mutex_unlock(&(ring->lock));
+        errno = errsv;
+        return -1;
+    }
+    op->done = false;
+    sqe->fd = fd;
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    if (ring->fixed_buffers)
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)buf;
+        sqe->len = n;
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        op->iov.iov_base = (void *)(uintptr_t)buf;
+        op->iov.iov_len = n;
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->addr = (uint64_t)(uintptr_t)&(op->iov);
+        sqe->len = 1;
+    }
+    neo4j_mutex_unlock(&(ring->lock));
+    return 0;
+}
+
+
+int neo4j_uring_wait(neo4j_uring_t *ring, struct neo4j_uring_op *op)
+{
+    REQUIRE(ring != NULL, -1);
+    REQUIRE(op != NULL, -1);
+
+    neo4j_mutex_lock(&(ring->lock));
+    int err = 0;
+    while (!op->done)
+    {
+        // submit everything queued (by this or any other connection) in
+        // a single call
+        if (submit(ring))
+        {
+            err = errno;
+            break;
+        }
+        if (ring->reaping)
+        {
+            // another thread is waiting in the kernel, and will pass on
+            // the completion. It alone may consume completions, else it
+            // could be left waiting for one that was already taken.
+            neo4j_cond_wait(&(ring->cond), &(ring->lock));
+            continue;
+        }
+        reap(ring);
+        if (op->done)
+        {
+            break;
+        }
+
+        ring->reaping = true;
+        neo4j_mutex_unlock(&(ring->lock));
+        int result = io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS);
+        int errsv = errno;
+        neo4j_mutex_lock(&(ring->lock));
+        ring->reaping = false;
+        reap(ring);
+        // wake the others, so that one of them takes over waiting
+        neo4j_cond_broadcast(&(ring->cond));
+        if (result < 0 && errsv != EINTR && errsv != EAGAIN)
+        {
+            err = errsv;
+            break;
+        }
+    }
+    neo4j_mutex_unlock(&(ring->lock));
+    if (err)
+    {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+
+int neo4j_uring_cancel(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        struct neo4j_uring_op *cancel_op)
+{
+    REQUIRE(ring != NULL, -1);
+    REQUIRE(op != NULL, -1);
+    REQUIRE(cancel_op != NULL, -1);
+
+    neo4j_mutex_lock(&(ring->lock));
+    if (op->done)
+    {
+        neo4j_mutex_unlock(&(ring->lock));
+        return 0;
+    }
+    struct io_uring_sqe *sqe = queue_sqe(ring);
+    if (sqe == NULL)
+    {
+        int errsv = errno;
+        neo4j_mutex_unlock(&(ring->lock));
+        errno = errsv;
+        return -1;
+    }
+    cancel_op->done = false;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)op;
+    sqe->user_data = (uint64_t)(uintptr_t)cancel_op;
+    neo4j_mutex_unlock(&(ring->lock));
+
+    // whether cancelled or not (as it was already completing), the
+    // operation completes, and then so does the cancellation
+    if (neo4j_uring_wait(ring, op) || neo4j_uring_wait(ring, cancel_op))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ * Get a new submission queue entry, submitting queued entries if the
+ * queue is full. Must be called with the ring locked.
+ */
+struct io_uring_sqe *queue_sqe(neo4j_uring_t *ring)
+{
+    unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_queued_tail - head >= ring->sq_entries)
+    {
+        if (submit(ring))
+        {
+            return NULL;
+        }
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_queued_tail - head >= ring->sq_entries)
+        {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+    unsigned int index = ring->sq_queued_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &(ring->sqes[index]);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[index] = index;
+    ++(ring->sq_queued_tail);
+    return sqe;
+}
+
+
+/*
+ * Submit all queued entries. Must be called with the ring locked.
+ */
+int submit(neo4j_uring_t *ring)
+{
+    __atomic_store_n(ring->sq_tail, ring->sq_queued_tail, __ATOMIC_RELEASE);
+    while (ring->sq_submitted_tail != ring->sq_queued_tail)
+    {
+        unsigned int n = ring->sq_queued_tail - ring->sq_submitted_tail;
+        int result = io_uring_enter(ring->fd, n, 0, 0);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        ring->sq_submitted_tail += result;
+    }
+    return 0;
+}
+
+
+/*
+ * Pass the result of each completion to the operation waiting on it. Must
+ * be called with the ring locked.
+ */
+void reap(neo4j_uring_t *ring)
+{
+    unsigned int head = *(ring->cq_head);
+    unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+    {
+        return;
+    }
+    for (; head != tail; ++head)
+    {
+        struct io_uring_cqe *cqe = &(ring->cqes[head & ring->cq_mask]);
+        struct neo4j_uring_op *op =
+            (struct neo4j_uring_op *)(uintptr_t)cqe->user_data;
+        op->result = cqe->res;
+        op->done = true;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    neo4j_cond_broadcast(&(ring->cond));
+}
+
+
+#else
+
+
+int neo4j_uring_cleanup(void)
+{
+    return 0;
+}
+
+
+neo4j_uring_t *neo4j_uring_shared(void)
+{
+    errno = ENOTSUP;
+    return NULL;
+}
+
+
+uint8_t *neo4j_uring_alloc_slot(neo4j_uring_t *ring)
+{
+    errno = ENOTSUP;
+    return NULL;
+}
+
+
+void neo4j_uring_free_slot(neo4j_uring_t *ring, uint8_t *slot)
+{
+}
+
+
+int neo4j_uring_queue_read(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        int fd, uint8_t *buf, size_t n)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+
+int neo4j_uring_queue_write(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        int fd, const uint8_t *buf, size_t n)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+
+int neo4j_uring_wait(neo4j_uring_t *ring, struct neo4j_uring_op *op)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+
+int neo4j_uring_cancel(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        struct neo4j_uring_op *cancel_op)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+#endif
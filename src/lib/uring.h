@@ -0,0 +1,170 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NEO4J_URING_H
+#define NEO4J_URING_H
+
+#include "neo4j-client.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__linux__)
+#define HAVE_URING 1
+#endif
+
+/*
+ * A process-wide io_uring, shared by all connections that use it.
+ *
+ * Operations from different connections are placed on a single submission
+ * queue, and are submitted together whenever any connection needs to wait
+ * for a result. One waiting thread at a time blocks in the kernel for
+ * completions, and hands each completion to the thread that is waiting on
+ * it.
+ *
+ * The ring also owns a pool of buffer slots, registered with the kernel
+ * where permitted so that I/O into them avoids mapping user pages for
+ * each operation.
+ */
+
+#define NEO4J_URING_SLOT_SIZE 16384
+
+typedef struct neo4j_uring neo4j_uring_t;
+
+struct neo4j_uring_op
+{
+    int result;
+    bool done;
+    // used when buffers could not be registered
+    struct iovec iov;
+};
+
+/**
+ * Release the shared ring, if it was created.
+ *
+ * Should be called before termination, once all iostreams using the ring
+ * have been closed. The ring is created again on next use.
+ *
+ * @internal
+ *
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_uring_cleanup(void);
+
+/**
+ * Get the shared ring, creating it on first use.
+ *
+ * @internal
+ *
+ * @return The ring, or `NULL` if io_uring is not available (errno will be
+ *         set).
+ */
+__neo4j_must_check
+neo4j_uring_t *neo4j_uring_shared(void);
+
+/**
+ * Allocate a buffer slot of `NEO4J_URING_SLOT_SIZE` bytes.
+ *
+ * @internal
+ *
+ * @param [ring] The ring.
+ * @return The slot, or `NULL` if all slots are in use (errno will be set).
+ */
+__neo4j_must_check
+uint8_t *neo4j_uring_alloc_slot(neo4j_uring_t *ring);
+
+/**
+ * Release a buffer slot.
+ *
+ * @internal
+ *
+ * @param [ring] The ring.
+ * @param [slot] The slot.
+ */
+void neo4j_uring_free_slot(neo4j_uring_t *ring, uint8_t *slot);
+
+/**
+ * Queue a read into (part of) a buffer slot.
+ *
+ * The read is not submitted until a thread waits on an operation.
+ *
+ * @internal
+ *
+ * @param [ring] The ring.
+ * @param [op] The operation, which must remain valid until completed.
+ * @param [fd] The file descriptor to read from.
+ * @param [buf] A pointer into a buffer slot.
+ * @param [n] The maximum number of bytes to read.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_uring_queue_read(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        int fd, uint8_t *buf, size_t n);
+
+/**
+ * Queue a write from (part of) a buffer slot.
+ *
+ * The write is not submitted until a thread waits on an operation.
+ *
+ * @internal
+ *
+ * @param [ring] The ring.
+ * @param [op] The operation, which must remain valid until completed.
+ * @param [fd] The file descriptor to write to.
+ * @param [buf] A pointer into a buffer slot.
+ * @param [n] The number of bytes to write.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_uring_queue_write(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        int fd, const uint8_t *buf, size_t n);
+
+/**
+ * Submit all queued operations, and wait for one to complete.
+ *
+ * On return, `op->result` holds the result of the operation, being the
+ * number of bytes transferred or a negated errno value.
+ *
+ * @internal
+ *
+ * @param [ring] The ring.
+ * @param [op] The operation to wait for.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_uring_wait(neo4j_uring_t *ring, struct neo4j_uring_op *op);
+
+/**
+ * Cancel an operation, and wait for it to complete.
+ *
+ * On return, the operation is no longer in flight, and any slot it used
+ * may be released. `op->result` is `-ECANCELED` if it was cancelled, or
+ * the result of the operation if it completed first.
+ *
+ * @internal
+ *
+ * @param [ring] The ring.
+ * @param [op] The operation to cancel.
+ * @param [cancel_op] An operation used for the cancellation, which must
+ *         remain valid until completed.
+ * @return 0 on success, -1 on failure (errno will be set).
+ */
+__neo4j_must_check
+int neo4j_uring_cancel(neo4j_uring_t *ring, struct neo4j_uring_op *op,
+        struct neo4j_uring_op *cancel_op);
+
+#endif/*NEO4J_URING_H*/
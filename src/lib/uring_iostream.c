@@ -0,0 +1,403 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../config.h"
+#include "uring_iostream.h"
+#include "uring.h"
+#include "util.h"
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stddef.h>
+#include <unistd.h>
+
+
+struct uring_iostream
+{
+    struct neo4j_waitable_iostream _waitable;
+    int fd;
+    neo4j_uring_t *ring;
+
+    // bytes read ahead, from rbuf[roff] to rbuf[roff+rlength]
+    uint8_t *rbuf;
+    size_t roff;
+    size_t rlength;
+    bool reading;
+    struct neo4j_uring_op rop;
+
+    // bytes queued for writing, from sbuf[soff] to sbuf[slength]
+    uint8_t *sbuf;
+    size_t soff;
+    size_t slength;
+    bool sending;
+    struct neo4j_uring_op sop;
+
+    // used to cancel operations still in flight at close
+    struct neo4j_uring_op cop;
+};
+
+
+static ssize_t uring_read(neo4j_iostream_t *self, void *buf, size_t nbyte);
+static ssize_t uring_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+static ssize_t uring_write(neo4j_iostream_t *self,
+        const void *buf, size_t nbyte);
+static ssize_t uring_writev(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt);
+static int uring_flush(neo4j_iostream_t *self);
+static int uring_close(neo4j_iostream_t *self);
+static int uring_wait(neo4j_iostream_t *self, unsigned int timeout);
+static int complete_send(struct uring_iostream *ios);
+static size_t copy_read_ahead(struct uring_iostream *ios,
+        const struct iovec *iov, unsigned int iovcnt);
+
+
+neo4j_iostream_t *neo4j_uring_iostream(int fd)
+{
+    REQUIRE(fd >= 0, NULL);
+
+    neo4j_uring_t *ring = neo4j_uring_shared();
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+
+    struct uring_iostream *ios = calloc(1, sizeof(struct uring_iostream));
+    if (ios == NULL)
+    {
+        return NULL;
+    }
+
+    ios->rbuf = neo4j_uring_alloc_slot(ring);
+    if (ios->rbuf == NULL)
+    {
+        goto failure;
+    }
+    ios->sbuf = neo4j_uring_alloc_slot(ring);
+    if (ios->sbuf == NULL)
+    {
+        goto failure;
+    }
+    ios->fd = fd;
+    ios->ring = ring;
+
+    neo4j_iostream_t *iostream = neo4j_waitable_ios_init(&(ios->_waitable),
+            uring_close, uring_wait);
+    iostream->read = uring_read;
+    iostream->readv = uring_readv;
+    iostream->write = uring_write;
+    iostream->writev = uring_writev;
+    iostream->flush = uring_flush;
+    return iostream;
+
+    int errsv;
+failure:
+    errsv = errno;
+    if (ios->rbuf != NULL)
+    {
+        neo4j_uring_free_slot(ring, ios->rbuf);
+    }
+    free(ios);
+    errno = errsv;
+    return NULL;
+}
+
+
+ssize_t uring_read(neo4j_iostream_t *self, void *buf, size_t nbyte)
+{
+    struct iovec iov = { .iov_base = buf, .iov_len = nbyte };
+    return uring_readv(self, &iov, 1);
+}
+
+
+ssize_t uring_readv(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    struct uring_iostream *ios = container_of(self,
+            struct uring_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+
+    size_t nbyte = iovlen(iov, iovcnt);
+    if (nbyte == 0)
+    {
+        return 0;
+    }
+    if (ios->rlength == 0)
+    {
+        // read as much as the slot holds, so following reads are served
+        // from memory
+        for (;;)
+        {
+            if (!ios->reading)
+            {
+                if (neo4j_uring_queue_read(ios->ring, &(ios->rop), ios->fd,
+                            ios->rbuf, NEO4J_URING_SLOT_SIZE))
+                {
+                    return -1;
+                }
+                ios->reading = true;
+            }
+            // on failure, the read is still in flight and is awaited again
+            // by the next call
+            if (neo4j_uring_wait(ios->ring, &(ios->rop)))
+            {
+                return -1;
+            }
+            ios->reading = false;
+            int result = ios->rop.result;
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                continue;
+            }
+            if (result < 0)
+            {
+                errno = -result;
+                return -1;
+            }
+            if (result == 0)
+            {
+                return 0;
+            }
+            ios->roff = 0;
+            ios->rlength = result;
+            break;
+        }
+    }
+
+    size_t n = copy_read_ahead(ios, iov, iovcnt);
+    return (n > SSIZE_MAX)? SSIZE_MAX : (ssize_t)n;
+}
+
+
+ssize_t uring_write(neo4j_iostream_t *self, const void *buf, size_t nbyte)
+{
+    struct iovec iov = { .iov_base = (void *)(uintptr_t)buf,
+        .iov_len = nbyte };
+    return uring_writev(self, &iov, 1);
+}
+
+
+ssize_t uring_writev(neo4j_iostream_t *self,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    struct uring_iostream *ios = container_of(self,
+            struct uring_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    if (ios->sending && complete_send(ios))
+    {
+        return -1;
+    }
+
+    // copy as much as fits in the slot, and queue it without submitting,
+    // so that writes from many connections enter the kernel together
+    size_t n = 0;
+    for (unsigned int i = 0; i < iovcnt && n < NEO4J_URING_SLOT_SIZE; ++i)
+    {
+        size_t len = minzu(iov[i].iov_len, NEO4J_URING_SLOT_SIZE - n);
+        memcpy(ios->sbuf + n, iov[i].iov_base, len);
+        n += len;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    if (neo4j_uring_queue_write(ios->ring, &(ios->sop), ios->fd,
+                ios->sbuf, n))
+    {
+        return -1;
+    }
+    ios->soff = 0;
+    ios->slength = n;
+    ios->sending = true;
+    return n;
+}
+
+
+int uring_flush(neo4j_iostream_t *self)
+{
+    struct uring_iostream *ios = container_of(self,
+            struct uring_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    return ios->sending? complete_send(ios) : 0;
+}
+
+
+int uring_close(neo4j_iostream_t *self)
+{
+    struct uring_iostream *ios = container_of(self,
+            struct uring_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+
+    int err = 0;
+    int errsv = 0;
+    if (ios->sending && complete_send(ios))
+    {
+        err = -1;
+        errsv = errno;
+    }
+
+    // cancel any operation still in flight (after a failed wait), as its
+    // completion refers to the stream and a slot
+    if (ios->reading)
+    {
+        if (neo4j_uring_cancel(ios->ring, &(ios->rop), &(ios->cop)) == 0)
+        {
+            ios->reading = false;
+        }
+        else if (err == 0)
+        {
+            err = -1;
+            errsv = errno;
+        }
+    }
+    if (ios->sending && !ios->reading)
+    {
+        if (neo4j_uring_cancel(ios->ring, &(ios->sop), &(ios->cop)) == 0)
+        {
+            ios->sending = false;
+        }
+        else if (err == 0)
+        {
+            err = -1;
+            errsv = errno;
+        }
+    }
+
+    int fd = ios->fd;
+    ios->fd = -1;
+    // only if the ring itself is failing may an operation remain in
+    // flight, in which case the stream and slots cannot safely be released
+    if (!ios->sending && !ios->reading)
+    {
+        neo4j_uring_free_slot(ios->ring, ios->sbuf);
+        neo4j_uring_free_slot(ios->ring, ios->rbuf);
+        free(ios);
+    }
+    if (close(fd) && err == 0)
+    {
+        return -1;
+    }
+    errno = errsv;
+    return err;
+}
+
+
+int uring_wait(neo4j_iostream_t *self, unsigned int timeout)
+{
+    struct uring_iostream *ios = container_of(self,
+            struct uring_iostream, _waitable._iostream);
+    if (ios->fd < 0)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    if (ios->rlength > 0)
+    {
+        return 0;
+    }
+
+    struct pollfd pfd = { .fd = ios->fd, .events = POLLIN };
+    int result;
+    do
+    {
+        result = poll(&pfd, 1, (timeout > INT_MAX)? INT_MAX : (int)timeout);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0)
+    {
+        return -1;
+    }
+    if (result == 0)
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ * Wait for the queued write to complete, requeuing the remainder after a
+ * short write. On failure, the queued bytes are discarded.
+ */
+int complete_send(struct uring_iostream *ios)
+{
+    assert(ios->sending);
+    while (ios->sending)
+    {
+        if (neo4j_uring_wait(ios->ring, &(ios->sop)))
+        {
+            // the operation is still in flight, and must be awaited again
+            return -1;
+        }
+        int result = ios->sop.result;
+        if (result < 0 && result != -EINTR && result != -EAGAIN)
+        {
+            ios->sending = false;
+            errno = -result;
+            return -1;
+        }
+        if (result > 0)
+        {
+            ios->soff += result;
+        }
+        if (ios->soff >= ios->slength)
+        {
+            ios->sending = false;
+            break;
+        }
+        if (neo4j_uring_queue_write(ios->ring, &(ios->sop), ios->fd,
+                    ios->sbuf + ios->soff, ios->slength - ios->soff))
+        {
+            ios->sending = false;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+size_t copy_read_ahead(struct uring_iostream *ios,
+        const struct iovec *iov, unsigned int iovcnt)
+{
+    size_t n = 0;
+    for (unsigned int i = 0; i < iovcnt && ios->rlength > 0; ++i)
+    {
+        size_t len = minzu(iov[i].iov_len, ios->rlength);
+        memcpy(iov[i].iov_base, ios->rbuf + ios->roff, len);
+        ios->roff += len;
+        ios->rlength -= len;
+        n += len;
+    }
+    return n;
+}
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <sys/uio.h>
 #include <sys/param.h>
+#include <time.h>
 
 
 /**
@@ -574,4 +575,19 @@ int describe_host(char *buf, size_t cap, const char *hostname,
         unsigned int port);
 
 
+/**
+ * Get the current time of the monotonic clock.
+ *
+ * @internal
+ *
+ * @return The time, in nanoseconds.
+ */
+static inline uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+
 #endif/*NEO4J_UTIL_H*/
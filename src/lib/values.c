@@ -32,6 +32,9 @@ static bool int_eq(const neo4j_value_t *value, const neo4j_value_t *other);
 static bool float_eq(const neo4j_value_t *value, const neo4j_value_t *other);
 static bool string_eq(const neo4j_value_t *value, const neo4j_value_t *other);
 static bool list_eq(const neo4j_value_t *value, const neo4j_value_t *other);
+static bool array_eq(const neo4j_value_t *value, const neo4j_value_t *other);
+static bool streamed_eq(const neo4j_value_t *value,
+        const neo4j_value_t *other);
 static bool map_eq(const neo4j_value_t *value, const neo4j_value_t *other);
 static bool struct_eq(const neo4j_value_t *value, const neo4j_value_t *other);
 
@@ -179,6 +182,26 @@ static struct neo4j_value_vt struct_vt =
       .fprint = neo4j_struct_fprint,
       .serialize = neo4j_struct_serialize,
       .eq = struct_eq };
+static struct neo4j_value_vt int_array_vt =
+    { .str = neo4j_array_str,
+      .fprint = neo4j_array_fprint,
+      .serialize = neo4j_int_array_serialize,
+      .eq = array_eq };
+static struct neo4j_value_vt float_array_vt =
+    { .str = neo4j_array_str,
+      .fprint = neo4j_array_fprint,
+      .serialize = neo4j_float_array_serialize,
+      .eq = array_eq };
+static struct neo4j_value_vt streamed_list_vt =
+    { .str = neo4j_streamed_str,
+      .fprint = neo4j_streamed_fprint,
+      .serialize = neo4j_streamed_serialize,
+      .eq = streamed_eq };
+static struct neo4j_value_vt streamed_map_vt =
+    { .str = neo4j_streamed_str,
+      .fprint = neo4j_streamed_fprint,
+      .serialize = neo4j_streamed_serialize,
+      .eq = streamed_eq };
 
 static const struct neo4j_value_vt *neo4j_value_vts[] =
     { &null_vt,
@@ -192,7 +215,11 @@ static const struct neo4j_value_vt *neo4j_value_vts[] =
       &relationship_vt,
       &path_vt,
       &identity_vt,
-      &struct_vt };
+      &struct_vt,
+      &int_array_vt,
+      &float_array_vt,
+      &streamed_list_vt,
+      &streamed_map_vt };
 
 #define NULL_VT_OFF 0
 #define BOOL_VT_OFF 1
@@ -206,6 +233,10 @@ static const struct neo4j_value_vt *neo4j_value_vts[] =
 #define PATH_VT_OFF 9
 #define IDENTITY_VT_OFF 10
 #define STRUCT_VT_OFF 11
+#define INT_ARRAY_VT_OFF 12
+#define FLOAT_ARRAY_VT_OFF 13
+#define STREAMED_LIST_VT_OFF 14
+#define STREAMED_MAP_VT_OFF 15
 #define _MAX_VT_OFF (sizeof(neo4j_value_vts) / sizeof(struct neo4j_value_vt *))
 
 static_assert(
@@ -440,6 +471,11 @@ bool list_eq(const neo4j_value_t *value, const neo4j_value_t *other)
         return false;
     }
 
+    if (o->_vt_off != LIST_VT_OFF)
+    {
+        return neo4j_value_vts[o->_vt_off]->eq(other, value);
+    }
+
     for (unsigned int i = 0; i < v->length; ++i)
     {
         if (!neo4j_eq(v->items[i], o->items[i]))
@@ -467,7 +503,75 @@ neo4j_value_t neo4j_list_get(neo4j_value_t value, unsigned int index)
     {
         return neo4j_null;
     }
-    return list->items[index];
+    switch (list->_vt_off)
+    {
+    case INT_ARRAY_VT_OFF:
+        return neo4j_int(((const struct neo4j_array *)list)->ints[index]);
+    case FLOAT_ARRAY_VT_OFF:
+        return neo4j_float(((const struct neo4j_array *)list)->floats[index]);
+    default:
+        return list->items[index];
+    }
+}
+
+
+// typed arrays
+
+neo4j_value_t neo4j_int64_array(const int64_t *values, unsigned int n)
+{
+#if UINT_MAX != UINT32_MAX
+    if (n > UINT32_MAX)
+    {
+        n = UINT32_MAX;
+    }
+#endif
+    struct neo4j_array v =
+        { ._type = NEO4J_LIST, ._vt_off = INT_ARRAY_VT_OFF,
+          .ints = values, .length = n };
+    return *((neo4j_value_t *)(&v));
+}
+
+
+neo4j_value_t neo4j_float64_array(const double *values, unsigned int n)
+{
+#if UINT_MAX != UINT32_MAX
+    if (n > UINT32_MAX)
+    {
+        n = UINT32_MAX;
+    }
+#endif
+    struct neo4j_array v =
+        { ._type = NEO4J_LIST, ._vt_off = FLOAT_ARRAY_VT_OFF,
+          .floats = values, .length = n };
+    return *((neo4j_value_t *)(&v));
+}
+
+
+bool array_eq(const neo4j_value_t *value, const neo4j_value_t *other)
+{
+    const struct neo4j_array *v = (const struct neo4j_array *)value;
+    const struct neo4j_array *o = (const struct neo4j_array *)other;
+
+    if (v->length != o->length)
+    {
+        return false;
+    }
+
+    if (v->_vt_off == INT_ARRAY_VT_OFF && o->_vt_off == INT_ARRAY_VT_OFF)
+    {
+        return v->length == 0 || v->ints == o->ints ||
+            memcmp(v->ints, o->ints, v->length * sizeof(int64_t)) == 0;
+    }
+
+    for (unsigned int i = 0; i < v->length; ++i)
+    {
+        if (!neo4j_eq(neo4j_list_get(*value, i), neo4j_list_get(*other, i)))
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 
@@ -502,6 +606,11 @@ bool map_eq(const neo4j_value_t *value, const neo4j_value_t *other)
     const struct neo4j_map *v = (const struct neo4j_map *)value;
     const struct neo4j_map *o = (const struct neo4j_map *)other;
 
+    if (o->_vt_off != MAP_VT_OFF)
+    {
+        return neo4j_value_vts[o->_vt_off]->eq(other, value);
+    }
+
     if (v->nentries != o->nentries)
     {
         return false;
@@ -573,6 +682,34 @@ neo4j_map_entry_t neo4j_map_kentry(neo4j_value_t key, neo4j_value_t value)
 }
 
 
+// streamed values
+
+neo4j_value_t neo4j_streamed_list(struct neo4j_value_producer *producer)
+{
+    struct neo4j_streamed v =
+        { ._type = NEO4J_LIST, ._vt_off = STREAMED_LIST_VT_OFF,
+          .producer = producer, .length = 0 };
+    return *((neo4j_value_t *)(&v));
+}
+
+
+neo4j_value_t neo4j_streamed_map(struct neo4j_value_producer *producer)
+{
+    struct neo4j_streamed v =
+        { ._type = NEO4J_MAP, ._vt_off = STREAMED_MAP_VT_OFF,
+          .producer = producer, .length = 0 };
+    return *((neo4j_value_t *)(&v));
+}
+
+
+bool streamed_eq(const neo4j_value_t *value, const neo4j_value_t *other)
+{
+    const struct neo4j_streamed *v = (const struct neo4j_streamed *)value;
+    const struct neo4j_streamed *o = (const struct neo4j_streamed *)other;
+    return v->_vt_off == o->_vt_off && v->producer == o->producer;
+}
+
+
 // node
 
 neo4j_value_t neo4j_node(const neo4j_value_t fields[3])
@@ -105,6 +105,35 @@ struct neo4j_list
 ASSERT_VALUE_ALIGNMENT(struct neo4j_list);
 
 
+struct neo4j_array
+{
+    uint8_t _vt_off;
+    uint8_t _type;
+    uint16_t _pad1;
+    uint32_t length;
+    union {
+        const int64_t *ints;
+        const double *floats;
+        union _neo4j_value_data _pad2;
+    };
+};
+ASSERT_VALUE_ALIGNMENT(struct neo4j_array);
+
+
+struct neo4j_streamed
+{
+    uint8_t _vt_off;
+    uint8_t _type;
+    uint16_t _pad1;
+    uint32_t length; // always 0, as the content is not available
+    union {
+        struct neo4j_value_producer *producer;
+        union _neo4j_value_data _pad2;
+    };
+};
+ASSERT_VALUE_ALIGNMENT(struct neo4j_streamed);
+
+
 struct neo4j_map
 {
     uint8_t _vt_off;
@@ -0,0 +1,1019 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "bolt_server.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MESSAGE_INIT 0x01
+#define MESSAGE_ACK_FAILURE 0x0E
+#define MESSAGE_RESET 0x0F
+#define MESSAGE_RUN 0x10
+#define MESSAGE_DISCARD_ALL 0x2F
+#define MESSAGE_PULL_ALL 0x3F
+#define MESSAGE_SUCCESS 0x70
+#define MESSAGE_RECORD 0x71
+#define MESSAGE_IGNORED 0x7E
+#define MESSAGE_FAILURE 0x7F
+
+#define NODE_SIGNATURE 0x4E
+
+#define MAX_CHUNK_SIZE 65535
+#define OUTPUT_BUFFER_SIZE 65536
+#define INPUT_BUFFER_SIZE 16384
+
+#define SERVER_AGENT "Neo4j/3.0.0"
+
+// a client disconnecting must not raise SIGPIPE in the host process
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+
+enum column_type
+{
+    TYPE_NULL,
+    TYPE_BOOL,
+    TYPE_INT,
+    TYPE_FLOAT,
+    TYPE_STRING,
+    TYPE_LIST,
+    TYPE_MAP,
+    TYPE_NODE
+};
+
+static const char *column_type_names[] =
+    { "null", "bool", "int", "float", "string", "list", "map", "node" };
+
+
+struct bolt_server_column
+{
+    char *name;
+    enum column_type type;
+};
+
+
+struct buffer
+{
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+};
+
+
+struct bolt_server_connection
+{
+    struct bolt_server *server;
+    int fd;
+    struct bolt_server_connection *next;
+
+    uint8_t input[INPUT_BUFFER_SIZE];
+    size_t input_offset;
+    size_t input_length;
+
+    // the message received, the message being sent, and the chunked
+    // messages awaiting a write
+    struct buffer in;
+    struct buffer msg;
+    struct buffer out;
+
+    bool failed;
+    const struct bolt_server_entry *pending;
+};
+
+
+static const struct bolt_server_result default_result =
+    { .statement = NULL, .columns = "n:int", .nrows = 1 };
+static const struct bolt_server_script default_script =
+    { .results = &default_result, .nresults = 1 };
+
+
+static int start(struct bolt_server *server, int fd,
+        const struct sockaddr *addr, socklen_t addrlen,
+        const struct bolt_server_script *script);
+static int load_script(struct bolt_server *server,
+        const struct bolt_server_script *script);
+static int load_entry(struct bolt_server_entry *entry,
+        const struct bolt_server_result *result);
+static int parse_columns(struct bolt_server_entry *entry, const char *spec);
+static void free_script(struct bolt_server *server);
+static void *serve(void *data);
+static void *serve_connection(void *data);
+static int handle_message(struct bolt_server_connection *conn);
+static int handle_run(struct bolt_server_connection *conn);
+static int stream_records(struct bolt_server_connection *conn,
+        const struct bolt_server_entry *entry);
+static int send_success(struct bolt_server_connection *conn,
+        const char *key, const char *value);
+static int send_failure(struct bolt_server_connection *conn,
+        const char *code, const char *message);
+static int send_ignored(struct bolt_server_connection *conn);
+static int send_message(struct bolt_server_connection *conn);
+static int flush_output(struct bolt_server_connection *conn);
+static int read_message(struct bolt_server_connection *conn);
+static int read_input(struct bolt_server_connection *conn, void *buf,
+        size_t n);
+static int unpack_string(const uint8_t *data, size_t length,
+        const char **s, size_t *n);
+static int pack_value(struct buffer *b, enum column_type type,
+        unsigned long long row);
+static int pack_int(struct buffer *b, int64_t value);
+static int pack_float(struct buffer *b, double value);
+static int pack_string(struct buffer *b, const char *s, size_t n);
+static int pack_cstring(struct buffer *b, const char *s);
+static int pack_header(struct buffer *b, uint8_t tiny, uint8_t marker8,
+        size_t n);
+static int pack_struct_header(struct buffer *b, unsigned int n,
+        uint8_t signature);
+static int put_be(struct buffer *b, uint64_t value, unsigned int nbytes);
+static int put_byte(struct buffer *b, uint8_t byte);
+static int put(struct buffer *b, const void *data, size_t n);
+static int write_all(int fd, const void *buf, size_t n);
+
+
+int bolt_server_start_tcp(struct bolt_server *server, int port,
+        const struct bolt_server_script *script)
+{
+    memset(server, 0, sizeof(struct bolt_server));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int option = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (start(server, fd, (struct sockaddr *)&addr, sizeof(addr), script))
+    {
+        return -1;
+    }
+
+    socklen_t addrlen = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr *)&addr, &addrlen) == 0)
+    {
+        server->port = ntohs(addr.sin_port);
+    }
+    return 0;
+}
+
+
+int bolt_server_start_unix(struct bolt_server *server, const char *path,
+        const struct bolt_server_script *script)
+{
+    memset(server, 0, sizeof(struct bolt_server));
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    strcpy(server->path, path);
+    return start(server, fd, (struct sockaddr *)&addr, sizeof(addr), script);
+}
+
+
+int start(struct bolt_server *server, int fd, const struct sockaddr *addr,
+        socklen_t addrlen, const struct bolt_server_script *script)
+{
+    server->fd = fd;
+    bool locks = false;
+    if (load_script(server, (script != NULL)? script : &default_script))
+    {
+        goto failure;
+    }
+    int err = pthread_mutex_init(&(server->lock), NULL);
+    if (err == 0 && (err = pthread_cond_init(&(server->cond), NULL)) != 0)
+    {
+        pthread_mutex_destroy(&(server->lock));
+    }
+    if (err)
+    {
+        errno = err;
+        goto failure;
+    }
+    locks = true;
+
+    if (bind(fd, addr, addrlen) || listen(fd, 128))
+    {
+        goto failure;
+    }
+
+    err = pthread_create(&(server->thread), NULL, serve, server);
+    if (err)
+    {
+        errno = err;
+        goto failure;
+    }
+    return 0;
+
+    int errsv;
+failure:
+    errsv = errno;
+    close(fd);
+    if (server->path[0] != '\0')
+    {
+        unlink(server->path);
+    }
+    if (locks)
+    {
+        pthread_cond_destroy(&(server->cond));
+        pthread_mutex_destroy(&(server->lock));
+    }
+    free_script(server);
+    errno = errsv;
+    return -1;
+}
+
+
+void bolt_server_stop(struct bolt_server *server)
+{
+    shutdown(server->fd, SHUT_RDWR);
+    pthread_join(server->thread, NULL);
+    close(server->fd);
+
+    // each connection thread removes itself once its socket is shut down
+    pthread_mutex_lock(&(server->lock));
+    for (struct bolt_server_connection *conn = server->connections;
+            conn != NULL; conn = conn->next)
+    {
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+    while (server->connections != NULL)
+    {
+        pthread_cond_wait(&(server->cond), &(server->lock));
+    }
+    pthread_mutex_unlock(&(server->lock));
+
+    pthread_cond_destroy(&(server->cond));
+    pthread_mutex_destroy(&(server->lock));
+    free_script(server);
+    if (server->path[0] != '\0')
+    {
+        unlink(server->path);
+    }
+}
+
+
+int load_script(struct bolt_server *server,
+        const struct bolt_server_script *script)
+{
+    server->entries = calloc(script->nresults,
+            sizeof(struct bolt_server_entry));
+    if (server->entries == NULL && script->nresults > 0)
+    {
+        return -1;
+    }
+    server->nentries = script->nresults;
+    for (unsigned int i = 0; i < script->nresults; ++i)
+    {
+        if (load_entry(&(server->entries[i]), &(script->results[i])))
+        {
+            return -1;
+        }
+    }
+    if (script->init_failure != NULL)
+    {
+        server->init_failure = strdup(script->init_failure);
+        if (server->init_failure == NULL)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+int load_entry(struct bolt_server_entry *entry,
+        const struct bolt_server_result *result)
+{
+    entry->nrows = result->nrows;
+    if (result->statement != NULL &&
+            (entry->statement = strdup(result->statement)) == NULL)
+    {
+        return -1;
+    }
+    if (result->failure != NULL)
+    {
+        entry->failure = strdup(result->failure);
+        return (entry->failure == NULL)? -1 : 0;
+    }
+    if (parse_columns(entry, (result->columns != NULL)? result->columns : ""))
+    {
+        return -1;
+    }
+
+    // the response to RUN is the same every time
+    struct buffer b = { .data = NULL, .length = 0, .capacity = 0 };
+    if (pack_struct_header(&b, 1, MESSAGE_SUCCESS) ||
+            pack_header(&b, 0xA0, 0xD8, 1) ||
+            pack_cstring(&b, "fields") ||
+            pack_header(&b, 0x90, 0xD4, entry->ncolumns))
+    {
+        free(b.data);
+        return -1;
+    }
+    for (unsigned int i = 0; i < entry->ncolumns; ++i)
+    {
+        if (pack_cstring(&b, entry->columns[i].name))
+        {
+            free(b.data);
+            return -1;
+        }
+    }
+    entry->run_success = b.data;
+    entry->run_success_length = b.length;
+    return 0;
+}
+
+
+int parse_columns(struct bolt_server_entry *entry, const char *spec)
+{
+    unsigned int n = (*spec != '\0')? 1 : 0;
+    for (const char *c = spec; *c != '\0'; ++c)
+    {
+        n += (*c == ',')? 1 : 0;
+    }
+    entry->columns = calloc(n, sizeof(struct bolt_server_column));
+    if (entry->columns == NULL && n > 0)
+    {
+        return -1;
+    }
+
+    const char *s = spec;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        size_t len = strcspn(s, ",");
+        const char *colon = memchr(s, ':', len);
+        if (colon == NULL || colon == s)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        const char *type = colon + 1;
+        size_t type_len = len - (type - s);
+
+        struct bolt_server_column *column = &(entry->columns[i]);
+        column->name = strndup(s, colon - s);
+        if (column->name == NULL)
+        {
+            return -1;
+        }
+        entry->ncolumns = i + 1;
+
+        unsigned int t = 0;
+        for (; t <= TYPE_NODE; ++t)
+        {
+            if (strlen(column_type_names[t]) == type_len &&
+                    strncmp(column_type_names[t], type, type_len) == 0)
+            {
+                break;
+            }
+        }
+        if (t > TYPE_NODE)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        column->type = (enum column_type)t;
+        s += len + 1;
+    }
+    return 0;
+}
+
+
+void free_script(struct bolt_server *server)
+{
+    for (unsigned int i = 0; i < server->nentries; ++i)
+    {
+        struct bolt_server_entry *entry = &(server->entries[i]);
+        for (unsigned int j = 0; j < entry->ncolumns; ++j)
+        {
+            free(entry->columns[j].name);
+        }
+        free(entry->columns);
+        free(entry->run_success);
+        free(entry->failure);
+        free(entry->statement);
+    }
+    free(server->entries);
+    free(server->init_failure);
+    server->entries = NULL;
+    server->nentries = 0;
+    server->init_failure = NULL;
+}
+
+
+void *serve(void *data)
+{
+    struct bolt_server *server = (struct bolt_server *)data;
+    for (;;)
+    {
+        int fd = accept(server->fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            return NULL;
+        }
+        if (server->path[0] == '\0')
+        {
+            int option = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+        }
+
+        struct bolt_server_connection *conn =
+            calloc(1, sizeof(struct bolt_server_connection));
+        if (conn == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        conn->server = server;
+        conn->fd = fd;
+
+        pthread_mutex_lock(&(server->lock));
+        conn->next = server->connections;
+        server->connections = conn;
+        pthread_mutex_unlock(&(server->lock));
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve_connection, conn) == 0)
+        {
+            pthread_detach(thread);
+            continue;
+        }
+
+        pthread_mutex_lock(&(server->lock));
+        server->connections = conn->next;
+        pthread_mutex_unlock(&(server->lock));
+        close(fd);
+        free(conn);
+    }
+}
+
+
+void *serve_connection(void *data)
+{
+    struct bolt_server_connection *conn =
+        (struct bolt_server_connection *)data;
+
+    uint8_t handshake[20];
+    static const uint8_t magic[4] = { 0x60, 0x60, 0xB0, 0x17 };
+    uint32_t version = htonl(1);
+    if (read_input(conn, handshake, sizeof(handshake)) == 0 &&
+            memcmp(handshake, magic, sizeof(magic)) == 0 &&
+            write_all(conn->fd, &version, sizeof(version)) == 0)
+    {
+        while (read_message(conn) == 0 && handle_message(conn) == 0)
+            ;
+    }
+
+    // the socket stays open until the connection is unlinked, so that
+    // stopping the server can shut it down
+    struct bolt_server *server = conn->server;
+    pthread_mutex_lock(&(server->lock));
+    struct bolt_server_connection **prev = &(server->connections);
+    while (*prev != conn)
+    {
+        prev = &((*prev)->next);
+    }
+    *prev = conn->next;
+    pthread_cond_broadcast(&(server->cond));
+    pthread_mutex_unlock(&(server->lock));
+
+    close(conn->fd);
+    free(conn->in.data);
+    free(conn->msg.data);
+    free(conn->out.data);
+    free(conn);
+    return NULL;
+}
+
+
+int handle_message(struct bolt_server_connection *conn)
+{
+    const uint8_t *data = conn->in.data;
+    if (conn->in.length < 2 || (data[0] & 0xF0) != 0xB0)
+    {
+        return -1;
+    }
+
+    int result;
+    uint8_t signature = data[1];
+    if (conn->failed && signature != MESSAGE_ACK_FAILURE &&
+            signature != MESSAGE_RESET)
+    {
+        result = send_ignored(conn);
+    }
+    else
+    {
+        switch (signature)
+        {
+        case MESSAGE_INIT:
+            if (conn->server->init_failure != NULL)
+            {
+                conn->failed = true;
+                result = send_failure(conn, conn->server->init_failure,
+                        "The client is unauthorized");
+                break;
+            }
+            result = send_success(conn, "server", SERVER_AGENT);
+            break;
+        case MESSAGE_RUN:
+            result = handle_run(conn);
+            break;
+        case MESSAGE_PULL_ALL:
+            result = (conn->pending != NULL)?
+                stream_records(conn, conn->pending) : 0;
+            conn->pending = NULL;
+            if (result == 0)
+            {
+                result = send_success(conn, "type", "r");
+            }
+            break;
+        case MESSAGE_DISCARD_ALL:
+            conn->pending = NULL;
+            result = send_success(conn, "type", "r");
+            break;
+        case MESSAGE_ACK_FAILURE:
+        case MESSAGE_RESET:
+            conn->failed = false;
+            conn->pending = NULL;
+            result = send_success(conn, NULL, NULL);
+            break;
+        default:
+            conn->failed = true;
+            result = send_failure(conn, "Neo.ClientError.Request.Invalid",
+                    "Unknown message");
+            break;
+        }
+    }
+    return (result == 0)? flush_output(conn) : -1;
+}
+
+
+int handle_run(struct bolt_server_connection *conn)
+{
+    const char *statement;
+    size_t n;
+    if (unpack_string(conn->in.data + 2, conn->in.length - 2,
+                &statement, &n))
+    {
+        return -1;
+    }
+
+    const struct bolt_server *server = conn->server;
+    const struct bolt_server_entry *entry = NULL;
+    for (unsigned int i = 0; i < server->nentries && entry == NULL; ++i)
+    {
+        const char *s = server->entries[i].statement;
+        if (s == NULL || (strlen(s) == n && memcmp(s, statement, n) == 0))
+        {
+            entry = &(server->entries[i]);
+        }
+    }
+
+    if (entry == NULL)
+    {
+        conn->failed = true;
+        return send_failure(conn, "Neo.ClientError.Statement.SyntaxError",
+                "The statement is not in the script");
+    }
+    if (entry->failure != NULL)
+    {
+        conn->failed = true;
+        return send_failure(conn, entry->failure, "Scripted failure");
+    }
+
+    conn->pending = entry;
+    return put(&(conn->msg), entry->run_success, entry->run_success_length) ||
+        send_message(conn);
+}
+
+
+int stream_records(struct bolt_server_connection *conn,
+        const struct bolt_server_entry *entry)
+{
+    struct buffer *b = &(conn->msg);
+    for (unsigned long long row = 1; row <= entry->nrows; ++row)
+    {
+        if (pack_struct_header(b, 1, MESSAGE_RECORD) ||
+                pack_header(b, 0x90, 0xD4, entry->ncolumns))
+        {
+            return -1;
+        }
+        for (unsigned int i = 0; i < entry->ncolumns; ++i)
+        {
+            if (pack_value(b, entry->columns[i].type, row))
+            {
+                return -1;
+            }
+        }
+        if (send_message(conn))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+int send_success(struct bolt_server_connection *conn, const char *key,
+        const char *value)
+{
+    struct buffer *b = &(conn->msg);
+    if (pack_struct_header(b, 1, MESSAGE_SUCCESS) ||
+            pack_header(b, 0xA0, 0xD8, (key != NULL)? 1 : 0))
+    {
+        return -1;
+    }
+    if (key != NULL && (pack_cstring(b, key) || pack_cstring(b, value)))
+    {
+        return -1;
+    }
+    return send_message(conn);
+}
+
+
+int send_failure(struct bolt_server_connection *conn, const char *code,
+        const char *message)
+{
+    struct buffer *b = &(conn->msg);
+    if (pack_struct_header(b, 1, MESSAGE_FAILURE) ||
+            pack_header(b, 0xA0, 0xD8, 2) ||
+            pack_cstring(b, "code") || pack_cstring(b, code) ||
+            pack_cstring(b, "message") || pack_cstring(b, message))
+    {
+        return -1;
+    }
+    return send_message(conn);
+}
+
+
+int send_ignored(struct bolt_server_connection *conn)
+{
+    return pack_struct_header(&(conn->msg), 0, MESSAGE_IGNORED) ||
+        send_message(conn);
+}
+
+
+/*
+ * Append the encoded message to the output, as chunks followed by an end
+ * marker, and write the output once it is large enough.
+ */
+int send_message(struct bolt_server_connection *conn)
+{
+    const uint8_t *data = conn->msg.data;
+    size_t n = conn->msg.length;
+    while (n > 0)
+    {
+        size_t length = (n < MAX_CHUNK_SIZE)? n : MAX_CHUNK_SIZE;
+        if (put_be(&(conn->out), length, 2) ||
+                put(&(conn->out), data, length))
+        {
+            return -1;
+        }
+        data += length;
+        n -= length;
+    }
+    conn->msg.length = 0;
+    if (put_be(&(conn->out), 0, 2))
+    {
+        return -1;
+    }
+    return (conn->out.length >= OUTPUT_BUFFER_SIZE)? flush_output(conn) : 0;
+}
+
+
+int flush_output(struct bolt_server_connection *conn)
+{
+    if (write_all(conn->fd, conn->out.data, conn->out.length))
+    {
+        return -1;
+    }
+    conn->out.length = 0;
+    return 0;
+}
+
+
+/*
+ * Read a chunked message, reassembling it in `conn->in`.
+ */
+int read_message(struct bolt_server_connection *conn)
+{
+    conn->in.length = 0;
+    for (;;)
+    {
+        uint8_t header[2];
+        if (read_input(conn, header, sizeof(header)))
+        {
+            return -1;
+        }
+        size_t length = ((size_t)header[0] << 8) | header[1];
+        if (length == 0)
+        {
+            if (conn->in.length == 0)
+            {
+                // an empty message is not valid
+                return -1;
+            }
+            return 0;
+        }
+        if (put(&(conn->in), NULL, length) ||
+                read_input(conn, conn->in.data + conn->in.length - length,
+                    length))
+        {
+            return -1;
+        }
+    }
+}
+
+
+int read_input(struct bolt_server_connection *conn, void *buf, size_t n)
+{
+    uint8_t *p = buf;
+    while (n > 0)
+    {
+        if (conn->input_length == 0)
+        {
+            ssize_t result = read(conn->fd, conn->input, sizeof(conn->input));
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                return -1;
+            }
+            conn->input_offset = 0;
+            conn->input_length = result;
+        }
+        size_t length = (n < conn->input_length)? n : conn->input_length;
+        memcpy(p, conn->input + conn->input_offset, length);
+        conn->input_offset += length;
+        conn->input_length -= length;
+        p += length;
+        n -= length;
+    }
+    return 0;
+}
+
+
+int unpack_string(const uint8_t *data, size_t length,
+        const char **s, size_t *n)
+{
+    if (length < 1)
+    {
+        return -1;
+    }
+    uint8_t marker = data[0];
+    size_t header = 1;
+    size_t size;
+    if ((marker & 0xF0) == 0x80)
+    {
+        size = marker & 0x0F;
+    }
+    else if (marker >= 0xD0 && marker <= 0xD2)
+    {
+        unsigned int nbytes = 1u << (marker - 0xD0);
+        if (length < 1 + nbytes)
+        {
+            return -1;
+        }
+        size = 0;
+        for (unsigned int i = 0; i < nbytes; ++i)
+        {
+            size = (size << 8) | data[1 + i];
+        }
+        header += nbytes;
+    }
+    else
+    {
+        return -1;
+    }
+    if (length - header < size)
+    {
+        return -1;
+    }
+    *s = (const char *)(data + header);
+    *n = size;
+    return 0;
+}
+
+
+int pack_value(struct buffer *b, enum column_type type,
+        unsigned long long row)
+{
+    char str[32];
+    int n;
+    switch (type)
+    {
+    case TYPE_NULL:
+        return put_byte(b, 0xC0);
+    case TYPE_BOOL:
+        return put_byte(b, (row & 1)? 0xC3 : 0xC2);
+    case TYPE_INT:
+        return pack_int(b, (int64_t)row);
+    case TYPE_FLOAT:
+        return pack_float(b, (double)row / 2);
+    case TYPE_STRING:
+        n = snprintf(str, sizeof(str), "row-%llu", row);
+        return pack_string(b, str, n);
+    case TYPE_LIST:
+        return pack_header(b, 0x90, 0xD4, 3) ||
+            pack_int(b, (int64_t)row) ||
+            pack_int(b, (int64_t)row + 1) ||
+            pack_int(b, (int64_t)row + 2);
+    case TYPE_MAP:
+        n = snprintf(str, sizeof(str), "row-%llu", row);
+        return pack_header(b, 0xA0, 0xD8, 2) ||
+            pack_cstring(b, "id") || pack_int(b, (int64_t)row) ||
+            pack_cstring(b, "name") || pack_string(b, str, n);
+    case TYPE_NODE:
+        return pack_struct_header(b, 3, NODE_SIGNATURE) ||
+            pack_int(b, (int64_t)row) ||
+            pack_header(b, 0x90, 0xD4, 1) || pack_cstring(b, "Row") ||
+            pack_header(b, 0xA0, 0xD8, 1) ||
+            pack_cstring(b, "id") || pack_int(b, (int64_t)row);
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+
+int pack_int(struct buffer *b, int64_t value)
+{
+    if (value >= -16 && value < 128)
+    {
+        return put_byte(b, (uint8_t)value);
+    }
+    if (value >= INT8_MIN && value <= INT8_MAX)
+    {
+        return put_byte(b, 0xC8) || put_be(b, (uint64_t)value, 1);
+    }
+    if (value >= INT16_MIN && value <= INT16_MAX)
+    {
+        return put_byte(b, 0xC9) || put_be(b, (uint64_t)value, 2);
+    }
+    if (value >= INT32_MIN && value <= INT32_MAX)
+    {
+        return put_byte(b, 0xCA) || put_be(b, (uint64_t)value, 4);
+    }
+    return put_byte(b, 0xCB) || put_be(b, (uint64_t)value, 8);
+}
+
+
+int pack_float(struct buffer *b, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return put_byte(b, 0xC1) || put_be(b, bits, 8);
+}
+
+
+int pack_string(struct buffer *b, const char *s, size_t n)
+{
+    return pack_header(b, 0x80, 0xD0, n) || put(b, s, n);
+}
+
+
+int pack_cstring(struct buffer *b, const char *s)
+{
+    return pack_string(b, s, strlen(s));
+}
+
+
+/*
+ * Pack the header for a string, list or map, given the marker for the
+ * tiny form and the marker for the 8-bit size form (the 16 and 32-bit
+ * forms follow it).
+ */
+int pack_header(struct buffer *b, uint8_t tiny, uint8_t marker8, size_t n)
+{
+    if (n < 16)
+    {
+        return put_byte(b, tiny | (uint8_t)n);
+    }
+    if (n <= UINT8_MAX)
+    {
+        return put_byte(b, marker8) || put_be(b, n, 1);
+    }
+    if (n <= UINT16_MAX)
+    {
+        return put_byte(b, marker8 + 1) || put_be(b, n, 2);
+    }
+    return put_byte(b, marker8 + 2) || put_be(b, n, 4);
+}
+
+
+int pack_struct_header(struct buffer *b, unsigned int n, uint8_t signature)
+{
+    return put_byte(b, 0xB0 | (uint8_t)n) || put_byte(b, signature);
+}
+
+
+int put_be(struct buffer *b, uint64_t value, unsigned int nbytes)
+{
+    uint8_t bytes[8];
+    for (unsigned int i = 0; i < nbytes; ++i)
+    {
+        bytes[i] = (uint8_t)(value >> (8 * (nbytes - 1 - i)));
+    }
+    return put(b, bytes, nbytes);
+}
+
+
+int put_byte(struct buffer *b, uint8_t byte)
+{
+    return put(b, &byte, 1);
+}
+
+
+/*
+ * Append bytes to a buffer, or just extend it if `data` is NULL.
+ */
+int put(struct buffer *b, const void *data, size_t n)
+{
+    if (b->length + n > b->capacity)
+    {
+        size_t capacity = (b->capacity > 0)? b->capacity * 2 : 1024;
+        while (capacity < b->length + n)
+        {
+            capacity *= 2;
+        }
+        uint8_t *d = realloc(b->data, capacity);
+        if (d == NULL)
+        {
+            return -1;
+        }
+        b->data = d;
+        b->capacity = capacity;
+    }
+    if (data != NULL)
+    {
+        memcpy(b->data + b->length, data, n);
+    }
+    b->length += n;
+    return 0;
+}
+
+
+int write_all(int fd, const void *buf, size_t n)
+{
+    const uint8_t *p = buf;
+    while (n > 0)
+    {
+        ssize_t result = send(fd, p, n, SEND_FLAGS);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result < 0)
+        {
+            return -1;
+        }
+        p += result;
+        n -= result;
+    }
+    return 0;
+}
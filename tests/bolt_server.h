@@ -0,0 +1,130 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NEO4J_BENCH_BOLT_SERVER_H
+#define NEO4J_BENCH_BOLT_SERVER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/un.h>
+
+/*
+ * A local Bolt v1 stand-in server, accepting connections on a loopback
+ * port or a unix domain socket and serving each in its own thread.
+ *
+ * Responses are scripted: each statement run is looked up in the script,
+ * and either fails with a given status code or streams a synthetic result
+ * of the given columns and number of rows. Values are generated as the
+ * records are sent, so results of millions of rows cost no memory.
+ */
+
+/**
+ * A scripted result.
+ *
+ * The columns are a comma separated list of `name:type` pairs, where type
+ * is one of `null`, `bool`, `int`, `float`, `string`, `list`, `map` or
+ * `node`. Values are derived from the row number, counting from 1: an int
+ * column holds the row number, a float column half of it, a string column
+ * `row-<n>`, a list `[n, n+1, n+2]`, a map `{id: n, name: "row-<n>"}`, and
+ * a node has identity n, the label `Row` and the property `id: n`. Bool
+ * columns are true for odd rows.
+ */
+struct bolt_server_result
+{
+    // the statement this result is for, or NULL for any statement
+    const char *statement;
+    const char *columns;
+    unsigned long long nrows;
+    // if non-NULL, running the statement fails with this status code
+    const char *failure;
+};
+
+struct bolt_server_script
+{
+    // results are matched in order, so a catch-all should come last
+    const struct bolt_server_result *results;
+    unsigned int nresults;
+    // if non-NULL, INIT fails with this status code
+    const char *init_failure;
+};
+
+struct bolt_server_column;
+struct bolt_server_connection;
+
+struct bolt_server_entry
+{
+    char *statement;
+    char *failure;
+    unsigned long long nrows;
+    struct bolt_server_column *columns;
+    unsigned int ncolumns;
+    // the encoded SUCCESS metadata for RUN
+    uint8_t *run_success;
+    size_t run_success_length;
+};
+
+struct bolt_server
+{
+    int fd;
+    int port;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    pthread_t thread;
+
+    struct bolt_server_entry *entries;
+    unsigned int nentries;
+    char *init_failure;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct bolt_server_connection *connections;
+    bool stopping;
+};
+
+/**
+ * Start a server listening on a loopback TCP port, in a new thread.
+ *
+ * @param [server] The server to start.
+ * @param [port] The port to listen on, or 0 for any free port (which is
+ *         then stored in `server->port`).
+ * @param [script] The responses to give, or `NULL` to return a single
+ *         record containing the integer 1 for every statement.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+int bolt_server_start_tcp(struct bolt_server *server, int port,
+        const struct bolt_server_script *script);
+
+/**
+ * Start a server listening on a unix domain socket, in a new thread.
+ *
+ * @param [server] The server to start.
+ * @param [path] The path of the socket, which is replaced if it exists.
+ * @param [script] The responses to give, or `NULL` to return a single
+ *         record containing the integer 1 for every statement.
+ * @return 0 on success, or -1 on failure (errno will be set).
+ */
+int bolt_server_start_unix(struct bolt_server *server, const char *path,
+        const struct bolt_server_script *script);
+
+/**
+ * Stop a server, closing all open connections.
+ *
+ * @param [server] The server to stop.
+ */
+void bolt_server_stop(struct bolt_server *server);
+
+#endif/*NEO4J_BENCH_BOLT_SERVER_H*/
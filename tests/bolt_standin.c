@@ -0,0 +1,120 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Runs the Bolt stand-in server until interrupted, for driving a client
+ * (or any other tool) against it by hand.
+ */
+#include "../config.h"
+#include "bolt_server.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static void usage(FILE *s, const char *prog_name)
+{
+    fprintf(s,
+"usage: %s [OPTIONS]\n"
+"options:\n"
+" -p N       Listen on loopback port N (default: any free port).\n"
+" -u PATH    Listen on a unix domain socket at PATH.\n"
+" -r N       Return N rows for every statement (default: 1).\n"
+" -c SPEC    Return the columns described by SPEC, a comma separated\n"
+"            list of name:type (default: n:int).\n"
+" -h         Output this usage information.\n"
+"\n"
+"Column types are null, bool, int, float, string, list, map and node.\n",
+        prog_name);
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *prog_name = argv[0];
+    int port = 0;
+    const char *path = NULL;
+    struct bolt_server_result result =
+        { .statement = NULL, .columns = "n:int", .nrows = 1 };
+
+    int c;
+    while ((c = getopt(argc, argv, "hp:u:r:c:")) >= 0)
+    {
+        switch (c)
+        {
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'u':
+            path = optarg;
+            break;
+        case 'r':
+            result.nrows = strtoull(optarg, NULL, 10);
+            break;
+        case 'c':
+            result.columns = optarg;
+            break;
+        case 'h':
+            usage(stdout, prog_name);
+            return EXIT_SUCCESS;
+        default:
+            usage(stderr, prog_name);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc || port < 0 || port > 65535)
+    {
+        usage(stderr, prog_name);
+        return EXIT_FAILURE;
+    }
+
+    // block termination signals, so they can be awaited below
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    struct bolt_server_script script = { .results = &result, .nresults = 1 };
+    struct bolt_server server;
+    if (path != NULL)
+    {
+        if (bolt_server_start_unix(&server, path, &script))
+        {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        printf("listening on bolt+unix://%s\n", path);
+    }
+    else
+    {
+        if (bolt_server_start_tcp(&server, port, &script))
+        {
+            fprintf(stderr, "port %d: %s\n", port, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        printf("listening on bolt://127.0.0.1:%d\n", server.port);
+    }
+    fflush(stdout);
+
+    int sig;
+    sigwait(&signals, &sig);
+    bolt_server_stop(&server);
+    return EXIT_SUCCESS;
+}
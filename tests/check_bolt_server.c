@@ -0,0 +1,254 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "bolt_server.h"
+#include "../src/lib/neo4j-client.h"
+#include "../src/lib/uring.h"
+#include <check.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+
+static const struct bolt_server_result results[] =
+    { { .statement = "FAIL", .failure = "Neo.ClientError.Statement.Invalid" },
+      { .statement = "TYPES",
+        .columns = "a:null,b:bool,c:float,d:list,e:map,f:node", .nrows = 2 },
+      { .statement = NULL, .columns = "n:int,s:string", .nrows = 10000 } };
+static const struct bolt_server_script script =
+    { .results = results, .nresults = 3 };
+
+static char path[64];
+static char uri[96];
+static struct bolt_server server;
+static neo4j_config_t *config;
+static neo4j_connection_t *connection;
+
+
+static void start_server(const struct bolt_server_script *s)
+{
+    snprintf(path, sizeof(path), "/tmp/neo4j-check.%d.sock", (int)getpid());
+    ck_assert_int_eq(bolt_server_start_unix(&server, path, s), 0);
+
+    config = neo4j_new_config();
+    ck_assert_ptr_ne(config, NULL);
+    ck_assert_int_eq(neo4j_config_set_username(config, "user"), 0);
+    ck_assert_int_eq(neo4j_config_set_password(config, "pass"), 0);
+
+    snprintf(uri, sizeof(uri), "bolt+unix://%s", path);
+    connection = neo4j_connect(uri, config, NEO4J_INSECURE);
+    ck_assert_ptr_ne(connection, NULL);
+}
+
+
+static void setup(void)
+{
+    start_server(&script);
+}
+
+
+static void teardown(void)
+{
+    neo4j_close(connection);
+    neo4j_config_free(config);
+    bolt_server_stop(&server);
+}
+
+
+START_TEST (fetches_synthetic_rows)
+{
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    neo4j_result_stream_t *stream =
+        neo4j_run(session, "MATCH (n) RETURN n", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+    ck_assert_int_eq(neo4j_nfields(stream), 2);
+    ck_assert_str_eq(neo4j_fieldname(stream, 0), "n");
+    ck_assert_str_eq(neo4j_fieldname(stream, 1), "s");
+
+    long long n = 0;
+    neo4j_result_t *result;
+    while ((result = neo4j_fetch_next(stream)) != NULL)
+    {
+        ++n;
+        neo4j_value_t v = neo4j_result_field(result, 0);
+        ck_assert(neo4j_type(v) == NEO4J_INT);
+        ck_assert_int_eq(neo4j_int_value(v), n);
+
+        char expected[32];
+        char buf[32];
+        snprintf(expected, sizeof(expected), "row-%lld", n);
+        v = neo4j_result_field(result, 1);
+        ck_assert(neo4j_type(v) == NEO4J_STRING);
+        ck_assert_str_eq(neo4j_string_value(v, buf, sizeof(buf)), expected);
+    }
+    ck_assert_int_eq(neo4j_check_failure(stream), 0);
+    ck_assert_int_eq(n, 10000);
+    ck_assert_int_eq(neo4j_close_results(stream), 0);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (returns_values_of_each_type)
+{
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    neo4j_result_stream_t *stream = neo4j_run(session, "TYPES", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+
+    neo4j_result_t *result = neo4j_fetch_next(stream);
+    ck_assert_ptr_ne(result, NULL);
+    ck_assert(neo4j_type(neo4j_result_field(result, 0)) == NEO4J_NULL);
+    neo4j_value_t v = neo4j_result_field(result, 1);
+    ck_assert(neo4j_type(v) == NEO4J_BOOL);
+    ck_assert(neo4j_bool_value(v));
+    v = neo4j_result_field(result, 2);
+    ck_assert(neo4j_type(v) == NEO4J_FLOAT);
+    ck_assert(neo4j_float_value(v) == 0.5);
+    v = neo4j_result_field(result, 3);
+    ck_assert(neo4j_type(v) == NEO4J_LIST);
+    ck_assert_int_eq(neo4j_list_length(v), 3);
+    ck_assert_int_eq(neo4j_int_value(neo4j_list_get(v, 2)), 3);
+    v = neo4j_result_field(result, 4);
+    ck_assert(neo4j_type(v) == NEO4J_MAP);
+    ck_assert_int_eq(neo4j_int_value(neo4j_map_get(v, "id")), 1);
+    v = neo4j_result_field(result, 5);
+    ck_assert(neo4j_type(v) == NEO4J_NODE);
+    ck_assert_int_eq(neo4j_list_length(neo4j_node_labels(v)), 1);
+
+    result = neo4j_fetch_next(stream);
+    ck_assert_ptr_ne(result, NULL);
+    ck_assert(!neo4j_bool_value(neo4j_result_field(result, 1)));
+    ck_assert_ptr_eq(neo4j_fetch_next(stream), NULL);
+    ck_assert_int_eq(neo4j_check_failure(stream), 0);
+    ck_assert_int_eq(neo4j_close_results(stream), 0);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (reports_scripted_failure)
+{
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    neo4j_result_stream_t *stream = neo4j_run(session, "FAIL", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+    ck_assert_ptr_eq(neo4j_fetch_next(stream), NULL);
+    ck_assert_int_eq(neo4j_check_failure(stream),
+            NEO4J_STATEMENT_EVALUATION_FAILED);
+    ck_assert_str_eq(neo4j_error_code(stream),
+            "Neo.ClientError.Statement.Invalid");
+    ck_assert_int_eq(neo4j_close_results(stream), 0);
+
+    // the failure is acknowledged, and the session continues
+    stream = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+    ck_assert_ptr_ne(neo4j_fetch_next(stream), NULL);
+    ck_assert_int_eq(neo4j_check_failure(stream), 0);
+    ck_assert_int_eq(neo4j_close_results(stream), 0);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (continues_after_reset)
+{
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    neo4j_result_stream_t *stream = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+    ck_assert_ptr_ne(neo4j_fetch_next(stream), NULL);
+    ck_assert_int_eq(neo4j_reset_session(session), 0);
+
+    stream = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+    ck_assert_ptr_ne(neo4j_fetch_next(stream), NULL);
+    ck_assert_int_eq(neo4j_check_failure(stream), 0);
+    ck_assert_int_eq(neo4j_close_results(stream), 0);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (rejects_scripted_credentials_failure)
+{
+    // replace the server started by the fixture
+    neo4j_close(connection);
+    neo4j_config_free(config);
+    bolt_server_stop(&server);
+
+    struct bolt_server_script failing = script;
+    failing.init_failure = "Neo.ClientError.Security.Unauthorized";
+    start_server(&failing);
+
+    ck_assert_ptr_eq(neo4j_new_session(connection), NULL);
+    ck_assert_int_eq(errno, NEO4J_INVALID_CREDENTIALS);
+}
+END_TEST
+
+
+START_TEST (uses_uring_again_after_cleanup)
+{
+    neo4j_close(connection);
+    connection = NULL;
+    ck_assert_int_eq(neo4j_config_set_io_uring(config, true), 0);
+    if (neo4j_uring_shared() == NULL)
+    {
+        // io_uring is unavailable on this platform or kernel
+        return;
+    }
+
+    ck_assert_int_eq(neo4j_uring_cleanup(), 0);
+    ck_assert_int_eq(neo4j_client_init(), 0);
+
+    connection = neo4j_connect(uri, config, NEO4J_INSECURE);
+    ck_assert_ptr_ne(connection, NULL);
+    ck_assert_ptr_ne(neo4j_uring_shared(), NULL);
+
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+    neo4j_result_stream_t *stream = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(stream, NULL);
+    ck_assert_ptr_ne(neo4j_fetch_next(stream), NULL);
+    ck_assert_int_eq(neo4j_check_failure(stream), 0);
+    ck_assert_int_eq(neo4j_close_results(stream), 0);
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+TCase* bolt_server_tcase(void)
+{
+    TCase *tc = tcase_create("bolt_server");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, fetches_synthetic_rows);
+    tcase_add_test(tc, returns_values_of_each_type);
+    tcase_add_test(tc, reports_scripted_failure);
+    tcase_add_test(tc, continues_after_reset);
+    tcase_add_test(tc, rejects_scripted_credentials_failure);
+    tcase_add_test(tc, uses_uring_again_after_cleanup);
+    return tc;
+}
@@ -0,0 +1,328 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "../src/lib/connection.h"
+#include "../src/lib/messages.h"
+#include "../src/lib/session.h"
+#include "../src/lib/util.h"
+#include "memiostream.h"
+#include <check.h>
+#include <errno.h>
+
+
+struct completed_batch
+{
+    unsigned long long batch;
+    unsigned int nrows;
+    int failure;
+    unsigned long long nodes_created;
+};
+
+
+static neo4j_iostream_t *stub_connect(struct neo4j_connection_factory *factory,
+        const char *hostname, unsigned int port, neo4j_config_t *config,
+        uint_fast32_t flags, struct neo4j_logger *logger);
+static neo4j_message_type_t recv_message(neo4j_iostream_t *ios,
+        neo4j_mpool_t *mpool, const neo4j_value_t **argv, uint16_t *argc);
+static void queue_message(neo4j_iostream_t *ios, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc);
+static void queue_run_success(neo4j_iostream_t *ios);
+static void queue_stream_end_success_with_counts(neo4j_iostream_t *ios,
+        long long nodes_created);
+static void queue_failure(neo4j_iostream_t *ios);
+static void batch_callback(void *userdata, unsigned long long batch,
+        unsigned int nrows, neo4j_result_stream_t *results);
+static void check_batch_request(unsigned int first, unsigned int nrows);
+
+
+static struct neo4j_logger_provider *logger_provider;
+static ring_buffer_t *in_rb;
+static ring_buffer_t *out_rb;
+static neo4j_iostream_t *client_ios;
+static neo4j_iostream_t *server_ios;
+static struct neo4j_connection_factory stub_factory;
+static neo4j_config_t *config;
+static neo4j_mpool_t bw_mpool;
+static neo4j_connection_t *bw_connection;
+static neo4j_session_t *session;
+static struct completed_batch completed[8];
+static unsigned int ncompleted;
+
+
+static void setup(void)
+{
+    logger_provider = neo4j_std_logger_provider(stderr, NEO4J_LOG_ERROR, 0);
+    in_rb = rb_alloc(1024);
+    out_rb = rb_alloc(1024);
+    client_ios = neo4j_memiostream(in_rb, out_rb);
+    server_ios = neo4j_memiostream(out_rb, in_rb);
+
+    stub_factory.tcp_connect = stub_connect;
+    config = neo4j_new_config();
+    neo4j_config_set_logger_provider(config, logger_provider);
+    neo4j_config_set_connection_factory(config, &stub_factory);
+    neo4j_config_set_max_pipelined_requests(config, 4);
+
+    bw_mpool = neo4j_std_mpool(config);
+
+    uint32_t version = htonl(1);
+    rb_append(in_rb, &version, sizeof(version));
+
+    bw_connection = neo4j_connect("neo4j://localhost:7687", config, 0);
+    ck_assert_ptr_ne(bw_connection, NULL);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    session = neo4j_new_session(bw_connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    rb_clear(out_rb);
+    ncompleted = 0;
+}
+
+
+static void teardown(void)
+{
+    if (session != NULL)
+    {
+        neo4j_end_session(session);
+    }
+    neo4j_close(bw_connection);
+    neo4j_mpool_drain(&bw_mpool);
+    neo4j_ios_close(server_ios);
+    neo4j_config_free(config);
+    rb_free(in_rb);
+    rb_free(out_rb);
+    neo4j_std_logger_provider_free(logger_provider);
+}
+
+
+neo4j_iostream_t *stub_connect(struct neo4j_connection_factory *factory,
+            const char *hostname, unsigned int port, neo4j_config_t *config,
+            uint_fast32_t flags, struct neo4j_logger *logger)
+{
+    return client_ios;
+}
+
+
+neo4j_message_type_t recv_message(neo4j_iostream_t *ios, neo4j_mpool_t *mpool,
+        const neo4j_value_t **argv, uint16_t *argc)
+{
+    neo4j_message_type_t type;
+    int result = neo4j_message_recv(ios, mpool, &type, argv, argc);
+    ck_assert_int_eq(result, 0);
+    return type;
+}
+
+
+void queue_message(neo4j_iostream_t *ios, neo4j_message_type_t type,
+        const neo4j_value_t *argv, uint16_t argc)
+{
+    int result = neo4j_message_send(ios, type, argv, argc, NULL, 0, 1024);
+    ck_assert_int_eq(result, 0);
+}
+
+
+void queue_run_success(neo4j_iostream_t *ios)
+{
+    neo4j_map_entry_t fields =
+        neo4j_map_entry("fields", neo4j_list(NULL, 0));
+    neo4j_value_t argv[1] = { neo4j_map(&fields, 1) };
+    queue_message(ios, NEO4J_SUCCESS_MESSAGE, argv, 1);
+}
+
+
+void queue_stream_end_success_with_counts(neo4j_iostream_t *ios,
+        long long nodes_created)
+{
+    neo4j_map_entry_t counts =
+        neo4j_map_entry("nodes-created", neo4j_int(nodes_created));
+    neo4j_map_entry_t fields[2] =
+        { neo4j_map_entry("type", neo4j_string("w")),
+          neo4j_map_entry("stats", neo4j_map(&counts, 1)) };
+    neo4j_value_t argv[1] = { neo4j_map(fields, 2) };
+    queue_message(ios, NEO4J_SUCCESS_MESSAGE, argv, 1);
+}
+
+
+void queue_failure(neo4j_iostream_t *ios)
+{
+    neo4j_map_entry_t fields[2] =
+        { neo4j_map_entry("code", neo4j_string("Neo.ClientError.Sample")),
+          neo4j_map_entry("message", neo4j_string("Sample error")) };
+    neo4j_value_t argv[1] = { neo4j_map(fields, 2) };
+    queue_message(ios, NEO4J_FAILURE_MESSAGE, argv, 1);
+}
+
+
+void batch_callback(void *userdata, unsigned long long batch,
+        unsigned int nrows, neo4j_result_stream_t *results)
+{
+    ck_assert_int_lt(ncompleted, 8);
+    struct completed_batch *c = &(completed[ncompleted++]);
+    c->batch = batch;
+    c->nrows = nrows;
+    c->failure = neo4j_check_failure(results);
+    c->nodes_created = (c->failure == 0)?
+        neo4j_update_counts(results).nodes_created : 0;
+}
+
+
+void check_batch_request(unsigned int first, unsigned int nrows)
+{
+    const neo4j_value_t *argv;
+    uint16_t argc;
+    neo4j_message_type_t type = recv_message(server_ios, &bw_mpool,
+            &argv, &argc);
+    ck_assert(type == NEO4J_RUN_MESSAGE);
+    ck_assert_int_eq(argc, 2);
+    char buf[128];
+    ck_assert_str_eq(neo4j_string_value(argv[0], buf, sizeof(buf)),
+            "UNWIND $batch AS row CREATE (n) SET n = row");
+
+    neo4j_value_t batch = neo4j_map_get(argv[1], "batch");
+    ck_assert(neo4j_type(batch) == NEO4J_LIST);
+    ck_assert_int_eq(neo4j_list_length(batch), nrows);
+    for (unsigned int i = 0; i < nrows; ++i)
+    {
+        neo4j_value_t row = neo4j_list_get(batch, i);
+        ck_assert(neo4j_type(row) == NEO4J_MAP);
+        ck_assert(neo4j_eq(neo4j_map_get(row, "x"), neo4j_int(first + i)));
+    }
+
+    type = recv_message(server_ios, &bw_mpool, &argv, &argc);
+    ck_assert(type == NEO4J_DISCARD_ALL_MESSAGE);
+}
+
+
+static int write_row(neo4j_bulk_writer_t *writer, int x)
+{
+    neo4j_map_entry_t entry = neo4j_map_entry("x", neo4j_int(x));
+    return neo4j_bulk_write(writer, neo4j_map(&entry, 1));
+}
+
+
+START_TEST (test_bulk_writer_sends_batches)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        queue_run_success(server_ios);
+        queue_stream_end_success_with_counts(server_ios, 10 + i);
+    }
+
+    neo4j_bulk_writer_t *writer = neo4j_open_bulk_writer(session,
+            "UNWIND $batch AS row CREATE (n) SET n = row", 2, 0,
+            batch_callback, NULL);
+    ck_assert_ptr_ne(writer, NULL);
+
+    ck_assert_int_eq(write_row(writer, 0), 0);
+    ck_assert(rb_is_empty(out_rb));
+    ck_assert_int_eq(write_row(writer, 1), 0);
+    // first batch is sent without waiting for a response
+    ck_assert(!rb_is_empty(out_rb));
+    ck_assert_int_eq(ncompleted, 0);
+
+    ck_assert_int_eq(write_row(writer, 2), 0);
+    ck_assert_int_eq(write_row(writer, 3), 0);
+    ck_assert_int_eq(ncompleted, 0);
+    ck_assert_int_eq(write_row(writer, 4), 0);
+
+    ck_assert_int_eq(neo4j_close_bulk_writer(writer), 0);
+    ck_assert_int_eq(ncompleted, 3);
+
+    unsigned int expected_rows[] = { 2, 2, 1 };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        ck_assert_int_eq(completed[i].batch, i);
+        ck_assert_int_eq(completed[i].nrows, expected_rows[i]);
+        ck_assert_int_eq(completed[i].failure, 0);
+        ck_assert_int_eq(completed[i].nodes_created, 10 + i);
+    }
+
+    check_batch_request(0, 2);
+    check_batch_request(2, 2);
+    check_batch_request(4, 1);
+    ck_assert(rb_is_empty(out_rb));
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
+START_TEST (test_bulk_writer_flushes_at_byte_threshold)
+{
+    queue_run_success(server_ios);
+    queue_stream_end_success_with_counts(server_ios, 1);
+    queue_run_success(server_ios);
+    queue_stream_end_success_with_counts(server_ios, 1);
+
+    // each row serializes to 4 bytes
+    neo4j_bulk_writer_t *writer = neo4j_open_bulk_writer(session,
+            "UNWIND $batch AS row CREATE (n) SET n = row", 100, 6,
+            batch_callback, NULL);
+    ck_assert_ptr_ne(writer, NULL);
+
+    ck_assert_int_eq(write_row(writer, 0), 0);
+    ck_assert(rb_is_empty(out_rb));
+    ck_assert_int_eq(write_row(writer, 1), 0);
+    ck_assert(!rb_is_empty(out_rb));
+    ck_assert_int_eq(write_row(writer, 2), 0);
+
+    ck_assert_int_eq(neo4j_close_bulk_writer(writer), 0);
+    ck_assert_int_eq(ncompleted, 2);
+    ck_assert_int_eq(completed[0].nrows, 2);
+    ck_assert_int_eq(completed[1].nrows, 1);
+
+    check_batch_request(0, 2);
+    check_batch_request(2, 1);
+}
+END_TEST
+
+
+START_TEST (test_bulk_writer_reports_failed_batch)
+{
+    queue_failure(server_ios); // RUN
+    queue_message(server_ios, NEO4J_IGNORED_MESSAGE, NULL, 0); // DISCARD_ALL
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // ACK_FAILURE
+
+    neo4j_bulk_writer_t *writer = neo4j_open_bulk_writer(session,
+            "UNWIND $batch AS row CREATE (n) SET n = row", 10, 0,
+            batch_callback, NULL);
+    ck_assert_ptr_ne(writer, NULL);
+
+    ck_assert_int_eq(write_row(writer, 0), 0);
+
+    ck_assert_int_eq(neo4j_close_bulk_writer(writer), -1);
+    ck_assert_int_eq(errno, NEO4J_STATEMENT_EVALUATION_FAILED);
+    ck_assert_int_eq(ncompleted, 1);
+    ck_assert_int_eq(completed[0].nrows, 1);
+    ck_assert_int_eq(completed[0].failure, NEO4J_STATEMENT_EVALUATION_FAILED);
+    // the ACK_FAILURE is queued, and sent when the session ends
+    ck_assert_int_eq(neo4j_end_session(session), 0);
+    session = NULL;
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
+TCase* bulk_writer_tcase(void)
+{
+    TCase *tc = tcase_create("bulk writer");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, test_bulk_writer_sends_batches);
+    tcase_add_test(tc, test_bulk_writer_flushes_at_byte_threshold);
+    tcase_add_test(tc, test_bulk_writer_reports_failed_batch);
+    return tc;
+}
@@ -18,6 +18,7 @@
 #include "../src/lib/client_config.h"
 #include <check.h>
 #include <errno.h>
+#include <limits.h>
 
 
 START_TEST (test_neo4j_config_create_and_release)
@@ -29,9 +30,68 @@ START_TEST (test_neo4j_config_create_and_release)
 END_TEST
 
 
+START_TEST (test_neo4j_config_tls_min_version)
+{
+    neo4j_config_t *config = neo4j_new_config();
+    ck_assert(config != NULL);
+
+    ck_assert_int_eq(neo4j_config_set_TLS_min_version(config, 0x0300), -1);
+    ck_assert_int_eq(errno, EINVAL);
+    ck_assert_int_eq(neo4j_config_set_TLS_min_version(config, 0x0305), -1);
+    ck_assert_int_eq(errno, EINVAL);
+
+#ifdef HAVE_TLS
+    ck_assert_int_eq(
+            neo4j_config_set_TLS_min_version(config, NEO4J_TLS_V1_3), 0);
+    ck_assert_int_eq(config->tls_min_version, NEO4J_TLS_V1_3);
+#else
+    ck_assert_int_eq(
+            neo4j_config_set_TLS_min_version(config, NEO4J_TLS_V1_3), -1);
+    ck_assert_int_eq(errno, NEO4J_TLS_NOT_SUPPORTED);
+#endif
+    neo4j_config_free(config);
+}
+END_TEST
+
+
+START_TEST (test_neo4j_config_socket_options)
+{
+    neo4j_config_t *config = neo4j_new_config();
+    ck_assert(config != NULL);
+
+    ck_assert(config->tcp_nodelay);
+    ck_assert_int_eq(neo4j_config_set_tcp_nodelay(config, false), 0);
+    ck_assert(!config->tcp_nodelay);
+
+    ck_assert_int_eq(neo4j_config_set_tcp_keepalive(config, 60, 10, 3), 0);
+    ck_assert_int_eq(config->tcp_keepalive_idle, 60);
+    ck_assert_int_eq(config->tcp_keepalive_interval, 10);
+    ck_assert_int_eq(config->tcp_keepalive_count, 3);
+    ck_assert_int_eq(neo4j_config_set_tcp_keepalive(config,
+                (unsigned int)INT_MAX + 1, 0, 0), -1);
+    ck_assert_int_eq(errno, ERANGE);
+
+    ck_assert_int_eq(neo4j_config_set_so_busy_poll(config, 50), 0);
+    ck_assert_int_eq(config->so_busy_poll, 50);
+    ck_assert_int_eq(neo4j_config_set_so_busy_poll(config,
+                (unsigned int)INT_MAX + 1), -1);
+    ck_assert_int_eq(errno, ERANGE);
+
+    neo4j_config_t *dup = neo4j_config_dup(config);
+    ck_assert(dup != NULL);
+    ck_assert(!dup->tcp_nodelay);
+    ck_assert_int_eq(dup->so_busy_poll, 50);
+    neo4j_config_free(dup);
+    neo4j_config_free(config);
+}
+END_TEST
+
+
 TCase* config_tcase(void)
 {
     TCase *tc = tcase_create("config");
     tcase_add_test(tc, test_neo4j_config_create_and_release);
+    tcase_add_test(tc, test_neo4j_config_tls_min_version);
+    tcase_add_test(tc, test_neo4j_config_socket_options);
     return tc;
 }
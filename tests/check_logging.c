@@ -16,7 +16,9 @@
  */
 #include "../config.h"
 #include "../src/lib/logging.h"
+#include "memstream.h"
 #include <check.h>
+#include <string.h>
 
 
 struct log_event
@@ -167,6 +169,103 @@ START_TEST (std_logger_provider_returns_same_logger_for_name)
 END_TEST
 
 
+START_TEST (async_logger_provider_writes_entries)
+{
+    char *buf = NULL;
+    size_t bufsize = 0;
+    FILE *stream = open_memstream(&buf, &bufsize);
+    ck_assert(stream != NULL);
+
+    struct neo4j_logger_provider *provider =
+        neo4j_async_logger_provider(stream, NEO4J_LOG_INFO, 0, 0);
+    ck_assert(provider != NULL);
+
+    neo4j_logger_t *logger = provider->get_logger(provider, "LOGNAME");
+    ck_assert(logger != NULL);
+    neo4j_log_info(logger, "message %d", 1);
+    neo4j_log_debug(logger, "not logged");
+    neo4j_log_warn(logger, "message %s", "two");
+    neo4j_logger_release(logger);
+
+    neo4j_async_logger_provider_free(provider);
+    fclose(stream);
+
+    ck_assert_str_eq(buf, "INFO  [LOGNAME]: message 1\n"
+            "WARN  [LOGNAME]: message two\n");
+    free(buf);
+}
+END_TEST
+
+
+START_TEST (async_logger_provider_drops_entries_when_full)
+{
+    char *buf = NULL;
+    size_t bufsize = 0;
+    FILE *stream = open_memstream(&buf, &bufsize);
+    ck_assert(stream != NULL);
+
+    struct neo4j_logger_provider *provider = neo4j_async_logger_provider(
+            stream, NEO4J_LOG_INFO, NEO4J_STD_LOGGER_NO_PREFIX, 4);
+    ck_assert(provider != NULL);
+    neo4j_logger_t *logger = provider->get_logger(provider, "LOGNAME");
+    ck_assert(logger != NULL);
+
+    // stall the writer, holding at most one entry beyond the ring
+    flockfile(stream);
+    for (int i = 0; i < 20; ++i)
+    {
+        neo4j_log_info(logger, "message %d", i);
+    }
+    unsigned long long dropped = neo4j_async_logger_dropped(provider);
+    ck_assert_int_ge(dropped, 15);
+    ck_assert_int_le(dropped, 16);
+    funlockfile(stream);
+
+    neo4j_logger_release(logger);
+    neo4j_async_logger_provider_free(provider);
+    fclose(stream);
+
+    ck_assert(strncmp(buf, "message 0\nmessage 1\nmessage 2\nmessage 3\n",
+                40) == 0);
+    char expected[64];
+    snprintf(expected, sizeof(expected), "%llu log entries dropped\n",
+            dropped);
+    ck_assert_ptr_ne(strstr(buf, expected), NULL);
+    free(buf);
+}
+END_TEST
+
+
+START_TEST (async_logger_provider_truncates_long_entries)
+{
+    char *buf = NULL;
+    size_t bufsize = 0;
+    FILE *stream = open_memstream(&buf, &bufsize);
+    ck_assert(stream != NULL);
+
+    struct neo4j_logger_provider *provider = neo4j_async_logger_provider(
+            stream, NEO4J_LOG_INFO, 0, 0);
+    ck_assert(provider != NULL);
+    neo4j_logger_t *logger = provider->get_logger(provider, "LOGNAME");
+    ck_assert(logger != NULL);
+
+    char message[2 * NEO4J_ASYNC_LOGGER_MAX_ENTRY];
+    memset(message, 'x', sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+    neo4j_log_info(logger, "%s", message);
+
+    neo4j_logger_release(logger);
+    neo4j_async_logger_provider_free(provider);
+    fclose(stream);
+
+    ck_assert_int_eq(strlen(buf), NEO4J_ASYNC_LOGGER_MAX_ENTRY - 1);
+    ck_assert(strncmp(buf, "INFO  [LOGNAME]: xxx", 20) == 0);
+    ck_assert_int_eq(buf[NEO4J_ASYNC_LOGGER_MAX_ENTRY - 2], '\n');
+    free(buf);
+}
+END_TEST
+
+
 TCase* logging_tcase(void)
 {
     TCase *tc = tcase_create("logging");
@@ -174,5 +273,8 @@ TCase* logging_tcase(void)
     tcase_add_test(tc, test_logging_handles_null_logger);
     tcase_add_test(tc, test_logging_logs_event);
     tcase_add_test(tc, std_logger_provider_returns_same_logger_for_name);
+    tcase_add_test(tc, async_logger_provider_writes_entries);
+    tcase_add_test(tc, async_logger_provider_drops_entries_when_full);
+    tcase_add_test(tc, async_logger_provider_truncates_long_entries);
     return tc;
 }
@@ -339,6 +339,29 @@ START_TEST (merge_with_empty_pool)
 END_TEST
 
 
+START_TEST (merge_with_empty_pool_of_debounce_only)
+{
+    ck_assert(pool.offset == pool.block_size);
+    ck_assert(neo4j_mpool_depth(pool) == 0);
+
+    neo4j_mpool_t pool2 = neo4j_mpool(pool.allocator, pool.block_size);
+    for (int i = NEO4J_MPOOL_DEBOUNCE; i > 0; --i)
+    {
+        ck_assert_int_gt(neo4j_mpool_add(&pool2, test_buffer_next()), 0);
+    }
+    ck_assert(pool2.ptrs == NULL);
+
+    ssize_t new_depth = neo4j_mpool_merge(&pool, &pool2);
+    ck_assert((size_t)new_depth == NEO4J_MPOOL_DEBOUNCE);
+    ck_assert(neo4j_mpool_depth(pool) == NEO4J_MPOOL_DEBOUNCE);
+    ck_assert(neo4j_mpool_depth(pool2) == 0);
+
+    neo4j_mpool_drain(&pool);
+    ck_assert_int_eq(allocator.releases, NEO4J_MPOOL_DEBOUNCE);
+}
+END_TEST
+
+
 START_TEST (merge_with_full_pool)
 {
     for (int i = 3*(pool.block_size-1); i > 0; --i)
@@ -626,6 +649,7 @@ TCase* memory_tcase(void)
     tcase_add_test(tc, fill_and_drain);
     tcase_add_test(tc, fill_and_partially_drain);
     tcase_add_test(tc, merge_with_empty_pool);
+    tcase_add_test(tc, merge_with_empty_pool_of_debounce_only);
     tcase_add_test(tc, merge_with_full_pool);
     tcase_add_test(tc, merge_with_underfull_pool);
     tcase_add_test(tc, merge_with_underfull_below_offset_pool);
@@ -0,0 +1,188 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "../src/lib/client_config.h"
+#include "../src/lib/network.h"
+#include <check.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+static neo4j_config_t *config;
+static int listen_fd;
+static char servname[8];
+
+
+static void setup(void)
+{
+    config = neo4j_new_config();
+    ck_assert_ptr_ne(config, NULL);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    ck_assert_int_ge(listen_fd, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    ck_assert_int_eq(bind(listen_fd, (struct sockaddr *)&addr,
+                sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ck_assert_int_eq(getsockname(listen_fd, (struct sockaddr *)&addr,
+                &len), 0);
+    snprintf(servname, sizeof(servname), "%u", ntohs(addr.sin_port));
+}
+
+
+static void teardown(void)
+{
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+    }
+    neo4j_config_free(config);
+}
+
+
+START_TEST (connects_to_listening_address)
+{
+    ck_assert_int_eq(listen(listen_fd, 1), 0);
+
+    int fd = neo4j_connect_tcp_socket("127.0.0.1", servname, config, NULL);
+    ck_assert_int_ge(fd, 0);
+    ck_assert_int_eq(fcntl(fd, F_GETFL, 0) & O_NONBLOCK, 0);
+
+    int peer = accept(listen_fd, NULL, NULL);
+    ck_assert_int_ge(peer, 0);
+    ck_assert_int_eq(write(fd, "x", 1), 1);
+    char c;
+    ck_assert_int_eq(read(peer, &c, 1), 1);
+    close(peer);
+    close(fd);
+
+    // again, with the address cached
+    fd = neo4j_connect_tcp_socket("127.0.0.1", servname, config, NULL);
+    ck_assert_int_ge(fd, 0);
+    close(fd);
+}
+END_TEST
+
+
+START_TEST (connect_fails_when_nothing_is_listening)
+{
+    close(listen_fd);
+    listen_fd = -1;
+
+    int fd = neo4j_connect_tcp_socket("127.0.0.1", servname, config, NULL);
+    ck_assert_int_eq(fd, -1);
+    ck_assert_int_eq(errno, ECONNREFUSED);
+}
+END_TEST
+
+
+START_TEST (connects_without_dns_cache)
+{
+    ck_assert_int_eq(listen(listen_fd, 1), 0);
+    ck_assert_int_eq(neo4j_config_set_dns_cache_ttl(config, 0, 0), 0);
+
+    int fd = neo4j_connect_tcp_socket("127.0.0.1", servname, config, NULL);
+    ck_assert_int_ge(fd, 0);
+    close(fd);
+}
+END_TEST
+
+
+START_TEST (connects_to_unix_socket)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path),
+            "/tmp/check-network.%d.sock", (int)getpid());
+    unlink(addr.sun_path);
+
+    int ufd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ck_assert_int_ge(ufd, 0);
+    ck_assert_int_eq(bind(ufd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    ck_assert_int_eq(listen(ufd, 1), 0);
+
+    int fd = neo4j_connect_unix_socket(addr.sun_path, config, NULL);
+    ck_assert_int_ge(fd, 0);
+    close(fd);
+    close(ufd);
+    unlink(addr.sun_path);
+
+    fd = neo4j_connect_unix_socket(addr.sun_path, config, NULL);
+    ck_assert_int_eq(fd, -1);
+    ck_assert_int_eq(errno, ENOENT);
+}
+END_TEST
+
+
+START_TEST (unix_socket_connect_times_out)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path),
+            "/tmp/check-network.%d.sock", (int)getpid());
+    unlink(addr.sun_path);
+
+    int ufd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ck_assert_int_ge(ufd, 0);
+    ck_assert_int_eq(bind(ufd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    ck_assert_int_eq(listen(ufd, 0), 0);
+
+    // fill the backlog, as connections are never accepted
+    int cfds[8];
+    unsigned int ncfds = 0;
+    for (; ncfds < 8; ++ncfds)
+    {
+        cfds[ncfds] = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        ck_assert_int_ge(cfds[ncfds], 0);
+        if (connect(cfds[ncfds], (struct sockaddr *)&addr, sizeof(addr)))
+        {
+            close(cfds[ncfds]);
+            break;
+        }
+    }
+    ck_assert_int_lt(ncfds, 8);
+
+    config->connect_timeout = 1;
+    int fd = neo4j_connect_unix_socket(addr.sun_path, config, NULL);
+    ck_assert_int_eq(fd, -1);
+    ck_assert_int_eq(errno, ETIMEDOUT);
+
+    for (unsigned int i = 0; i < ncfds; ++i)
+    {
+        close(cfds[i]);
+    }
+    close(ufd);
+    unlink(addr.sun_path);
+}
+END_TEST
+
+
+TCase* network_tcase(void)
+{
+    TCase *tc = tcase_create("network");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, connects_to_listening_address);
+    tcase_add_test(tc, connect_fails_when_nothing_is_listening);
+    tcase_add_test(tc, connects_without_dns_cache);
+    tcase_add_test(tc, connects_to_unix_socket);
+    tcase_add_test(tc, unix_socket_connect_times_out);
+    return tc;
+}
@@ -0,0 +1,228 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "../src/lib/posix_iostream.h"
+#include "../src/lib/iostream.h"
+#include <check.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+static int fds[2];
+static neo4j_iostream_t *ios;
+
+
+static void setup(void)
+{
+    ck_assert_int_eq(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ios = neo4j_posix_iostream_with_timeouts(fds[0], 10, 10);
+    ck_assert_ptr_ne(ios, NULL);
+}
+
+
+static void teardown(void)
+{
+    neo4j_ios_close(ios);
+    close(fds[1]);
+}
+
+
+START_TEST (read_returns_available_bytes)
+{
+    ck_assert_int_eq(write(fds[1], "0123", 4), 4);
+
+    char buf[8];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, sizeof(buf)), 4);
+    ck_assert(memcmp(buf, "0123", 4) == 0);
+}
+END_TEST
+
+
+START_TEST (read_times_out_when_no_bytes_arrive)
+{
+    char buf[8];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, sizeof(buf)), -1);
+    ck_assert_int_eq(errno, ETIMEDOUT);
+
+    struct iovec iov[1] = { { .iov_base = buf, .iov_len = sizeof(buf) } };
+    ck_assert_int_eq(neo4j_ios_readv(ios, iov, 1), -1);
+    ck_assert_int_eq(errno, ETIMEDOUT);
+}
+END_TEST
+
+
+START_TEST (write_times_out_when_peer_does_not_read)
+{
+    char buf[4096];
+    memset(buf, 'x', sizeof(buf));
+
+    ssize_t result;
+    while ((result = neo4j_ios_write(ios, buf, sizeof(buf))) > 0)
+        ;
+    ck_assert_int_eq(result, -1);
+    ck_assert_int_eq(errno, ETIMEDOUT);
+}
+END_TEST
+
+
+START_TEST (fd_is_only_available_for_posix_iostreams)
+{
+    ck_assert_int_eq(neo4j_posix_iostream_fd(ios), fds[0]);
+
+    neo4j_iostream_t other = { .close = NULL };
+    ck_assert_int_eq(neo4j_posix_iostream_fd(&other), -1);
+    ck_assert_int_eq(errno, EINVAL);
+}
+END_TEST
+
+
+START_TEST (ktls_read_returns_data_without_record_type)
+{
+    if (neo4j_posix_iostream_enable_ktls(ios))
+    {
+        ck_assert_int_eq(errno, ENOTSUP);
+        return;
+    }
+
+    ck_assert_int_eq(write(fds[1], "0123", 4), 4);
+
+    char buf[8];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, sizeof(buf)), 4);
+    ck_assert(memcmp(buf, "0123", 4) == 0);
+}
+END_TEST
+
+
+START_TEST (tls_close_notify_ends_stream)
+{
+    struct neo4j_tls_control ctrl = { 0 };
+    uint8_t alert[2] = { 1, 0 }; // warning, close_notify
+    struct iovec iov[1] = { { .iov_base = alert, .iov_len = sizeof(alert) } };
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 21, iov, 2), 0);
+}
+END_TEST
+
+
+START_TEST (tls_other_alert_resets_connection)
+{
+    struct neo4j_tls_control ctrl = { 0 };
+    uint8_t alert[2] = { 2, 40 }; // fatal, handshake_failure
+    struct iovec iov[1] = { { .iov_base = alert, .iov_len = sizeof(alert) } };
+
+    // the alert is split over two reads
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 21, iov, 1), 1);
+    iov[0].iov_base = alert + 1;
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 21, iov, 1), -1);
+    ck_assert_int_eq(errno, ECONNRESET);
+}
+END_TEST
+
+
+START_TEST (tls_key_update_is_rejected)
+{
+    struct neo4j_tls_control ctrl = { 0 };
+    uint8_t msg[5] = { 24, 0, 0, 1, 0 }; // key_update, update_not_requested
+    struct iovec iov[1] = { { .iov_base = msg, .iov_len = sizeof(msg) } };
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 22, iov, 5), -1);
+    ck_assert_int_eq(errno, EPROTO);
+}
+END_TEST
+
+
+START_TEST (tls_session_ticket_is_skipped)
+{
+    struct neo4j_tls_control ctrl = { 0 };
+    // new_session_ticket, with a 6 byte body, followed by a key update
+    uint8_t msg[14] = { 4, 0, 0, 6, 'a', 'b', 'c', 'd', 'e', 'f',
+                        24, 0, 0, 1 };
+
+    // the ticket is split over two reads, and two buffers
+    struct iovec iov[2] = { { .iov_base = msg, .iov_len = 2 },
+                            { .iov_base = msg + 2, .iov_len = 4 } };
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 22, iov, 6), 1);
+    ck_assert_int_eq(ctrl.skip, 4);
+    iov[0].iov_base = msg + 6;
+    iov[0].iov_len = 4;
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 22, iov, 4), 1);
+    ck_assert_int_eq(ctrl.skip, 0);
+    ck_assert_int_eq(ctrl.header_length, 0);
+
+    // the next handshake message is parsed from its header
+    iov[0].iov_base = msg + 10;
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 22, iov, 4), -1);
+    ck_assert_int_eq(errno, EPROTO);
+}
+END_TEST
+
+
+START_TEST (tls_unknown_record_type_is_rejected)
+{
+    struct neo4j_tls_control ctrl = { 0 };
+    uint8_t msg[1] = { 1 }; // change_cipher_spec
+    struct iovec iov[1] = { { .iov_base = msg, .iov_len = sizeof(msg) } };
+    ck_assert_int_eq(neo4j_tls_control_record(&ctrl, 20, iov, 1), -1);
+    ck_assert_int_eq(errno, EPROTO);
+}
+END_TEST
+
+
+START_TEST (spinning_read_returns_available_bytes)
+{
+    ck_assert_int_eq(neo4j_posix_iostream_set_read_spin(ios, 1000), 0);
+
+    char buf[8];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, sizeof(buf)), -1);
+    ck_assert_int_eq(errno, ETIMEDOUT);
+
+    ck_assert_int_eq(write(fds[1], "0123", 4), 4);
+    struct iovec iov[1] = { { .iov_base = buf, .iov_len = sizeof(buf) } };
+    ck_assert_int_eq(neo4j_ios_readv(ios, iov, 1), 4);
+    ck_assert(memcmp(buf, "0123", 4) == 0);
+}
+END_TEST
+
+
+START_TEST (wait_returns_when_bytes_are_available)
+{
+    ck_assert_int_eq(neo4j_ios_wait(ios, 0), -1);
+    ck_assert_int_eq(errno, ETIMEDOUT);
+
+    ck_assert_int_eq(write(fds[1], "0123", 4), 4);
+    ck_assert_int_eq(neo4j_ios_wait(ios, 10), 0);
+}
+END_TEST
+
+
+TCase* posix_iostream_tcase(void)
+{
+    TCase *tc = tcase_create("posix_iostream");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, read_returns_available_bytes);
+    tcase_add_test(tc, read_times_out_when_no_bytes_arrive);
+    tcase_add_test(tc, write_times_out_when_peer_does_not_read);
+    tcase_add_test(tc, wait_returns_when_bytes_are_available);
+    tcase_add_test(tc, fd_is_only_available_for_posix_iostreams);
+    tcase_add_test(tc, ktls_read_returns_data_without_record_type);
+    tcase_add_test(tc, tls_close_notify_ends_stream);
+    tcase_add_test(tc, tls_other_alert_resets_connection);
+    tcase_add_test(tc, tls_key_update_is_rejected);
+    tcase_add_test(tc, tls_session_ticket_is_skipped);
+    tcase_add_test(tc, tls_unknown_record_type_is_rejected);
+    tcase_add_test(tc, spinning_read_returns_available_bytes);
+    return tc;
+}
@@ -41,6 +41,9 @@ static void queue_stream_end_success_with_counts(neo4j_iostream_t *ios);
 static void queue_stream_end_success_with_profile(neo4j_iostream_t *ios);
 static void queue_stream_end_success_with_plan(neo4j_iostream_t *ios);
 static void queue_failure(neo4j_iostream_t *ios);
+static void trace_callback(void *userdata, neo4j_trace_point_t point,
+        uint64_t timestamp, neo4j_session_t *session,
+        unsigned long long request_id, const char *request_type);
 
 
 static struct neo4j_logger_provider *logger_provider;
@@ -293,6 +296,123 @@ START_TEST (test_run_returns_results_and_completes)
 END_TEST
 
 
+#define MAX_TRACE_EVENTS 16
+
+struct trace_event
+{
+    neo4j_trace_point_t point;
+    uint64_t timestamp;
+    unsigned long long request_id;
+    const char *request_type;
+};
+
+struct trace_log
+{
+    struct trace_event events[MAX_TRACE_EVENTS];
+    unsigned int nevents;
+};
+
+
+void trace_callback(void *userdata, neo4j_trace_point_t point,
+        uint64_t timestamp, neo4j_session_t *session,
+        unsigned long long request_id, const char *request_type)
+{
+    struct trace_log *log = (struct trace_log *)userdata;
+    ck_assert_int_lt(log->nevents, MAX_TRACE_EVENTS);
+    struct trace_event *event = &(log->events[(log->nevents)++]);
+    event->point = point;
+    event->timestamp = timestamp;
+    event->request_id = request_id;
+    event->request_type = request_type;
+}
+
+
+START_TEST (test_run_traces_request_lifecycle)
+{
+    struct trace_log log = { .nevents = 0 };
+    neo4j_config_set_trace_callback(connection->config, trace_callback, &log);
+
+    neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    ck_assert_int_eq(log.nevents, 2);
+
+    queue_run_success(server_ios); // RUN
+    queue_record(server_ios); // PULL_ALL
+    queue_record(server_ios); // PULL_ALL
+    queue_stream_end_success(server_ios); // PULL_ALL
+
+    ck_assert_int_eq(neo4j_check_failure(results), 0);
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    neo4j_config_set_trace_callback(connection->config, NULL, NULL);
+
+    struct
+    {
+        neo4j_trace_point_t point;
+        const char *request_type;
+    } expected[] = {
+        { NEO4J_TRACE_REQUEST_QUEUED, "RUN" },
+        { NEO4J_TRACE_REQUEST_QUEUED, "PULL_ALL" },
+        { NEO4J_TRACE_REQUEST_SENT, "RUN" },
+        { NEO4J_TRACE_REQUEST_SENT, "PULL_ALL" },
+        { NEO4J_TRACE_RESPONSE_RECEIVED, "RUN" },
+        { NEO4J_TRACE_RESPONSE_RECEIVED, "PULL_ALL" },
+        { NEO4J_TRACE_RECORD_RECEIVED, "PULL_ALL" },
+        { NEO4J_TRACE_RECORD_RECEIVED, "PULL_ALL" },
+        { NEO4J_TRACE_RESULTS_COMPLETED, "PULL_ALL" }
+    };
+    unsigned int nexpected = sizeof(expected) / sizeof(expected[0]);
+    ck_assert_int_eq(log.nevents, nexpected);
+
+    unsigned long long run_id = log.events[0].request_id;
+    for (unsigned int i = 0; i < nexpected; ++i)
+    {
+        ck_assert_int_eq(log.events[i].point, expected[i].point);
+        ck_assert_str_eq(log.events[i].request_type, expected[i].request_type);
+        ck_assert_int_eq(log.events[i].request_id,
+                (strcmp(expected[i].request_type, "RUN") == 0)?
+                run_id : run_id + 1);
+        if (i > 0)
+        {
+            ck_assert(log.events[i].timestamp >= log.events[i-1].timestamp);
+        }
+    }
+}
+END_TEST
+
+
+START_TEST (test_run_parses_metadata_on_demand)
+{
+    neo4j_config_set_logger_provider(connection->config, NULL);
+
+    neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+
+    queue_run_success(server_ios); // RUN
+    queue_record(server_ios); // PULL_ALL
+    neo4j_map_entry_t fields[2] =
+        { neo4j_map_entry("type", neo4j_string("rw")),
+          neo4j_map_entry("stats", neo4j_int(1)) };
+    neo4j_value_t argv[1] = { neo4j_map(fields, 2) };
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, argv, 1); // PULL_ALL
+
+    // the invalid stats are not parsed until the counts are requested
+    ck_assert_ptr_ne(neo4j_fetch_next(results), NULL);
+    ck_assert_ptr_eq(neo4j_fetch_next(results), NULL);
+    ck_assert_int_eq(errno, 0);
+    ck_assert_int_eq(neo4j_check_failure(results), 0);
+    ck_assert_int_eq(neo4j_statement_type(results), NEO4J_READ_WRITE_STATEMENT);
+
+    struct neo4j_update_counts counts = neo4j_update_counts(results);
+    ck_assert_int_eq(errno, EPROTO);
+    ck_assert_int_eq(counts.nodes_created, 0);
+    ck_assert_int_eq(neo4j_check_failure(results), EPROTO);
+
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
 START_TEST (test_run_can_close_immediately_after_fetch)
 {
     neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1",
@@ -439,6 +559,9 @@ START_TEST (test_run_returns_failure_when_statement_fails)
 
     ck_assert_int_eq(neo4j_close_results(results), 0);
 
+    // the ACK_FAILURE is queued, and sent when the session ends
+    ck_assert_int_eq(neo4j_end_session(session), 0);
+    session = NULL;
     ck_assert(rb_is_empty(in_rb));
 }
 END_TEST
@@ -471,6 +594,9 @@ START_TEST (test_run_returns_failure_during_streaming)
 
     ck_assert_int_eq(neo4j_close_results(results), 0);
 
+    // the ACK_FAILURE is queued, and sent when the session ends
+    ck_assert_int_eq(neo4j_end_session(session), 0);
+    session = NULL;
     ck_assert(rb_is_empty(in_rb));
 }
 END_TEST
@@ -503,6 +629,33 @@ START_TEST (test_run_skips_results_after_session_close)
 END_TEST
 
 
+START_TEST (test_run_parses_metadata_after_session_close)
+{
+    neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+
+    queue_run_success(server_ios); // RUN
+    queue_stream_end_success_with_plan(server_ios); // PULL_ALL
+    ck_assert_ptr_eq(neo4j_fetch_next(results), NULL);
+    ck_assert_int_eq(errno, 0);
+
+    neo4j_end_session(session);
+    session = NULL;
+
+    // the metadata is only parsed now, without the session
+    ck_assert_int_eq(neo4j_statement_type(results), NEO4J_READ_ONLY_STATEMENT);
+    struct neo4j_statement_plan *plan = neo4j_statement_plan(results);
+    ck_assert_ptr_ne(plan, NULL);
+    ck_assert(!plan->is_profile);
+    ck_assert_str_eq(plan->output_step->operator_type, "ProduceResults");
+    neo4j_statement_plan_release(plan);
+
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
 START_TEST (test_run_skips_results_after_session_reset)
 {
     neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1", neo4j_null);
@@ -559,6 +712,163 @@ START_TEST (test_run_returns_same_failure_after_session_close)
 END_TEST
 
 
+START_TEST (test_run_cancels_statement_when_timeout_expires)
+{
+    neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    ck_assert_int_eq(neo4j_set_results_timeout(results, 1000), 0);
+
+    queue_run_success(server_ios); // RUN
+    queue_record(server_ios); // PULL_ALL
+
+    ck_assert_ptr_ne(neo4j_fetch_next(results), NULL);
+    // no further response arrives before the timeout expires
+    ck_assert_ptr_eq(neo4j_fetch_next(results), NULL);
+    ck_assert_int_eq(errno, NEO4J_STATEMENT_TIMEOUT);
+    ck_assert_int_eq(neo4j_check_failure(results), NEO4J_STATEMENT_TIMEOUT);
+
+    const neo4j_value_t *argv;
+    uint16_t argc;
+    neo4j_message_type_t type = recv_message(server_ios, &mpool,
+            &argv, &argc);
+    ck_assert(type == NEO4J_RUN_MESSAGE);
+    type = recv_message(server_ios, &mpool, &argv, &argc);
+    ck_assert(type == NEO4J_PULL_ALL_MESSAGE);
+    type = recv_message(server_ios, &mpool, &argv, &argc);
+    ck_assert(type == NEO4J_RESET_MESSAGE);
+    ck_assert(rb_is_empty(out_rb));
+
+    queue_failure(server_ios); // PULL_ALL
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RESET
+
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert(rb_is_empty(in_rb));
+
+    // the session remains usable
+    results = neo4j_run(session, "RETURN 2", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    queue_run_success(server_ios); // RUN
+    queue_stream_end_success(server_ios); // PULL_ALL
+    ck_assert_ptr_eq(neo4j_fetch_next(results), NULL);
+    ck_assert_int_eq(errno, 0);
+    ck_assert_int_eq(neo4j_check_failure(results), 0);
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
+START_TEST (test_run_fails_session_when_timeout_expires_mid_message)
+{
+    neo4j_result_stream_t *results = neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    ck_assert_int_eq(neo4j_set_results_timeout(results, 1000), 0);
+
+    queue_run_success(server_ios); // RUN
+    queue_record(server_ios); // PULL_ALL
+
+    // only the first half of the next record arrives
+    ring_buffer_t *rb = rb_alloc(256);
+    ck_assert_ptr_ne(rb, NULL);
+    neo4j_iostream_t *ios = neo4j_loopback_iostream(rb);
+    ck_assert_ptr_ne(ios, NULL);
+    neo4j_value_t argv[1] = { neo4j_list(NULL, 0) };
+    queue_message(ios, NEO4J_RECORD_MESSAGE, argv, 1);
+    uint8_t buf[256];
+    size_t n = rb_extract(rb, buf, sizeof(buf));
+    ck_assert_int_gt(n, 2);
+    rb_append(in_rb, buf, n / 2);
+    neo4j_ios_close(ios);
+    rb_free(rb);
+
+    ck_assert_ptr_ne(neo4j_fetch_next(results), NULL);
+    ck_assert_ptr_eq(neo4j_fetch_next(results), NULL);
+    ck_assert_int_eq(errno, NEO4J_STATEMENT_TIMEOUT);
+    ck_assert_int_eq(neo4j_check_failure(results), NEO4J_STATEMENT_TIMEOUT);
+
+    // the rest of the message can no longer be read, so the session fails
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert_ptr_eq(neo4j_run(session, "RETURN 2", neo4j_null), NULL);
+    ck_assert_int_eq(errno, NEO4J_SESSION_FAILED);
+}
+END_TEST
+
+
+START_TEST (test_send_cancels_statement_when_session_timeout_expires)
+{
+    ck_assert_int_eq(neo4j_session_set_statement_timeout(session, 1000), 0);
+
+    neo4j_result_stream_t *results = neo4j_send(session, "RETURN 1",
+            neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    ck_assert_int_eq(neo4j_check_failure(results), NEO4J_STATEMENT_TIMEOUT);
+
+    // the server completes the statement before receiving the RESET
+    queue_run_success(server_ios); // RUN
+    queue_stream_end_success(server_ios); // DISCARD_ALL
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RESET
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+
+    queue_run_success(server_ios); // RUN
+    queue_stream_end_success(server_ios); // DISCARD_ALL
+    results = neo4j_send(session, "RETURN 2", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    ck_assert_int_eq(neo4j_check_failure(results), 0);
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
+START_TEST (test_run_is_not_queued_without_pull_all)
+{
+    connection->config->session_request_queue_max_size = 3;
+    session->request_queue_size = 3;
+    ck_assert_int_eq(neo4j_session_set_statement_timeout(session, 1000), 0);
+
+    neo4j_result_stream_t *results1 =
+        neo4j_run(session, "RETURN 1", neo4j_null);
+    ck_assert_ptr_ne(results1, NULL);
+
+    // there is no room for both requests, and the deadline expires while
+    // waiting for it
+    ck_assert_ptr_eq(neo4j_run(session, "RETURN 2", neo4j_null), NULL);
+    ck_assert_int_eq(errno, NEO4J_STATEMENT_TIMEOUT);
+
+    const neo4j_value_t *argv;
+    uint16_t argc;
+    neo4j_message_type_t type = recv_message(server_ios, &mpool,
+            &argv, &argc);
+    ck_assert(type == NEO4J_RUN_MESSAGE);
+    char buf[128];
+    ck_assert_str_eq(neo4j_string_value(argv[0], buf, sizeof(buf)),
+            "RETURN 1");
+    type = recv_message(server_ios, &mpool, &argv, &argc);
+    ck_assert(type == NEO4J_PULL_ALL_MESSAGE);
+    type = recv_message(server_ios, &mpool, &argv, &argc);
+    ck_assert(type == NEO4J_RESET_MESSAGE);
+    ck_assert(rb_is_empty(out_rb));
+
+    queue_message(server_ios, NEO4J_IGNORED_MESSAGE, NULL, 0); // RUN
+    queue_message(server_ios, NEO4J_IGNORED_MESSAGE, NULL, 0); // PULL_ALL
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RESET
+    ck_assert_int_ne(neo4j_check_failure(results1), 0);
+    ck_assert_int_eq(neo4j_close_results(results1), 0);
+
+    // the session remains usable
+    neo4j_result_stream_t *results =
+        neo4j_run(session, "RETURN 3", neo4j_null);
+    ck_assert_ptr_ne(results, NULL);
+    queue_run_success(server_ios); // RUN
+    queue_stream_end_success(server_ios); // PULL_ALL
+    ck_assert_ptr_eq(neo4j_fetch_next(results), NULL);
+    ck_assert_int_eq(errno, 0);
+    ck_assert_int_eq(neo4j_close_results(results), 0);
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
 START_TEST (test_send_completes)
 {
     neo4j_result_stream_t *results = neo4j_send(session, "RETURN 1",
@@ -650,6 +960,9 @@ START_TEST (test_send_returns_failure_when_statement_fails)
 
     ck_assert_int_eq(neo4j_close_results(results), 0);
 
+    // the ACK_FAILURE is queued, and sent when the session ends
+    ck_assert_int_eq(neo4j_end_session(session), 0);
+    session = NULL;
     ck_assert(rb_is_empty(in_rb));
 }
 END_TEST
@@ -660,6 +973,8 @@ TCase* result_stream_tcase(void)
     TCase *tc = tcase_create("result stream");
     tcase_add_checked_fixture(tc, setup, teardown);
     tcase_add_test(tc, test_run_returns_results_and_completes);
+    tcase_add_test(tc, test_run_traces_request_lifecycle);
+    tcase_add_test(tc, test_run_parses_metadata_on_demand);
     tcase_add_test(tc, test_run_can_close_immediately_after_fetch);
     tcase_add_test(tc, test_run_returns_fieldnames);
     tcase_add_test(tc, test_run_returns_profile);
@@ -667,10 +982,15 @@ TCase* result_stream_tcase(void)
     tcase_add_test(tc, test_run_returns_failure_when_statement_fails);
     tcase_add_test(tc, test_run_returns_failure_during_streaming);
     tcase_add_test(tc, test_run_skips_results_after_session_close);
+    tcase_add_test(tc, test_run_parses_metadata_after_session_close);
     tcase_add_test(tc, test_run_skips_results_after_session_reset);
     tcase_add_test(tc, test_run_returns_same_failure_after_session_close);
+    tcase_add_test(tc, test_run_cancels_statement_when_timeout_expires);
     tcase_add_test(tc, test_send_completes);
     tcase_add_test(tc, test_send_returns_fieldnames);
     tcase_add_test(tc, test_send_returns_failure_when_statement_fails);
+    tcase_add_test(tc, test_run_fails_session_when_timeout_expires_mid_message);
+    tcase_add_test(tc, test_send_cancels_statement_when_session_timeout_expires);
+    tcase_add_test(tc, test_run_is_not_queued_without_pull_all);
     return tc;
 }
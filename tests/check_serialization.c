@@ -18,6 +18,7 @@
 #include "../src/lib/serialization.h"
 #include "../src/lib/iostream.h"
 #include "../src/lib/ring_buffer.h"
+#include "../src/lib/util.h"
 #include "../src/lib/values.h"
 #include "memiostream.h"
 #include <check.h>
@@ -555,6 +556,220 @@ START_TEST (serialize_list16)
 END_TEST
 
 
+START_TEST (serialize_int64_array)
+{
+    int r;
+    uint8_t buf[1024];
+    uint8_t expected[1024];
+
+    int64_t ints[] =
+            { 1, -16, -17, 127, 128, -129, 32767, 32768, -32769,
+              2147483647, 2147483648LL, INT64_MIN, INT64_MAX };
+    neo4j_value_t items[13];
+    for (int i = 0; i < 13; ++i)
+    {
+        items[i] = neo4j_int(ints[i]);
+    }
+
+    r = neo4j_serialize(neo4j_list(items, 13), ios);
+    ck_assert_int_eq(r, 0);
+    size_t len = rb_used(rb);
+    rb_extract(rb, &expected, len);
+
+    neo4j_value_t array = neo4j_int64_array(ints, 13);
+    ck_assert(neo4j_type(array) == NEO4J_LIST);
+    r = neo4j_serialize(array, ios);
+    ck_assert_int_eq(r, 0);
+    ck_assert_int_eq(rb_used(rb), len);
+
+    rb_extract(rb, &buf, len);
+    ck_assert(memcmp(buf, expected, len) == 0);
+}
+END_TEST
+
+
+START_TEST (serialize_float64_array)
+{
+    int r;
+    uint8_t buf[64];
+
+    double floats[] = { 1.0, -0.5 };
+    neo4j_value_t array = neo4j_float64_array(floats, 2);
+    uint8_t expected[] =
+            { 0x92, 0xC1, 0x3F, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+              0xC1, 0xBF, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+    r = neo4j_serialize(array, ios);
+    ck_assert_int_eq(r, 0);
+    ck_assert_int_eq(rb_used(rb), sizeof(expected));
+
+    rb_extract(rb, &buf, sizeof(expected));
+    ck_assert(memcmp(buf, expected, sizeof(expected)) == 0);
+}
+END_TEST
+
+
+START_TEST (serialize_large_int64_array)
+{
+    int r;
+    const unsigned int n = 70000;
+    ring_buffer_t *lrb = rb_alloc(2 * n);
+    neo4j_iostream_t *lios = neo4j_loopback_iostream(lrb);
+
+    int64_t *ints = calloc(n, sizeof(int64_t));
+    ck_assert_ptr_ne(ints, NULL);
+    ints[n-1] = 200;
+
+    r = neo4j_serialize(neo4j_int64_array(ints, n), lios);
+    ck_assert_int_eq(r, 0);
+    ck_assert_int_eq(rb_used(lrb), 5 + n + 2);
+
+    uint8_t header[5];
+    rb_extract(lrb, header, 5);
+    uint8_t expected_header[] = { 0xD6, 0x00, 0x01, 0x11, 0x70 };
+    ck_assert(memcmp(header, expected_header, 5) == 0);
+
+    rb_discard(lrb, n - 1);
+    uint8_t tail[3];
+    rb_extract(lrb, tail, 3);
+    uint8_t expected_tail[] = { 0xC9, 0x00, 0xC8 };
+    ck_assert(memcmp(tail, expected_tail, 3) == 0);
+
+    free(ints);
+    neo4j_ios_close(lios);
+    rb_free(lrb);
+}
+END_TEST
+
+
+struct test_producer
+{
+    struct neo4j_value_producer _producer;
+    int variant;
+};
+
+
+static int test_produce(struct neo4j_value_producer *self,
+        neo4j_value_writer_t *writer)
+{
+    struct test_producer *p = container_of(self, struct test_producer,
+            _producer);
+    switch (p->variant)
+    {
+    case 0:
+        if (neo4j_writer_begin_list(writer, 2) ||
+                neo4j_writer_begin_map(writer, 2) ||
+                neo4j_writer_key(writer, "a") ||
+                neo4j_writer_int(writer, 1000) ||
+                neo4j_writer_key(writer, "b") ||
+                neo4j_writer_string(writer, "bernie") ||
+                neo4j_writer_end(writer) ||
+                neo4j_writer_begin_list(writer, 3) ||
+                neo4j_writer_float(writer, 1.0) ||
+                neo4j_writer_bool(writer, true) ||
+                neo4j_writer_null(writer) ||
+                neo4j_writer_end(writer) ||
+                neo4j_writer_end(writer))
+        {
+            return -1;
+        }
+        return 0;
+    case 1:
+        // too few items
+        if (neo4j_writer_begin_list(writer, 2) ||
+                neo4j_writer_int(writer, 1))
+        {
+            return -1;
+        }
+        return neo4j_writer_end(writer);
+    case 2:
+        // value written where a key is expected
+        if (neo4j_writer_begin_map(writer, 1))
+        {
+            return -1;
+        }
+        return neo4j_writer_int(writer, 1);
+    default:
+        // unfinished, but producer claims success
+        return neo4j_writer_begin_list(writer, 1);
+    }
+}
+
+
+START_TEST (serialize_streamed_list)
+{
+    int r;
+    uint8_t buf[128];
+    uint8_t expected[128];
+
+    neo4j_map_entry_t entries[] =
+            { { .key = neo4j_string("a"), .value = neo4j_int(1000) },
+              { .key = neo4j_string("b"), .value = neo4j_string("bernie") } };
+    neo4j_value_t list_items[] =
+            { neo4j_float(1.0), neo4j_bool(true), neo4j_null };
+    neo4j_value_t items[] =
+            { neo4j_map(entries, 2), neo4j_list(list_items, 3) };
+
+    r = neo4j_serialize(neo4j_list(items, 2), ios);
+    ck_assert_int_eq(r, 0);
+    size_t len = rb_used(rb);
+    rb_extract(rb, &expected, len);
+
+    struct test_producer producer =
+            { ._producer.produce = test_produce, .variant = 0 };
+    neo4j_value_t value = neo4j_streamed_list(&(producer._producer));
+    ck_assert(neo4j_type(value) == NEO4J_LIST);
+    ck_assert_int_eq(neo4j_list_length(value), 0);
+
+    r = neo4j_serialize(value, ios);
+    ck_assert_int_eq(r, 0);
+    ck_assert_int_eq(rb_used(rb), len);
+
+    rb_extract(rb, &buf, len);
+    ck_assert(memcmp(buf, expected, len) == 0);
+}
+END_TEST
+
+
+START_TEST (streamed_values_tostring_truncates)
+{
+    struct test_producer producer =
+            { ._producer.produce = test_produce, .variant = 0 };
+    neo4j_value_t value = neo4j_streamed_list(&(producer._producer));
+
+    char buf[8];
+    ck_assert_str_eq(neo4j_tostring(value, buf, sizeof(buf)), "[...]");
+    ck_assert_str_eq(neo4j_tostring(value, buf, 6), "[...]");
+    ck_assert_str_eq(neo4j_tostring(value, buf, 3), "[.");
+    ck_assert_str_eq(neo4j_tostring(value, buf, 1), "");
+    ck_assert_int_eq(neo4j_ntostring(value, NULL, 0), 5);
+
+    value = neo4j_streamed_map(&(producer._producer));
+    ck_assert_str_eq(neo4j_tostring(value, buf, sizeof(buf)), "{...}");
+}
+END_TEST
+
+
+START_TEST (serialize_invalid_streamed_values)
+{
+    struct test_producer producer =
+            { ._producer.produce = test_produce, .variant = 0 };
+
+    neo4j_value_t value = neo4j_streamed_map(&(producer._producer));
+    ck_assert(neo4j_type(value) == NEO4J_MAP);
+    ck_assert_int_eq(neo4j_serialize(value, ios), -1);
+    ck_assert_int_eq(errno, EINVAL);
+
+    value = neo4j_streamed_list(&(producer._producer));
+    for (producer.variant = 1; producer.variant <= 3; ++(producer.variant))
+    {
+        ck_assert_int_eq(neo4j_serialize(value, ios), -1);
+        ck_assert_int_eq(errno, EINVAL);
+    }
+}
+END_TEST
+
+
 START_TEST (serialize_tiny_struct)
 {
     int r;
@@ -741,6 +956,12 @@ TCase* serialization_tcase(void)
     tcase_add_test(tc, serialize_tiny_list);
     tcase_add_test(tc, serialize_list8);
     tcase_add_test(tc, serialize_list16);
+    tcase_add_test(tc, serialize_int64_array);
+    tcase_add_test(tc, serialize_float64_array);
+    tcase_add_test(tc, serialize_large_int64_array);
+    tcase_add_test(tc, serialize_streamed_list);
+    tcase_add_test(tc, streamed_values_tostring_truncates);
+    tcase_add_test(tc, serialize_invalid_streamed_values);
     tcase_add_test(tc, serialize_tiny_struct);
     tcase_add_test(tc, serialize_struct8);
     tcase_add_test(tc, serialize_struct16);
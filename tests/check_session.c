@@ -16,6 +16,7 @@
  */
 #include "../config.h"
 #include "../src/lib/chunking_iostream.h"
+#include "../src/lib/client_config.h"
 #include "../src/lib/connection.h"
 #include "../src/lib/deserialization.h"
 #include "../src/lib/messages.h"
@@ -25,6 +26,7 @@
 #include "memiostream.h"
 #include <check.h>
 #include <errno.h>
+#include <unistd.h>
 
 
 struct received_response
@@ -299,12 +301,15 @@ START_TEST (test_session_sends_reset_on_reset)
     neo4j_message_type_t type = recv_message(server_ios, &mpool, &argv, &argc);
     ck_assert(type == NEO4J_INIT_MESSAGE);
     ck_assert_int_eq(argc, 2);
+    // RESET is queued, and sent with the next request or when ending
+    ck_assert(rb_is_empty(out_rb));
+
+    ck_assert_int_eq(neo4j_end_session(session), 0);
 
     type = recv_message(server_ios, &mpool, &argv, &argc);
     ck_assert(type == NEO4J_RESET_MESSAGE);
     ck_assert_int_eq(argc, 0);
-
-    neo4j_end_session(session);
+    ck_assert(rb_is_empty(in_rb));
 }
 END_TEST
 
@@ -398,9 +403,382 @@ START_TEST (test_session_drains_requests_and_acks_after_failure)
 
     type = recv_message(server_ios, &mpool, NULL, NULL);
     ck_assert(type == NEO4J_PULL_ALL_MESSAGE);
+    // ACK_FAILURE is queued, and sent with the next request or when ending
+    ck_assert(rb_is_empty(out_rb));
+
+    ck_assert_int_eq(neo4j_end_session(session), 0);
+
+    type = recv_message(server_ios, &mpool, NULL, NULL);
+    ck_assert(type == NEO4J_ACK_FAILURE_MESSAGE);
+    ck_assert(rb_is_empty(in_rb));
+}
+END_TEST
+
+
+START_TEST (test_session_sends_ack_failure_with_next_request)
+{
+    neo4j_config_set_logger_provider(connection->config, NULL);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    neo4j_message_type_t type = recv_message(server_ios, &mpool, NULL, NULL);
+    ck_assert(type == NEO4J_INIT_MESSAGE);
+
+    struct received_response resp1 = { 1, NULL };
+    int result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &resp1);
+    ck_assert_int_eq(result, 0);
+
+    queue_message(server_ios, NEO4J_FAILURE_MESSAGE, NULL, 0);
+    result = neo4j_session_sync(session, &(resp1.condition));
+    ck_assert_int_eq(result, 0);
+    ck_assert(resp1.type == NEO4J_FAILURE_MESSAGE);
+
+    type = recv_message(server_ios, &mpool, NULL, NULL);
+    ck_assert(type == NEO4J_RUN_MESSAGE);
+    ck_assert(rb_is_empty(out_rb));
+
+    struct received_response resp2 = { 1, NULL };
+    result = neo4j_session_run(session, &mpool, "RETURN 2", neo4j_null,
+            response_recv_callback, &resp2);
+    ck_assert_int_eq(result, 0);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // ACK_FAILURE
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RUN
+    result = neo4j_session_sync(session, &(resp2.condition));
+    ck_assert_int_eq(result, 0);
+    ck_assert(resp2.type == NEO4J_SUCCESS_MESSAGE);
 
     type = recv_message(server_ios, &mpool, NULL, NULL);
     ck_assert(type == NEO4J_ACK_FAILURE_MESSAGE);
+    type = recv_message(server_ios, &mpool, NULL, NULL);
+    ck_assert(type == NEO4J_RUN_MESSAGE);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_session_fails_next_request_if_reset_fails)
+{
+    neo4j_config_set_logger_provider(connection->config, NULL);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    ck_assert_int_eq(neo4j_reset_session(session), 0);
+
+    struct received_response resp = { 1, NULL };
+    int result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &resp);
+    ck_assert_int_eq(result, 0);
+
+    queue_message(server_ios, NEO4J_FAILURE_MESSAGE, NULL, 0); // RESET
+    queue_message(server_ios, NEO4J_IGNORED_MESSAGE, NULL, 0); // RUN
+    result = neo4j_session_sync(session, &(resp.condition));
+    ck_assert_int_eq(result, -1);
+    ck_assert_int_eq(errno, EPROTO);
+    ck_assert(resp.type == NEO4J_IGNORED_MESSAGE);
+
+    neo4j_end_session(session);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    session = neo4j_new_session(connection);
+    ck_assert_ptr_eq(session, NULL);
+    ck_assert_int_eq(errno, NEO4J_CONNECTION_CLOSED);
+}
+END_TEST
+
+
+START_TEST (test_session_grows_request_queue_when_full)
+{
+    connection->config->session_request_queue_max_size = 8;
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+    session->request_queue_size = 2;
+
+    struct received_response resp[6];
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        resp[i].condition = 1;
+        resp[i].type = NULL;
+        int result = neo4j_session_run(session, &mpool, "RETURN 1",
+                neo4j_null, response_recv_callback, &(resp[i]));
+        ck_assert_int_eq(result, 0);
+    }
+    ck_assert_int_eq(session->request_queue_size, 8);
+    ck_assert_int_eq(session->request_queue_depth, 6);
+    ck_assert_int_eq(session->inflight_requests, 0);
+    ck_assert_ptr_eq(connection->request_queue, session->request_queue);
+
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    }
+    int result = neo4j_session_sync(session, NULL);
+    ck_assert_int_eq(result, 0);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        ck_assert(resp[i].type == NEO4J_SUCCESS_MESSAGE);
+    }
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_session_synchronizes_when_request_queue_full)
+{
+    connection->config->session_request_queue_size = 2;
+    connection->config->session_request_queue_max_size = 2;
+    connection->request_queue_size = 2;
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    struct received_response resp[3];
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        resp[i].condition = 1;
+        resp[i].type = NULL;
+    }
+
+    int result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &(resp[0]));
+    ck_assert_int_eq(result, 0);
+    result = neo4j_session_pull_all(session, &mpool,
+            response_recv_callback, &(resp[1]));
+    ck_assert_int_eq(result, 0);
+
+    // the queue is full, so the next request awaits the first response
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    result = neo4j_session_pull_all(session, &mpool,
+            response_recv_callback, &(resp[2]));
+    ck_assert_int_eq(result, 0);
+    ck_assert(resp[0].type == NEO4J_SUCCESS_MESSAGE);
+    ck_assert_int_eq(session->request_queue_size, 2);
+    ck_assert_int_le(session->request_queue_depth, 2);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    result = neo4j_session_sync(session, NULL);
+    ck_assert_int_eq(result, 0);
+    ck_assert(resp[1].type == NEO4J_SUCCESS_MESSAGE);
+    ck_assert(resp[2].type == NEO4J_SUCCESS_MESSAGE);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_session_pipeline_window_is_fixed_by_default)
+{
+    neo4j_config_set_max_pipelined_requests(connection->config, 42);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    ck_assert_int_eq(neo4j_session_pipeline_window(session), 42);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_session_adapts_pipeline_window_to_response_size)
+{
+    neo4j_config_set_max_pipelined_requests(connection->config, 32);
+    neo4j_config_set_adaptive_pipelining(connection->config, true);
+    connection->config->pipeline_response_budget = 64;
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+    unsigned int window = neo4j_session_pipeline_window(session);
+    ck_assert_int_ge(window, 1);
+    ck_assert_int_le(window, 32);
+
+    neo4j_map_entry_t entry = neo4j_map_entry("fields", neo4j_string(
+            "a response that is large relative to the budget"));
+    neo4j_value_t metadata = neo4j_map(&entry, 1);
+
+    struct received_response resp[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        resp[i].condition = 1;
+        resp[i].type = NULL;
+        int result = neo4j_session_run(session, &mpool, "RETURN 1",
+                neo4j_null, response_recv_callback, &(resp[i]));
+        ck_assert_int_eq(result, 0);
+        queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, &metadata, 1);
+    }
+
+    int result = neo4j_session_sync(session, NULL);
+    ck_assert_int_eq(result, 0);
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        ck_assert(resp[i].type == NEO4J_SUCCESS_MESSAGE);
+    }
+
+    ck_assert_int_lt(neo4j_session_pipeline_window(session), window);
+    ck_assert_int_ge(neo4j_session_pipeline_window(session), 1);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_session_grows_adaptive_pipeline_window)
+{
+    neo4j_config_set_adaptive_pipelining(connection->config, true);
+    // the INIT response is then delayed like the others
+    neo4j_config_set_pipelined_init(connection->config, true);
+
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+    unsigned int window = neo4j_session_pipeline_window(session);
+    ck_assert_int_eq(window, NEO4J_DEFAULT_MAX_PIPELINED_REQUESTS);
+
+    // every response takes about the same time, as over a high-latency
+    // link where requests are not queueing at the server
+    for (unsigned int i = 0; i < 20; ++i)
+    {
+        struct received_response resp = { .condition = 1, .type = NULL };
+        int result = neo4j_session_run(session, &mpool, "RETURN 1",
+                neo4j_null, response_recv_callback, &resp);
+        ck_assert_int_eq(result, 0);
+        ck_assert_int_eq(neo4j_session_flush(session), 0);
+        usleep(5000);
+        if (i == 0)
+        {
+            queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // INIT
+        }
+        queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+        ck_assert_int_eq(neo4j_session_sync(session, &(resp.condition)), 0);
+        ck_assert(resp.type == NEO4J_SUCCESS_MESSAGE);
+        rb_clear(out_rb);
+    }
+
+    ck_assert_int_gt(neo4j_session_pipeline_window(session), window);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_session_measures_reset_round_trip_from_send)
+{
+    neo4j_config_set_adaptive_pipelining(connection->config, true);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // INIT
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    // the first RESET is queued, and sent by the second
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RESET
+    ck_assert_int_eq(neo4j_reset_session(session), 0);
+    ck_assert_int_eq(neo4j_reset_session(session), 0);
+    ck_assert(rb_is_empty(in_rb));
+    // a round-trip measured from an unset send time would span the uptime,
+    // and shrink the pipeline window after every reset
+    ck_assert(session->srtt > 0);
+    ck_assert(session->srtt < 1000000000);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RESET
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_pipelined_init_is_sent_with_first_request)
+{
+    neo4j_config_set_pipelined_init(connection->config, true);
+
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+    ck_assert(rb_is_empty(out_rb));
+
+    struct received_response resp = { 1, NULL };
+    int result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &resp);
+    ck_assert_int_eq(result, 0);
+
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // INIT
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0); // RUN
+    result = neo4j_session_sync(session, &(resp.condition));
+    ck_assert_int_eq(result, 0);
+    ck_assert(resp.type == NEO4J_SUCCESS_MESSAGE);
+
+    const neo4j_value_t *argv;
+    uint16_t argc;
+    neo4j_message_type_t type =
+        recv_message(server_ios, &mpool, &argv, &argc);
+    ck_assert(type == NEO4J_INIT_MESSAGE);
+    ck_assert_int_eq(argc, 2);
+    ck_assert(neo4j_eq(neo4j_map_get(argv[1], "principal"),
+                neo4j_string("user")));
+    ck_assert(neo4j_eq(neo4j_map_get(argv[1], "credentials"),
+                neo4j_string("pass")));
+    type = recv_message(server_ios, &mpool, NULL, NULL);
+    ck_assert(type == NEO4J_RUN_MESSAGE);
+
+    neo4j_end_session(session);
+}
+END_TEST
+
+
+START_TEST (test_new_session_rejects_over_long_password)
+{
+    neo4j_config_set_logger_provider(connection->config, NULL);
+    char password[2048];
+    memset(password, 'x', sizeof(password) - 1);
+    password[sizeof(password) - 1] = '\0';
+    ck_assert_int_eq(
+            neo4j_config_set_password(connection->config, password), 0);
+
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_eq(session, NULL);
+    ck_assert_int_eq(errno, NEO4J_INVALID_CREDENTIALS);
+    ck_assert(rb_is_empty(out_rb));
+}
+END_TEST
+
+
+START_TEST (test_pipelined_init_failure_fails_first_request)
+{
+    neo4j_config_set_logger_provider(connection->config, NULL);
+    neo4j_config_set_pipelined_init(connection->config, true);
+
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    struct received_response resp = { 1, NULL };
+    int result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &resp);
+    ck_assert_int_eq(result, 0);
+
+    neo4j_map_entry_t failure_metadata[] =
+        { neo4j_map_entry("code",
+                neo4j_string("Neo.ClientError.Security.Unauthorized")),
+          neo4j_map_entry("message", neo4j_string("Invalid credentials")) };
+    neo4j_value_t failure = neo4j_map(failure_metadata, 2);
+    queue_message(server_ios, NEO4J_FAILURE_MESSAGE, &failure, 1); // INIT
+    result = neo4j_session_sync(session, &(resp.condition));
+    ck_assert_int_eq(result, -1);
+    ck_assert_int_eq(errno, NEO4J_INVALID_CREDENTIALS);
+    ck_assert(resp.type == NEO4J_IGNORED_MESSAGE);
+
+    result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &resp);
+    ck_assert_int_eq(result, -1);
+    ck_assert_int_eq(errno, NEO4J_SESSION_FAILED);
 
     neo4j_end_session(session);
 }
@@ -465,12 +843,14 @@ START_TEST (test_session_cant_start_after_eproto_in_ack_failure)
     queue_message(server_ios, NEO4J_IGNORED_MESSAGE, NULL, 0);
     queue_message(server_ios, NEO4J_FAILURE_MESSAGE, NULL, 0);
     result = neo4j_session_sync(session1, NULL);
-    ck_assert_int_eq(result, -1);
-    ck_assert_int_eq(errno, EPROTO);
+    ck_assert_int_eq(result, 0);
     ck_assert(resp1.type == NEO4J_FAILURE_MESSAGE);
     ck_assert(resp2.type == NEO4J_IGNORED_MESSAGE);
 
-    neo4j_end_session(session1);
+    // the queued ACK_FAILURE is sent when ending the session
+    result = neo4j_end_session(session1);
+    ck_assert_int_eq(result, -1);
+    ck_assert_int_eq(errno, EPROTO);
 
     queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
     neo4j_session_t *session2 = neo4j_new_session(connection);
@@ -506,11 +886,15 @@ START_TEST (test_session_drains_acks_when_closed)
     // no queued response for the ACK_FAILURE => connection closed
 
     result = neo4j_session_sync(session, &(resp1.condition));
-    ck_assert_int_eq(result, -1);
-    ck_assert_int_eq(errno, NEO4J_CONNECTION_CLOSED);
+    ck_assert_int_eq(result, 0);
     ck_assert(resp1.type == NEO4J_FAILURE_MESSAGE);
     ck_assert(resp2.type == NEO4J_IGNORED_MESSAGE);
 
+    // the queued ACK_FAILURE is sent when ending the session
+    result = neo4j_end_session(session);
+    ck_assert_int_eq(result, -1);
+    ck_assert_int_eq(errno, NEO4J_CONNECTION_CLOSED);
+
     type = recv_message(server_ios, &mpool, NULL, NULL);
     ck_assert(type == NEO4J_RUN_MESSAGE);
 
@@ -519,6 +903,60 @@ START_TEST (test_session_drains_acks_when_closed)
 
     type = recv_message(server_ios, &mpool, NULL, NULL);
     ck_assert(type == NEO4J_ACK_FAILURE_MESSAGE);
+}
+END_TEST
+
+
+START_TEST (test_session_records_request_stats)
+{
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    neo4j_session_t *session = neo4j_new_session(connection);
+    ck_assert_ptr_ne(session, NULL);
+
+    struct neo4j_connection_stats cstats;
+    ck_assert_int_eq(neo4j_connection_stats(connection, &cstats), 0);
+    ck_assert_int_eq(cstats.messages_sent, 1);
+    ck_assert_int_eq(cstats.messages_received, 1);
+    unsigned long long bytes_received = cstats.bytes_received;
+
+    struct received_response resp1 = { 1, NULL };
+    int result = neo4j_session_run(session, &mpool, "RETURN 1", neo4j_null,
+            response_recv_callback, &resp1);
+    ck_assert_int_eq(result, 0);
+    struct received_response resp2 = { 1, NULL };
+    result = neo4j_session_run(session, &mpool, "RETURN 2", neo4j_null,
+            response_recv_callback, &resp2);
+    ck_assert_int_eq(result, 0);
+
+    struct neo4j_session_stats sstats;
+    ck_assert_int_eq(neo4j_session_stats(session, &sstats), 0);
+    ck_assert_int_eq(sstats.request_queue_depth, 2);
+    ck_assert_int_eq(sstats.max_request_queue_depth, 2);
+    ck_assert_int_eq(sstats.inflight_requests, 0);
+
+    size_t queued = rb_used(in_rb);
+    queue_message(server_ios, NEO4J_SUCCESS_MESSAGE, NULL, 0);
+    queue_message(server_ios, NEO4J_IGNORED_MESSAGE, NULL, 0);
+    queued = rb_used(in_rb) - queued;
+
+    result = neo4j_session_sync(session, NULL);
+    ck_assert_int_eq(result, 0);
+    ck_assert(resp2.type == NEO4J_IGNORED_MESSAGE);
+
+    ck_assert_int_eq(neo4j_session_stats(session, &sstats), 0);
+    ck_assert_int_eq(sstats.requests, 3);
+    ck_assert_int_eq(sstats.failed_requests, 1);
+    ck_assert_int_eq(sstats.request_queue_depth, 0);
+    ck_assert_int_eq(sstats.request_latency.count, 3);
+
+    ck_assert_int_eq(neo4j_connection_stats(connection, &cstats), 0);
+    ck_assert_int_eq(cstats.messages_sent, 3);
+    ck_assert_int_eq(cstats.messages_received, 3);
+    ck_assert_int_eq(cstats.chunks_received, 3);
+    ck_assert_int_eq(cstats.bytes_received - bytes_received, queued);
+    ck_assert_int_eq(cstats.bytes_sent, rb_used(out_rb));
+    ck_assert_int_gt(cstats.reads, 0);
+    ck_assert_int_gt(cstats.writes, 0);
 
     neo4j_end_session(session);
 }
@@ -541,8 +979,20 @@ TCase* session_tcase(void)
     tcase_add_test(tc, test_session_drains_outstanding_requests_on_reset);
     tcase_add_test(tc, test_session_awaits_inflight_requests_on_reset);
     tcase_add_test(tc, test_session_drains_requests_and_acks_after_failure);
+    tcase_add_test(tc, test_session_sends_ack_failure_with_next_request);
+    tcase_add_test(tc, test_session_fails_next_request_if_reset_fails);
+    tcase_add_test(tc, test_session_grows_request_queue_when_full);
+    tcase_add_test(tc, test_session_synchronizes_when_request_queue_full);
+    tcase_add_test(tc, test_session_pipeline_window_is_fixed_by_default);
+    tcase_add_test(tc, test_session_adapts_pipeline_window_to_response_size);
+    tcase_add_test(tc, test_session_grows_adaptive_pipeline_window);
+    tcase_add_test(tc, test_session_measures_reset_round_trip_from_send);
+    tcase_add_test(tc, test_pipelined_init_is_sent_with_first_request);
+    tcase_add_test(tc, test_pipelined_init_failure_fails_first_request);
+    tcase_add_test(tc, test_new_session_rejects_over_long_password);
     tcase_add_test(tc, test_session_cant_start_after_eproto_in_failure);
     tcase_add_test(tc, test_session_cant_start_after_eproto_in_ack_failure);
     tcase_add_test(tc, test_session_drains_acks_when_closed);
+    tcase_add_test(tc, test_session_records_request_stats);
     return tc;
 }
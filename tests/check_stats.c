@@ -0,0 +1,183 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "../src/lib/neo4j-client.h"
+#include "../src/lib/stats.h"
+#include "memstream.h"
+#include <check.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static FILE *memstream;
+static char *memstream_buffer;
+static size_t memstream_size;
+
+
+static void setup(void)
+{
+    memstream = open_memstream(&memstream_buffer, &memstream_size);
+    ck_assert(memstream != NULL);
+}
+
+
+static void teardown(void)
+{
+    fclose(memstream);
+    free(memstream_buffer);
+}
+
+
+START_TEST (test_latency_buckets_cover_recorded_latencies)
+{
+    ck_assert_int_eq(neo4j_latency_bucket_bound(0), 1);
+    ck_assert_int_eq(neo4j_latency_bucket_bound(3), 4);
+    ck_assert_int_eq(neo4j_latency_bucket_bound(7), 8);
+    ck_assert_int_eq(neo4j_latency_bucket_bound(8), 10);
+    ck_assert_int_eq(neo4j_latency_bucket_bound(11), 16);
+    ck_assert_int_eq(neo4j_latency_bucket_bound(12), 20);
+
+    for (uint64_t us = 0; us < 100000; ++us)
+    {
+        unsigned int index = neo4j_latency_bucket(us);
+        ck_assert_int_lt(us, neo4j_latency_bucket_bound(index));
+        if (index > 0)
+        {
+            ck_assert_int_ge(us, neo4j_latency_bucket_bound(index - 1));
+        }
+    }
+
+    ck_assert_int_eq(neo4j_latency_bucket(UINT64_MAX),
+            NEO4J_LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+END_TEST
+
+
+START_TEST (test_latency_histogram_records_count_sum_and_max)
+{
+    struct neo4j_latency_histogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    neo4j_latency_record(&histogram, 2500);
+    neo4j_latency_record(&histogram, 1000000);
+    neo4j_latency_record(&histogram, 999);
+
+    ck_assert_int_eq(histogram.count, 3);
+    ck_assert_int_eq(histogram.sum, 1002);
+    ck_assert_int_eq(histogram.max, 1000);
+    ck_assert_int_eq(histogram.buckets[0], 1);
+    ck_assert_int_eq(histogram.buckets[2], 1);
+    ck_assert_int_eq(histogram.buckets[neo4j_latency_bucket(1000)], 1);
+}
+END_TEST
+
+
+START_TEST (test_latency_percentiles)
+{
+    struct neo4j_latency_histogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    ck_assert_int_eq(neo4j_latency_percentile(&histogram, 50), 0);
+
+    for (unsigned int i = 0; i < 90; ++i)
+    {
+        neo4j_latency_record(&histogram, 6000);
+    }
+    for (unsigned int i = 0; i < 10; ++i)
+    {
+        neo4j_latency_record(&histogram, 150000);
+    }
+
+    ck_assert_int_eq(neo4j_latency_percentile(&histogram, 0), 7);
+    ck_assert_int_eq(neo4j_latency_percentile(&histogram, 50), 7);
+    ck_assert_int_eq(neo4j_latency_percentile(&histogram, 90), 7);
+    unsigned long long p99 = neo4j_latency_percentile(&histogram, 99);
+    ck_assert_int_eq(p99, 150);
+    ck_assert_int_eq(neo4j_latency_percentile(&histogram, 100), 150);
+}
+END_TEST
+
+
+START_TEST (test_fprint_connection_stats)
+{
+    struct neo4j_connection_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.bytes_sent = 42;
+    stats.messages_received = 7;
+
+    ck_assert_int_eq(neo4j_fprint_connection_stats(memstream, &stats), 0);
+    fflush(memstream);
+
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "# TYPE neo4j_client_connection_sent_bytes_total counter\n"
+            "neo4j_client_connection_sent_bytes_total 42\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "neo4j_client_connection_received_messages_total 7\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "neo4j_client_connection_reads_total 0\n"), NULL);
+}
+END_TEST
+
+
+START_TEST (test_fprint_session_stats)
+{
+    struct neo4j_session_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.requests = 3;
+    stats.request_queue_depth = 2;
+    neo4j_latency_record(&(stats.request_latency), 3000);
+    neo4j_latency_record(&(stats.request_latency), 1500000);
+    neo4j_latency_record(&(stats.request_latency), 1500000);
+
+    ck_assert_int_eq(neo4j_fprint_session_stats(memstream, &stats), 0);
+    fflush(memstream);
+
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "neo4j_client_session_requests_total 3\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "# TYPE neo4j_client_session_request_queue_depth gauge\n"
+            "neo4j_client_session_request_queue_depth 2\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "# TYPE neo4j_client_session_request_latency_seconds histogram\n"
+            "neo4j_client_session_request_latency_seconds_bucket{le=\"1e-06\"}"
+            " 0\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "neo4j_client_session_request_latency_seconds_bucket{le=\"4e-06\"}"
+            " 1\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "neo4j_client_session_request_latency_seconds_bucket{le=\"0.002048\"}"
+            " 3\n"), NULL);
+    ck_assert_ptr_ne(strstr(memstream_buffer,
+            "neo4j_client_session_request_latency_seconds_bucket{le=\"+Inf\"}"
+            " 3\n"
+            "neo4j_client_session_request_latency_seconds_sum 0.003003\n"
+            "neo4j_client_session_request_latency_seconds_count 3\n"), NULL);
+}
+END_TEST
+
+
+TCase* stats_tcase(void)
+{
+    TCase *tc = tcase_create("stats");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, test_latency_buckets_cover_recorded_latencies);
+    tcase_add_test(tc, test_latency_histogram_records_count_sum_and_max);
+    tcase_add_test(tc, test_latency_percentiles);
+    tcase_add_test(tc, test_fprint_connection_stats);
+    tcase_add_test(tc, test_fprint_session_stats);
+    return tc;
+}
@@ -0,0 +1,313 @@
+/* vi:set ts=4 sw=4 expandtab:
+ *
+ * Copyright 2016, Chris Leishman (http://github.com/cleishm)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../config.h"
+#include "../src/lib/uring_iostream.h"
+#include "../src/lib/iostream.h"
+#include "../src/lib/posix_iostream.h"
+#include "../src/lib/thread.h"
+#include "../src/lib/uring.h"
+#include <check.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define PING_PONG_ROUNDS 2000
+
+
+static int fds[2];
+static neo4j_iostream_t *ios;
+
+
+static void setup(void)
+{
+    ck_assert_int_eq(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ios = neo4j_uring_iostream(fds[0]);
+    if (ios == NULL)
+    {
+        // io_uring is unavailable on this platform or kernel
+        ck_assert(errno == ENOTSUP || errno == ENOSYS || errno == EPERM);
+        close(fds[0]);
+    }
+}
+
+
+static void teardown(void)
+{
+    if (ios != NULL)
+    {
+        neo4j_ios_close(ios);
+    }
+    close(fds[1]);
+}
+
+
+START_TEST (read_returns_available_bytes)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    ck_assert_int_eq(write(fds[1], "0123", 4), 4);
+
+    char buf[8];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, sizeof(buf)), 4);
+    ck_assert(memcmp(buf, "0123", 4) == 0);
+
+    ck_assert_int_eq(write(fds[1], "4567", 4), 4);
+    struct iovec iov[2] = { { .iov_base = buf, .iov_len = 1 },
+            { .iov_base = buf + 1, .iov_len = 7 } };
+    ck_assert_int_eq(neo4j_ios_readv(ios, iov, 2), 4);
+    ck_assert(memcmp(buf, "4567", 4) == 0);
+}
+END_TEST
+
+
+START_TEST (read_serves_bytes_read_ahead)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    ck_assert_int_eq(write(fds[1], "01234567", 8), 8);
+
+    char buf[4];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, 3), 3);
+    ck_assert(memcmp(buf, "012", 3) == 0);
+    ck_assert_int_eq(neo4j_ios_wait(ios, 0), 0);
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, 4), 4);
+    ck_assert(memcmp(buf, "3456", 4) == 0);
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, 4), 1);
+    ck_assert(memcmp(buf, "7", 1) == 0);
+}
+END_TEST
+
+
+START_TEST (read_returns_zero_at_end_of_stream)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    ck_assert_int_eq(shutdown(fds[1], SHUT_WR), 0);
+
+    char buf[8];
+    ck_assert_int_eq(neo4j_ios_read(ios, buf, sizeof(buf)), 0);
+}
+END_TEST
+
+
+START_TEST (writes_are_sent_on_flush)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    struct iovec iov[2] = { { .iov_base = "0123", .iov_len = 4 },
+            { .iov_base = "4567", .iov_len = 4 } };
+    ck_assert_int_eq(neo4j_ios_writev(ios, iov, 2), 8);
+    ck_assert_int_eq(neo4j_ios_flush(ios), 0);
+
+    char buf[16];
+    ck_assert_int_eq(read(fds[1], buf, sizeof(buf)), 8);
+    ck_assert(memcmp(buf, "01234567", 8) == 0);
+}
+END_TEST
+
+
+START_TEST (large_writes_are_sent_in_parts)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    size_t n = 3 * 16384 + 100;
+    uint8_t *data = malloc(n);
+    ck_assert_ptr_ne(data, NULL);
+    for (size_t i = 0; i < n; ++i)
+    {
+        data[i] = (uint8_t)i;
+    }
+    // the socket buffer holds it all, so the writes complete
+    int sndbuf = n * 2;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &sndbuf, sizeof(sndbuf));
+
+    ck_assert_int_eq(neo4j_ios_write_all(ios, data, n, NULL), 0);
+    ck_assert_int_eq(neo4j_ios_flush(ios), 0);
+
+    uint8_t *received = malloc(n);
+    ck_assert_ptr_ne(received, NULL);
+    size_t nreceived = 0;
+    while (nreceived < n)
+    {
+        ssize_t result = read(fds[1], received + nreceived, n - nreceived);
+        ck_assert_int_gt(result, 0);
+        nreceived += result;
+    }
+    ck_assert(memcmp(received, data, n) == 0);
+    free(received);
+    free(data);
+}
+END_TEST
+
+
+START_TEST (slots_are_released_on_close)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    // more streams than there are slots, if the slots were not released
+    for (int i = 0; i < 512; ++i)
+    {
+        int pair[2];
+        ck_assert_int_eq(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+        neo4j_iostream_t *other = neo4j_uring_iostream(pair[0]);
+        ck_assert_ptr_ne(other, NULL);
+        ck_assert_int_eq(neo4j_ios_write(other, "0", 1), 1);
+        ck_assert_int_eq(neo4j_ios_close(other), 0);
+        close(pair[1]);
+    }
+}
+END_TEST
+
+
+START_TEST (in_flight_read_is_cancelled)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    neo4j_uring_t *ring = neo4j_uring_shared();
+    ck_assert_ptr_ne(ring, NULL);
+    uint8_t *slot = neo4j_uring_alloc_slot(ring);
+    ck_assert_ptr_ne(slot, NULL);
+
+    // nothing is written to the pair, so the read cannot complete
+    struct neo4j_uring_op op;
+    struct neo4j_uring_op cancel_op;
+    ck_assert_int_eq(neo4j_uring_queue_read(ring, &op, fds[1],
+                slot, NEO4J_URING_SLOT_SIZE), 0);
+    ck_assert_int_eq(neo4j_uring_cancel(ring, &op, &cancel_op), 0);
+    ck_assert(op.done);
+    ck_assert_int_eq(op.result, -ECANCELED);
+    ck_assert(cancel_op.done);
+    neo4j_uring_free_slot(ring, slot);
+}
+END_TEST
+
+
+struct replier
+{
+    neo4j_iostream_t *ios;
+    int failures;
+};
+
+
+static void *reply(void *data)
+{
+    struct replier *replier = data;
+    for (int i = 0; i < PING_PONG_ROUNDS; ++i)
+    {
+        char c;
+        if (neo4j_ios_read(replier->ios, &c, 1) != 1 ||
+                neo4j_ios_write(replier->ios, &c, 1) != 1 ||
+                neo4j_ios_flush(replier->ios))
+        {
+            (replier->failures)++;
+            break;
+        }
+    }
+    return NULL;
+}
+
+
+START_TEST (concurrent_reads_share_the_ring)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    // each connection reads on the ring from its own thread, so that one
+    // waits in the kernel while the other waits on it. Both are driven in
+    // lockstep, so neither can complete a round should the other miss its
+    // completion.
+    int peers[2];
+    struct replier repliers[2];
+    neo4j_thread_t threads[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        int pair[2];
+        ck_assert_int_eq(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+        peers[i] = pair[1];
+        repliers[i].ios = neo4j_uring_iostream(pair[0]);
+        ck_assert_ptr_ne(repliers[i].ios, NULL);
+        repliers[i].failures = 0;
+        ck_assert_int_eq(neo4j_thread_create(&(threads[i]), reply,
+                    &(repliers[i])), 0);
+    }
+
+    for (int i = 0; i < PING_PONG_ROUNDS; ++i)
+    {
+        char c = (char)i;
+        ck_assert_int_eq(write(peers[0], &c, 1), 1);
+        ck_assert_int_eq(write(peers[1], &c, 1), 1);
+        for (int j = 0; j < 2; ++j)
+        {
+            ck_assert_int_eq(read(peers[j], &c, 1), 1);
+            ck_assert_int_eq(c, (char)i);
+        }
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        neo4j_thread_join(threads[i]);
+        ck_assert_int_eq(repliers[i].failures, 0);
+        ck_assert_int_eq(neo4j_ios_close(repliers[i].ios), 0);
+        close(peers[i]);
+    }
+}
+END_TEST
+
+
+START_TEST (fd_is_not_available_for_uring_iostreams)
+{
+    if (ios == NULL)
+    {
+        return;
+    }
+    ck_assert_int_eq(neo4j_posix_iostream_fd(ios), -1);
+    ck_assert_int_eq(errno, EINVAL);
+}
+END_TEST
+
+
+TCase* uring_iostream_tcase(void)
+{
+    TCase *tc = tcase_create("uring_iostream");
+    tcase_add_checked_fixture(tc, setup, teardown);
+    tcase_add_test(tc, read_returns_available_bytes);
+    tcase_add_test(tc, read_serves_bytes_read_ahead);
+    tcase_add_test(tc, read_returns_zero_at_end_of_stream);
+    tcase_add_test(tc, writes_are_sent_on_flush);
+    tcase_add_test(tc, large_writes_are_sent_in_parts);
+    tcase_add_test(tc, slots_are_released_on_close);
+    tcase_add_test(tc, in_flight_read_is_cancelled);
+    tcase_add_test(tc, concurrent_reads_share_the_ring);
+    tcase_add_test(tc, fd_is_not_available_for_uring_iostreams);
+    return tc;
+}
@@ -337,6 +337,72 @@ START_TEST (list_eq)
 END_TEST
 
 
+START_TEST (int64_array_value)
+{
+    int64_t ints[] = { 1, -2, 300 };
+    neo4j_value_t value = neo4j_int64_array(ints, 3);
+    ck_assert(neo4j_type(value) == NEO4J_LIST);
+    ck_assert_int_eq(neo4j_list_length(value), 3);
+    ck_assert(neo4j_eq(neo4j_list_get(value, 2), neo4j_int(300)));
+    ck_assert(neo4j_is_null(neo4j_list_get(value, 3)));
+
+    char *str = neo4j_tostring(value, buf, sizeof(buf));
+    ck_assert_str_eq(str, "[1,-2,300]");
+    ck_assert_int_eq(neo4j_ntostring(value, buf, 5), 10);
+    ck_assert_str_eq(buf, "[1,-");
+
+    ck_assert(neo4j_fprint(value, memstream) == 10);
+    fflush(memstream);
+    ck_assert_str_eq(memstream_buffer, "[1,-2,300]");
+
+    value = neo4j_int64_array(ints, 0);
+    str = neo4j_tostring(value, buf, sizeof(buf));
+    ck_assert_str_eq(str, "[]");
+}
+END_TEST
+
+
+START_TEST (float64_array_value)
+{
+    double floats[] = { 1.5, -2.25 };
+    neo4j_value_t value = neo4j_float64_array(floats, 2);
+    ck_assert(neo4j_type(value) == NEO4J_LIST);
+    ck_assert_int_eq(neo4j_list_length(value), 2);
+    ck_assert(neo4j_eq(neo4j_list_get(value, 1), neo4j_float(-2.25)));
+
+    char *str = neo4j_tostring(value, buf, sizeof(buf));
+    ck_assert_str_eq(str, "[1.500000,-2.250000]");
+}
+END_TEST
+
+
+START_TEST (array_eq)
+{
+    int64_t ints1[] = { 1, 2 };
+    int64_t ints2[] = { 1, 2 };
+    int64_t ints3[] = { 1, 3 };
+    double floats[] = { 1.0, 2.0 };
+    neo4j_value_t list_values[] = { neo4j_int(1), neo4j_int(2) };
+
+    neo4j_value_t value1 = neo4j_int64_array(ints1, 2);
+    neo4j_value_t value2 = neo4j_int64_array(ints2, 2);
+    neo4j_value_t value3 = neo4j_int64_array(ints3, 2);
+    neo4j_value_t value4 = neo4j_list(list_values, 2);
+    neo4j_value_t value5 = neo4j_float64_array(floats, 2);
+
+    ck_assert(neo4j_eq(value1, value2));
+    ck_assert(!neo4j_eq(value1, value3));
+    ck_assert(!neo4j_eq(value3, value1));
+    ck_assert(neo4j_eq(value1, value4));
+    ck_assert(neo4j_eq(value4, value1));
+    ck_assert(!neo4j_eq(value3, value4));
+    ck_assert(!neo4j_eq(value4, value3));
+    ck_assert(!neo4j_eq(value1, value5));
+    ck_assert(!neo4j_eq(value5, value4));
+}
+END_TEST
+
+
 START_TEST (map_value)
 {
     neo4j_map_entry_t map_entries[] =
@@ -1041,6 +1107,9 @@ TCase* values_tcase(void)
     tcase_add_test(tc, string_eq);
     tcase_add_test(tc, list_value);
     tcase_add_test(tc, list_eq);
+    tcase_add_test(tc, int64_array_value);
+    tcase_add_test(tc, float64_array_value);
+    tcase_add_test(tc, array_eq);
     tcase_add_test(tc, map_value);
     tcase_add_test(tc, invalid_map_value);
     tcase_add_test(tc, map_eq);
@@ -22,7 +22,7 @@
 
 
 struct memiostream {
-    neo4j_iostream_t iostream;
+    struct neo4j_waitable_iostream iostream;
     ring_buffer_t *inbuffer;
     ring_buffer_t *outbuffer;
 };
@@ -36,6 +36,7 @@ static ssize_t memios_writev(neo4j_iostream_t *stream,
         const struct iovec *iov, unsigned int iovcnt);
 static int memios_flush(neo4j_iostream_t *stream);
 static int memios_close(neo4j_iostream_t *stream);
+static int memios_wait(neo4j_iostream_t *stream, unsigned int timeout);
 
 
 neo4j_iostream_t *neo4j_memiostream(ring_buffer_t *inbuffer,
@@ -52,12 +53,12 @@ neo4j_iostream_t *neo4j_memiostream(ring_buffer_t *inbuffer,
 
     ios->inbuffer = inbuffer;
     ios->outbuffer = outbuffer;
-    ios->iostream.read = memios_read;
-    ios->iostream.readv = memios_readv;
-    ios->iostream.write = memios_write;
-    ios->iostream.writev = memios_writev;
-    ios->iostream.flush = memios_flush;
-    ios->iostream.close = memios_close;
+    neo4j_waitable_ios_init(&(ios->iostream), memios_close, memios_wait);
+    ios->iostream._iostream.read = memios_read;
+    ios->iostream._iostream.readv = memios_readv;
+    ios->iostream._iostream.write = memios_write;
+    ios->iostream._iostream.writev = memios_writev;
+    ios->iostream._iostream.flush = memios_flush;
     return (neo4j_iostream_t *)ios;
 }
 
@@ -134,3 +135,21 @@ int memios_close(neo4j_iostream_t *stream)
     free(ios);
     return 0;
 }
+
+
+int memios_wait(neo4j_iostream_t *stream, unsigned int timeout)
+{
+    struct memiostream *ios = (struct memiostream *)stream;
+    if (ios->inbuffer == NULL)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+    // nothing further can arrive in the buffer whilst waiting
+    if (rb_is_empty(ios->inbuffer))
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}